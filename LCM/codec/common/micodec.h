@@ -29,6 +29,7 @@
 #define _mi_codec_h
 
 #include <MI.h>
+#include <stdio.h>
 
 #if !defined(_MSC_VER)
 #include <common/linux/sal.h>
@@ -567,6 +568,16 @@ MI_Result MI_MAIN_CALL MI_Application_NewDeserializer_Mof(
     _In_z_ MI_Char *format, 
     _Out_ MI_Deserializer *deserializer);
 
+/* Writes instance to file in one pass, without sizing it or buffering it
+   whole first. bytesWritten receives the number of bytes written, also on
+   failure. */
+MI_Result MI_MAIN_CALL MI_Serializer_SerializeInstanceToFile_Mof(
+    _Inout_ MI_Serializer *serializer,
+    MI_Uint32 flags,
+    _In_ const MI_Instance *instance,
+    _Inout_ FILE *file,
+    _Out_opt_ MI_Uint64 *bytesWritten);
+
 MI_Result MI_MAIN_CALL MI_Application_NewSerializer_Binary(
     _Inout_ MI_Application *application, 
     MI_Uint32 flags,
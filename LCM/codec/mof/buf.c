@@ -44,10 +44,43 @@ MI_Result Buf_Construct(
     self->size = 0;
     self->capacity = capacity;
     self->owner = 0;
+    self->sink = NULL;
+    self->sinkContext = NULL;
 
     return MI_RESULT_OK;
 }
 
+MI_Result Buf_ConstructSink(
+    _Out_ Buf* self,
+    _Inout_updates_(capacity) MI_Char* data,
+    size_t capacity,
+    _In_ MI_Result (*sink)(void* sinkContext, const MI_Char* data, size_t size),
+    _In_opt_ void* sinkContext)
+{
+    if (!data || capacity == 0 || !sink)
+        return MI_RESULT_FAILED;
+
+    Buf_Construct(self, data, capacity);
+    self->sink = sink;
+    self->sinkContext = sinkContext;
+
+    return MI_RESULT_OK;
+}
+
+MI_Result Buf_Flush(
+    _Inout_ Buf* self)
+{
+    MI_Result r = MI_RESULT_OK;
+
+    if (self->sink && self->size > 0)
+    {
+        r = self->sink(self->sinkContext, self->data, self->size);
+        self->size = 0;
+    }
+
+    return r;
+}
+
 void Buf_Destruct(
     _Inout_ Buf* self)
 {
@@ -60,6 +93,20 @@ MI_Result Buf_Put(
     _In_reads_(size) const MI_Char* data,
     size_t size)
 {
+    /* A sink buffer is written out instead, and data that still does not
+     * fit goes to the sink directly */
+
+    if (self->sink && self->size + size > self->capacity)
+    {
+        MI_Result r = Buf_Flush(self);
+
+        if (r != MI_RESULT_OK)
+            return r;
+
+        if (size > self->capacity)
+            return self->sink(self->sinkContext, data, size);
+    }
+
     /* If allocation is too small, then enlarge it */
 
     if (self->size + size > self->capacity)
@@ -19,6 +19,9 @@
 
 #include <MI.h>
 
+/* Capacity, in characters, of the chunk a sink buffer is written out in */
+#define BUF_SINK_CHUNK_SIZE 4096
+
 typedef struct Buf
 {
     /* Pointer to data buffer */
@@ -32,6 +35,10 @@ typedef struct Buf
 
     /* Non-zero if Buf instance owns the 'data' buffer */
     int owner;
+
+    /* If set, a full buffer is passed to sink and reused instead of enlarged */
+    MI_Result (*sink)(void* sinkContext, const MI_Char* data, size_t size);
+    void* sinkContext;
 }
 Buf;
 
@@ -40,6 +47,17 @@ MI_Result Buf_Construct(
     _Inout_ MI_Char* data,
     size_t capacity);
 
+MI_Result Buf_ConstructSink(
+    _Out_ Buf* self,
+    _Inout_updates_(capacity) MI_Char* data,
+    size_t capacity,
+    _In_ MI_Result (*sink)(void* sinkContext, const MI_Char* data, size_t size),
+    _In_opt_ void* sinkContext);
+
+/* Passes what is left in a sink buffer to its sink */
+MI_Result Buf_Flush(
+    _Inout_ Buf* self);
+
 void Buf_Destruct(
     _Inout_ Buf* self);
 
@@ -1774,6 +1774,38 @@ static MI_Result MI_CALL _Serializer_SerializeInstance(
     return MI_RESULT_OK;
 }
 
+/*
+**==============================================================================
+**
+** _FileSink()
+**
+**     Sink of the Buf that MI_Serializer_SerializeInstanceToFile_Mof() writes
+**     through.
+**
+**==============================================================================
+*/
+
+typedef struct _FileSinkContext
+{
+    FILE* file;
+    MI_Uint64 written;
+}
+FileSinkContext;
+
+static MI_Result _FileSink(
+    void* sinkContext,
+    _In_reads_(size) const MI_Char* data,
+    size_t size)
+{
+    FileSinkContext* context = (FileSinkContext*)sinkContext;
+
+    if (fwrite(data, sizeof(MI_Char), size, context->file) != size)
+        return MI_RESULT_FAILED;
+
+    context->written += size * sizeof(MI_Char);
+    return MI_RESULT_OK;
+}
+
 /*
 **==============================================================================
 **
@@ -1847,3 +1879,76 @@ MI_Result MI_MAIN_CALL MI_Application_NewSerializer_Mof(
 
     return MI_RESULT_OK;
 }
+
+/* Serializes instance to file in a single pass. The output goes through a
+ * fixed chunk on the stack straight into the stdio buffer of file, so no
+ * instance is ever held in memory as a whole. */
+MI_Result MI_MAIN_CALL MI_Serializer_SerializeInstanceToFile_Mof(
+    _Inout_ MI_Serializer *serializer,
+    MI_Uint32 flags,
+    _In_ const MI_Instance *instance,
+    _Inout_ FILE *file,
+    _Out_opt_ MI_Uint64 *bytesWritten)
+{
+    MI_Char chunk[BUF_SINK_CHUNK_SIZE];
+    FileSinkContext context;
+    ExtFunctionTable* eft;
+    Buf out;
+    MI_Result r;
+
+    if (bytesWritten)
+        *bytesWritten = 0;
+
+    /* Check arguments */
+
+    if (!serializer || !instance || !file)
+        return MI_RESULT_INVALID_PARAMETER;
+
+    /* Check the magic number */
+
+    if (serializer->reserved1 != cCodecMagic)
+        return MI_RESULT_FAILED;
+
+    /* Extract the extended function table */
+
+    eft = (ExtFunctionTable*)(serializer->reserved2);
+
+    if (!eft)
+        return MI_RESULT_FAILED;
+
+    /* Construct Buf */
+
+    context.file = file;
+    context.written = 0;
+
+    if (Buf_ConstructSink(
+        &out,
+        chunk,
+        BUF_SINK_CHUNK_SIZE,
+        _FileSink,
+        &context) != MI_RESULT_OK)
+    {
+        return MI_RESULT_FAILED;
+    }
+
+    /* Put the instance */
+
+    r = _PutInstance(
+        &out,
+        eft,
+        instance,
+        flags,
+        MI_FALSE, /* keysOnly */
+        MI_FALSE, /* addAlias */
+        MI_FALSE, /* nestedCall */
+        NULL);
+
+    if (r == MI_RESULT_OK)
+        r = Buf_Flush(&out);
+
+    if (bytesWritten)
+        *bytesWritten = context.written;
+
+    Buf_Destruct(&out);
+    return r;
+}
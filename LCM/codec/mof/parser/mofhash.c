@@ -35,7 +35,78 @@ MI_Uint32 HashName(_In_z_ const MI_Char* str)
         hash ^= ((hash << 5) + PAL_tolower(*p) + (hash >> 2));
         p++;
     }
-    return hash % HASH_TABLE_SIZE;
+    /* Mix the high bits into the low bits used to pick a slot */
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/*
+**==============================================================================
+**
+** Find the slot holding the string, or the empty slot where it belongs
+**
+**==============================================================================
+*/
+static HashNodePtr _FindSlot(
+    _In_ HashNodePtr nodes,
+    _In_ MI_Uint32 size,
+    _In_ MI_Uint32 h,
+    _In_ MI_Uint32 code,
+    _In_z_ const MI_Char* name)
+{
+    MI_Uint32 mask = size - 1;
+    MI_Uint32 i = h & mask;
+    /* Table is never full, so an empty slot ends every probe */
+    while (nodes[i].source)
+    {
+        if ((nodes[i].code == code) && (Tcscasecmp(nodes[i].source, name) == 0))
+        {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &nodes[i];
+}
+
+/*
+**==============================================================================
+**
+** Double the number of slots
+**
+**==============================================================================
+*/
+static int _Grow(
+    _In_ Batch* batch,
+    _Inout_ StringHash *hash)
+{
+    MI_Uint32 i;
+    MI_Uint32 size = hash->size * 2;
+    HashNodePtr nodes;
+    if (size < hash->size)
+    {
+        return -1;
+    }
+    nodes = (HashNodePtr)Batch_GetClear(batch, sizeof(HashNode) * size);
+    if (NULL == nodes)
+    {
+        return -1;
+    }
+    for (i = 0; i < hash->size; i++)
+    {
+        if (hash->nodes[i].source)
+        {
+            HashNodePtr node = _FindSlot(nodes, size, HashName(hash->nodes[i].source),
+                hash->nodes[i].code, hash->nodes[i].source);
+            *node = hash->nodes[i];
+        }
+    }
+    hash->nodes = nodes;
+    hash->size = size;
+    return 0;
 }
 
 /*
@@ -52,11 +123,13 @@ int StringHash_Init(
     Batch* batch = (Batch*)mofbatch;
     if (hash->nodes == NULL)
     {
-        hash->nodes = (HashNodePtr*)Batch_GetClear(batch, sizeof(HashNodePtr) * (HASH_TABLE_SIZE));
+        hash->nodes = (HashNodePtr)Batch_GetClear(batch, sizeof(HashNode) * HASH_INITIAL_SIZE);
         if (NULL == hash->nodes)
         {
             return -1;
         }
+        hash->size = HASH_INITIAL_SIZE;
+        hash->count = 0;
     }
     return 0;
 }
@@ -65,6 +138,7 @@ int StringHash_Init(
 **==============================================================================
 **
 ** Add string to hash table
+**  Adding a string that is already there updates its position
 **
 **==============================================================================
 */
@@ -76,17 +150,26 @@ int StringHash_Add(
     _In_z_ const MI_Char* str)
 {
     Batch * batch = (Batch*)mofbatch;
-    MI_Uint32 h = HashName(str);
-    HashNodePtr node = (HashNodePtr)Batch_GetClear(batch, sizeof(HashNode));
-    if (NULL == node)
+    HashNodePtr node;
+    if (StringHash_Init(mofbatch, hash) != 0)
     {
         return -1;
     }
-    node->source = str;
-    node->code = code;
+    if ((MI_Uint64)(hash->count + 1) * 4 > (MI_Uint64)hash->size * 3)
+    {
+        if (_Grow(batch, hash) != 0)
+        {
+            return -1;
+        }
+    }
+    node = _FindSlot(hash->nodes, hash->size, HashName(str), code, str);
+    if (NULL == node->source)
+    {
+        node->source = str;
+        node->code = code;
+        hash->count++;
+    }
     node->pos = pos;
-    node->next = hash->nodes[h];
-    hash->nodes[h] = node;
     return 0;
 }
 
@@ -103,17 +186,10 @@ MI_Uint32 StringHash_Find(
 {
     if(hash->nodes)
     {
-        MI_Uint32 h = HashName(name);
-        MI_Uint32 code = Hash(name);
-        HashNodePtr node;
-        node = hash->nodes[h];
-        while (node)
+        HashNodePtr node = _FindSlot(hash->nodes, hash->size, HashName(name), Hash(name), name);
+        if (node->source)
         {
-            if ((node->code == code) && (Tcscasecmp(node->source, name) == 0))
-            {
-                return node->pos;
-            }
-            node = node->next;
+            return node->pos;
         }
     }
     return HASH_INVALID_POS;
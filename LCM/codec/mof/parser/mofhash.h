@@ -40,31 +40,33 @@ extern "C" {
 */
 /* Invalid position means not found the string in hash table */
 #define HASH_INVALID_POS 0xFFFFFFFF
-/* Defines Hash table size, a big prime number */
-#define HASH_TABLE_SIZE 1000003
+/* Initial number of slots, a power of two leaving room for HASH_THRESHOLD strings */
+#define HASH_INITIAL_SIZE 512
 /* Fallback to hash search beyond this threshold */
 #define HASH_THRESHOLD 128
 /* A number used to caculate hash value */
 #define HASH_SEED_PRIME_NUMBER 1313038763
-/* Defines hash node */
+/* Defines hash node, a slot of the open addressing table */
 typedef struct _HashNode *HashNodePtr;
 typedef struct _HashNode
 {
+    const MI_Char* source; /* source string of the node, NULL if slot is empty */
     MI_Uint32 pos; /* Index of the string in the array */
                    /* Assume the string(s) are stored in */
                    /* another separate array, such as MOF_ClassDeclList */
-    const MI_Char* source; /* source string of the node */
     MI_Uint32 code; /* Another hash code of the string to */
                     /* fastern search on collision entry*/
-    HashNodePtr next; /* Next node with same hash value */
 }
 HashNode;
 /* Defines structure of string hash table */
-/* TODO: Extend and reuse hashtable structure defined in base/hashtable.h */
-/* Need hashtable take a batch to allocate memory */
+/* Slots are allocated from the batch and the table doubles once it is */
+/* 3/4 full, so small documents only pay for a few KB. Old slot arrays */
+/* are released together with the batch. */
 typedef struct _StringHash
 {
-    HashNodePtr* nodes;
+    HashNodePtr nodes;
+    MI_Uint32 size; /* Number of slots, a power of two */
+    MI_Uint32 count; /* Number of strings in the table */
 }StringHash;
 
 
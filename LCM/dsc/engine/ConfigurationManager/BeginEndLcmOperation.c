@@ -16,35 +16,80 @@
 */
 
 #include "BeginEndLcmOperation.h"
+#include <pthread.h>
 extern Sem g_h_ConfigurationStoppedEvent;
 
 //
-// global variable used by TryBeginLcaOperation and EndLcaOperation
+// State used by TryBeginLcmOperation and EndLcmOperation.  Read-only methods
+// share the LCM with each other; any other method needs it to itself.
 //
- volatile ptrdiff_t g_activeOperationMethodName = 0;
+static pthread_mutex_t g_lcmOperationLock = PTHREAD_MUTEX_INITIALIZER;
+static const MI_Char* g_activeOperationMethodName = NULL;
+static const MI_Char* g_activeReaderMethodName = NULL;
+static MI_Uint32 g_activeReaderCount = 0;
 
 /// <summary>
-/// Try begin general method if another method is not running currently. General methods don't include StopConfiguration
+/// Returns whether the method only reads LCM state and can run alongside other read-only methods.
+/// GetConfiguration and TestConfiguration are not included: they run resources through
+/// Exec_WMIv2Provider, which keeps the current provider operation and the resources not in
+/// desired state in process globals.
+/// </summary>
+MI_Boolean IsReadOnlyLcmOperation(
+    _In_z_ const MI_Char* methodName)
+{
+    if (Tcscasecmp(methodName, MSFT_DSCLocalConfigManager_GetMetaConfiguration) == 0)
+    {
+        return MI_TRUE;
+    }
+
+    return MI_FALSE;
+}
+
+/// <summary>
+/// Try begin general method if a conflicting method is not running currently. General methods don't include StopConfiguration
 /// </summary>
 MI_Result TryBeginLcmOperation(
     _In_z_ const MI_Char* methodName,
     _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
 {
-    MI_Char* originalMethodName;
+    const MI_Char* originalMethodName;
     int waitResult = 0;
 
     *cimErrorDetails = NULL;
-    originalMethodName = (MI_Char*)Atomic_CompareAndSwap(&g_activeOperationMethodName, (ptrdiff_t) NULL, (ptrdiff_t)methodName);
+
+    pthread_mutex_lock(&g_lcmOperationLock);
+    originalMethodName = g_activeOperationMethodName;
+
+    if (IsReadOnlyLcmOperation(methodName))
+    {
+        // We silently let GetMetaConfiguration to go if the active operation is not SetMetaConfiguration
+        if (originalMethodName != NULL
+            && Tcscasecmp(originalMethodName, MSFT_DSCLocalConfigManager_SendMetaConfigurationApply) == 0)
+        {
+            pthread_mutex_unlock(&g_lcmOperationLock);
+            return GetCimMIError3Params(MI_RESULT_FAILED, cimErrorDetails, ID_LCM_MULTIPLE_METHOD_REQUEST, methodName, originalMethodName, methodName);
+        }
+
+        g_activeReaderCount++;
+        g_activeReaderMethodName = methodName;
+        pthread_mutex_unlock(&g_lcmOperationLock);
+        return MI_RESULT_OK;
+    }
+
+    if (originalMethodName == NULL && g_activeReaderCount > 0)
+    {
+        originalMethodName = g_activeReaderMethodName;
+    }
 
     if (originalMethodName != NULL)
-	{
-		// We silently let GetMetaConfiguration to go if the active operation is not SetMetaConfiguration
-		if (Tcscasecmp(originalMethodName, MSFT_DSCLocalConfigManager_SendMetaConfigurationApply) == 0
-			|| Tcscasecmp(methodName, MSFT_DSCLocalConfigManager_GetMetaConfiguration) != 0)
-		{
-			return GetCimMIError3Params(MI_RESULT_FAILED, cimErrorDetails, ID_LCM_MULTIPLE_METHOD_REQUEST, methodName, originalMethodName, methodName);
-		}
-	}
+    {
+        pthread_mutex_unlock(&g_lcmOperationLock);
+        return GetCimMIError3Params(MI_RESULT_FAILED, cimErrorDetails, ID_LCM_MULTIPLE_METHOD_REQUEST, methodName, originalMethodName, methodName);
+    }
+
+    g_activeOperationMethodName = methodName;
+    pthread_mutex_unlock(&g_lcmOperationLock);
+
     waitResult = Sem_TimedWait(&g_h_ConfigurationStoppedEvent, (int)0); //Ignore the result
     return MI_RESULT_OK;
 }
@@ -52,10 +97,28 @@ MI_Result TryBeginLcmOperation(
 /// <summary>
 /// End the operation of the method.
 /// </summar>
-void EndLcmOperation()
+void EndLcmOperation(
+    _In_z_ const MI_Char* methodName)
 {
     int waitResult = 0;
-    Atomic_Swap(&g_activeOperationMethodName, (ptrdiff_t)NULL);
+
+    pthread_mutex_lock(&g_lcmOperationLock);
+    if (IsReadOnlyLcmOperation(methodName))
+    {
+        if (g_activeReaderCount > 0)
+        {
+            g_activeReaderCount--;
+        }
+        if (g_activeReaderCount == 0)
+        {
+            g_activeReaderMethodName = NULL;
+        }
+        pthread_mutex_unlock(&g_lcmOperationLock);
+        return;
+    }
+
+    g_activeOperationMethodName = NULL;
+    pthread_mutex_unlock(&g_lcmOperationLock);
+
     waitResult = Sem_Post(&g_h_ConfigurationStoppedEvent, 1); //Ignore the result
 }
-
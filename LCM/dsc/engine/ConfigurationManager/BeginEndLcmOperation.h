@@ -21,10 +21,14 @@
 #include "EngineHelper.h"
 #include "Resources_LCM.h"
 
+MI_Boolean IsReadOnlyLcmOperation(
+    _In_z_ const MI_Char* methodName);
+
 MI_Result TryBeginLcmOperation(
     _In_z_ const MI_Char* methodName,
     _Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
 
-void EndLcmOperation();
+void EndLcmOperation(
+    _In_z_ const MI_Char* methodName);
 
 #endif // _BeginEndLacOperation_h_
@@ -0,0 +1,270 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <pthread.h>
+#include "DSC_Systemcalls.h"
+#include "EventWrapper.h"
+#include "Resources_LCM.h"
+#include "SchemaCache.h"
+#include "ConfigurationCache.h"
+
+typedef struct _ConfigurationCacheEntry
+{
+    MI_Char *documentLocation;
+    MI_Char *checksum;
+    MI_Uint32 flags;
+    MI_Uint64 fileFingerprint;
+    MI_Uint64 schemaVersion;
+    MI_ClassA classes;              // keeps the class declarations of the cached instances alive
+    MI_InstanceA resources;
+    MI_Instance *documentInstance;
+} ConfigurationCacheEntry;
+
+static pthread_mutex_t g_ConfigurationCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static ConfigurationCacheEntry *g_ConfigurationCache = NULL;
+
+static void FreeEntry(_In_opt_ ConfigurationCacheEntry *entry)
+{
+    MI_Uint32 xCount = 0;
+    if( entry == NULL)
+    {
+        return;
+    }
+    // Arrays may be partially filled when cloning failed.
+    for( xCount = 0 ; xCount < entry->resources.size; xCount++)
+    {
+        MI_Instance_Delete(entry->resources.data[xCount]);
+    }
+    DSC_free(entry->resources.data);
+    if( entry->documentInstance)
+    {
+        MI_Instance_Delete(entry->documentInstance);
+    }
+    for( xCount = 0 ; xCount < entry->classes.size; xCount++)
+    {
+        MI_Class_Delete(entry->classes.data[xCount]);
+    }
+    DSC_free(entry->classes.data);
+    DSC_free(entry->documentLocation);
+    DSC_free(entry->checksum);
+    DSC_free(entry);
+}
+
+static MI_Char* CopyString(_In_z_ const MI_Char *source)
+{
+    size_t length = (Tcslen(source) + 1) * sizeof(MI_Char);
+    MI_Char *copy = (MI_Char*) DSC_malloc(length, NitsHere());
+    if( copy)
+    {
+        memcpy(copy, source, length);
+    }
+    return copy;
+}
+
+static MI_Result CloneInstances(_In_ MI_InstanceA *source,
+                                _Out_ MI_InstanceA *clones)
+{
+    MI_Result r = MI_RESULT_OK;
+
+    clones->data = NULL;
+    clones->size = 0;
+    if( source->size == 0)
+    {
+        return MI_RESULT_OK;
+    }
+    clones->data = (MI_Instance**) DSC_malloc(sizeof(MI_Instance*) * source->size, NitsHere());
+    if( clones->data == NULL)
+    {
+        return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+    }
+    for( clones->size = 0 ; clones->size < source->size; clones->size++)
+    {
+        r = DSC_MI_Instance_Clone(source->data[clones->size], &clones->data[clones->size]);
+        if( r != MI_RESULT_OK)
+        {
+            return r;
+        }
+    }
+    return MI_RESULT_OK;
+}
+
+static MI_Result CloneClasses(_In_ ModuleManager *moduleManager,
+                              _Out_ MI_ClassA *clones)
+{
+    MI_Result r = MI_RESULT_OK;
+    ModuleLoaderObject *moduleLoader = (ModuleLoaderObject*) moduleManager->reserved2;
+
+    clones->data = NULL;
+    clones->size = 0;
+    if( moduleLoader == NULL || moduleLoader->schemaCount == 0)
+    {
+        return MI_RESULT_OK;
+    }
+    clones->data = (MI_Class**) DSC_malloc(sizeof(MI_Class*) * moduleLoader->schemaCount, NitsHere());
+    if( clones->data == NULL)
+    {
+        return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+    }
+    for( clones->size = 0 ; clones->size < moduleLoader->schemaCount; clones->size++)
+    {
+        r = MI_Class_Clone(moduleLoader->providerSchema[clones->size], &clones->data[clones->size]);
+        if( r != MI_RESULT_OK)
+        {
+            return r;
+        }
+    }
+    return MI_RESULT_OK;
+}
+
+/* Called with the lock held. */
+static MI_Boolean GetCachedDocument(_In_z_ const MI_Char *documentLocation,
+                                    _In_z_ const MI_Char *checksum,
+                                    MI_Uint32 flags,
+                                    MI_Uint64 fileFingerprint,
+                                    MI_Uint64 schemaVersion,
+                                    _Out_ MI_InstanceA *resources,
+                                    _Outptr_result_maybenull_ MI_Instance **documentInstance)
+{
+    ConfigurationCacheEntry *entry = g_ConfigurationCache;
+
+    if( entry == NULL ||
+        entry->flags != flags ||
+        entry->fileFingerprint != fileFingerprint ||
+        entry->schemaVersion != schemaVersion ||
+        Tcscmp(entry->documentLocation, documentLocation) != 0 ||
+        Tcscmp(entry->checksum, checksum) != 0)
+    {
+        return MI_FALSE;
+    }
+
+    if( CloneInstances(&entry->resources, resources) != MI_RESULT_OK ||
+        (entry->documentInstance != NULL && DSC_MI_Instance_Clone(entry->documentInstance, documentInstance) != MI_RESULT_OK))
+    {
+        // Partially cloned, let the caller parse the document instead.
+        CleanUpInstanceCache(resources);
+        DSC_free(resources->data);
+        resources->data = NULL;
+        resources->size = 0;
+        *documentInstance = NULL;
+        return MI_FALSE;
+    }
+    return MI_TRUE;
+}
+
+/* Best effort, the document is simply parsed again on the next run when this fails. */
+static void SetCachedDocument(_In_ ModuleManager *moduleManager,
+                              _In_z_ const MI_Char *documentLocation,
+                              _In_z_ const MI_Char *checksum,
+                              MI_Uint32 flags,
+                              MI_Uint64 fileFingerprint,
+                              MI_Uint64 schemaVersion,
+                              _In_ MI_InstanceA *resources,
+                              _In_opt_ MI_Instance *documentInstance)
+{
+    ConfigurationCacheEntry *entry = NULL;
+    ConfigurationCacheEntry *oldEntry = NULL;
+
+    entry = (ConfigurationCacheEntry*) DSC_malloc(sizeof(ConfigurationCacheEntry), NitsHere());
+    if( entry == NULL)
+    {
+        return;
+    }
+    entry->flags = flags;
+    entry->fileFingerprint = fileFingerprint;
+    entry->schemaVersion = schemaVersion;
+    entry->documentLocation = CopyString(documentLocation);
+    entry->checksum = CopyString(checksum);
+    if( entry->documentLocation == NULL ||
+        entry->checksum == NULL ||
+        CloneClasses(moduleManager, &entry->classes) != MI_RESULT_OK ||
+        CloneInstances(resources, &entry->resources) != MI_RESULT_OK ||
+        (documentInstance != NULL && DSC_MI_Instance_Clone(documentInstance, &entry->documentInstance) != MI_RESULT_OK))
+    {
+        FreeEntry(entry);
+        return;
+    }
+
+    pthread_mutex_lock(&g_ConfigurationCacheLock);
+    oldEntry = g_ConfigurationCache;
+    g_ConfigurationCache = entry;
+    pthread_mutex_unlock(&g_ConfigurationCacheLock);
+
+    FreeEntry(oldEntry);
+}
+
+MI_Result ConfigurationCache_LoadDocument(
+    _In_ ModuleManager *moduleManager,
+    MI_Uint32 flags,
+    _In_z_ const MI_Char *documentLocation,
+    _In_z_ const MI_Char *checksum,
+    _Outptr_result_maybenull_ MI_Instance **cimErrorDetails,
+    _Out_ MI_InstanceA *resources,
+    _Outptr_result_maybenull_ MI_Instance **documentInstance)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Uint64 fileFingerprint = 0;
+    MI_Uint64 schemaVersion = 0;
+    MI_Boolean found = MI_FALSE;
+
+    if( moduleManager == NULL || documentLocation == NULL || checksum == NULL || resources == NULL || documentInstance == NULL)
+    {
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, cimErrorDetails, ID_MODMAN_LOADDOC_NULLPARAM);
+    }
+    memset(resources, 0, sizeof(MI_InstanceA));
+    *documentInstance = NULL;
+
+    // Loading the manager scans the module schemas, after that the schema version is current.
+    r = LoadModuleManager(moduleManager, cimErrorDetails);
+    if( r != MI_RESULT_OK)
+    {
+        return r;
+    }
+    schemaVersion = SchemaCache_GetVersion();
+
+    // The checksum file isn't rewritten when Current.mof is, so the file itself has to be the same too.
+    if( SchemaCache_GetFingerprint(documentLocation, NULL, &fileFingerprint) != MI_RESULT_OK)
+    {
+        return moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, flags, documentLocation, cimErrorDetails, resources, documentInstance);
+    }
+
+    pthread_mutex_lock(&g_ConfigurationCacheLock);
+    found = GetCachedDocument(documentLocation, checksum, flags, fileFingerprint, schemaVersion, resources, documentInstance);
+    pthread_mutex_unlock(&g_ConfigurationCacheLock);
+    if( found)
+    {
+        DSC_EventWriteMessageLoadingInstance(documentLocation);
+        return MI_RESULT_OK;
+    }
+
+    r = moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, flags, documentLocation, cimErrorDetails, resources, documentInstance);
+    if( r == MI_RESULT_OK)
+    {
+        SetCachedDocument(moduleManager, documentLocation, checksum, flags, fileFingerprint, schemaVersion, resources, *documentInstance);
+    }
+    return r;
+}
+
+void ConfigurationCache_Clear()
+{
+    ConfigurationCacheEntry *oldEntry = NULL;
+
+    pthread_mutex_lock(&g_ConfigurationCacheLock);
+    oldEntry = g_ConfigurationCache;
+    g_ConfigurationCache = NULL;
+    pthread_mutex_unlock(&g_ConfigurationCacheLock);
+
+    FreeEntry(oldEntry);
+}
@@ -0,0 +1,46 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/**************************************************************************************************/
+/*                                                                                                */
+/* Process wide cache of the last configuration document loaded for a consistency run. It holds  */
+/* the deserialized resource instances and the document instance of Current.mof, keyed by the     */
+/* document checksum, and is reused until the checksum, the file or the module schema changes.    */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#ifndef __CONFIGURATIONCACHE_H_
+#define __CONFIGURATIONCACHE_H_
+
+#include "MI.h"
+#include "EngineHelper.h"
+#include "ModuleHandler.h"
+
+/* Same contract as ModuleManager_LoadInstanceDocumentFromLocation. The caller owns the returned instances,
+   they are clones of the cached ones when 'documentLocation' wasn't modified since it was last loaded. */
+MI_Result ConfigurationCache_LoadDocument(
+    _In_ ModuleManager *moduleManager,
+    MI_Uint32 flags,
+    _In_z_ const MI_Char *documentLocation,
+    _In_z_ const MI_Char *checksum,
+    _Outptr_result_maybenull_ MI_Instance **cimErrorDetails,
+    _Out_ MI_InstanceA *resources,
+    _Outptr_result_maybenull_ MI_Instance **documentInstance);
+
+/* Drops the cached document. */
+void ConfigurationCache_Clear();
+
+#endif //__CONFIGURATIONCACHE_H_
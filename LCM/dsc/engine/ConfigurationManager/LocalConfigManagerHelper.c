@@ -31,6 +31,8 @@
 #include "MSFT_WebDownloadManager.h"
 #include "RegistrationManager.h"
 #include "OMI_LocalConfigManagerHelper.h"
+#include "ConfigurationCache.h"
+#include "SchemaCache.h"
 
 #if defined(BUILD_OMS)
 extern MI_Boolean g_DscHost;
@@ -54,6 +56,12 @@ MI_Boolean g_bNotFirstTimeReport = MI_FALSE;
 LCMProviderContext g_baselcmContext = {0};
 LCMProviderContext * g_lcmContext = &g_baselcmContext;
 
+// Guards the LCM status: the internal state cache, its store and the status fields of g_metaConfig.
+// GetMetaConfiguration runs alongside other operations, so the LCM goes busy with the first
+// operation that calls SetLCMStatusBusy and ready with the last one that calls SetLCMStatusReady.
+static RecursiveLock g_lcmStatusLock;
+static MI_Uint32 g_lcmStatusBusyCount = 0;
+
 MI_Result ReportStatusToServer(
         _In_ LCMProviderContext *lcmContext,
         _In_opt_z_ const MI_Char * errorMessage,
@@ -443,6 +451,11 @@ MI_Result InitPath(
     return result;
 }
 
+MI_Boolean IsLcmInitialized()
+{
+    return g_InitializationState == INITIALIZED ? MI_TRUE : MI_FALSE;
+}
+
 MI_Result UnInitHandler(
     _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
 {
@@ -554,9 +567,15 @@ MI_Result UnInitHandler(
 
     if (g_DSCInternalCache)
     {
+        MI_Instance *flushError = NULL;
+        if (FlushCurrentStatus(&flushError) != MI_RESULT_OK && flushError != NULL)
+        {
+            MI_Instance_Delete(flushError);
+        }
         MI_Instance_Delete(g_DSCInternalCache);
         g_DSCInternalCache = NULL;
     }
+    CloseCurrentStatusStore();
 
     error = DSC_EventUnRegister();
     if (error != 0)
@@ -884,6 +903,7 @@ MI_Result CallRestoreConfiguration(
 {
     MI_Result r = MI_RESULT_OK;
     LCMProviderContext lcmContext = {0};
+    DSC_FileView previousConfigView;
     MI_Uint8A PreviousConfigValue={0};
     MI_Uint32 bufferIndex = 0;
 
@@ -898,12 +918,14 @@ MI_Result CallRestoreConfiguration(
     }
 
     //Read file contents from the current configuration file into PreviousConfigValue
-    r = ReadFileContent(GetPreviousConfigFileName(), &PreviousConfigValue.data, &PreviousConfigValue.size,cimErrorDetails);
+    r = DSC_FileView_OpenReplaced(GetPreviousConfigFileName(), &previousConfigView, cimErrorDetails);
     if (r != MI_RESULT_OK)
     {
                 SetLCMStatusReady();
         return r;
     }
+    PreviousConfigValue.data = previousConfigView.data;
+    PreviousConfigValue.size = previousConfigView.size;
 
     GetRealBufferIndex((const MI_ConstUint8A*) &(PreviousConfigValue), &bufferIndex);
     lcmContext.executionMode = (LCM_EXECUTIONMODE_OFFLINE | LCM_EXECUTIONMODE_ONLINE);
@@ -916,6 +938,7 @@ MI_Result CallRestoreConfiguration(
     SetMessageInContext(ID_OUTPUT_OPERATION_START,ID_OUTPUT_ITEM_ROLLBACK,&lcmContext);
     LCM_BuildMessage(&lcmContext, ID_OUTPUT_EMPTYSTRING, EMPTY_STRING, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
     r =  SetConfiguration(PreviousConfigValue.data + bufferIndex, PreviousConfigValue.size - bufferIndex,MI_FALSE,&lcmContext, dwFlags, cimErrorDetails);
+    DSC_FileView_Close(&previousConfigView);
 
         //Debug Log 
     DSC_EventWriteMethodEnd(__WFUNCTION__);
@@ -1176,6 +1199,339 @@ MI_Result FilterPartialConfigurations(
         return result;
 }
 
+#define MOF_SERIALIZE_BUFFER_SIZE (64 * 1024)
+#define PARTIALCONFIG_MERGE_MAX_WORKERS 4
+#define PARTIALCONFIG_MERGE_STAGING_SUFFIX MI_T(".merge")
+
+/*A partial configuration as an earlier merge left it: validated, with its resources and
+  its base document (renamed for the merged document) already serialized. Entries are
+  keyed by the partial's .checksum file, or its content when it has none, along with
+  its size and modification time. The whole cache is dropped when MetaConfig.mof or the
+  installed module schemas change, since validation depends on both.*/
+typedef struct _PartialConfigMergeEntry
+{
+        struct _PartialConfigMergeEntry *next;
+        MI_Char *fileName;
+        unsigned char checksum[SHA256TRANSFORM_DIGEST_LEN];
+        MI_Uint64 fileSize;
+        MI_Sint64 fileModified;
+        MI_Char *name;
+        MI_Uint8 *resources;
+        MI_Uint32 resourcesSize;
+        MI_Uint8 *baseDocument;
+        MI_Uint32 baseDocumentSize;
+} PartialConfigMergeEntry;
+
+typedef struct _PartialConfigMergeJob
+{
+        PartialConfigMergeEntry *entry;
+        MI_Char *filePath;
+        MI_Boolean cached;
+        MI_Boolean invalid;     //Failed ValidatePartialConfiguration, the file gets deleted
+        MI_Boolean fatal;       //Fails the whole merge
+        MI_Result result;
+        MI_Instance *cimErrorDetails;
+} PartialConfigMergeJob;
+
+typedef struct _PartialConfigMergeWork
+{
+        ModuleManager *moduleManager;
+        MI_Instance *metaConfigInstance;
+        MI_Application *application;
+        PartialConfigMergeJob *jobs;
+        MI_Uint32 jobCount;
+        MI_Uint32 nextJob;
+        Lock lock;
+} PartialConfigMergeWork;
+
+//Only touched by MergePartialConfigurations, which runs as the exclusive LCM writer.
+static PartialConfigMergeEntry *g_PartialConfigMergeCache = NULL;
+static unsigned char g_PartialConfigMergeCacheMetaConfig[SHA256TRANSFORM_DIGEST_LEN];
+static MI_Uint64 g_PartialConfigMergeCacheSchemaVersion = 0;
+static MI_Boolean g_PartialConfigMergeCacheValid = MI_FALSE;
+
+static void FreePartialConfigMergeEntry(_In_opt_ PartialConfigMergeEntry *entry)
+{
+        if (entry == NULL)
+        {
+                return;
+        }
+        DSCFREE_IF_NOT_NULL(entry->fileName);
+        DSCFREE_IF_NOT_NULL(entry->name);
+        DSCFREE_IF_NOT_NULL(entry->resources);
+        DSCFREE_IF_NOT_NULL(entry->baseDocument);
+        DSC_free(entry);
+}
+
+static void ClearPartialConfigMergeCache()
+{
+        PartialConfigMergeEntry *entry;
+
+        while (g_PartialConfigMergeCache != NULL)
+        {
+                entry = g_PartialConfigMergeCache;
+                g_PartialConfigMergeCache = entry->next;
+                FreePartialConfigMergeEntry(entry);
+        }
+}
+
+/*Takes the cached entry for fileName out of the cache, NULL if there is none.*/
+static PartialConfigMergeEntry* RemovePartialConfigMergeEntry(_In_z_ const MI_Char *fileName)
+{
+        PartialConfigMergeEntry **link = &g_PartialConfigMergeCache;
+        PartialConfigMergeEntry *entry;
+
+        for (entry = g_PartialConfigMergeCache; entry != NULL; link = &entry->next, entry = entry->next)
+        {
+                if (Tcscmp(entry->fileName, fileName) == 0)
+                {
+                        *link = entry->next;
+                        entry->next = NULL;
+                        return entry;
+                }
+        }
+
+        return NULL;
+}
+
+/*Computes the cache key of a partial configuration file.*/
+static MI_Result GetPartialConfigMergeKey(_In_z_ const MI_Char *filePath,
+        _Inout_ PartialConfigMergeEntry *entry,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+        MI_Char checksumPath[MAX_PATH];
+        DSC_FileView content;
+        MI_Result result;
+        struct stat fileStat;
+
+        if (Stprintf(checksumPath, MAX_PATH, MI_T("%T%T"), filePath, CHECKSUM_EXTENSION) == -1)
+        {
+                return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_PRINTF_ERROR);
+        }
+
+        if (stat(filePath, &fileStat) != 0)
+        {
+                return GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR, filePath);
+        }
+        entry->fileSize = (MI_Uint64) fileStat.st_size;
+        entry->fileModified = (MI_Sint64) fileStat.st_mtime;
+
+        //Pulled partials come with a checksum, pushed ones are hashed here.
+        result = DSC_FileView_Open(File_ExistT(checksumPath) != -1 ? checksumPath : filePath, &content, cimErrorDetails);
+        if (result != MI_RESULT_OK)
+        {
+                return result;
+        }
+        PAL_SHA256Transform(content.data, content.size, entry->checksum);
+        DSC_FileView_Close(&content);
+
+        return MI_RESULT_OK;
+}
+
+/*Appends instances to a serialization buffer, growing it as needed.*/
+static MI_Result SerializeInstancesToBuffer(_Inout_ MI_Serializer *pSerializer,
+        _In_reads_(instanceCount) MI_Instance **instances,
+        MI_Uint32 instanceCount,
+        _Inout_ MI_Uint8 **buffer,
+        _Inout_ MI_Uint32 *bufferSize,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+        MI_Uint32 capacity = *bufferSize;
+        MI_Uint32 bufferUsed = 0;
+        MI_Uint32 xCount;
+        MI_Uint8 *grown;
+        MI_Result result;
+
+        for (xCount = 0; xCount < instanceCount; xCount++)
+        {
+                bufferUsed = 0;
+                result = MI_Serializer_SerializeInstance(pSerializer, 0, instances[xCount], *buffer == NULL ? NULL : *buffer + *bufferSize, capacity - *bufferSize, &bufferUsed);
+                if (result != MI_RESULT_OK && bufferUsed > capacity - *bufferSize)
+                {
+                        capacity = *bufferSize + bufferUsed;
+                        if (capacity < MOF_SERIALIZE_BUFFER_SIZE)
+                        {
+                                capacity = MOF_SERIALIZE_BUFFER_SIZE;
+                        }
+                        else if (capacity - *bufferSize < *bufferSize)
+                        {
+                                capacity = *bufferSize * 2;
+                        }
+                        grown = (MI_Uint8*) DSC_realloc(*buffer, capacity, NitsHere());
+                        if (grown == NULL)
+                        {
+                                return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
+                        }
+                        *buffer = grown;
+                        bufferUsed = 0;
+                        result = MI_Serializer_SerializeInstance(pSerializer, 0, instances[xCount], *buffer + *bufferSize, capacity - *bufferSize, &bufferUsed);
+                }
+                if (result != MI_RESULT_OK)
+                {
+                        return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_DURING_SERIALIZING);
+                }
+
+                *bufferSize += bufferUsed;
+                if (*bufferSize > MAX_MOFSIZE)
+                {
+                        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_FILESIZE_ERROR);
+                }
+        }
+
+        return MI_RESULT_OK;
+}
+
+/*Validates, loads and serializes one changed partial configuration.*/
+static void BuildPartialConfigMergeEntry(_In_ PartialConfigMergeWork *work,
+        _Inout_ PartialConfigMergeJob *job,
+        _Inout_ MI_Serializer *pSerializer)
+{
+        MI_InstanceA resourceInstanceArray = { 0 };
+        MI_Instance *baseDocumentInstance = NULL;
+        PartialConfigMergeEntry *entry = job->entry;
+        MI_Value value;
+
+        job->result = ValidatePartialConfiguration(work->moduleManager, job->filePath, work->metaConfigInstance, &job->cimErrorDetails);
+        if (job->result != MI_RESULT_OK)
+        {
+                job->invalid = MI_TRUE;
+                return;
+        }
+
+        job->result = work->moduleManager->ft->LoadInstanceDocumentFromLocation(work->moduleManager, VALIDATE_DOCUMENT_INSTANCE, job->filePath, &job->cimErrorDetails, &resourceInstanceArray, &baseDocumentInstance);
+        if (job->result != MI_RESULT_OK)
+        {
+                return;
+        }
+
+        job->fatal = MI_TRUE;
+        job->result = DSC_MI_Instance_GetElement(baseDocumentInstance, OMI_ConfigurationDocument_Name, &value, NULL, NULL, NULL);
+        GOTO_CLEANUP_IF_FAILED(job->result, Exit);
+        entry->name = (MI_Char*) DSC_malloc((Tcslen(value.string) + 1) * sizeof(MI_Char), NitsHere());
+        if (entry->name == NULL)
+        {
+                job->result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, &job->cimErrorDetails, ID_LCMHELPER_MEMORY_ERROR);
+                goto Exit;
+        }
+        memcpy(entry->name, value.string, (Tcslen(value.string) + 1) * sizeof(MI_Char));
+
+        job->result = SerializeInstancesToBuffer(pSerializer, resourceInstanceArray.data, resourceInstanceArray.size, &entry->resources, &entry->resourcesSize, &job->cimErrorDetails);
+        GOTO_CLEANUP_IF_FAILED(job->result, Exit);
+
+        //Kept in case this partial comes first and provides the merged document's base document
+        value.string = OMI_ConfigurationDocument_PartialConfigAuthor;
+        job->result = MI_Instance_SetElement(baseDocumentInstance, OMI_ConfigurationDocument_Author, &value, MI_STRING, 0);
+        GOTO_CLEANUP_IF_FAILED(job->result, Exit);
+        value.string = OMI_ConfigurationDocument_PartialConfigName;
+        job->result = MI_Instance_SetElement(baseDocumentInstance, OMI_ConfigurationDocument_Name, &value, MI_STRING, 0);
+        GOTO_CLEANUP_IF_FAILED(job->result, Exit);
+        job->result = SerializeInstancesToBuffer(pSerializer, &baseDocumentInstance, 1, &entry->baseDocument, &entry->baseDocumentSize, &job->cimErrorDetails);
+        GOTO_CLEANUP_IF_FAILED(job->result, Exit);
+
+        job->fatal = MI_FALSE;
+
+Exit:
+        INSTANCE_DELETE_IF_NOT_NULL(baseDocumentInstance);
+        CleanUpInstanceCache(&resourceInstanceArray);
+}
+
+typedef struct _PartialConfigMergeWorker
+{
+        PartialConfigMergeWork *work;
+        MI_Serializer serializer;
+        Thread thread;
+} PartialConfigMergeWorker;
+
+static PAL_Uint32 THREAD_API PartialConfigMergeWorkerProc(void *param)
+{
+        PartialConfigMergeWorker *worker = (PartialConfigMergeWorker*) param;
+        PartialConfigMergeWork *work = worker->work;
+        PartialConfigMergeJob *job;
+
+        for (;;)
+        {
+                Lock_Acquire(&work->lock);
+                while (work->nextJob < work->jobCount && work->jobs[work->nextJob].cached)
+                {
+                        work->nextJob++;
+                }
+                job = work->nextJob < work->jobCount ? &work->jobs[work->nextJob++] : NULL;
+                Lock_Release(&work->lock);
+
+                if (job == NULL)
+                {
+                        break;
+                }
+                BuildPartialConfigMergeEntry(work, job, &worker->serializer);
+        }
+
+        return 0;
+}
+
+/*Runs the jobs of the changed partial configurations, up to PARTIALCONFIG_MERGE_MAX_WORKERS at a time.
+  The module manager is fully loaded before this, so the workers only read from it. The calling
+  thread takes a share of the work too, and finishes it alone if no other worker could start.*/
+static MI_Result BuildPartialConfigMergeEntries(_Inout_ PartialConfigMergeWork *work,
+        MI_Uint32 changedCount,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+        PartialConfigMergeWorker workers[PARTIALCONFIG_MERGE_MAX_WORKERS];
+        MI_Uint32 workerCount = changedCount < PARTIALCONFIG_MERGE_MAX_WORKERS ? changedCount : PARTIALCONFIG_MERGE_MAX_WORKERS;
+        MI_Uint32 startedCount;
+        MI_Uint32 xCount;
+        PAL_Uint32 ret;
+
+        for (xCount = 0; xCount < workerCount; xCount++)
+        {
+                workers[xCount].work = work;
+                if (MI_Application_NewSerializer_Mof(work->application, 0, MOFCODEC_FORMAT, &workers[xCount].serializer) != MI_RESULT_OK)
+                {
+                        break;
+                }
+        }
+        workerCount = xCount;
+        if (workerCount == 0)
+        {
+                return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERRORMERGING_PARTIALCONFIGS);
+        }
+
+        Lock_Init(&work->lock);
+        for (startedCount = 1; startedCount < workerCount; startedCount++)
+        {
+                if (Thread_CreateJoinable(&workers[startedCount].thread, PartialConfigMergeWorkerProc, NULL, &workers[startedCount]) != 0)
+                {
+                        break;
+                }
+        }
+
+        PartialConfigMergeWorkerProc(&workers[0]);
+
+        for (xCount = 1; xCount < startedCount; xCount++)
+        {
+                Thread_Join(&workers[xCount].thread, &ret);
+                Thread_Destroy(&workers[xCount].thread);
+        }
+
+        for (xCount = 0; xCount < workerCount; xCount++)
+        {
+                MI_Serializer_Close(&workers[xCount].serializer);
+        }
+        return MI_RESULT_OK;
+}
+
+static MI_Result WriteMergeBuffer(_Inout_ FILE *fp,
+        _In_reads_bytes_(size) const MI_Uint8 *buffer,
+        MI_Uint32 size,
+        _In_z_ const MI_Char *filePath,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+        if (size > 0 && fwrite(buffer, 1, size, fp) != size)
+        {
+                return GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, filePath);
+        }
+        return MI_RESULT_OK;
+}
+
 MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         _In_ ModuleManager* moduleManager,
         _In_z_ const MI_Char* targetMofFile,
@@ -1186,14 +1542,13 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         MI_Char *partialConfigDir = NULL;
         MI_Instance* metaConfigInstance = NULL;
         MI_Char* unexpandedPartialConfigFilePath = NULL;
-        MI_Char* partialConfigFilePath = NULL;
         MI_Char* checksumFile = NULL;
+        MI_Char stagingFile[MAX_PATH];
         MI_InstanceA resourceInstanceArray = { 0 };
         Internal_Dir *dirHandle = NULL;
         MI_Application application = MI_APPLICATION_NULL;
         MI_Boolean applicationInited = MI_FALSE;
         MI_Serializer serializer = { 0 };
-        MI_Value value;
         MI_Boolean errorOccured = MI_FALSE;
         MI_Boolean serializerInited = MI_FALSE;
         MI_Boolean isLocked = MI_FALSE;
@@ -1201,6 +1556,19 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         Internal_DirEnt *dirEntry = NULL;
         MI_Instance * baseDocumentInstance = NULL;
         MI_Uint32 resultStatus = 0;
+        PartialConfigMergeWork work = { 0 };
+        PartialConfigMergeJob *jobs = NULL;
+        PartialConfigMergeJob *grownJobs = NULL;
+        PartialConfigMergeEntry *entry = NULL;
+        MI_Uint32 jobCapacity = 0;
+        MI_Uint32 jobCount = 0;
+        MI_Uint32 changedCount = 0;
+        MI_Uint32 xCount = 0;
+        DSC_FileView metaConfigContent;
+        unsigned char metaConfigChecksum[SHA256TRANSFORM_DIGEST_LEN];
+        MI_Uint64 schemaVersion = 0;
+        FILE *stagingFp = NULL;
+        MI_Boolean useCache = MI_FALSE;
 
         /****************************** INITIALIZE EVERYTHING *******************************************/
         if (cimErrorDetails == NULL || targetMofFile == NULL || targetBaseDocumentMergedFile == NULL || moduleManager == NULL)
@@ -1213,13 +1581,11 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         result = ExpandPath(CONFIGURATION_PARTIALCONFIG_STORE, &partialConfigDir, cimErrorDetails);
         RETURN_RESULT_IF_FAILED(result);
 
-        if (File_ExistT(GetPendingConfigFileName()) != -1)
-        {
-                File_RemoveT(GetPendingConfigFileName());
-        }
-        if (File_ExistT(GetPartialConfigBaseDocumentInstanceFileName()) != -1)
+        //The merge is assembled next to Pending.mof and only swapped in at the end
+        if (Stprintf(stagingFile, MAX_PATH, MI_T("%T%T"), GetPendingConfigFileName(), PARTIALCONFIG_MERGE_STAGING_SUFFIX) == -1)
         {
-                File_RemoveT(GetPartialConfigBaseDocumentInstanceFileName());
+                DSC_free(partialConfigDir);
+                return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_PRINTF_ERROR);
         }
 
         result = MI_Application_Initialize(0, NULL, NULL, &application);
@@ -1230,6 +1596,33 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         GOTO_CLEANUP_AND_THROW_ERROR_IF_FAILED(result, result, ID_LCMHELPER_ERRORMERGING_PARTIALCONFIGS, cimErrorDetails, Exit)
                 serializerInited = MI_TRUE;
 
+        result = GetMetaConfig((MSFT_DSCMetaConfiguration **) &metaConfigInstance);
+        GOTO_CLEANUP_IF_FAILED(result, Exit);
+
+        //Whether a partial is valid depends on the meta configuration and the module schemas as well.
+        //LoadModuleManager above rescanned the schemas, so the schema version is current.
+        schemaVersion = SchemaCache_GetVersion();
+        if (DSC_FileView_OpenReplaced(g_MetaConfigFileName, &metaConfigContent, cimErrorDetails) == MI_RESULT_OK)
+        {
+                PAL_SHA256Transform(metaConfigContent.data, metaConfigContent.size, metaConfigChecksum);
+                DSC_FileView_Close(&metaConfigContent);
+                useCache = g_PartialConfigMergeCacheValid &&
+                           g_PartialConfigMergeCacheSchemaVersion == schemaVersion &&
+                           memcmp(metaConfigChecksum, g_PartialConfigMergeCacheMetaConfig, SHA256TRANSFORM_DIGEST_LEN) == 0;
+                memcpy(g_PartialConfigMergeCacheMetaConfig, metaConfigChecksum, SHA256TRANSFORM_DIGEST_LEN);
+                g_PartialConfigMergeCacheSchemaVersion = schemaVersion;
+                g_PartialConfigMergeCacheValid = MI_TRUE;
+        }
+        else
+        {
+                INSTANCE_DELETE_IF_NOT_NULL(*cimErrorDetails);
+                g_PartialConfigMergeCacheValid = MI_FALSE;
+        }
+        if (!useCache)
+        {
+                ClearPartialConfigMergeCache();
+        }
+
         //We know the directory exists for sure here so no need for checking for that.
         //Open directory and check for the first obtained file
         dirHandle = Internal_Dir_Open(partialConfigDir, NitsMakeCallSite(-3, NULL, NULL, 0));
@@ -1238,116 +1631,173 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
                 result = GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_MODMAN_FINDFIRST_FAILED);
                 goto Exit;
         }
-        dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION);
-        //From now on until pending.mof is fully done, lock everything
-
-        RecursiveLock_Acquire(&gExecutionLock);
-        isLocked = MI_TRUE;
-        result = GetMetaConfig((MSFT_DSCMetaConfiguration **) &metaConfigInstance);
-        GOTO_CLEANUP_IF_FAILED(result, Exit);
 
         DSC_EventWriteLCMAboutToMergePartial();
-        /****************************** LOGIC TO DESERIALIZE AND SERIALIZEs *******************************************/
-        //For each file that is obtained, merge it up into the new pending.mof
-        while (dirEntry != NULL)
+        /****************************** FIND THE PARTIALS THAT CHANGED *******************************************/
+        for (dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION); dirEntry != NULL; dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION))
         {
                 /* Only process files*/
-                if (!dirEntry->isDir)
+                if (dirEntry->isDir)
                 {
+                        continue;
+                }
 
-                        //Concatenate directory and filename
-                        result = GetFullPath(partialConfigDir, dirEntry->name, &unexpandedPartialConfigFilePath, cimErrorDetails);
-                        GOTO_CLEANUP_IF_FAILED(result, Exit);
-
-                        result = ExpandPath(unexpandedPartialConfigFilePath, &partialConfigFilePath, cimErrorDetails);
-                        DSC_free(unexpandedPartialConfigFilePath);
-                        GOTO_CLEANUP_IF_FAILED(result, Exit);
-                        //Validate the configuration - if its correctly placed - sometimes it could have been published first , n then run another set, and you still need to validate, if not valid, silently delete
-                        result = ValidatePartialConfiguration(moduleManager, partialConfigFilePath, metaConfigInstance, cimErrorDetails);
-                        if (result != MI_RESULT_OK)
+                if (jobCount == jobCapacity)
+                {
+                        jobCapacity = jobCapacity == 0 ? 16 : jobCapacity * 2;
+                        grownJobs = (PartialConfigMergeJob*) DSC_realloc(jobs, jobCapacity * sizeof(PartialConfigMergeJob), NitsHere());
+                        if (grownJobs == NULL)
                         {
-                                if (*cimErrorDetails)
-                                {//Output the warning with any possible underlying error that came with the above function calls
-                                        DSC_WriteWarningFromError1Param((MI_Context*) lcmContext->context, cimErrorDetails, ID_LCM_PARTIALCONFIG_DELETINGFILE_WARNING, partialConfigFilePath);
-                                        INSTANCE_DELETE_IF_NOT_NULL(*cimErrorDetails);
-                                }
-                                File_RemoveT(partialConfigFilePath); //Delete the file since its irrelevant
-                               
-                                ConcatStrings(&checksumFile, 0, partialConfigFilePath, CHECKSUM_EXTENSION);
-                                File_RemoveT(checksumFile); //Delete the corresponding checksum file as well 
-                                
-                                dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION);
-                                DSCFREE_IF_NOT_NULL(partialConfigFilePath);
-                                DSCFREE_IF_NOT_NULL(checksumFile);
-                                                                
-                result = MI_RESULT_OK;
-                                errorOccured = MI_TRUE;
-                                continue; //Carry on to the next file
+                                result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_LCMHELPER_MEMORY_ERROR);
+                                goto Exit;
                         }
-                        //Check if the required modules are present
-                        
-                        /*
-                          result = DoPushDependencyCheck((MI_Char*) partialConfigFilePath, cimErrorDetails);
-                        
-                        if (result == MI_RESULT_OK)
-                        {
-                                result = moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, VALIDATE_DOCUMENT_INSTANCE, partialConfigFilePath, cimErrorDetails, &resourceInstanceArray, &baseDocumentInstance);
+                        jobs = grownJobs;
+                }
+                memset(&jobs[jobCount], 0, sizeof(PartialConfigMergeJob));
+
+                //Concatenate directory and filename
+                result = GetFullPath(partialConfigDir, dirEntry->name, &unexpandedPartialConfigFilePath, cimErrorDetails);
+                GOTO_CLEANUP_IF_FAILED(result, Exit);
+
+                result = ExpandPath(unexpandedPartialConfigFilePath, &jobs[jobCount].filePath, cimErrorDetails);
+                DSCFREE_IF_NOT_NULL(unexpandedPartialConfigFilePath);
+                GOTO_CLEANUP_IF_FAILED(result, Exit);
+                jobCount++;
+
+                entry = (PartialConfigMergeEntry*) DSC_malloc(sizeof(PartialConfigMergeEntry), NitsHere());
+                if (entry == NULL)
+                {
+                        result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_LCMHELPER_MEMORY_ERROR);
+                        goto Exit;
+                }
+                jobs[jobCount - 1].entry = entry;
+                entry->fileName = (MI_Char*) DSC_malloc((Tcslen(dirEntry->name) + 1) * sizeof(MI_Char), NitsHere());
+                if (entry->fileName == NULL)
+                {
+                        result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_LCMHELPER_MEMORY_ERROR);
+                        goto Exit;
+                }
+                memcpy(entry->fileName, dirEntry->name, (Tcslen(dirEntry->name) + 1) * sizeof(MI_Char));
+
+                result = GetPartialConfigMergeKey(jobs[jobCount - 1].filePath, entry, cimErrorDetails);
+                GOTO_CLEANUP_IF_FAILED(result, Exit);
+
+                //Unchanged partials are reused as they were merged last time
+                entry = RemovePartialConfigMergeEntry(dirEntry->name);
+                if (entry != NULL &&
+                    entry->fileSize == jobs[jobCount - 1].entry->fileSize &&
+                    entry->fileModified == jobs[jobCount - 1].entry->fileModified &&
+                    memcmp(entry->checksum, jobs[jobCount - 1].entry->checksum, SHA256TRANSFORM_DIGEST_LEN) == 0)
+                {
+                        FreePartialConfigMergeEntry(jobs[jobCount - 1].entry);
+                        jobs[jobCount - 1].entry = entry;
+                        jobs[jobCount - 1].cached = MI_TRUE;
+                }
+                else
+                {
+                        FreePartialConfigMergeEntry(entry);
+                        changedCount++;
+                }
+                entry = NULL;
+        }
+        //Partials that are gone from the store are dropped from the cache
+        ClearPartialConfigMergeCache();
+
+        /****************************** VALIDATE AND DESERIALIZE THE CHANGED ONES *******************************************/
+        if (changedCount > 0)
+        {
+                work.moduleManager = moduleManager;
+                work.metaConfigInstance = metaConfigInstance;
+                work.application = &application;
+                work.jobs = jobs;
+                work.jobCount = jobCount;
+                result = BuildPartialConfigMergeEntries(&work, changedCount, cimErrorDetails);
+                GOTO_CLEANUP_IF_FAILED(result, Exit);
+        }
+
+        /****************************** ASSEMBLE THE MERGED DOCUMENT *******************************************/
+        stagingFp = File_OpenT(stagingFile, MI_T("wb"));
+        if (stagingFp == NULL)
+        {
+                result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR, stagingFile);
+                goto Exit;
+        }
+        setvbuf(stagingFp, NULL, _IOFBF, FILE_REPLACE_BUFFER_SIZE);
+
+        //Partials go in directory order, as they always have
+        for (xCount = 0; xCount < jobCount; xCount++)
+        {
+                PartialConfigMergeJob *job = &jobs[xCount];
+
+                if (job->invalid)
+                {
+                        if (job->cimErrorDetails)
+                        {//Output the warning with any possible underlying error that came with the above function calls
+                                DSC_WriteWarningFromError1Param((MI_Context*) lcmContext->context, &job->cimErrorDetails, ID_LCM_PARTIALCONFIG_DELETINGFILE_WARNING, job->filePath);
+                                INSTANCE_DELETE_IF_NOT_NULL(job->cimErrorDetails);
                         }
-                        */
+                        File_RemoveT(job->filePath); //Delete the file since its irrelevant
 
-                        result = moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, VALIDATE_DOCUMENT_INSTANCE, partialConfigFilePath, cimErrorDetails, &resourceInstanceArray, &baseDocumentInstance);
+                        ConcatStrings(&checksumFile, 0, job->filePath, CHECKSUM_EXTENSION);
+                        File_RemoveT(checksumFile); //Delete the corresponding checksum file as well
+                        DSCFREE_IF_NOT_NULL(checksumFile);
 
-                        //If any of the above operations failed, just skip the file and continue to the next one - give them a warning that you're doing this
-                        if (result != MI_RESULT_OK)
-                        {
-                                if (*cimErrorDetails)
-                                { //Output the warning with any possible underlying error that came with the above function calls
-                                        DSC_WriteWarningFromError1Param((MI_Context*) lcmContext->context, cimErrorDetails, ID_LCM_PARTIALCONFIG_SKIPFILE_WARNING, partialConfigFilePath);
-                                        INSTANCE_DELETE_IF_NOT_NULL(*cimErrorDetails);
-                                }
-                                dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION);
-                                DSCFREE_IF_NOT_NULL(partialConfigFilePath);
-                                result = MI_RESULT_OK;
-                                errorOccured = MI_TRUE;
-                                continue; //Carry on to the next file
+                        errorOccured = MI_TRUE;
+                        continue; //Carry on to the next file
+                }
+
+                if (job->fatal)
+                {
+                        result = job->result;
+                        *cimErrorDetails = job->cimErrorDetails;
+                        job->cimErrorDetails = NULL;
+                        goto Exit;
+                }
+
+                //If any of the above operations failed, just skip the file and continue to the next one - give them a warning that you're doing this
+                if (job->result != MI_RESULT_OK)
+                {
+                        if (job->cimErrorDetails)
+                        { //Output the warning with any possible underlying error that came with the above function calls
+                                DSC_WriteWarningFromError1Param((MI_Context*) lcmContext->context, &job->cimErrorDetails, ID_LCM_PARTIALCONFIG_SKIPFILE_WARNING, job->filePath);
+                                INSTANCE_DELETE_IF_NOT_NULL(job->cimErrorDetails);
                         }
+                        errorOccured = MI_TRUE;
+                        continue; //Carry on to the next file
+                }
 
-                        //Get the partial configuration name from the document
-                        result = DSC_MI_Instance_GetElement(baseDocumentInstance, OMI_ConfigurationDocument_Name, &value, NULL, NULL, NULL);
+                DSC_EventWriteLCMMergingPartialConfiguration(job->entry->name);
+                result = WriteMergeBuffer(stagingFp, job->entry->resources, job->entry->resourcesSize, stagingFile, cimErrorDetails);
+                GOTO_CLEANUP_IF_FAILED(result, Exit);
+                //Set in the unique base document - happens one time only
+                if (!newBaseDocumentIsPlaced)
+                {
+                        result = WriteMergeBuffer(stagingFp, job->entry->baseDocument, job->entry->baseDocumentSize, stagingFile, cimErrorDetails);
                         GOTO_CLEANUP_IF_FAILED(result, Exit);
-                        DSC_EventWriteLCMMergingPartialConfiguration(value.string);
+                        newBaseDocumentIsPlaced = MI_TRUE;
+                }
 
-                        //For now its just a simple merge, put all of these deserialized stuff into another file and we'll be done, yay!
-                        result = SerializeInstanceArrayToFile(&resourceInstanceArray, GetPendingConfigFileName(), cimErrorDetails, MI_T("ab"), MI_FALSE, &serializer);
-                        GOTO_CLEANUP_IF_FAILED(result, Exit);
-                        //Free the path for the partial config, to rellocate for the next one.
-                        DSCFREE_IF_NOT_NULL(partialConfigFilePath);
-                        result = SerializeSingleInstanceToFile(baseDocumentInstance, GetPartialConfigBaseDocumentInstanceFileName(), cimErrorDetails, MI_T("ab"), MI_FALSE, &serializer);
-                        GOTO_CLEANUP_IF_FAILED(result, Exit);
-                        //Set in the unique base document - happens one time only
-                        if (!newBaseDocumentIsPlaced)
-                        {
-                                value.string = OMI_ConfigurationDocument_PartialConfigAuthor;
-                                result = MI_Instance_SetElement(baseDocumentInstance, OMI_ConfigurationDocument_Author, &value, MI_STRING, 0);
-                                GOTO_CLEANUP_IF_FAILED(result, Exit);
-                                value.string = OMI_ConfigurationDocument_PartialConfigName;
-                                result = MI_Instance_SetElement(baseDocumentInstance, OMI_ConfigurationDocument_Name, &value, MI_STRING, 0);
-                                GOTO_CLEANUP_IF_FAILED(result, Exit);
-                                result = SerializeSingleInstanceToFile(baseDocumentInstance, GetPendingConfigFileName(), cimErrorDetails, MI_T("ab"), MI_FALSE, &serializer);
-                                GOTO_CLEANUP_IF_FAILED(result, Exit);
-                                newBaseDocumentIsPlaced = MI_TRUE;
-                        }
-                        //We can't have multiple base document instances, so remove them from each (we'll add one at the end)
-                        INSTANCE_DELETE_IF_NOT_NULL(baseDocumentInstance);
-                        CleanUpInstanceCache(&resourceInstanceArray); //To clear old file's data                        
+                //Keep it for the next merge
+                if (g_PartialConfigMergeCacheValid)
+                {
+                        job->entry->next = g_PartialConfigMergeCache;
+                        g_PartialConfigMergeCache = job->entry;
+                        job->entry = NULL;
                 }
-                dirEntry = Internal_Dir_Read(dirHandle, MOF_EXTENSION);
-        }//End of recursing directory files
+        }
+
+        if (fflush(stagingFp) != 0)
+        {
+                result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, stagingFile);
+                goto Exit;
+        }
+        File_Close(stagingFp);
+        stagingFp = NULL;
 
         //Now check if the merged file is valid
-        if (File_ExistT(GetPartialConfigBaseDocumentInstanceFileName()) != -1)
+        if (newBaseDocumentIsPlaced)
         {
-                result = ValidatePartialConfigMergedFile(moduleManager, GetPendingConfigFileName(), cimErrorDetails);
+                result = ValidatePartialConfigMergedFile(moduleManager, stagingFile, cimErrorDetails);
         }
         else
         {
@@ -1365,7 +1815,7 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
         GOTO_CLEANUP_IF_FAILED(result, Exit);
 
         // we have a basic merged pending mof file, We will doing filtering to remove the ones that dependsOn is not satisfied
-        result = moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, 0, GetPendingConfigFileName(), cimErrorDetails, &resourceInstanceArray, &baseDocumentInstance);
+        result = moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, 0, stagingFile, cimErrorDetails, &resourceInstanceArray, &baseDocumentInstance);
 
         GOTO_CLEANUP_IF_FAILED(result, Exit);
         // clean up the temp file so the filtered configuration will be saved there
@@ -1384,6 +1834,11 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
 
         result = SerializeSingleInstanceToFile(baseDocumentInstance, GetPendingConfigTmpFileName(), cimErrorDetails, MI_T("ab"), MI_FALSE, &serializer);
         GOTO_CLEANUP_IF_FAILED(result, Exit);
+
+        /****************************** SWAP IN THE NEW PENDING.MOF *******************************************/
+        RecursiveLock_Acquire(&gExecutionLock);
+        isLocked = MI_TRUE;
+
         if (File_ExistT(GetPendingConfigFileName()) != -1)
         {
                 File_RemoveT(GetPendingConfigFileName());
@@ -1400,159 +1855,108 @@ MI_Result MergePartialConfigurations(_In_ LCMProviderContext *lcmContext,
             GOTO_CLEANUP_IF_FAILED(result, Exit);
         }
 
-        File_CopyT(GetPendingConfigTmpFileName(), GetPendingConfigFileName());
-        File_CopyT(GetPartialConfigBaseDocumentInstanceTmpFileName(), GetPartialConfigBaseDocumentInstanceFileName());
-
-        /****************************** CLEANUIP AND RETURN *******************************************/
-Exit:
-        DSCFREE_IF_NOT_NULL(partialConfigFilePath);
-        DSCFREE_IF_NOT_NULL(partialConfigDir);
-        INSTANCE_DELETE_IF_NOT_NULL(baseDocumentInstance);
-        INSTANCE_DELETE_IF_NOT_NULL(metaConfigInstance);
-        //Note: No need to clean partialConfigInstance variable as it points to a part of metaconfiguration
-        if (resourceInstanceArray.data != NULL)
-        {
-                CleanUpInstanceCache(&resourceInstanceArray);
-        }
-        if (serializerInited)
-        {
-                MI_Serializer_Close(&serializer);
-                serializerInited = MI_FALSE;
-        }
-
-        if (applicationInited)
-        {
-                MI_Application_Close(&application);
-                applicationInited = MI_FALSE;
-        }
-        if (isLocked)
-        {
-                RecursiveLock_Release(&gExecutionLock);
-                isLocked = MI_FALSE;
-        }
-        if (dirHandle != NULL)
-                Internal_Dir_Close(dirHandle);
-        return result;
-}
-
-/*Function to add a single instance to a destination file*/
-MI_Result SerializeSingleInstanceToFile(_In_ MI_Instance *miInstance,
-        _In_z_ const MI_Char* filePath,
-        _Outptr_result_maybenull_ MI_Instance** cimErrorDetails,
-        _In_z_ const MI_Char* fileOpenMode,
-        _In_ MI_Boolean isLockSensitive,
-        _Inout_ MI_Serializer *pSerializer)
-{
-        MI_Uint32 bufferSize = 0;
-        MI_Char * buffer = NULL;
-        MI_Boolean locked = MI_FALSE;
-        MI_Result result = MI_RESULT_OK;
-
-        BOOL bFileInGoodState = FALSE;
-        FILE *fp = NULL;
-        size_t writeSize = 0;
-        if (filePath == NULL || fileOpenMode == NULL || pSerializer == NULL || miInstance == NULL)
-        {
-                return MI_RESULT_INVALID_PARAMETER;
-        }
-        *cimErrorDetails = NULL;
-        fp = File_OpenT(filePath, fileOpenMode);
-        if (fp == NULL)
-        {
-                result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR, filePath);
-                goto Exit;
-        }
-        if (isLockSensitive)
-        {
-                RecursiveLock_Acquire(&gExecutionLock);
-                locked = MI_TRUE;
-        }
-        bFileInGoodState = FALSE;
+        File_CopyReplaceT(GetPendingConfigTmpFileName(), GetPendingConfigFileName());
+        File_CopyReplaceT(GetPartialConfigBaseDocumentInstanceTmpFileName(), GetPartialConfigBaseDocumentInstanceFileName());
 
-        if (buffer)
+        /****************************** CLEANUIP AND RETURN *******************************************/
+Exit:
+        if (result != MI_RESULT_OK)
         {
-                DSC_free(buffer);
-                buffer = NULL;
-                bufferSize = 0;
+                //A failed merge leaves no pending configuration behind
+                if (!isLocked)
+                {
+                        RecursiveLock_Acquire(&gExecutionLock);
+                        isLocked = MI_TRUE;
+                }
+                if (File_ExistT(GetPendingConfigFileName()) != -1)
+                {
+                        File_RemoveT(GetPendingConfigFileName());
+                }
+                if (File_ExistT(GetPartialConfigBaseDocumentInstanceFileName()) != -1)
+                {
+                        File_RemoveT(GetPartialConfigBaseDocumentInstanceFileName());
+                }
         }
-        // get the size of buffer, ignore the API return (MI_RESULT_FAILED)
-        MI_Serializer_SerializeInstance(pSerializer, 0, miInstance, NULL, 0, &bufferSize);
-
-        buffer = (MI_Char *) DSC_malloc(bufferSize, NitsHere());
-        if (buffer == NULL)
+        if (isLocked)
         {
-                result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
-                goto Exit;
+                RecursiveLock_Release(&gExecutionLock);
+                isLocked = MI_FALSE;
         }
-
-        result = MI_Serializer_SerializeInstance(pSerializer, 0, miInstance, (MI_Uint8*) buffer, bufferSize, &bufferSize);
-        GOTO_CLEANUP_AND_THROW_ERROR_IF_FAILED(result, MI_RESULT_FAILED, ID_LCMHELPER_ERROR_DURING_SERIALIZING, cimErrorDetails, Exit)
-
-                writeSize = fwrite((MI_Uint8*) buffer, 1, bufferSize, fp);
-        if (writeSize != bufferSize)
+        if (stagingFp != NULL)
         {
-                result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, filePath);
-                goto Exit;
+                File_Close(stagingFp);
         }
-
-        bFileInGoodState = TRUE;
-
-Exit:
-
-        if (fp != NULL)
+        File_RemoveT(stagingFile);
+        for (xCount = 0; xCount < jobCount; xCount++)
         {
-                File_Close(fp);
-                fp = NULL;
+                FreePartialConfigMergeEntry(jobs[xCount].entry);
+                DSCFREE_IF_NOT_NULL(jobs[xCount].filePath);
+                INSTANCE_DELETE_IF_NOT_NULL(jobs[xCount].cimErrorDetails);
         }
-
-        if (!bFileInGoodState)
+        DSCFREE_IF_NOT_NULL(jobs);
+        DSCFREE_IF_NOT_NULL(partialConfigDir);
+        INSTANCE_DELETE_IF_NOT_NULL(baseDocumentInstance);
+        INSTANCE_DELETE_IF_NOT_NULL(metaConfigInstance);
+        //Note: No need to clean partialConfigInstance variable as it points to a part of metaconfiguration
+        if (resourceInstanceArray.data != NULL)
         {
-                File_RemoveT(filePath);
+                CleanUpInstanceCache(&resourceInstanceArray);
         }
-
-        if (locked && isLockSensitive)
+        if (serializerInited)
         {
-                RecursiveLock_Release(&gExecutionLock);
-                locked = MI_FALSE;
+                MI_Serializer_Close(&serializer);
+                serializerInited = MI_FALSE;
         }
 
-        if (buffer != NULL)
+        if (applicationInited)
         {
-                DSC_free(buffer);
-                buffer = NULL;
+                MI_Application_Close(&application);
+                applicationInited = MI_FALSE;
         }
+        if (dirHandle != NULL)
+                Internal_Dir_Close(dirHandle);
         return result;
 }
 
-/*Function to add instances into the destination file.*/
-MI_Result SerializeInstanceArrayToFile(_In_ MI_InstanceA *miInstanceArray,
+
+/*Serializes instances into filePath in one pass. The serialization buffer is reused
+  across instances and only grows when an instance does not fit. Append modes add to
+  filePath in place; any other mode writes a new file that replaces filePath once it
+  is complete and on disk.*/
+static MI_Result SerializeInstancesToFile(_In_reads_(instanceCount) MI_Instance **instances,
+        MI_Uint32 instanceCount,
         _In_z_ const MI_Char* filePath,
         _Outptr_result_maybenull_ MI_Instance** cimErrorDetails,
         _In_z_ const MI_Char* fileOpenMode,
         _In_ MI_Boolean isLockSensitive,
         _Inout_ MI_Serializer *pSerializer)
 {
-        MI_Uint32 bufferSize = 0;
-        MI_Char * buffer = NULL;
+        MI_Uint64 bytesWritten = 0;
         MI_Boolean locked = MI_FALSE;
+        MI_Boolean append = (fileOpenMode[0] == MI_T('a'));
         MI_Result result = MI_RESULT_OK;
         MI_Uint32 xCount = 0;
-        MI_Uint32 totalSize = 0;
+        MI_Uint64 totalSize = 0;
 
         BOOL bFileInGoodState = FALSE;
         FILE *fp = NULL;
-        size_t writeSize = 0;
-        if (filePath == NULL || fileOpenMode == NULL || pSerializer == NULL || miInstanceArray == NULL || cimErrorDetails == NULL)
+
+        *cimErrorDetails = NULL;
+        if (append)
         {
-                return MI_RESULT_INVALID_PARAMETER;
+                fp = File_OpenT(filePath, fileOpenMode);
+                if (fp != NULL)
+                {
+                        setvbuf(fp, NULL, _IOFBF, FILE_REPLACE_BUFFER_SIZE);
+                }
+        }
+        else
+        {
+                fp = File_OpenReplaceT(filePath);
         }
-        *cimErrorDetails = NULL;
-        fp = File_OpenT(filePath, fileOpenMode);
         if (fp == NULL)
         {
-                GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR, filePath);
-
-                result = MI_RESULT_FAILED;
+                result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR, filePath);
                 goto Exit;
         }
         if (isLockSensitive)
@@ -1560,45 +1964,25 @@ MI_Result SerializeInstanceArrayToFile(_In_ MI_InstanceA *miInstanceArray,
                 RecursiveLock_Acquire(&gExecutionLock);
                 locked = MI_TRUE;
         }
-        bFileInGoodState = FALSE;
-        for (xCount = 0; xCount < miInstanceArray->size; xCount++)
-        {
-                MI_Instance * pInstance = miInstanceArray->data[xCount];
 
-                if (buffer)
+        for (xCount = 0; xCount < instanceCount; xCount++)
+        {
+                // The codec writes each instance straight into fp's buffer, in one pass.
+                result = MI_Serializer_SerializeInstanceToFile_Mof(pSerializer, 0, instances[xCount], fp, &bytesWritten);
+                if (result != MI_RESULT_OK && ferror(fp))
                 {
-                        DSC_free(buffer);
-                        buffer = NULL;
-                        bufferSize = 0;
+                        result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, filePath);
+                        goto Exit;
                 }
-                // get the size of buffer, ignore the API return (MI_RESULT_FAILED)
-                MI_Serializer_SerializeInstance(pSerializer, 0, pInstance, NULL, 0, &bufferSize);
+                GOTO_CLEANUP_AND_THROW_ERROR_IF_FAILED(result, MI_RESULT_FAILED, ID_LCMHELPER_ERROR_DURING_SERIALIZING, cimErrorDetails, Exit)
 
                 // check total size
-                totalSize += bufferSize;
+                totalSize += bytesWritten;
                 if (totalSize > MAX_MOFSIZE)
                 {
                         result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_FILESIZE_ERROR);
                         goto Exit;
                 }
-
-                buffer = (MI_Char *) DSC_malloc(bufferSize, NitsHere());
-                if (buffer == NULL)
-                {
-                        result = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
-                        goto Exit;
-                }
-
-                result = MI_Serializer_SerializeInstance(pSerializer, 0, pInstance, (MI_Uint8*) buffer, bufferSize, &bufferSize);
-                GOTO_CLEANUP_AND_THROW_ERROR_IF_FAILED(result, MI_RESULT_FAILED, ID_LCMHELPER_ERROR_DURING_SERIALIZING, cimErrorDetails, Exit)
-
-
-                        writeSize = fwrite((MI_Uint8*) buffer, 1, bufferSize, fp);
-                if (writeSize != bufferSize)
-                {
-                        result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, filePath);
-                        goto Exit;
-                }
         }
         bFileInGoodState = TRUE;
 
@@ -1606,11 +1990,31 @@ Exit:
 
         if (fp != NULL)
         {
-                File_Close(fp);
+                if (append)
+                {
+                        if (fflush(fp) != 0)
+                        {
+                                bFileInGoodState = FALSE;
+                        }
+                        File_Close(fp);
+                }
+                else if (!bFileInGoodState)
+                {
+                        File_AbortReplaceT(fp, filePath);
+                }
+                else if (File_CommitReplaceT(fp, filePath) != 0)
+                {
+                        bFileInGoodState = FALSE;
+                }
                 fp = NULL;
+
+                if (!bFileInGoodState && result == MI_RESULT_OK)
+                {
+                        result = GetCimMIError1Param(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_ERROR_WRITINGFILE, filePath);
+                }
         }
 
-        if (!bFileInGoodState)
+        if (!bFileInGoodState && append)
         {
                 File_RemoveT(filePath);
         }
@@ -1620,16 +2024,37 @@ Exit:
                 RecursiveLock_Release(&gExecutionLock);
                 locked = MI_FALSE;
         }
+        return result;
+}
 
-        if (buffer != NULL)
+/*Function to add a single instance to a destination file*/
+MI_Result SerializeSingleInstanceToFile(_In_ MI_Instance *miInstance,
+        _In_z_ const MI_Char* filePath,
+        _Outptr_result_maybenull_ MI_Instance** cimErrorDetails,
+        _In_z_ const MI_Char* fileOpenMode,
+        _In_ MI_Boolean isLockSensitive,
+        _Inout_ MI_Serializer *pSerializer)
+{
+        if (filePath == NULL || fileOpenMode == NULL || pSerializer == NULL || miInstance == NULL)
         {
-                DSC_free(buffer);
-                buffer = NULL;
+                return MI_RESULT_INVALID_PARAMETER;
         }
+        return SerializeInstancesToFile(&miInstance, 1, filePath, cimErrorDetails, fileOpenMode, isLockSensitive, pSerializer);
+}
 
-
-
-        return result;
+/*Function to add instances into the destination file.*/
+MI_Result SerializeInstanceArrayToFile(_In_ MI_InstanceA *miInstanceArray,
+        _In_z_ const MI_Char* filePath,
+        _Outptr_result_maybenull_ MI_Instance** cimErrorDetails,
+        _In_z_ const MI_Char* fileOpenMode,
+        _In_ MI_Boolean isLockSensitive,
+        _Inout_ MI_Serializer *pSerializer)
+{
+        if (filePath == NULL || fileOpenMode == NULL || pSerializer == NULL || miInstanceArray == NULL || cimErrorDetails == NULL)
+        {
+                return MI_RESULT_INVALID_PARAMETER;
+        }
+        return SerializeInstancesToFile(miInstanceArray->data, miInstanceArray->size, filePath, cimErrorDetails, fileOpenMode, isLockSensitive, pSerializer);
 }
 
 MI_Result GetFullPath(
@@ -2659,6 +3084,7 @@ MI_Result ApplyConfig(
     MI_Uint32 applyConfigFlags = 0;
     MI_Instance *metaConfigInstance = NULL;
     MI_Value configModeValue;
+    MI_Char *mofChecksum = NULL;
 
     //Debug Log 
     DSC_EventWriteMessageApplyingConfig(configFileLocation);
@@ -2674,7 +3100,20 @@ MI_Result ApplyConfig(
     r = GetMetaConfig((MSFT_DSCMetaConfiguration**) &metaConfigInstance);
     EH_CheckResult(r);
 
-    r =  moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, applyConfigFlags, configFileLocation, cimErrorDetails, &resourceInstances, &documentIns);
+    // Consistency runs keep applying the same Current.mof, reuse its instances until the checksum changes.
+    if (Tcscmp(configFileLocation, GetCurrentConfigFileName()) == 0 &&
+        GetMofChecksum(&mofChecksum, NULL, cimErrorDetails) == MI_RESULT_OK && mofChecksum != NULL)
+    {
+        r = ConfigurationCache_LoadDocument(moduleManager, applyConfigFlags, configFileLocation, mofChecksum, cimErrorDetails, &resourceInstances, &documentIns);
+        DSC_free(mofChecksum);
+    }
+    else
+    {
+        // Without a checksum the document is parsed as before.
+        INSTANCE_DELETE_IF_NOT_NULL(*cimErrorDetails);
+        DSCFREE_IF_NOT_NULL(mofChecksum);
+        r =  moduleManager->ft->LoadInstanceDocumentFromLocation(moduleManager, applyConfigFlags, configFileLocation, cimErrorDetails, &resourceInstances, &documentIns);
+    }
     if (r != MI_RESULT_OK)
     {
         if (cimErrorDetails && *cimErrorDetails)
@@ -2916,11 +3355,11 @@ MI_Result CopyConfigurationFile(
 
     if (File_ExistT(filePathFrom) == 0)
     {
-        if (File_CopyT(filePathFrom, filePathTo) != 0)
+        if (File_CopyReplaceT(filePathFrom, filePathTo) != 0)
         {
             if (backupSuccess)
             {
-                File_CopyT(fileBackup, filePathTo);
+                File_CopyReplaceT(fileBackup, filePathTo);
             }
 
             result = GetCimMIError2Params(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_COPY_FAILED, locationFrom, locationTo);
@@ -2995,14 +3434,18 @@ MI_Result SaveFile(
         return MI_RESULT_INVALID_PARAMETER; 
     }
     *cimErrorDetails = NULL;    // Explicitly set *cimErrorDetails to NULL as _Outptr_ requires setting this at least once.     
-    fp = File_OpenT(filePath, MI_T("wb"));
+    fp = File_OpenReplaceT(filePath);
     if( fp == NULL)
     {
         return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR);
     }
     result = fwrite(ConfigData, 1, dataSize, fp);
-    File_Close(fp);
     if( result != dataSize)
+    {
+        File_AbortReplaceT(fp, filePath);
+        return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_CREATE_CONF_FAILED);
+    }
+    if( File_CommitReplaceT(fp, filePath) != 0)
     {
         return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_LCMHELPER_CREATE_CONF_FAILED);
     }
@@ -3486,7 +3929,7 @@ MI_Result GetMofChecksum(
 {
     MI_Result r = MI_RESULT_OK;
     MI_Uint8 *checksumBuffer = NULL;
-    MI_Uint8 *tmpchecksumBuffer = NULL;
+    DSC_FileView fileView = {0};
     MI_Uint32 checksumBufferSize = 0;
     MI_Uint32 mofChecksumSize = 0;
     MI_Char *checkSumFile = NULL;
@@ -3525,11 +3968,22 @@ MI_Result GetMofChecksum(
     /* Read checksum file if exists.*/
     if (File_ExistT(checkSumFile) == 0)
     {
-        r = ReadFileContent(checkSumFile, &tmpchecksumBuffer, &checksumBufferSize, cimErrorDetails);    
-        checksumBuffer = (MI_Uint8*)DSC_malloc(checksumBufferSize + 1, NitsHere());
-        memcpy(checksumBuffer, tmpchecksumBuffer, checksumBufferSize);
-        checksumBuffer[checksumBufferSize] = '\0';
-        DSC_free(tmpchecksumBuffer);
+        r = DSC_FileView_Open(checkSumFile, &fileView, cimErrorDetails);
+        if (r == MI_RESULT_OK)
+        {
+            checksumBufferSize = fileView.size;
+            checksumBuffer = (MI_Uint8*)DSC_malloc(checksumBufferSize + 1, NitsHere());
+            if (checksumBuffer == NULL)
+            {
+                r = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
+            }
+            else
+            {
+                memcpy(checksumBuffer, fileView.data, checksumBufferSize);
+                checksumBuffer[checksumBufferSize] = '\0';
+            }
+            DSC_FileView_Close(&fileView);
+        }
         if( configName != NULL)
         {
             DSC_free(checkSumFile);
@@ -3538,19 +3992,14 @@ MI_Result GetMofChecksum(
     }
     else
     {
-        MI_Uint32 computedMofChecksumSize = 0;
         MI_Uint8 *computedMofChecksum = NULL;
         MI_Uint8 RawHash[SHA256TRANSFORM_DIGEST_LEN];
 
         //checksum doesn't exist, we need to compute it.
-        /* Read current.mof file if exists.*/
+        /* Hash current.mof in place if exists.*/
         if (File_ExistT(configurationFile) == 0)
         {
-            r = ReadFileContent(configurationFile, &tmpchecksumBuffer, &checksumBufferSize, cimErrorDetails);
-            checksumBuffer = (MI_Uint8*)DSC_malloc(checksumBufferSize + 1, NitsHere());
-            memcpy(checksumBuffer, tmpchecksumBuffer, checksumBufferSize);
-            checksumBuffer[checksumBufferSize] = '\0';
-            DSC_free(tmpchecksumBuffer);
+            r = DSC_FileView_Open(configurationFile, &fileView, cimErrorDetails);
             if( configName != NULL)
             {
                 DSC_free(checkSumFile);
@@ -3571,12 +4020,12 @@ MI_Result GetMofChecksum(
         }
         if (r == MI_RESULT_OK)
         {
-            PAL_SHA256Transform(checksumBuffer, checksumBufferSize, RawHash);
+            PAL_SHA256Transform(fileView.data, fileView.size, RawHash);
+            DSC_FileView_Close(&fileView);
 
             computedMofChecksum = DSC_malloc( SHA256TRANSFORM_DIGEST_LEN*2 +1, TLINE);
             if (computedMofChecksum == NULL)
             {
-                DSC_free(checksumBuffer);
                 return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);                
             }
             {
@@ -3591,7 +4040,6 @@ MI_Result GetMofChecksum(
                 }
             }
 
-            DSC_free(checksumBuffer);
             checksumBuffer = computedMofChecksum;
             checksumBufferSize = CHECKSUM_SIZE;
         }
@@ -4697,7 +5145,7 @@ MI_Result ReportStatusToServer(
 }
 
 
-MI_Result GetMetaConfig(
+static MI_Result GetMetaConfigLocked(
     _Outptr_ MSFT_DSCMetaConfiguration ** metaConfigInstance)
 {
     MI_Result r;
@@ -4724,6 +5172,17 @@ MI_Result GetMetaConfig(
     return r;
 }
 
+MI_Result GetMetaConfig(
+    _Outptr_ MSFT_DSCMetaConfiguration ** metaConfigInstance)
+{
+    MI_Result r;
+
+    RecursiveLock_Acquire(&g_lcmStatusLock);
+    r = GetMetaConfigLocked(metaConfigInstance);
+    RecursiveLock_Release(&g_lcmStatusLock);
+    return r;
+}
+
 MI_Result SetMetaConfig(
     _In_ const MI_Instance * metaConfigInstance,
     _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
@@ -4803,6 +5262,7 @@ void LCM_FinishOperation(
     MI_ConstStringPtr errorMessage = NULL;
     MI_ConstStringPtr messageId = NULL;
     MI_ConstStringPtr errorType = NULL;
+    MI_Instance *flushError = NULL;
 
     if (errorDetails)
     {
@@ -4849,6 +5309,15 @@ void LCM_FinishOperation(
             MI_Instance_SetElement(errorDetails, REPORTING_SERIALIZEDERROR, &value, MI_STRING, 0);
         }
     }
+
+    // Status updates the operation only made in memory are written here.
+    if (FlushCurrentStatus(&flushError) != MI_RESULT_OK && flushError != NULL)
+    {
+        MI_Instance_Delete(flushError);
+    }
+
+    // Telemetry gathered during the operation is written once, here.
+    DSCFlushTelemetry();
     return;
 }
 
@@ -5448,8 +5917,7 @@ MI_Result DeseralizeMetaConfig(
     MI_Application * miApplication = NULL;
     MI_Result r = MI_RESULT_OK;
     MI_ClassA metaSchema = {0};
-    MI_Uint8 *metaConfigBuffer = NULL;
-    MI_Uint32 bufferSize = 0;
+    DSC_FileView metaConfigBuffer;
     MI_Uint32 deserializeSize;
     MI_Instance *newInstance = NULL;
 
@@ -5494,24 +5962,24 @@ MI_Result DeseralizeMetaConfig(
     }
 
     /* read meta config mof file into buffer and with size*/
-    r = ReadFileContent(g_MetaConfigFileName, &metaConfigBuffer, &bufferSize, cimErrorDetails);
+    r = DSC_FileView_OpenReplaced(g_MetaConfigFileName, &metaConfigBuffer, cimErrorDetails);
     if (r != MI_RESULT_OK)
     {
         CleanUpClassCache(&metaSchema);
         return MI_RESULT_FAILED;
     }
 
-    r = MI_Deserializer_DeserializeInstance(moduleLoader->deserializer, 0, metaConfigBuffer, bufferSize, &metaSchema.data[0], metaSchema.size, NULL, NULL, &deserializeSize, &newInstance, cimErrorDetails);
+    r = MI_Deserializer_DeserializeInstance(moduleLoader->deserializer, 0, metaConfigBuffer.data, metaConfigBuffer.size, &metaSchema.data[0], metaSchema.size, NULL, NULL, &deserializeSize, &newInstance, cimErrorDetails);
     CleanUpClassCache(&metaSchema);
 
     if (r != MI_RESULT_OK)
     {
-        DSC_free(metaConfigBuffer);
+        DSC_FileView_Close(&metaConfigBuffer);
         AppendWMIError1ParamID(*cimErrorDetails, ID_LCM_FAILED_TO_GET_METACONFIGURATION);
         return r;
     }
 
-    DSC_free(metaConfigBuffer);
+    DSC_FileView_Close(&metaConfigBuffer);
     r = DSC_MSFT_DSCMetaConfiguration_Clone((MSFT_DSCMetaConfiguration*)newInstance, metaConfig);
     MI_Instance_Delete(newInstance);
     if (r != MI_RESULT_OK)
@@ -5867,75 +6335,168 @@ MI_Boolean IsGetConfigurationFirstTime()
     return File_ExistT(GetCurrentConfigFileName()) == -1 ? MI_TRUE:MI_FALSE;
 }
 
-MI_Result UpdateCurrentStatus(
-    _In_opt_ MI_Boolean *complianceStatus,
-    _In_opt_ MI_Uint32 *getActionStatusCode,
-        _In_opt_ MI_Uint32 *lcmStatusCode,
-    _In_opt_ MI_Char* registeredServerURLs,
+/* DSCEngineCache.mof is written, never read back, by the LCM: status reads go to
+   g_DSCInternalCache. UpdateCurrentStatus only changes that instance; the file is
+   rewritten when the LCM leaves the busy state or an operation finishes, so the
+   busy, compliance and pull status updates of one operation cost one write. The
+   application, serializer and buffer are created once and kept until unload. */
+typedef struct _CurrentStatusStore
+{
+    MI_Application application;
+    MI_Serializer serializer;
+    MI_Uint8 *buffer;
+    MI_Char *path;
+    MI_Boolean dirty;
+} CurrentStatusStore;
+
+static CurrentStatusStore g_CurrentStatusStore;
+
+static MI_Result OpenCurrentStatusStore(
     _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
-    MI_Application miApp = MI_APPLICATION_NULL;
-    MI_Result r = MI_RESULT_OK;
-    MI_Char *serializerBuffer = NULL;
-    MI_Uint32 bufferUsed = 0;
-    MI_Uint32 bufferSize = METACONFIG_MAX_BUFFER_SIZE;
-    MI_Serializer serializer = {0};
-    MI_Char *fileExpandedPath = NULL;
+    MI_Result r;
+
+    if (g_CurrentStatusStore.buffer != NULL)
+    {
+        return MI_RESULT_OK;
+    }
+
+    r = ExpandPath(CONFIGURATION_LOCATION_INTERNALSTATECACHE, &g_CurrentStatusStore.path, extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
 
-    r = DSC_MI_Application_Initialize(0, NULL, NULL, &miApp);   
+    r = DSC_MI_Application_Initialize(0, NULL, NULL, &g_CurrentStatusStore.application);
     if (r != MI_RESULT_OK)
     {
+        DSC_free(g_CurrentStatusStore.path);
+        g_CurrentStatusStore.path = NULL;
         return GetCimMIError(r, extendedError, ID_MODMAN_APPINIT_FAILED);
     }
 
-    r = UpdateDSCCacheInstance(&miApp, &g_DSCInternalCache, complianceStatus, getActionStatusCode, lcmStatusCode, registeredServerURLs, extendedError);
+    r = MI_Application_NewSerializer_Mof(&g_CurrentStatusStore.application, 0, MOFCODEC_FORMAT, &g_CurrentStatusStore.serializer);
     if (r != MI_RESULT_OK)
     {
-        MI_Application_Close(&miApp);
-        return r;
+        MI_Application_Close(&g_CurrentStatusStore.application);
+        DSC_free(g_CurrentStatusStore.path);
+        g_CurrentStatusStore.path = NULL;
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_LCMHELPER_METASCHEMA_CREATESERIALIZE_FAILED);
     }
 
-    serializerBuffer = (MI_Char*) DSC_malloc(bufferSize, NitsHere());
-    if (serializerBuffer == NULL)
+    g_CurrentStatusStore.buffer = (MI_Uint8*) DSC_malloc(METACONFIG_MAX_BUFFER_SIZE, NitsHere());
+    if (g_CurrentStatusStore.buffer == NULL)
     {
-        MI_Application_Close(&miApp);
+        MI_Serializer_Close(&g_CurrentStatusStore.serializer);
+        MI_Application_Close(&g_CurrentStatusStore.application);
+        DSC_free(g_CurrentStatusStore.path);
+        g_CurrentStatusStore.path = NULL;
         return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_LCMHELPER_MEMORY_ERROR);
     }
 
-    r = MI_Application_NewSerializer_Mof(&miApp, 0, MOFCODEC_FORMAT, &serializer);
-    if (r != MI_RESULT_OK )
+    return MI_RESULT_OK;
+}
+
+void CloseCurrentStatusStore()
+{
+    if (g_CurrentStatusStore.buffer == NULL)
     {
-        DSC_free(serializerBuffer);
-        MI_Application_Close(&miApp);        
-        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_LCMHELPER_METASCHEMA_CREATESERIALIZE_FAILED);
+        return;
     }
 
-    r = MI_Serializer_SerializeInstance(&serializer, 0, g_DSCInternalCache, (MI_Uint8*) serializerBuffer, bufferSize , &bufferUsed);
-    MI_Serializer_Close(&serializer);
-    MI_Application_Close(&miApp);     
-    if (r != MI_RESULT_OK )    
+    MI_Serializer_Close(&g_CurrentStatusStore.serializer);
+    MI_Application_Close(&g_CurrentStatusStore.application);
+    DSC_free(g_CurrentStatusStore.buffer);
+    DSC_free(g_CurrentStatusStore.path);
+    memset(&g_CurrentStatusStore, 0, sizeof(g_CurrentStatusStore));
+}
+
+MI_Result FlushCurrentStatus(
+    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r;
+    MI_Uint32 bufferUsed = 0;
+
+    if (extendedError == NULL)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+    *extendedError = NULL;
+
+    if (!g_CurrentStatusStore.dirty || g_DSCInternalCache == NULL)
+    {
+        return MI_RESULT_OK;
+    }
+
+    r = OpenCurrentStatusStore(extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
+
+    r = MI_Serializer_SerializeInstance(&g_CurrentStatusStore.serializer, 0, g_DSCInternalCache, g_CurrentStatusStore.buffer, METACONFIG_MAX_BUFFER_SIZE, &bufferUsed);
+    if (r != MI_RESULT_OK)
     {
-        DSC_free(serializerBuffer);  
         return GetCimMIError(MI_RESULT_INVALID_CLASS, extendedError, ID_LCMHELPER_METASCHEMA_CREATESERIALIZE_FAILED);
     }
 
-    r = ExpandPath(CONFIGURATION_LOCATION_INTERNALSTATECACHE, &fileExpandedPath, extendedError);
-    if (r != MI_RESULT_OK )    
+    // SaveFile replaces the file by rename, so a crash leaves the previous state intact.
+    r = SaveFile(g_CurrentStatusStore.path, g_CurrentStatusStore.buffer, bufferUsed, extendedError);
+    if (r == MI_RESULT_OK)
+    {
+        g_CurrentStatusStore.dirty = MI_FALSE;
+    }
+
+    return r;
+}
+
+static MI_Result UpdateCurrentStatusLocked(
+    _In_opt_ MI_Boolean *complianceStatus,
+    _In_opt_ MI_Uint32 *getActionStatusCode,
+        _In_opt_ MI_Uint32 *lcmStatusCode,
+    _In_opt_ MI_Char* registeredServerURLs,
+    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+
+    r = OpenCurrentStatusStore(extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
+
+    r = UpdateDSCCacheInstance(&g_CurrentStatusStore.application, &g_DSCInternalCache, complianceStatus, getActionStatusCode, lcmStatusCode, registeredServerURLs, extendedError);
+    if (r != MI_RESULT_OK)
     {
-        DSC_free(serializerBuffer);  
         return r;
     }
 
-    File_RemoveT(fileExpandedPath);
-    r = SaveFile(fileExpandedPath, (MI_Uint8*) serializerBuffer, bufferUsed, extendedError);
-    DSC_free(serializerBuffer); 
-    DSC_free(fileExpandedPath);
+    g_CurrentStatusStore.dirty = MI_TRUE;
+    if (lcmStatusCode != NULL && *lcmStatusCode != LCM_STATUSCODE_BUSY)
+    {
+        r = FlushCurrentStatus(extendedError);
+    }
 
         UpdateLCMStatusCodeHistory(&g_DSCInternalCache, &g_LCMStatusCodeHistory);
 
     return r;
 }
 
+MI_Result UpdateCurrentStatus(
+    _In_opt_ MI_Boolean *complianceStatus,
+    _In_opt_ MI_Uint32 *getActionStatusCode,
+        _In_opt_ MI_Uint32 *lcmStatusCode,
+    _In_opt_ MI_Char* registeredServerURLs,
+    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r;
+
+    RecursiveLock_Acquire(&g_lcmStatusLock);
+    r = UpdateCurrentStatusLocked(complianceStatus, getActionStatusCode, lcmStatusCode, registeredServerURLs, extendedError);
+    RecursiveLock_Release(&g_lcmStatusLock);
+    return r;
+}
+
 void GetLatestStatus(
     _Out_ MI_Boolean *complianceStatus,
     _Out_ MI_Uint32 *getActionStatusCode,
@@ -5948,6 +6509,7 @@ void GetLatestStatus(
     *complianceStatus = MI_FALSE;
     *getActionStatusCode = GET_ACTION_STATUS_CODE_SUCCESS;
         *lcmStatusCode = LCM_STATUSCODE_READY;
+    RecursiveLock_Acquire(&g_lcmStatusLock);
     if (g_DSCInternalCache)
     {
         if (MI_Instance_GetElement(g_DSCInternalCache, DSC_InternalStateCache_ComplianceStatus, &value, &type, &flags, NULL) == MI_RESULT_OK)
@@ -5965,6 +6527,7 @@ void GetLatestStatus(
                         *lcmStatusCode = (MI_Uint32)value.sint64;
                 }
     }
+    RecursiveLock_Release(&g_lcmStatusLock);
 }
 
 MI_Result LCM_Pull_ExecuteActionPerConfiguration(
@@ -6574,8 +7137,17 @@ MI_Result SetLCMStatusBusy()
         MI_Uint32 lcmStatus;
         MI_Instance *extendedError;
         MI_Result r;
-        
-        g_currentError[0] = '\0';
+
+        RecursiveLock_Acquire(&g_lcmStatusLock);
+        HoldJobId();
+        if (g_lcmStatusBusyCount++ > 0)
+        {
+            // Another operation already reported the LCM busy.
+            RecursiveLock_Release(&g_lcmStatusLock);
+            return MI_RESULT_OK;
+        }
+
+        SetCurrentError(NULL);
 
         if (!g_LCMPendingReboot)
         {
@@ -6596,6 +7168,7 @@ MI_Result SetLCMStatusBusy()
         }
         
         ReportStatusToServer(NULL, NULL, NULL, NULL, 0, MI_FALSE, /*isStatusReport*/ 1, (MI_Instance*)NULL);
+        RecursiveLock_Release(&g_lcmStatusLock);
 
         // errors in above invocation are silently ignored since failure of updating status should not block other operations
         r = MI_RESULT_OK;
@@ -6607,6 +7180,20 @@ MI_Result SetLCMStatusReady()
         MI_Uint32 lcmStatus;
         MI_Instance *extendedError;
         MI_Result r;
+        MI_Boolean heldJobId = MI_FALSE;
+
+        RecursiveLock_Acquire(&g_lcmStatusLock);
+        if (g_lcmStatusBusyCount > 0)
+        {
+            heldJobId = MI_TRUE;
+            if (--g_lcmStatusBusyCount > 0)
+            {
+                // Operations that are still running keep the LCM busy.
+                ReleaseJobId();
+                RecursiveLock_Release(&g_lcmStatusLock);
+                return MI_RESULT_OK;
+            }
+        }
 
         if (!g_LCMPendingReboot)
         {
@@ -6622,6 +7209,11 @@ MI_Result SetLCMStatusReady()
         }
 
         ReportStatusToServer(NULL, NULL, NULL, NULL, 0, MI_TRUE, /*isStatusReport*/ 1, (MI_Instance*)NULL);
+        if (heldJobId)
+        {
+            ReleaseJobId();
+        }
+        RecursiveLock_Release(&g_lcmStatusLock);
 
         // errors in above invocation are silently ignored since failure of updating status should not block other operations
         r = MI_RESULT_OK;
@@ -6634,6 +7226,7 @@ MI_Result SetLCMStatusReboot()
         MI_Instance *extendedError;
         MI_Result r;
 
+        RecursiveLock_Acquire(&g_lcmStatusLock);
         g_LCMPendingReboot = MI_TRUE;
         lcmStatus = LCM_STATUSCODE_REBOOT;
         r = UpdateCurrentStatus(NULL, NULL, &lcmStatus, NULL, &extendedError);
@@ -6644,6 +7237,7 @@ MI_Result SetLCMStatusReboot()
 #ifdef TEST_BUILD
                 NitsAssert(r == MI_RESULT_OK, "UpdateCurrentStatus should succeed");
 #endif
+        RecursiveLock_Release(&g_lcmStatusLock);
 
         // errors in above invocation are silently ignored since failure of updating status should not block other operations
         r = MI_RESULT_OK;
@@ -81,6 +81,8 @@ extern "C"
 
     MI_Result UnInitHandler(_Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
 
+    MI_Boolean IsLcmInitialized();
+
     MI_Result ApplyConfig(_In_ LCMProviderContext *lcmContext,
                              _In_z_ const MI_Char *configFileLocation,
                              _In_ ModuleManager *moduleManager,
@@ -286,6 +288,12 @@ extern "C"
         _In_opt_ MI_Char *registeredServerURLs,
         _Outptr_result_maybenull_ MI_Instance **extendedError);
 
+    // Writes the internal state cache if UpdateCurrentStatus changed it since the last write.
+    MI_Result FlushCurrentStatus(
+        _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+    void CloseCurrentStatusStore();
+
     void GetLatestStatus(
         _Out_ MI_Boolean *complianceStatus,
         _Out_ MI_Uint32 *getActionStatusCode,
@@ -380,6 +388,11 @@ extern "C"
 
     const MI_Char * GetPartialConfigBaseDocumentInstanceTmpFileName();
 
+    /*Checksum of the current configuration, or of the partial configuration 'configName'*/
+    MI_Result GetMofChecksum(_Outptr_result_maybenull_z_  MI_Char** mofChecksum,
+        _In_z_ const MI_Char* configName,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
+
     /*Function to obtain the partial configuration file name*/
     MI_Result GetPartialConfigStoreLocation(_In_ ModuleManager * moduleManager,
         _In_count_(documentSize) const MI_Uint8* configData,
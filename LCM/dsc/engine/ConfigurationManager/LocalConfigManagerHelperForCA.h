@@ -22,7 +22,8 @@
 
 RecursiveLock g_cs_CurrentWmiv2Operation;
 Sem g_h_ConfigurationStoppedEvent;
-volatile BOOL g_CancelConfiguration;
+// TRUE while a StopConfiguration is pending; set with Atomic_Swap, it is read from scheduler threads too.
+volatile ptrdiff_t g_CancelConfiguration;
 
 
 #ifdef __cplusplus
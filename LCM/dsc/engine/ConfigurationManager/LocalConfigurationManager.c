@@ -33,179 +33,278 @@ struct _LCMTaskNode
 {
     ThreadProc task;
     void* params;
+    MI_Boolean readOnly;
     LCMTaskNode * next;
 };
 
+/*
+    Queued operations are run by up to LCM_TASK_QUEUE_MAX_WORKERS persistent
+    worker threads that sleep on g_TaskQueueCond while there is nothing to run.
+    Tasks start in arrival order: the head of the queue starts when the LCM is
+    idle, or when it is read-only and only read-only tasks are running.
+*/
+#define LCM_TASK_QUEUE_MAX_WORKERS 4
+
 static LCMTaskNode * g_TaskHead = NULL;
-static pthread_mutex_t g_TaskQueueMutex;
+static LCMTaskNode * g_TaskTail = NULL;
+static pthread_mutex_t g_TaskQueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_TaskQueueCond = PTHREAD_COND_INITIALIZER;
 static int g_TaskQueueShutdown = 0;
-static int g_TaskQueueExists = 0;
+static int g_TaskWorkerCount = 0;
+static int g_TaskIdleWorkerCount = 0;
+static int g_TaskRunningCount = 0;
+static MI_Boolean g_TaskRunningWriter = MI_FALSE;
+// Name of the running operation that is not read-only, if any.
 static MI_Char g_CurrentRunningMethodName[LCM_MAX_PATH] = {0};
 
-// This method is to verify if a task node can be added in the operation queue or not.
-// Task is not allowed to add in queue in following conditions.
-//     1. Incoming dsc task request is ‘PerformRequiredConfigurationChecks’
-//          and
-//            a. Consistency Check is already running.
-//            b. Consistency Check is already queued to run later.
-MI_Boolean TaskAllowedToAddInQueue(LCMTaskNode * node)
+typedef struct _LCMTaskCoalescePolicy
 {
-    LCMTaskNode* current;
-    MI_Boolean result = MI_TRUE;
+    const MI_Char* methodName;
+    MI_Boolean whileRunning;
+} LCMTaskCoalescePolicy;
+
+// Operations that only ask the LCM to do work it will do anyway. A request
+// without input data is dropped when an identical one is already queued (or,
+// for whileRunning, already running), and answered right away.
+static const LCMTaskCoalescePolicy g_TaskCoalescePolicies[] =
+{
+    { MSFT_DSCLocalConfigManager_PerformRequiredConfigurationChecks, MI_TRUE },
+    { MSFT_DSCLocalConfigManager_PerformInventory, MI_FALSE },
+};
 
-    if(node == NULL)
+static MI_Boolean TaskHasInput(Context_Invoke_Basic *args)
+{
+    return (args->data.data != NULL || (args->stringdata != NULL && args->stringdata[0] != '\0')) ? MI_TRUE : MI_FALSE;
+}
+
+static void FreeTaskArgs(Context_Invoke_Basic *args)
+{
+    if (args->data.data != NULL)
     {
-        return result;
+        PAL_Free((void*)args->data.data);
     }
+    if (args->stringdata != NULL)
+    {
+        PAL_Free(args->stringdata);
+    }
+    PAL_Free(args);
+}
 
+// This method is to verify if a task node can be added in the operation queue or not.
+// Task is not allowed to add in queue when it matches a coalescing policy, has no
+// input data and an identical request is
+//     a. already queued to run later, or
+//     b. already running, if the policy says so.
+// Must be called with g_TaskQueueMutex held.
+static MI_Boolean TaskAllowedToAddInQueue(LCMTaskNode * node)
+{
+    LCMTaskNode* current;
+    const LCMTaskCoalescePolicy *policy = NULL;
     Context_Invoke_Basic *nodeArgs = (Context_Invoke_Basic *)node->params;
-    if(nodeArgs == NULL || nodeArgs->methodName == NULL)
+    size_t i;
+
+    if(nodeArgs == NULL || nodeArgs->methodName == NULL || TaskHasInput(nodeArgs))
     {
-        return result;
+        return MI_TRUE;
     }
 
-    pthread_mutex_lock(&g_TaskQueueMutex);
-
-    // if incoming request is consistency request.
-    if(Tcscasecmp(nodeArgs->methodName, MSFT_DSCLocalConfigManager_PerformRequiredConfigurationChecks) == 0)
+    for (i = 0; i < sizeof(g_TaskCoalescePolicies) / sizeof(g_TaskCoalescePolicies[0]); ++i)
     {
-        // verify if consistency operation is already queued.
-        current = g_TaskHead;
-        while (current != NULL)
+        if (Tcscasecmp(nodeArgs->methodName, g_TaskCoalescePolicies[i].methodName) == 0)
         {
-            Context_Invoke_Basic *currentNodeArgs = current->params;
-            if(currentNodeArgs == NULL || currentNodeArgs->methodName == NULL)
-            {
-                current = current->next;
-                continue;
-            }
+            policy = &g_TaskCoalescePolicies[i];
+            break;
+        }
+    }
 
-            // Only one consistency operation can be queued.
-            if(Tcscasecmp(currentNodeArgs->methodName, MSFT_DSCLocalConfigManager_PerformRequiredConfigurationChecks) == 0)
-            {
-                DSC_EventWriteMessageDscOperationAlreadyQueued(currentNodeArgs->methodName);
-                result = MI_FALSE;
-                goto Cleanup;
-            }
+    if (policy == NULL)
+    {
+        return MI_TRUE;
+    }
 
-            current = current->next;
+    for (current = g_TaskHead; current != NULL; current = current->next)
+    {
+        Context_Invoke_Basic *currentNodeArgs = current->params;
+        if(currentNodeArgs == NULL || currentNodeArgs->methodName == NULL || TaskHasInput(currentNodeArgs))
+        {
+            continue;
         }
 
-        // verify if consistency operation is already running.
-        if(Tcscasecmp(g_CurrentRunningMethodName, MSFT_DSCLocalConfigManager_PerformRequiredConfigurationChecks) == 0)
+        if(Tcscasecmp(currentNodeArgs->methodName, nodeArgs->methodName) == 0)
         {
-            DSC_EventWriteMessageDscOperationAlreadyRunning(nodeArgs->methodName);
-            result = MI_FALSE;
-            goto Cleanup;
+            DSC_EventWriteMessageDscOperationAlreadyQueued(currentNodeArgs->methodName);
+            return MI_FALSE;
         }
     }
 
-Cleanup:
-    pthread_mutex_unlock(&g_TaskQueueMutex);
-    return result;
+    if(policy->whileRunning && Tcscasecmp(g_CurrentRunningMethodName, nodeArgs->methodName) == 0)
+    {
+        DSC_EventWriteMessageDscOperationAlreadyRunning(nodeArgs->methodName);
+        return MI_FALSE;
+    }
+
+    return MI_TRUE;
 }
 
-void AddToTaskQueue(LCMTaskNode * node)
+static MI_Boolean TaskCanStart(LCMTaskNode * node)
 {
-    LCMTaskNode* current;
-    if(!TaskAllowedToAddInQueue(node))
+    if (g_TaskRunningCount == 0)
     {
-        Context_Invoke_Basic *args = (Context_Invoke_Basic *)node->params;
-        MI_Context_PostResult(args->context, MI_RESULT_OK);
-        DSC_free(node);
-        return;
+        return MI_TRUE;
     }
 
-    pthread_mutex_lock(&g_TaskQueueMutex);
+    // The first operation initializes the LCM, so read-only operations only overlap once that is done.
+    return (node->readOnly && !g_TaskRunningWriter && IsLcmInitialized()) ? MI_TRUE : MI_FALSE;
+}
 
-    if (g_TaskHead == NULL)
+static PAL_Uint32 THREAD_API TaskQueueWorker(void* param);
+
+// Wakes an idle worker, or starts a new one if all of them are busy.
+static void WakeTaskWorker()
+{
+    if (g_TaskIdleWorkerCount > 0)
     {
-        g_TaskHead = node;
+        pthread_cond_signal(&g_TaskQueueCond);
     }
-    else
+    else if (g_TaskWorkerCount < LCM_TASK_QUEUE_MAX_WORKERS)
     {
-        current = g_TaskHead;
-        while (current != NULL)
+        if (Thread_CreateDetached(TaskQueueWorker, NULL, NULL) == 0)
         {
-            if (current->next == NULL)
-            {
-            current->next = node;
-            break;
-            }
-            else
-            {
-            current = current->next;
-            }
+            g_TaskWorkerCount++;
         }
     }
-    pthread_mutex_unlock(&g_TaskQueueMutex);
 }
 
-void TaskQueueLoop()
+static PAL_Uint32 THREAD_API TaskQueueWorker(void* param)
 {
-    int shouldShutdown;
-    LCMTaskNode * currentTask = NULL;
+    MI_UNREFERENCED_PARAMETER(param);
 
     pthread_mutex_lock(&g_TaskQueueMutex);
-    shouldShutdown = g_TaskQueueShutdown;
-    pthread_mutex_unlock(&g_TaskQueueMutex);
 
-    while (shouldShutdown == 0)
+    for (;;)
     {
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskHead != NULL)
+        LCMTaskNode * currentTask;
+        MI_Boolean readOnly;
+        ptrdiff_t start,finish;
+        MI_Real64 duration;
+        MI_Char wcTime[DURATION_SIZE] = {0};
+        MI_Char methodName[LCM_MAX_PATH] = {0};
+        Context_Invoke_Basic *nodeArgs;
+
+        while (g_TaskQueueShutdown == 0 && (g_TaskHead == NULL || !TaskCanStart(g_TaskHead)))
         {
-            Thread t;
-            PAL_Uint32 ret;
-            ptrdiff_t start,finish;
-            MI_Real64 duration;
-            MI_Char wcTime[DURATION_SIZE] = {0};
+            g_TaskIdleWorkerCount++;
+            pthread_cond_wait(&g_TaskQueueCond, &g_TaskQueueMutex);
+            g_TaskIdleWorkerCount--;
+        }
 
-            currentTask = g_TaskHead;
-            g_TaskHead = currentTask->next;
+        if (g_TaskQueueShutdown != 0)
+        {
+            break;
+        }
 
-            Context_Invoke_Basic *nodeArgs = (Context_Invoke_Basic *)currentTask->params;
-            if(nodeArgs != NULL && nodeArgs->methodName != NULL)
-            {
-                Tcslcpy(g_CurrentRunningMethodName, nodeArgs->methodName, LCM_MAX_PATH);
-            }
-            pthread_mutex_unlock(&g_TaskQueueMutex);
+        currentTask = g_TaskHead;
+        g_TaskHead = currentTask->next;
+        if (g_TaskHead == NULL)
+        {
+            g_TaskTail = NULL;
+        }
 
-            DSC_EventWriteMessageStartingDscOperation(g_CurrentRunningMethodName);
+        readOnly = currentTask->readOnly;
+        nodeArgs = (Context_Invoke_Basic *)currentTask->params;
+        if(nodeArgs != NULL && nodeArgs->methodName != NULL)
+        {
+            Tcslcpy(methodName, nodeArgs->methodName, LCM_MAX_PATH);
+        }
 
-            // Capture timestamp when operation started.
-            start=CPU_GetTimeStamp();
+        g_TaskRunningCount++;
+        if (!readOnly)
+        {
+            g_TaskRunningWriter = MI_TRUE;
+            Tcslcpy(g_CurrentRunningMethodName, methodName, LCM_MAX_PATH);
+        }
+        else if (g_TaskHead != NULL && TaskCanStart(g_TaskHead))
+        {
+            WakeTaskWorker();
+        }
+        pthread_mutex_unlock(&g_TaskQueueMutex);
 
-            Thread_CreateJoinable(&t, currentTask->task, NULL, currentTask->params);
-            Thread_Join(&t, &ret);
-            Thread_Destroy(&t);
-            DSC_free(currentTask);
+        DSC_EventWriteMessageStartingDscOperation(methodName);
 
-            // Operation is completed.
-            finish=CPU_GetTimeStamp();
-            duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
-            Stprintf(wcTime, DURATION_SIZE, MI_T("%0.4f"), duration);
+        // Capture timestamp when operation started.
+        start=CPU_GetTimeStamp();
 
-            DSC_EventWriteMessageDscOperationCompleted(g_CurrentRunningMethodName, wcTime);
-            g_CurrentRunningMethodName[0] = '\0';
-        }
-        else
+        currentTask->task(currentTask->params);
+        DSC_free(currentTask);
+
+        // Operation is completed.
+        finish=CPU_GetTimeStamp();
+        duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
+        Stprintf(wcTime, DURATION_SIZE, MI_T("%0.4f"), duration);
+
+        DSC_EventWriteMessageDscOperationCompleted(methodName, wcTime);
+
+        pthread_mutex_lock(&g_TaskQueueMutex);
+        g_TaskRunningCount--;
+        if (!readOnly)
         {
-            currentTask = NULL;
-            pthread_mutex_unlock(&g_TaskQueueMutex);
+            g_TaskRunningWriter = MI_FALSE;
+            g_CurrentRunningMethodName[0] = '\0';
         }
+        pthread_cond_broadcast(&g_TaskQueueCond);
+    }
 
-        usleep(10000);
+    g_TaskWorkerCount--;
+    pthread_cond_broadcast(&g_TaskQueueCond);
+    pthread_mutex_unlock(&g_TaskQueueMutex);
+    return 0;
+}
 
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        shouldShutdown = g_TaskQueueShutdown;
-        pthread_mutex_unlock(&g_TaskQueueMutex);
+static void AddToTaskQueue(ThreadProc task, Context_Invoke_Basic *args)
+{
+    MI_Instance *cimErrorDetails = NULL;
+    LCMTaskNode * node = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
+    if (node == NULL)
+    {
+        GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, &cimErrorDetails, ID_LCMHELPER_MEMORY_ERROR);
+        MI_PostCimError(args->context, cimErrorDetails);
+        MI_Instance_Delete(cimErrorDetails);
+        FreeTaskArgs(args);
+        return;
     }
 
+    node->task = task;
+    node->params = args;
+    node->readOnly = args->methodName != NULL ? IsReadOnlyLcmOperation(args->methodName) : MI_FALSE;
+    node->next = NULL;
+
     pthread_mutex_lock(&g_TaskQueueMutex);
-    g_TaskQueueShutdown = 0;
-    g_TaskHead = NULL;
-    g_TaskQueueExists = 0;
+
+    if(!TaskAllowedToAddInQueue(node))
+    {
+        pthread_mutex_unlock(&g_TaskQueueMutex);
+        MI_Context_PostResult(args->context, MI_RESULT_OK);
+        FreeTaskArgs(args);
+        DSC_free(node);
+        return;
+    }
+
+    if (g_TaskTail == NULL)
+    {
+        g_TaskHead = node;
+    }
+    else
+    {
+        g_TaskTail->next = node;
+    }
+    g_TaskTail = node;
+
+    // Otherwise a worker picks the task up when the operation ahead of it completes.
+    if (g_TaskHead == node && TaskCanStart(node))
+    {
+        WakeTaskWorker();
+    }
+
     pthread_mutex_unlock(&g_TaskQueueMutex);
 }
 
@@ -234,7 +333,7 @@ void UnloadFromProvider(
 {
     MI_Result miResult;
     MI_Instance *cimErrorDetails = NULL;
-    int taskQueueExists;
+    LCMTaskNode * pending;
     MI_UNREFERENCED_PARAMETER(self);
 
     miResult = UnInitHandler(&cimErrorDetails);
@@ -247,17 +346,30 @@ void UnloadFromProvider(
 
     pthread_mutex_lock(&g_TaskQueueMutex);
     g_TaskQueueShutdown = 1;
-    pthread_mutex_unlock(&g_TaskQueueMutex);
+    pthread_cond_broadcast(&g_TaskQueueCond);
 
-    // Wait until the TaskQueue is complete before allowing unload
-    do
+    // Wait until the running operations are complete before allowing unload
+    while (g_TaskWorkerCount != 0)
     {
-        usleep(10000);
+        pthread_cond_wait(&g_TaskQueueCond, &g_TaskQueueMutex);
+    }
 
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        taskQueueExists = g_TaskQueueExists;
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    } while (taskQueueExists != 0);
+    // Operations that never started are answered instead of being dropped.
+    pending = g_TaskHead;
+    g_TaskHead = NULL;
+    g_TaskTail = NULL;
+    g_TaskQueueShutdown = 0;
+    pthread_mutex_unlock(&g_TaskQueueMutex);
+
+    while (pending != NULL)
+    {
+        LCMTaskNode * next = pending->next;
+        Context_Invoke_Basic *args = (Context_Invoke_Basic *)pending->params;
+        MI_Context_PostResult(args->context, MI_RESULT_FAILED);
+        FreeTaskArgs(args);
+        DSC_free(pending);
+        pending = next;
+    }
 
     MI_Context_PostResult(context, MI_RESULT_OK);
 }
@@ -338,7 +450,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_SendConfigurationApply_Internal(void *p
     duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
     LCM_WriteMessage_Internal_TimeTaken(args->context,EMPTY_STRING, ID_LCM_TIMEMESSAGE,  ID_OUTPUT_ITEM_SET,(const MI_Real64)duration, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -351,7 +463,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_SendConfigurationApply_Internal(void *p
 
 ExitWithError:
     ResetJobId();
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -369,6 +481,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
     MI_Uint32 bufferIndex = 0;
     MSFT_DSCLocalConfigurationManager_GetConfiguration outputObject;
     MI_Uint8A dataValue = {0};
+    DSC_FileView configurationView = {0};
     //Declarations for measuring time
     MI_Real64 duration;
     ptrdiff_t start, finish;
@@ -415,6 +528,9 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
         return 0;
     }
 
+    // Every path from here reaches SetLCMStatusReady, which must pair with this call.
+    SetLCMStatusBusy();
+
     // If the configuration file has not been passed in the parameters
     if (!args->dataExist)
     {
@@ -429,19 +545,21 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
             else
             {
                 // Read file contents from the pending configuration file into dataValue
-                miResult = ReadFileContent(GetPendingConfigFileName(), &dataValue.data, &dataValue.size, &cimErrorDetails);
+                miResult = DSC_FileView_OpenReplaced(GetPendingConfigFileName(), &configurationView, &cimErrorDetails);
             }
         }
         else
         {
             // Read file contents from the current configuration file into dataValue
-            miResult = ReadFileContent(GetCurrentConfigFileName(), &dataValue.data, &dataValue.size, &cimErrorDetails);
+            miResult = DSC_FileView_OpenReplaced(GetCurrentConfigFileName(), &configurationView, &cimErrorDetails);
         }
 
         if (miResult != MI_RESULT_OK)
         {
             goto ExitWithError;
         }
+        dataValue.data = configurationView.data;
+        dataValue.size = configurationView.size;
     }
     else
     {
@@ -459,7 +577,6 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
     }
 
     start=CPU_GetTimeStamp();
-    SetLCMStatusBusy();
     miResult = CallGetConfiguration(dataValue.data,
         dataValue.size, &outInstances,
         args->context, &cimErrorDetails);
@@ -499,16 +616,13 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
     duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
     LCM_WriteMessage_Internal_TimeTaken(args->context,EMPTY_STRING, ID_LCM_TIMEMESSAGE,  ID_OUTPUT_ITEM_GET,(const MI_Real64)duration, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
     //Debug Log
     DSC_EventWriteMethodEnd(__WFUNCTION__);
-    if (!args->dataExist)
-    {
-       DSC_free(dataValue.data);
-    }
+    DSC_FileView_Close(&configurationView);
 
     ResetJobId();
     if (args->dataExist)
@@ -521,14 +635,11 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetConfiguration_Internal(void *param)
 
 ExitWithError:
     ResetJobId();
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
-    if (!args->dataExist)
-    {
-       DSC_free(dataValue.data);
-    }
+    DSC_FileView_Close(&configurationView);
     if (args->dataExist)
     {
         PAL_Free(args->data.data);
@@ -575,6 +686,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_ApplyConfiguration_Internal(void *param
         return 0;
     }
 
+    SetLCMStatusBusy();
     miResult = MSFT_DSCLocalConfigurationManager_ApplyConfiguration_Construct(&outputObject, args->context);
     if (miResult != MI_RESULT_OK)
     {
@@ -582,7 +694,6 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_ApplyConfiguration_Internal(void *param
         goto ExitWithError;
     }
 
-    SetLCMStatusBusy();
     miResult = CallConsistencyEngine(args->context, TASK_REGULAR, &cimErrorDetails);
     if (miResult != MI_RESULT_OK)
     {
@@ -604,7 +715,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_ApplyConfiguration_Internal(void *param
         goto ExitWithError;
     }
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -615,7 +726,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_ApplyConfiguration_Internal(void *param
     return 0;
 
 ExitWithError:
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -701,14 +812,15 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetMetaConfiguration_Internal(void *par
     MSFT_DSCLocalConfigurationManager_GetMetaConfiguration_Destruct(&outputObject);
     if (miResult != MI_RESULT_OK)
     {
-        EndLcmOperation();
+        EndLcmOperation(args->methodName);
+        SetLCMStatusReady();
         MI_Context_PostResult(args->context, miResult);
         ResetJobId();
         PAL_Free(args);
         return 0;
     }
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -719,7 +831,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_GetMetaConfiguration_Internal(void *par
     return 0;
 
 ExitWithError:
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -783,7 +895,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_RollBack_Internal(void *param)
     duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
     LCM_WriteMessage_Internal_TimeTaken(args->context,EMPTY_STRING, ID_LCM_TIMEMESSAGE, ID_OUTPUT_ITEM_ROLLBACK,(const MI_Real64)duration, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -794,7 +906,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_RollBack_Internal(void *param)
     return 0;
 
 ExitWithError:
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -848,6 +960,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_TestConfiguration_Internal(void *param)
         return 0;
     }
 
+    SetLCMStatusBusy();
     miResult = MSFT_DSCLocalConfigurationManager_TestConfiguration_Construct(&outputObject, args->context);
     if (miResult != MI_RESULT_OK)
     {
@@ -855,7 +968,6 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_TestConfiguration_Internal(void *param)
         goto ExitWithError;
     }
 
-    SetLCMStatusBusy();
     miResult = CallTestConfiguration(&testStatus, &resourceId, args->context, &cimErrorDetails);
     if (miResult != MI_RESULT_OK)
     {
@@ -906,7 +1018,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_TestConfiguration_Internal(void *param)
     duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
     LCM_WriteMessage_Internal_TimeTaken(args->context,EMPTY_STRING, ID_LCM_TIMEMESSAGE, ID_OUTPUT_ITEM_TEST, (const MI_Real64)duration, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -917,7 +1029,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_TestConfiguration_Internal(void *param)
     return 0;
 
 ExitWithError:
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -1043,7 +1155,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformRequiredConfigurationChecks_Inte
     MI_Context_PostResult(args->context, miResult);
 
 ExitSimple:
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     // Debug log
     DSC_EventWriteMethodEnd(__WFUNCTION__);
@@ -1189,21 +1301,7 @@ void Invoke_SendConfiguration(
         args->force = MI_TRUE;
     }
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_SendConfigurationApply_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_SendConfigurationApply_Internal, args);
 }
 
 void Invoke_SendConfigurationApply(
@@ -1266,21 +1364,7 @@ void Invoke_SendConfigurationApply(
         args->force = MI_TRUE;
     }
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_SendConfigurationApply_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_SendConfigurationApply_Internal, args);
 }
 
 void Invoke_GetConfiguration(
@@ -1350,21 +1434,7 @@ void Invoke_GetConfiguration(
     args->data.data = dataValue;
     args->data.size = dataSize;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_GetConfiguration_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_GetConfiguration_Internal, args);
 }
 
 void Invoke_ApplyConfiguration(
@@ -1408,21 +1478,7 @@ void Invoke_ApplyConfiguration(
     args->context = context;
     args->methodName = methodName;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_ApplyConfiguration_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_ApplyConfiguration_Internal, args);
 }
 
 void Invoke_SendMetaConfigurationApply(
@@ -1481,21 +1537,7 @@ void Invoke_SendMetaConfigurationApply(
     args->data.size = in->ConfigurationData.value.size;
     args->flag = GetCallSetConfigurationFlags(context) | LCM_SET_METACONFIG;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_SendConfigurationApply_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_SendConfigurationApply_Internal, args);
 }
 
 void Invoke_GetMetaConfiguration(
@@ -1539,21 +1581,7 @@ void Invoke_GetMetaConfiguration(
     args->context = context;
     args->methodName = methodName;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_GetMetaConfiguration_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_GetMetaConfiguration_Internal, args);
 }
 
 void Invoke_RollBack(
@@ -1598,21 +1626,7 @@ void Invoke_RollBack(
     args->methodName = methodName;
     args->flag = GetCallSetConfigurationFlags(context);
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_RollBack_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_RollBack_Internal, args);
 }
 
 void Invoke_TestConfiguration(
@@ -1656,21 +1670,7 @@ void Invoke_TestConfiguration(
     args->context = context;
     args->methodName = methodName;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_TestConfiguration_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_TestConfiguration_Internal, args);
 }
 
 void Invoke_PerformRequiredConfigurationChecks(
@@ -1717,21 +1717,7 @@ void Invoke_PerformRequiredConfigurationChecks(
     if( in && in->Flags.exists)
         args->flag = in->Flags.value;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_PerformRequiredConfigurationChecks_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_PerformRequiredConfigurationChecks_Internal, args);
 }
 
 void Invoke_StopConfiguration(
@@ -1778,21 +1764,7 @@ void Invoke_StopConfiguration(
     if( in )
         args->force = in->force.exists ? in->force.value : MI_FALSE;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_StopConfiguration_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_StopConfiguration_Internal, args);
 }
 
 MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformInventory_Internal(void *param)
@@ -1845,6 +1817,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformInventory_Internal(void *param)
         return 0;
     }
 
+    SetLCMStatusBusy();
     miResult = MSFT_DSCLocalConfigurationManager_PerformInventory_Construct(&outputObject, args->context);
     if (miResult != MI_RESULT_OK)
     {
@@ -1853,7 +1826,6 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformInventory_Internal(void *param)
     }
 
     start=CPU_GetTimeStamp();
-    SetLCMStatusBusy();
 
     InMOF = (MI_Char*) args->stringdata;
 
@@ -1892,7 +1864,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformInventory_Internal(void *param)
     duration = (MI_Real64)(finish- start) / TIME_PER_SECONND;
     LCM_WriteMessage_Internal_TimeTaken(args->context,EMPTY_STRING, ID_LCM_TIMEMESSAGE,  ID_OUTPUT_ITEM_INVENTORY,(const MI_Real64)duration, MI_WRITEMESSAGE_CHANNEL_VERBOSE);
 
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_Context_PostResult(args->context, MI_RESULT_OK);
 
@@ -1907,7 +1879,7 @@ MI_EXTERN_C PAL_Uint32 THREAD_API Invoke_PerformInventory_Internal(void *param)
 
 ExitWithError:
     ResetJobId();
-    EndLcmOperation();
+    EndLcmOperation(args->methodName);
     SetLCMStatusReady();
     MI_PostCimError(args->context, cimErrorDetails);
     MI_Instance_Delete(cimErrorDetails);
@@ -1967,21 +1939,7 @@ void Invoke_PerformInventory(
     args->context = context;
     args->methodName = methodName;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_PerformInventory_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_PerformInventory_Internal, args);
 }
 
 void Invoke_PerformInventoryOOB(
@@ -2044,19 +2002,5 @@ void Invoke_PerformInventoryOOB(
     args->context = context;
     args->methodName = methodName;
 
-    {
-        LCMTaskNode * newNode = (LCMTaskNode*)DSC_malloc(sizeof(LCMTaskNode), NitsHere());
-        newNode->task = Invoke_PerformInventory_Internal;
-        newNode->params = args;
-        newNode->next = NULL;
-        AddToTaskQueue(newNode);
-
-        pthread_mutex_lock(&g_TaskQueueMutex);
-        if (g_TaskQueueExists == 0)
-        {
-            Thread_CreateDetached(TaskQueueLoop, NULL, NULL);
-            g_TaskQueueExists = 1;
-        }
-        pthread_mutex_unlock(&g_TaskQueueMutex);
-    }
+    AddToTaskQueue(Invoke_PerformInventory_Internal, args);
 }
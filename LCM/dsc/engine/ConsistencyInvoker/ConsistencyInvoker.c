@@ -18,16 +18,46 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define PYTHON_COMMAND "python"
-#define PYTHON2_COMMAND "python2"
-#define PYTHON3_COMMAND "python3"
+#include "PythonInterpreter.h"
+#include "dsc_host_protocol.h"
+
 #define PYTHON_SCRIPT_NAME "PerformRequiredConfigurationChecks.py"
+#define DSC_HOST_SOCKET_PATH DSC_HOST_BASE_PATH "/" DSCHOST_SOCKET_FILE_NAME
+#define DSC_HOST_OUTPUT_PATH DSC_HOST_BASE_PATH "/output"
+
+// Hands the consistency check to a running 'dsc_host --serve' instead of starting
+// python and a new dsc_host. Returns DscHostService_Unavailable when there is none.
+static DscHostServiceResult InvokeDscHostService(int *exitCode)
+{
+    const char *arguments[] = { "1" };
+    char *output = NULL;
+    DscHostServiceResult result;
+
+    result = DscHost_InvokeService(DSC_HOST_SOCKET_PATH, DSC_HOST_OUTPUT_PATH, "PerformRequiredConfigurationChecks", 1, arguments, exitCode, &output);
+    if (output != NULL)
+    {
+        fputs(output, stdout);
+        free(output);
+    }
 
-char* getPythonProvider();
+    return result;
+}
 
 int main(int argc, char *argv[])
 {
-    char * pythonCommand = PYTHON2_COMMAND;
+    const char * pythonCommand = PYTHON2_COMMAND;
+    int serviceExitCode = 0;
+
+    switch (InvokeDscHostService(&serviceExitCode))
+    {
+        case DscHostService_Ok:
+            return serviceExitCode;
+        case DscHostService_Failed:
+            // The request may have run; do not run it a second time.
+            return 1;
+        default:
+            break;
+    }
 
     char* dscScriptPath = malloc(strlen(DSC_SCRIPT_PATH) + 1);
     if(dscScriptPath == NULL) {
@@ -35,10 +65,7 @@ int main(int argc, char *argv[])
     }
     dscScriptPath = strcpy(dscScriptPath, DSC_SCRIPT_PATH);
 
-    pythonCommand = getPythonProvider();
-    if(pythonCommand == NULL) {
-        return 0;
-    }
+    pythonCommand = PythonInterpreter_GetCommand();
 
     if(strcmp(pythonCommand, PYTHON3_COMMAND) == 0)
     {
@@ -65,62 +92,3 @@ int main(int argc, char *argv[])
     return returnValue;
 }
 
-
-char* getPythonProvider()
-{
-    int buffer_length = 128;
-    char buffer[buffer_length]; 
-    char* result = malloc(1);
-    if(result == NULL) {
-        printf("Not enough memory to execute command.");
-        return NULL;
-    }
-    *result = 0; 
-
-    FILE* pipe = popen("python3 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");   
-    if(!pipe) {
-        printf("Cant start command.");
-    }
-    while(fgets(buffer, 128, pipe) != NULL) {
-        char* tempResult = realloc(result, (result ? strlen(result) : 0) + buffer_length );
-
-        if(NULL == tempResult) {
-            free(result);
-        }
-        result = tempResult;
-        strcat(result,buffer);
-    }
-
-    // If python3 --version exists
-    if(*result != '\0' && result[0] == '3') {
-    	return PYTHON3_COMMAND;
-    }
-
-    // Look for python2
-    result = malloc(1);
-    if(result == NULL) {
-        printf("Not enough memory to execute command.");
-        return NULL;
-    }
-    *result = 0;
-    pipe = popen("python2 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");
-    if(!pipe) {
-    	printf("Cant start command.");
-    }
-    while(fgets(buffer, 128, pipe) != NULL) {
-        char* tempResult = realloc(result, (result ? strlen(result) : 0) + buffer_length );
-
-        if(NULL == tempResult) {
-            free(result);
-        }
-        result = tempResult;
-        strcat(result,buffer);
-    }
-
-    // If python2 --version exists
-    if(*result != '\0' && result[0] == '2') {
-	    return PYTHON2_COMMAND;
-    }
-
-    return PYTHON_COMMAND;
-}
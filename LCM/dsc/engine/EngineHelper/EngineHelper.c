@@ -18,6 +18,10 @@
 #include <MI.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "EngineHelper.h"
 #include "DSC_Systemcalls.h"
 #include "Resources_LCM.h"
@@ -26,7 +30,16 @@
 extern Loc_Mapping g_LocMappingTable[];
 extern MI_Uint32 g_LocMappingTableSize;
 void *g_registrationManager;
-char g_currentError[5001];
+
+// Last error message of the running operation, read by the end-of-run status report.
+// Read-only operations run concurrently, so it is only accessed under g_currentErrorLock.
+static char g_currentError[5001];
+static Lock g_currentErrorLock;
+
+// Concurrent operations share one job id; ResetJobId leaves it alone while any holds it.
+static Lock g_jobIdLock;
+static MI_Uint32 g_jobIdHolders = 0;
+
 StatusReport_ResourceNotInDesiredState * g_rnids = NULL;
 
 #if defined(BUILD_OMS)
@@ -198,7 +211,7 @@ MI_Result GetCimMIError(MI_Result result ,
     GetResourceString(errorStringId, &intlstr);
 
     MI_Utilities_CimErrorFromErrorCode( (MI_Uint32)result, MI_RESULT_TYPE_MI, intlstr.str, cimErrorDetails);
-    strncpy(g_currentError, intlstr.str, 5000);
+    SetCurrentError(intlstr.str);
     DSC_EventWriteCIMError(intlstr.str,(MI_Uint32)result);
     if( intlstr.str)
         Intlstr_Free(intlstr);
@@ -214,7 +227,7 @@ MI_Result GetCimWin32Error(MI_Uint32 result ,
     GetResourceString(errorStringId, &intlstr);
 
     MI_Utilities_CimErrorFromErrorCode( (MI_Uint32)result, MI_RESULT_TYPE_WIN32, intlstr.str, cimErrorDetails);
-    strncpy(g_currentError, intlstr.str, 5000);
+    SetCurrentError(intlstr.str);
     DSC_EventWriteCIMError(intlstr.str,(MI_Uint32)result);
     if( intlstr.str)
         Intlstr_Free(intlstr);
@@ -234,7 +247,7 @@ MI_Result GetCimMIError1Param(MI_Result result ,
     if( resIntlstr.str )
     {
         MI_Utilities_CimErrorFromErrorCode((MI_Uint32)result, MI_RESULT_TYPE_MI, resIntlstr.str, cimErrorDetails);
-        strncpy(g_currentError, resIntlstr.str, 5000);
+        SetCurrentError(resIntlstr.str);
         DSC_EventWriteCIMError(resIntlstr.str,(MI_Uint32)result);
         errorInitialized = TRUE;
         Intlstr_Free(resIntlstr);
@@ -262,7 +275,7 @@ MI_Result GetCimMIError2Params(MI_Result result ,
     if( resIntlstr.str )
     {
         MI_Utilities_CimErrorFromErrorCode((MI_Uint32)result, MI_RESULT_TYPE_MI, resIntlstr.str, cimErrorDetails);
-        strncpy(g_currentError, resIntlstr.str, 5000);
+        SetCurrentError(resIntlstr.str);
         DSC_EventWriteCIMError(resIntlstr.str,(MI_Uint32)result);
         errorInitialized = TRUE;
         Intlstr_Free(resIntlstr);
@@ -291,7 +304,7 @@ MI_Result GetCimMIError3Params(MI_Result result ,
     if( resIntlstr.str )
     {
         MI_Utilities_CimErrorFromErrorCode((MI_Uint32)result, MI_RESULT_TYPE_MI, resIntlstr.str, cimErrorDetails);
-        strncpy(g_currentError, resIntlstr.str, 5000);
+        SetCurrentError(resIntlstr.str);
         DSC_EventWriteCIMError(resIntlstr.str,(MI_Uint32)result);
         errorInitialized = TRUE;
         Intlstr_Free(resIntlstr);
@@ -321,7 +334,7 @@ MI_Result GetCimMIError4Params(MI_Result result ,
     if( resIntlstr.str )
     {
         MI_Utilities_CimErrorFromErrorCode((MI_Uint32)result, MI_RESULT_TYPE_MI, resIntlstr.str, cimErrorDetails);
-        strncpy(g_currentError, resIntlstr.str, 5000);
+        SetCurrentError(resIntlstr.str);
         DSC_EventWriteCIMError(resIntlstr.str,(MI_Uint32)result);
         errorInitialized = TRUE;
         Intlstr_Free(resIntlstr);
@@ -424,7 +437,7 @@ MI_Result ResolvePath(_Outptr_opt_result_maybenull_z_ MI_Char **envResolvedPath,
     return MI_RESULT_OK;
 }
 
-void SetJobId()
+static void SetJobIdLocked()
 {
     MI_Char *palUuid;
     if(g_ConfigurationDetails.hasSetDetail==MI_TRUE)
@@ -442,9 +455,62 @@ void SetJobId()
     PAL_Free(palUuid);
     g_ConfigurationDetails.hasSetDetail=MI_TRUE;
 }
+
+void SetJobId()
+{
+    Lock_Acquire(&g_jobIdLock);
+    SetJobIdLocked();
+    Lock_Release(&g_jobIdLock);
+}
+
 void ResetJobId()
 {
-    g_ConfigurationDetails.hasSetDetail=MI_FALSE;
+    Lock_Acquire(&g_jobIdLock);
+    if (g_jobIdHolders == 0)
+    {
+        g_ConfigurationDetails.hasSetDetail=MI_FALSE;
+    }
+    Lock_Release(&g_jobIdLock);
+}
+
+void HoldJobId()
+{
+    Lock_Acquire(&g_jobIdLock);
+    SetJobIdLocked();
+    g_jobIdHolders++;
+    Lock_Release(&g_jobIdLock);
+}
+
+void ReleaseJobId()
+{
+    Lock_Acquire(&g_jobIdLock);
+    if (g_jobIdHolders > 0 && --g_jobIdHolders == 0)
+    {
+        g_ConfigurationDetails.hasSetDetail=MI_FALSE;
+    }
+    Lock_Release(&g_jobIdLock);
+}
+
+void SetCurrentError(_In_opt_z_ const char *message)
+{
+    Lock_Acquire(&g_currentErrorLock);
+    if (message == NULL)
+    {
+        g_currentError[0] = '\0';
+    }
+    else
+    {
+        strncpy(g_currentError, message, sizeof(g_currentError) - 1);
+    }
+    Lock_Release(&g_currentErrorLock);
+}
+
+void GetCurrentError(_Out_writes_z_(size) char *message, size_t size)
+{
+    Lock_Acquire(&g_currentErrorLock);
+    strncpy(message, g_currentError, size - 1);
+    message[size - 1] = '\0';
+    Lock_Release(&g_currentErrorLock);
 }
 
 void CleanUpClassCache(_Inout_ MI_ClassA *miClassArray)
@@ -835,6 +901,148 @@ MI_Result ReadFileContent(_In_z_ const MI_Char *pFileName,
     return MI_RESULT_OK;
 }
 
+/* Reads what is left of fd into a DSC_malloc'ed buffer; sizeHint is only where to start. */
+static MI_Result ReadFileViewBuffered(int fd,
+                                      size_t sizeHint,
+                                      _Inout_ DSC_FileView *view,
+                                      _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+    MI_Uint8 *buffer = NULL;
+    size_t capacity = sizeHint + 1;
+    size_t length = 0;
+    ssize_t count;
+
+    buffer = (MI_Uint8*)DSC_malloc(capacity, NitsHere());
+    if (buffer == NULL)
+    {
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    for (;;)
+    {
+        if (length == capacity)
+        {
+            MI_Uint8 *grown;
+            if (capacity > MAX_FILEVIEW_SIZE)
+            {
+                DSC_free(buffer);
+                return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_FILESIZE_ERROR);
+            }
+            grown = (MI_Uint8*)DSC_realloc(buffer, capacity * 2, NitsHere());
+            if (grown == NULL)
+            {
+                DSC_free(buffer);
+                return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_MEMORY_ERROR);
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+
+        count = read(fd, buffer + length, capacity - length);
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count < 0)
+        {
+            DSC_free(buffer);
+            return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_READFILE_ERROR);
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        length += (size_t)count;
+    }
+
+    if (length > MAX_FILEVIEW_SIZE)
+    {
+        DSC_free(buffer);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_FILESIZE_ERROR);
+    }
+
+    view->data = buffer;
+    view->size = (MI_Uint32)length;
+    view->mapped = MI_FALSE;
+    return MI_RESULT_OK;
+}
+
+static MI_Result OpenFileView(_In_z_ const MI_Char *pFileName,
+                              MI_Boolean map,
+                              _Out_ DSC_FileView *view,
+                              _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+    MI_Result r;
+    struct stat fileStat;
+    void *mapping;
+    int fd;
+
+    memset(view, 0, sizeof(*view));
+
+    fd = open(pFileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return GetCimMIError(MI_RESULT_FAILED, cimErrorDetails, ID_ENGINEHELPER_OPENFILE_ERROR);
+    }
+
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 0 || (MI_Uint64)fileStat.st_size > MAX_FILEVIEW_SIZE)
+    {
+        close(fd);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, cimErrorDetails, ID_ENGINEHELPER_FILESIZE_ERROR);
+    }
+
+    // Private and writable, so a consumer that scribbles on its input only dirties its own pages.
+    // Callers only ask for a mapping of files that are replaced by rename, never rewritten in place.
+    if (map && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0)
+    {
+        mapping = mmap(NULL, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            madvise(mapping, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+            close(fd);
+            view->data = (MI_Uint8*)mapping;
+            view->size = (MI_Uint32)fileStat.st_size;
+            view->mapped = MI_TRUE;
+            return MI_RESULT_OK;
+        }
+    }
+
+    r = ReadFileViewBuffered(fd, (size_t)fileStat.st_size, view, cimErrorDetails);
+    close(fd);
+    return r;
+}
+
+MI_Result DSC_FileView_Open(_In_z_ const MI_Char *pFileName,
+                            _Out_ DSC_FileView *view,
+                            _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+    return OpenFileView(pFileName, MI_FALSE, view, cimErrorDetails);
+}
+
+MI_Result DSC_FileView_OpenReplaced(_In_z_ const MI_Char *pFileName,
+                                    _Out_ DSC_FileView *view,
+                                    _Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+    return OpenFileView(pFileName, MI_TRUE, view, cimErrorDetails);
+}
+
+void DSC_FileView_Close(_Inout_ DSC_FileView *view)
+{
+    if (view->data != NULL)
+    {
+        if (view->mapped)
+        {
+            munmap(view->data, view->size);
+        }
+        else
+        {
+            DSC_free(view->data);
+        }
+    }
+
+    memset(view, 0, sizeof(*view));
+}
+
 void CleanupTempDirectory(_In_z_ MI_Char *mofFileName)
 {
     /*It is ok if we fail to cleanup temp directory.*/
@@ -186,6 +186,7 @@
 
 /* MSFT_CimConfigurationProviderRegistration*/
 #define MSFT_CimConfigurationProviderRegistration_Namespace                MI_T("Namespace")
+#define MSFT_CimConfigurationProviderRegistration_TimeoutSec               MI_T("TimeoutSec")
 #define MSFT_CimConfigurationProviderRegistration_BaseProperty_Count    3
 
 /* MSFT_PSConfigurationProviderRegistration*/
@@ -285,6 +286,8 @@
 #define MSFT_DSCLocalConfigManager_RollBack                                                             MI_T("RollBack")
 #define MSFT_DSCLocalConfigManager_PerformRequiredConfigurationChecks   MI_T("PerformRequiredConfigurationChecks")
 #define MSFT_DSCLocalConfigManager_StopConfiguration                                    MI_T("StopConfiguration")
+#define MSFT_DSCLocalConfigManager_TestConfiguration                                    MI_T("TestConfiguration")
+#define MSFT_DSCLocalConfigManager_PerformInventory                                     MI_T("PerformInventory")
 
 /* MSFT_Credential */
 #define MSFT_Credential_UserName                    MI_T("UserName")
@@ -356,6 +359,7 @@
 #define MODULEHANDLER_LOADED     1
 
 #define MAX_MOFSIZE         (10*1024*1024) // Setting the Max Mof Size as 10 MB as per Bug # 298792
+#define MAX_FILEVIEW_SIZE   ((MI_Uint64)0xFFFFFFFF) // Sizes handed to the codecs are MI_Uint32
 
 #define TIME_PER_SECONND 1000000 // 1 MicroSecond
 
@@ -460,6 +464,7 @@ typedef MI_InstancePtr* MI_InstancePtrPtr;
 #define CONFIGURATION_SYSTEMDIR CONFIG_SYSCONFDIR PATH_SEPARATOR DSC_CONFIG_DIRNAME  MI_T("/configuration")
 #define CONFIGURATION_PROGFILES CONFIG_DATADIR PATH_SEPARATOR DSC_CONFIG_DIRNAME MI_T("/configuration")
 #define AGENTID_FILE_PATH CONFIG_SYSCONFDIR PATH_SEPARATOR DSC_CONFIG_DIRNAME "/agentid"
+#define LAST_STATUSREPORT_FILE_PATH CONFIG_SYSCONFDIR PATH_SEPARATOR DSC_CONFIG_DIRNAME "/last_statusreport"
 #define OMI_CONF_FILE_PATH CONFIG_SYSCONFDIR PATH_SEPARATOR DSC_CONFIG_DIRNAME PATH_SEPARATOR MI_T("dsc.conf")
 
 #define CONFIGURATION_SCHEMA_SEARCH_PATH                  CONFIGURATION_SYSTEMDIR PATH_SEPARATOR MI_T("schema")
@@ -561,6 +566,7 @@ typedef MI_InstancePtr* MI_InstancePtrPtr;
 #define DSCCOMPUTERNAME MI_T("DSC_REMOTE_COMPUTERNAME")
 #define DSCWHATIFENABLED MI_T("DSC_WHATIF_ENABLED")
 #define DSC_JOBIDSTRING MI_T("DSC_JOBID_STRING")
+#define DSC_PROVIDERTIMEOUTSTRING MI_T("DSC_PROVIDER_TIMEOUT_SEC")
 
 #define REPORTFORMAT_VERSION_1_0                                                MI_T("1.0")
 #define RETRY_LOOP_COUNT        10
@@ -696,6 +702,8 @@ typedef struct _WriteMessageResource
 #define PROPERTY_BITMASK_ALL            (1|2|4|8)
 
 
+typedef struct _ClassIndex ClassIndex;
+
 typedef struct _ModuleLoaderObject
 {
     MI_Application *application;
@@ -704,6 +712,7 @@ typedef struct _ModuleLoaderObject
     MI_Instance **registrationSchema;
     MI_Uint32 regisrationCount;
     MI_Uint32 *schemaToRegistrationMapping; // size is equal to schemaCount. If registration found value is index into registrationSchema otherwise -1.
+    ClassIndex *classIndex;                 // case-insensitive class name to index into providerSchema.
     MI_Deserializer *deserializer;
     MI_OperationOptions *options;
     MI_OperationOptions *strictOptions;
@@ -724,6 +733,11 @@ void SetJobId();
 
 void ResetJobId();
 
+// Shares the job id with the other operations that hold it; the last ReleaseJobId resets it.
+void HoldJobId();
+
+void ReleaseJobId();
+
 MI_Boolean IsConfirmUsed(_In_opt_ MI_Context* context);
 
 void SetJobDeviceName();
@@ -774,6 +788,27 @@ MI_Result ReadFileContent(_In_z_ const MI_Char *pFileName,
         _Out_ MI_Uint32 *pBufferSize,
         _Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
 
+/* Read-only view of a whole file. Unlike ReadFileContent it has no MAX_MOFSIZE limit.
+   DSC_FileView_Open reads the file into memory. DSC_FileView_OpenReplaced maps it instead,
+   and is only for files the LCM writes through File_OpenReplaceT/File_CopyReplaceT: a file
+   rewritten in place (shutil.copy, a user's own path) would change under the mapping. */
+typedef struct _DSC_FileView
+{
+    MI_Uint8 *data;
+    MI_Uint32 size;
+    MI_Boolean mapped;
+} DSC_FileView;
+
+MI_Result DSC_FileView_Open(_In_z_ const MI_Char *pFileName,
+        _Out_ DSC_FileView *view,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
+
+MI_Result DSC_FileView_OpenReplaced(_In_z_ const MI_Char *pFileName,
+        _Out_ DSC_FileView *view,
+        _Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
+
+void DSC_FileView_Close(_Inout_ DSC_FileView *view);
+
 const MI_Char * GetResourceId( _In_ MI_Instance *inst);
 
 const MI_Char * GetSourceInfo( _In_ MI_Instance *inst);
@@ -885,7 +920,10 @@ MI_Result StripBracesFromGuid(
 
 MI_Datetime PalDatetimeToMiDatetime(_In_ PAL_Datetime inDatetime);
 
-extern char g_currentError[5001];
+void SetCurrentError(_In_opt_z_ const char *message);
+
+void GetCurrentError(_Out_writes_z_(size) char *message, size_t size);
+
 extern StatusReport_ResourceNotInDesiredState * g_rnids;
 extern MSFT_DSCMetaConfiguration *g_metaConfig;
 
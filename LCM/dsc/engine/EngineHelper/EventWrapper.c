@@ -19,6 +19,7 @@
 #include "EventWrapper.h"
 #include <pal/cpu.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "parson.h"
 
@@ -33,6 +34,18 @@ static Log_Level _DSCDetailedLogLevel = OMI_VERBOSE;
 #define BIGMSGSIZE 1024 * 64
 #define TIMESTAMP_SIZE 128
 
+/* Telemetry records are kept in memory and merged into OMSCONFIG_HOST_TELEMETRY_PATH by
+   DSCFlushTelemetry, or sooner when they would no longer fit in the buffer. */
+static pthread_mutex_t _telemetryLock = PTHREAD_MUTEX_INITIALIZER;
+static char _telemetryPending[BIGMSGSIZE];
+static size_t _telemetryPendingSize = 0;
+static int _telemetryFlushAtExit = 0;
+
+/* The capture of the calling thread, if any. A captured line is stored as its level followed by
+   the line as DSCLog_VPut would write it, without the newline, and a terminating NUL. */
+static pthread_key_t _captureKey;
+static pthread_once_t _captureKeyOnce = PTHREAD_ONCE_INIT;
+
 static const char* _levelDSCStrings[] =
 {
     "FATAL",
@@ -102,53 +115,248 @@ int DSCLog_VPut(
     return 1;
 }
 
-void DSCFileVPutTelemetry(
+static void _FlushTelemetryLocked()
+{
+    JSON_Value *telemetry_root_value = NULL;
+    JSON_Object *telemetry_root_object = NULL;
+    const char *current_message_buffer = NULL;
+    char new_msg_buffer[BIGMSGSIZE];
+    char tmp_path[PAL_MAX_PATH_SIZE];
+
+    if (_telemetryPendingSize == 0)
+    {
+        return;
+    }
+    _telemetryPending[_telemetryPendingSize] = '\0';
+    _telemetryPendingSize = 0;
+
+    telemetry_root_value = json_parse_file(OMSCONFIG_HOST_TELEMETRY_PATH);
+    if(telemetry_root_value == NULL) {
+        printf("Failed to parse JSON from OMS Config Host Telemetry Path");
+        return;
+    }
+
+    if (json_value_get_type(telemetry_root_value) != JSONObject) {
+        json_value_free(telemetry_root_value);
+        telemetry_root_value = json_value_init_object();
+        if(telemetry_root_value == NULL) {
+            printf("Failed to parse JSON from OMS Config Host Telemetry Path");
+            return;
+        }
+    }
+
+    telemetry_root_object = json_value_get_object(telemetry_root_value);
+    current_message_buffer = json_object_get_string(telemetry_root_object, "message");
+
+    snprintf(new_msg_buffer, BIGMSGSIZE, "%s%s", current_message_buffer ? current_message_buffer : "", _telemetryPending);
+
+    json_object_set_string(telemetry_root_object, "operation", "omsconfighost");
+    json_object_set_string(telemetry_root_object, "message", new_msg_buffer);
+    json_object_set_boolean(telemetry_root_object, "success", 1);
+
+    // Readers never see a partially written file.
+    snprintf(tmp_path, PAL_MAX_PATH_SIZE, "%s.tmp", OMSCONFIG_HOST_TELEMETRY_PATH);
+    if (json_serialize_to_file(telemetry_root_value, tmp_path) == JSONSuccess)
+    {
+        if (rename(tmp_path, OMSCONFIG_HOST_TELEMETRY_PATH) != 0)
+        {
+            unlink(tmp_path);
+        }
+    }
+    json_value_free(telemetry_root_value);
+}
+
+void DSCFlushTelemetry()
+{
+    pthread_mutex_lock(&_telemetryLock);
+    _FlushTelemetryLocked();
+    pthread_mutex_unlock(&_telemetryLock);
+}
+
+static void _FlushTelemetryAtExit()
+{
+    // Don't wait on a thread that was still logging when the process exited.
+    if (pthread_mutex_trylock(&_telemetryLock) == 0)
+    {
+        _FlushTelemetryLocked();
+        pthread_mutex_unlock(&_telemetryLock);
+    }
+}
+
+static void _AppendTelemetry(
         Log_Level level,
         int eventId,
         const char* file,
         MI_Uint32 line,
-        const ZChar* format,
-        va_list ap
+        const char* message
     )
 {
     char tmp_msg_buffer[MSGSIZE * 2];
-    char formatter_msg_buffer[MSGSIZE];
     char timestamp_buffer[TIMESTAMP_SIZE];
+    int length = 0;
     _GetDSCTimeStamp(timestamp_buffer);
 
     int current_pid = getpid();
 
+    length = Stprintf(tmp_msg_buffer, MSGSIZE * 2, PAL_T("<OMSCONFIGLOG>[%s] [%d] [%s] [%d] [%s:%d] %s</OMSCONFIGLOG>"), timestamp_buffer, current_pid, _levelDSCStrings[level], eventId, file, line, message);
+    if (length <= 0)
+    {
+        return;
+    }
+    if (length >= MSGSIZE * 2)
+    {
+        length = MSGSIZE * 2 - 1;
+    }
+
+    pthread_mutex_lock(&_telemetryLock);
+    if (!_telemetryFlushAtExit)
+    {
+        atexit(_FlushTelemetryAtExit);
+        _telemetryFlushAtExit = 1;
+    }
+    if (_telemetryPendingSize + length >= BIGMSGSIZE)
+    {
+        _FlushTelemetryLocked();
+    }
+    memcpy(_telemetryPending + _telemetryPendingSize, tmp_msg_buffer, length);
+    _telemetryPendingSize += length;
+    pthread_mutex_unlock(&_telemetryLock);
+}
+
+void DSCFileVPutTelemetry(
+        Log_Level level,
+        int eventId,
+        const char* file,
+        MI_Uint32 line,
+        const ZChar* format,
+        va_list ap
+    )
+{
+    char formatter_msg_buffer[MSGSIZE];
+
     Vstprintf(formatter_msg_buffer, MSGSIZE , format, ap);
-    Stprintf(tmp_msg_buffer, MSGSIZE * 2, PAL_T("<OMSCONFIGLOG>[%s] [%d] [%s] [%d] [%s:%d] %s</OMSCONFIGLOG>"), timestamp_buffer, current_pid, _levelDSCStrings[level], eventId, file, line, formatter_msg_buffer);
+    _AppendTelemetry(level, eventId, file, line, formatter_msg_buffer);
+}
 
-    JSON_Value *telemetry_root_value = NULL;
-    telemetry_root_value = json_parse_file(OMSCONFIG_HOST_TELEMETRY_PATH);
-    if(telemetry_root_value == NULL) {
-        printf("Failed to parse JSON from OMS Config Host Telemetry Path");
+static void _CreateCaptureKey()
+{
+    pthread_key_create(&_captureKey, NULL);
+}
+
+static DSCLogCapture* _GetCapture()
+{
+    pthread_once(&_captureKeyOnce, _CreateCaptureKey);
+    return (DSCLogCapture*) pthread_getspecific(_captureKey);
+}
+
+void DSCLog_BeginCapture(_Inout_ DSCLogCapture *capture)
+{
+    pthread_once(&_captureKeyOnce, _CreateCaptureKey);
+    pthread_setspecific(_captureKey, capture);
+}
+
+void DSCLog_EndCapture()
+{
+    pthread_once(&_captureKeyOnce, _CreateCaptureKey);
+    pthread_setspecific(_captureKey, NULL);
+}
+
+static void _CaptureLine(
+    DSCLogCapture *capture,
+    Log_Level level,
+    const char* file,
+    MI_Uint32 line,
+    const ZChar* format,
+    va_list ap)
+{
+    char header[TIMESTAMP_SIZE + PAL_MAX_PATH_SIZE + 64];
+    char timestamp[TIMESTAMP_SIZE];
+    int headerLength;
+    int messageLength;
+    size_t needed;
+    va_list measure;
+
+    _GetDSCTimeStamp(timestamp);
+    headerLength = snprintf(header, sizeof(header), "%s: %s: %s(%u): ", timestamp, _levelDSCStrings[(int)level], scs(file), line);
+    if (headerLength < 0)
+    {
+        return;
+    }
+    if ((size_t)headerLength >= sizeof(header))
+    {
+        headerLength = sizeof(header) - 1;
+    }
+
+    va_copy(measure, ap);
+    messageLength = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+    if (messageLength < 0)
+    {
         return;
     }
 
-    if (json_value_get_type(telemetry_root_value) != JSONObject) {
-        telemetry_root_value = json_value_init_object();
-        if(telemetry_root_value == NULL) {
-            printf("Failed to parse JSON from OMS Config Host Telemetry Path");
+    // level, header, message, NUL
+    needed = capture->size + 1 + headerLength + messageLength + 1;
+    if (needed > capture->capacity)
+    {
+        size_t capacity = capture->capacity == 0 ? MSGSIZE : capture->capacity;
+        char *data;
+
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        data = (char*) realloc(capture->data, capacity);
+        if (data == NULL)
+        {
             return;
         }
+        capture->data = data;
+        capture->capacity = capacity;
     }
 
-    JSON_Object *telemetry_root_object = json_value_get_object(telemetry_root_value);
+    capture->data[capture->size++] = (char) level;
+    memcpy(capture->data + capture->size, header, headerLength);
+    capture->size += headerLength;
+    vsnprintf(capture->data + capture->size, messageLength + 1, format, ap);
+    capture->size += messageLength + 1;
+}
 
-    const char *current_message_buffer = NULL;
-    current_message_buffer = json_object_get_string(telemetry_root_object, "message");
+void DSCLog_WriteCapture(_Inout_ DSCLogCapture *capture)
+{
+    size_t offset = 0;
 
-    char new_msg_buffer[BIGMSGSIZE];
-    snprintf(new_msg_buffer, BIGMSGSIZE, "%s%s", current_message_buffer, tmp_msg_buffer);
+    while (offset < capture->size)
+    {
+        Log_Level level = (Log_Level) capture->data[offset];
+        const char *text = capture->data + offset + 1;
 
-    json_object_set_string(telemetry_root_object, "operation", "omsconfighost");
-    json_object_set_string(telemetry_root_object, "message", new_msg_buffer);
-    json_object_set_boolean(telemetry_root_object, "success", 1);
+        if (_DSCLogFile && level <= _DSCLogLevel)
+        {
+            Ftprintf(_DSCLogFile, ZT("%s\n"), text);
+        }
+        if (_DSCDetailedLogFile && level <= _DSCDetailedLogLevel)
+        {
+            Ftprintf(_DSCDetailedLogFile, ZT("%s\n"), text);
+        }
+        offset += 1 + strlen(text) + 1;
+    }
+    if (_DSCLogFile)
+    {
+        fflush(_DSCLogFile);
+    }
+    if (_DSCDetailedLogFile)
+    {
+        fflush(_DSCDetailedLogFile);
+    }
 
-    json_serialize_to_file(telemetry_root_value, OMSCONFIG_HOST_TELEMETRY_PATH);
+    if (capture->data != NULL)
+    {
+        free(capture->data);
+    }
+    capture->data = NULL;
+    capture->size = 0;
+    capture->capacity = 0;
 }
 
 void DSCFilePutLog(
@@ -166,19 +374,30 @@ void DSCFilePutLog(
     {
         TChar fmt[FMTSIZE];
         va_list ap;
+        DSCLogCapture *capture;
 
         Stprintf(fmt, FMTSIZE, PAL_T("EventId=%d Priority=%s "), priority, _levelDSCStrings[priority]);
         Tcslcat(fmt, format, FMTSIZE);
                 
-        va_start(ap, format);
-        // Write warning and error level logs
-        DSCLog_VPut(_DSCLogFile, (Log_Level)priority, _DSCLogLevel, file, line, fmt, ap);
-        va_end(ap);
+        capture = _GetCapture();
+        if (capture != NULL)
+        {
+            va_start(ap, format);
+            _CaptureLine(capture, (Log_Level)priority, file, line, fmt, ap);
+            va_end(ap);
+        }
+        else
+        {
+            va_start(ap, format);
+            // Write warning and error level logs
+            DSCLog_VPut(_DSCLogFile, (Log_Level)priority, _DSCLogLevel, file, line, fmt, ap);
+            va_end(ap);
 
-        va_start(ap, format);
-        // Write all the logs
-        DSCLog_VPut(_DSCDetailedLogFile, (Log_Level)priority, _DSCDetailedLogLevel, file, line, fmt, ap);
-        va_end(ap);
+            va_start(ap, format);
+            // Write all the logs
+            DSCLog_VPut(_DSCDetailedLogFile, (Log_Level)priority, _DSCDetailedLogLevel, file, line, fmt, ap);
+            va_end(ap);
+        }
 
         if (priority <= OMI_WARNING)
         {
@@ -198,48 +417,13 @@ void DSCFilePutTelemetry(
     ...)
 {
     va_list ap;
-    char tmp_msg_buffer[MSGSIZE * 2];
     char formatter_msg_buffer[MSGSIZE];
-    char timestamp_buffer[TIMESTAMP_SIZE];
-    _GetDSCTimeStamp(timestamp_buffer);
-
-    int current_pid = getpid();
-
 
     va_start(ap, format);
     Vstprintf(formatter_msg_buffer, MSGSIZE , format, ap);
     va_end(ap);
 
-    Stprintf(tmp_msg_buffer, MSGSIZE * 2, PAL_T("<OMSCONFIGLOG>[%s] [%d] [%s] [%d] [%s:%d] %s</OMSCONFIGLOG>"), timestamp_buffer, current_pid, _levelDSCStrings[priority], eventId, file, line, formatter_msg_buffer);
-
-    JSON_Value *telemetry_root_value = NULL;
-    telemetry_root_value = json_parse_file(OMSCONFIG_HOST_TELEMETRY_PATH);
-    if(telemetry_root_value == NULL) {
-        printf("Failed to parse JSON from OMS Config Host Telemetry Path");
-        return;
-    }
-
-    if (json_value_get_type(telemetry_root_value) != JSONObject) {
-        telemetry_root_value = json_value_init_object();
-        if(telemetry_root_value == NULL) {
-            printf("Failed to parse JSON from OMS Config Host Telemetry Path");
-            return;
-        }
-    }
-
-    JSON_Object *telemetry_root_object = json_value_get_object(telemetry_root_value);
-
-    const char *current_message_buffer = NULL;
-    current_message_buffer = json_object_get_string(telemetry_root_object, "message");
-
-    char new_msg_buffer[BIGMSGSIZE];
-    snprintf(new_msg_buffer, BIGMSGSIZE, "%s%s", current_message_buffer, tmp_msg_buffer);
-
-    json_object_set_string(telemetry_root_object, "operation", "omsconfighost");
-    json_object_set_string(telemetry_root_object, "message", new_msg_buffer);
-    json_object_set_boolean(telemetry_root_object, "success", 1);
-
-    json_serialize_to_file(telemetry_root_value, OMSCONFIG_HOST_TELEMETRY_PATH);
+    _AppendTelemetry((Log_Level)priority, eventId, file, line, formatter_msg_buffer);
 }
 
 void DSCLog_Close()
@@ -316,6 +500,7 @@ unsigned long DSC_EventRegister()
 
 unsigned long DSC_EventUnRegister()
 {
+    DSCFlushTelemetry();
     DSCLog_Close();
     return 0;
 }
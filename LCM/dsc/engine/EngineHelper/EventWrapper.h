@@ -154,6 +154,25 @@ void DSCFilePutTelemetry(
     const PAL_Char* format,
     ...);
 
+/* Writes the telemetry records collected so far to OMSCONFIG_HOST_TELEMETRY_PATH. */
+void DSCFlushTelemetry();
+
+/* Log lines a thread writes between DSCLog_BeginCapture and DSCLog_EndCapture are kept in the
+   capture instead of going to the log files. DSCLog_WriteCapture writes them out later, which lets
+   the CA scheduler report concurrently applied resources in execution order. */
+typedef struct _DSCLogCapture
+{
+    char *data;
+    size_t size;
+    size_t capacity;
+} DSCLogCapture;
+
+void DSCLog_BeginCapture(_Inout_ DSCLogCapture *capture);
+void DSCLog_EndCapture();
+
+/* Writes the captured lines to the log files and empties the capture. */
+void DSCLog_WriteCapture(_Inout_ DSCLogCapture *capture);
+
 #include <eventing/oidsc.h>
 
 #define DSC_EventWriteLCMSendConfigurationError(ComponentName,ErrorId, ErrorDetail, ResourceId, SourceInfo, errorMessage) \
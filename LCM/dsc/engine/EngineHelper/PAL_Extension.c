@@ -26,6 +26,7 @@
     #include <sys/stat.h>
 //    #include <uuid/uuid.h>
     #include <dirent.h>
+    #include <fcntl.h>
     #include <unistd.h>
     #include <ctype.h>
     #include <openssl/sha.h>
@@ -240,6 +241,170 @@ int File_CopyT(_In_z_ const PAL_Char* src, _In_z_ const PAL_Char* dest)
     return 0;
 }
 
+static int GetReplacePath(_In_z_ const PAL_Char* path, _Out_writes_z_(PAL_MAX_PATH_SIZE) PAL_Char* replacePath)
+{
+    if (Tcslcpy(replacePath, path, PAL_MAX_PATH_SIZE) >= PAL_MAX_PATH_SIZE ||
+        Tcslcat(replacePath, FILE_REPLACE_SUFFIX, PAL_MAX_PATH_SIZE) >= PAL_MAX_PATH_SIZE)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+FILE* File_OpenReplaceT(_In_z_ const PAL_Char* path)
+{
+    PAL_Char replacePath[PAL_MAX_PATH_SIZE];
+    FILE* fp;
+
+    if (GetReplacePath(path, replacePath) != 0)
+        return NULL;
+
+    fp = File_OpenT(replacePath, PAL_T("wb"));
+    if (fp)
+    {
+        setvbuf(fp, NULL, _IOFBF, FILE_REPLACE_BUFFER_SIZE);
+#if defined(CONFIG_POSIX) && !defined(CONFIG_ENABLE_WCHAR)
+        {
+            /* The replacement takes over the owner and mode of the file it replaces. The mode
+               is set last, since changing the owner can clear the set-id bits. */
+            struct stat st;
+            if (stat(path, &st) == 0)
+            {
+                if (fchown(fileno(fp), st.st_uid, st.st_gid) != 0)
+                {
+                    /* Without the privilege to give the file away it keeps our owner. */
+                }
+                fchmod(fileno(fp), st.st_mode & 07777);
+            }
+        }
+#endif
+    }
+
+    return fp;
+}
+
+#if defined(CONFIG_POSIX) && !defined(CONFIG_ENABLE_WCHAR)
+/* fsyncs the directory holding path, so a rename into it survives a crash. */
+static int SyncParentDirectory(_In_z_ const char* path)
+{
+    char directory[PAL_MAX_PATH_SIZE];
+    char* slash;
+    int fd;
+    int result = 0;
+
+    if (Strlcpy(directory, path, PAL_MAX_PATH_SIZE) >= PAL_MAX_PATH_SIZE)
+        return -1;
+
+    slash = strrchr(directory, '/');
+    if (slash == NULL)
+        Strlcpy(directory, ".", PAL_MAX_PATH_SIZE);
+    else if (slash == directory)
+        directory[1] = '\0';
+    else
+        *slash = '\0';
+
+    fd = open(directory, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fsync(fd) != 0)
+        result = -1;
+    close(fd);
+
+    return result;
+}
+#endif
+
+int File_CommitReplaceT(_In_ FILE* fp, _In_z_ const PAL_Char* path)
+{
+    PAL_Char replacePath[PAL_MAX_PATH_SIZE];
+    int result = 0;
+
+    if (GetReplacePath(path, replacePath) != 0)
+    {
+        File_Close(fp);
+        return -1;
+    }
+
+    if (fflush(fp) != 0)
+        result = -1;
+#if defined(CONFIG_POSIX)
+    else if (fsync(fileno(fp)) != 0)
+        result = -1;
+#endif
+
+    File_Close(fp);
+
+    if (result != 0)
+    {
+        File_RemoveT(replacePath);
+        return result;
+    }
+
+#if defined(CONFIG_POSIX) && !defined(CONFIG_ENABLE_WCHAR)
+    if (rename(replacePath, path) != 0)
+    {
+        File_RemoveT(replacePath);
+        return -1;
+    }
+    result = SyncParentDirectory(path);
+#else
+    /* No atomic rename over an existing file here, fall back to copying. */
+    result = File_CopyT(replacePath, path);
+    File_RemoveT(replacePath);
+#endif
+
+    return result;
+}
+
+void File_AbortReplaceT(_In_ FILE* fp, _In_z_ const PAL_Char* path)
+{
+    PAL_Char replacePath[PAL_MAX_PATH_SIZE];
+
+    File_Close(fp);
+    if (GetReplacePath(path, replacePath) == 0)
+        File_RemoveT(replacePath);
+}
+
+int File_CopyReplaceT(_In_z_ const PAL_Char* src, _In_z_ const PAL_Char* dest)
+{
+    FILE* is = NULL;
+    FILE* os = NULL;
+    char buf[4096];
+    size_t n;
+
+    is = File_OpenT(src, PAL_T("rb"));
+    if (!is)
+        return -1;
+
+    os = File_OpenReplaceT(dest);
+    if (!os)
+    {
+        File_Close(is);
+        return -1;
+    }
+
+    while ((n = fread(buf, 1, sizeof(buf), is)) > 0)
+    {
+        if (fwrite(buf, 1, n, os) != n)
+        {
+            File_Close(is);
+            File_AbortReplaceT(os, dest);
+            return -1;
+        }
+    }
+
+    if (ferror(is))
+    {
+        File_Close(is);
+        File_AbortReplaceT(os, dest);
+        return -1;
+    }
+
+    File_Close(is);
+    return File_CommitReplaceT(os, dest);
+}
+
 
 int Directory_Exist( 
         _In_z_ const char *path)
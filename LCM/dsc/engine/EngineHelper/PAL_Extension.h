@@ -57,6 +57,21 @@ int AsciiToUCS2(_In_z_ char *input,
 
 int File_CopyT(_In_z_ const PAL_Char* src, _In_z_ const PAL_Char* dest);
 
+#define FILE_REPLACE_SUFFIX PAL_T(".new")
+#define FILE_REPLACE_BUFFER_SIZE (64 * 1024)
+
+/* Opens path FILE_REPLACE_SUFFIX for writing, with the mode (and, when permitted, the owner)
+   of path. File_CommitReplaceT flushes it to disk, renames it over path and syncs the directory,
+   so readers of path only ever see a complete file. */
+FILE* File_OpenReplaceT(_In_z_ const PAL_Char* path);
+
+int File_CommitReplaceT(_In_ FILE* fp, _In_z_ const PAL_Char* path);
+
+void File_AbortReplaceT(_In_ FILE* fp, _In_z_ const PAL_Char* path);
+
+/* File_CopyT through File_OpenReplaceT/File_CommitReplaceT. */
+int File_CopyReplaceT(_In_z_ const PAL_Char* src, _In_z_ const PAL_Char* dest);
+
 
 int File_Exist( 
         _In_z_ const char *path);
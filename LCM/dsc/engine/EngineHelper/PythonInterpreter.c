@@ -0,0 +1,285 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/*
+** This file is compiled into the LCM, into ConsistencyInvoker and into every
+** python backed provider library, so it only depends on libc and has to
+** build both as C and as C++.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "PythonInterpreter.h"
+
+#ifndef PYTHON_PID_DIR
+#if defined(BUILD_OMS)
+#define PYTHON_PID_DIR "/var/opt/microsoft/omsconfig"
+#else
+#define PYTHON_PID_DIR "/var/opt/omi"
+#endif
+#endif
+
+#define PYTHON_INTERPRETER_CACHE_FILE PYTHON_PID_DIR "/python_interpreter.cache"
+#define PYTHON_INTERPRETER_CACHE_TEMPLATE PYTHON_INTERPRETER_CACHE_FILE ".XXXXXX"
+#define PYTHON_INTERPRETER_CACHE_VERSION 1
+#define PYTHON_INTERPRETER_DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+#define PYTHON_INTERPRETER_MAX_PATH 1024
+#define PYTHON_INTERPRETER_CANDIDATES 2
+#define PYTHON_INTERPRETER_NOT_PROBED '-'
+
+typedef struct _PythonCandidate
+{
+    const char* command;
+    char major;                                 /* first digit printed by "<command> -V" */
+    char path[PYTHON_INTERPRETER_MAX_PATH];     /* resolved through $PATH, empty when missing */
+    long long mtime;
+    long long size;
+} PythonCandidate;
+
+static const char* s_pythonCommand = NULL;
+
+/* Locates the candidate the same way "sh -c <command>" would, without forking */
+static void ResolveCandidate(
+    PythonCandidate* candidate)
+{
+    const char* searchPath = getenv("PATH");
+    const char* dir;
+    const char* end;
+    struct stat st;
+
+    candidate->path[0] = '\0';
+    candidate->mtime = 0;
+    candidate->size = 0;
+
+    if (searchPath == NULL || *searchPath == '\0')
+    {
+        searchPath = PYTHON_INTERPRETER_DEFAULT_PATH;
+    }
+
+    for (dir = searchPath; ; dir = end + 1)
+    {
+        int len;
+
+        end = strchr(dir, ':');
+        len = end ? (int)(end - dir) : (int)strlen(dir);
+        if (len == 0)
+        {
+            dir = ".";
+            len = 1;
+        }
+
+        if (snprintf(candidate->path, sizeof(candidate->path), "%.*s/%s", len, dir, candidate->command) < (int)sizeof(candidate->path) &&
+            stat(candidate->path, &st) == 0 &&
+            S_ISREG(st.st_mode) &&
+            access(candidate->path, X_OK) == 0)
+        {
+            candidate->mtime = (long long)st.st_mtime;
+            candidate->size = (long long)st.st_size;
+            return;
+        }
+
+        if (end == NULL)
+        {
+            break;
+        }
+    }
+
+    candidate->path[0] = '\0';
+}
+
+static char ProbeCandidate(
+    const PythonCandidate* candidate)
+{
+    char command[PYTHON_INTERPRETER_MAX_PATH + 16];
+    char buffer[128];
+    char major = PYTHON_INTERPRETER_NOT_PROBED;
+    FILE* pipe;
+
+    if (candidate->path[0] == '\0')
+    {
+        return major;
+    }
+
+    snprintf(command, sizeof(command), "'%s' -V 2>&1", candidate->path);
+    pipe = popen(command, "r");
+    if (pipe == NULL)
+    {
+        return major;
+    }
+
+    while (fgets(buffer, sizeof(buffer), pipe) != NULL)
+    {
+        if (strncmp(buffer, "Python ", 7) == 0)
+        {
+            major = buffer[7];
+            break;
+        }
+    }
+
+    // The LCM reaps every child from its SIGCHLD handler, so the exit status
+    // may already be gone; the version banner is all that matters here.
+    pclose(pipe);
+    return major;
+}
+
+/*
+** The cache holds a version line followed by one line per candidate:
+**     <command> <major|-> <mtime> <size> <path|->
+** It is only trusted when every candidate still resolves to the same file
+** with the same fingerprint.
+*/
+static int LoadCache(
+    PythonCandidate* candidates)
+{
+    char command[32];
+    char major[2];
+    char path[PYTHON_INTERPRETER_MAX_PATH];
+    long long mtime;
+    long long size;
+    int version = 0;
+    int valid = 1;
+    int i;
+    FILE* file = fopen(PYTHON_INTERPRETER_CACHE_FILE, "r");
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+
+    if (fscanf(file, "%d", &version) != 1 || version != PYTHON_INTERPRETER_CACHE_VERSION)
+    {
+        valid = 0;
+    }
+
+    for (i = 0; valid && i < PYTHON_INTERPRETER_CANDIDATES; ++i)
+    {
+        PythonCandidate* candidate = &candidates[i];
+
+        if (fscanf(file, "%31s %1s %lld %lld %1023s", command, major, &mtime, &size, path) != 5 ||
+            strcmp(command, candidate->command) != 0 ||
+            strcmp(path, candidate->path[0] == '\0' ? "-" : candidate->path) != 0 ||
+            mtime != candidate->mtime ||
+            size != candidate->size)
+        {
+            valid = 0;
+            break;
+        }
+        candidate->major = major[0];
+    }
+
+    fclose(file);
+    return valid;
+}
+
+/* Best effort: a read-only or missing var directory only costs a re-probe */
+static void SaveCache(
+    const PythonCandidate* candidates)
+{
+    char tempPath[] = PYTHON_INTERPRETER_CACHE_TEMPLATE;
+    FILE* file;
+    int fd;
+    int i;
+    int ok;
+
+    fd = mkstemp(tempPath);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    file = fdopen(fd, "w");
+    if (file == NULL)
+    {
+        close(fd);
+        unlink(tempPath);
+        return;
+    }
+
+    ok = fprintf(file, "%d\n", PYTHON_INTERPRETER_CACHE_VERSION) > 0;
+    for (i = 0; ok && i < PYTHON_INTERPRETER_CANDIDATES; ++i)
+    {
+        const PythonCandidate* candidate = &candidates[i];
+        ok = fprintf(file, "%s %c %lld %lld %s\n",
+                     candidate->command,
+                     candidate->major,
+                     candidate->mtime,
+                     candidate->size,
+                     candidate->path[0] == '\0' ? "-" : candidate->path) > 0;
+    }
+
+    if (fclose(file) != 0 || !ok || rename(tempPath, PYTHON_INTERPRETER_CACHE_FILE) != 0)
+    {
+        unlink(tempPath);
+    }
+}
+
+const char* PythonInterpreter_GetCommand(void)
+{
+    PythonCandidate candidates[PYTHON_INTERPRETER_CANDIDATES];
+    PythonCandidate* python3 = &candidates[0];
+    PythonCandidate* python2 = &candidates[1];
+    int i;
+
+    if (s_pythonCommand != NULL)
+    {
+        return s_pythonCommand;
+    }
+
+    memset(candidates, 0, sizeof(candidates));
+    python3->command = PYTHON3_COMMAND;
+    python2->command = PYTHON2_COMMAND;
+    for (i = 0; i < PYTHON_INTERPRETER_CANDIDATES; ++i)
+    {
+        candidates[i].major = PYTHON_INTERPRETER_NOT_PROBED;
+        ResolveCandidate(&candidates[i]);
+    }
+
+    if (!LoadCache(candidates))
+    {
+        // python2 is only a fallback, so it is not probed when python3 works
+        python3->major = ProbeCandidate(python3);
+        if (python3->major != '3')
+        {
+            python2->major = ProbeCandidate(python2);
+        }
+        SaveCache(candidates);
+    }
+
+    if (python3->major == '3')
+    {
+        s_pythonCommand = PYTHON3_COMMAND;
+    }
+    else if (python2->major == '2')
+    {
+        s_pythonCommand = PYTHON2_COMMAND;
+    }
+    else
+    {
+        s_pythonCommand = PYTHON_COMMAND;
+    }
+
+    return s_pythonCommand;
+}
+
+int PythonInterpreter_IsPython3(void)
+{
+    return strcmp(PythonInterpreter_GetCommand(), PYTHON3_COMMAND) == 0;
+}
@@ -0,0 +1,54 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _python_interpreter_h
+#define _python_interpreter_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PYTHON_COMMAND "python"
+#define PYTHON2_COMMAND "python2"
+#define PYTHON3_COMMAND "python3"
+
+/*
+**==============================================================================
+**
+** Python interpreter discovery shared by the provider bridge, the module
+** installer and the consistency invoker.
+**
+** The interpreter is probed at most once per process.  The outcome is also
+** persisted under the DSC var directory together with the mtime and size of
+** every candidate interpreter, so later processes only stat() the candidates
+** instead of forking "pythonN -V".  Installing, removing or upgrading an
+** interpreter changes its fingerprint and triggers a fresh probe.
+**
+** Returns PYTHON3_COMMAND, PYTHON2_COMMAND or, when neither is usable,
+** PYTHON_COMMAND.  The returned string is static and must not be freed.
+**
+**==============================================================================
+*/
+const char* PythonInterpreter_GetCommand(void);
+
+/* Non zero when PythonInterpreter_GetCommand() resolved to python3 */
+int PythonInterpreter_IsPython3(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _python_interpreter_h */
@@ -21,14 +21,49 @@
 #include "ModuleHandlerInternal.h"
 #include "DSC_Systemcalls.h"
 #include "ModuleValidator.h"
+#include "SchemaCache.h"
 #include "EventWrapper.h"
 
 #include "Resources_LCM.h"
 
 #include "NativeResourceProviderMiModule.h"
+#include "pal/hashmap.h"
 
 extern const ModuleManagerFT g_ModuleManagerFT;
 
+typedef struct _ClassIndexBucket
+{
+    struct _ClassIndexBucket *next;
+    const MI_Char *className;   // owned by the indexed class
+    MI_Uint32 position;
+} ClassIndexBucket;
+
+struct _ClassIndex
+{
+    HashMap map;
+    ClassIndexBucket *buckets;  // one per indexed class
+};
+
+NITS_EXTERN_C size_t ClassIndex_Hash(const HashBucket* bucket_)
+{
+    return HashMap_HashProc_PalStringCaseInsensitive(((ClassIndexBucket*)bucket_)->className);
+}
+
+NITS_EXTERN_C int ClassIndex_Equal(
+    const HashBucket* bucket1_,
+    const HashBucket* bucket2_)
+{
+    ClassIndexBucket* bucket1 = (ClassIndexBucket*)bucket1_;
+    ClassIndexBucket* bucket2 = (ClassIndexBucket*)bucket2_;
+    return Tcscasecmp(bucket1->className, bucket2->className) == 0;
+}
+
+NITS_EXTERN_C void ClassIndex_Release(HashBucket* bucket_)
+{
+    // Buckets live in ClassIndex::buckets.
+    MI_UNREFERENCED_PARAMETER(bucket_);
+}
+
 #if defined(BUILD_OMS)
 extern MI_Boolean g_DscHost;
 #endif
@@ -145,6 +180,7 @@ MI_Result MI_CALL ModuleManager_Close(_Inout_ ModuleManager *moduleManager,
         }
         DSC_free(moduleLoader->registrationSchema);
         DSC_free(moduleLoader->schemaToRegistrationMapping);
+        ClassIndex_Delete(moduleLoader->classIndex);
         MI_OperationOptions_Delete(moduleLoader->options);
         MI_OperationOptions_Delete(moduleLoader->strictOptions);
         MI_Deserializer_Close(moduleLoader->deserializer);
@@ -289,21 +325,20 @@ MI_Result  ModuleManager_GetRegistrationInstance (
         return r;
     }
 
-    for( xCount = 0 ; xCount < moduleLoader->schemaCount; xCount++)
+    xCount = ClassIndex_Find(moduleLoader->classIndex, className);
+    if( xCount == (MI_Uint32)-1)
     {
-        if( Tcscasecmp(className, moduleLoader->providerSchema[xCount]->classDecl->name) == 0 )
-        {
-            if( moduleLoader->schemaToRegistrationMapping[xCount] == (MI_Uint32)-1 ||
-                moduleLoader->schemaToRegistrationMapping[xCount] > moduleLoader->regisrationCount)
-            {
-                return GetCimMIError(MI_RESULT_NOT_FOUND, extendedError,ID_MODMAN_REGINS_NOTFOUND);
-            }
-            *registrationInstance = moduleLoader->registrationSchema[ moduleLoader->schemaToRegistrationMapping[xCount] ] ;
-            return MI_RESULT_OK;
-        }
+        /*If here we didn't find the registration*/
+        return GetCimMIError(MI_RESULT_NOT_FOUND, extendedError,ID_MODMAN_CONFIGCLASS_NOTREG);
     }
-    /*If here we didn't find the registration*/
-    return GetCimMIError(MI_RESULT_NOT_FOUND, extendedError,ID_MODMAN_CONFIGCLASS_NOTREG);
+
+    if( moduleLoader->schemaToRegistrationMapping[xCount] == (MI_Uint32)-1 ||
+        moduleLoader->schemaToRegistrationMapping[xCount] > moduleLoader->regisrationCount)
+    {
+        return GetCimMIError(MI_RESULT_NOT_FOUND, extendedError,ID_MODMAN_REGINS_NOTFOUND);
+    }
+    *registrationInstance = moduleLoader->registrationSchema[ moduleLoader->schemaToRegistrationMapping[xCount] ] ;
+    return MI_RESULT_OK;
 
 }
 
@@ -407,6 +442,7 @@ MI_Result ModuleManager_Update (
         }
         DSC_free(inModuleLoader->registrationSchema);
         DSC_free(inModuleLoader->schemaToRegistrationMapping);
+        ClassIndex_Delete(inModuleLoader->classIndex);
         DSC_free(inModuleLoader);
     }
 
@@ -578,32 +614,43 @@ MI_Result GetMappingTable(_In_ MI_Application *miApp,
 
     memset((*moduleLoader)->schemaToRegistrationMapping, -1, sizeof(MI_Uint32) * miClassArray->size );
 
+    r = ClassIndex_New(miClassArray->data, miClassArray->size, &(*moduleLoader)->classIndex);
+    if( r != MI_RESULT_OK )
+    {
+        DSC_free((*moduleLoader)->schemaToRegistrationMapping);
+        DSC_free(*moduleLoader);
+        *moduleLoader = NULL;
+        return GetCimMIError(r, extendedError, ID_LCMHELPER_MEMORY_ERROR);
+    }
+
     r = DSC_MI_Application_NewSession(miApp, NULL, NULL, NULL, NULL, NULL, &miSession);
     if( r != MI_RESULT_OK )
     {
+        ClassIndex_Delete((*moduleLoader)->classIndex);
+        DSC_free((*moduleLoader)->schemaToRegistrationMapping);
         DSC_free(*moduleLoader);
         *moduleLoader = NULL;
         return GetCimMIError(r, extendedError, ID_CAINFRA_NEWSESSION_FAILED);
     }
 
-    /* Create Mapping*/
-    for( xCount = 0; xCount < miClassArray->size ; xCount++)
+    /* Create Mapping, each class maps to the first registration naming it.*/
+    for( yCount = 0; yCount < miInstanceArray->size ; yCount++)
     {
-        for( yCount = 0; yCount < miInstanceArray->size ; yCount++)
+        r = DSC_MI_Instance_GetElement(miInstanceArray->data[yCount], MI_T("className"), &className, NULL, NULL, NULL);
+        if( r != MI_RESULT_OK )
         {
-            r = DSC_MI_Instance_GetElement(miInstanceArray->data[yCount], MI_T("className"), &className, NULL, NULL, NULL);
-            if( r != MI_RESULT_OK )
-            {
-                DSC_free(*moduleLoader);
-                *moduleLoader = NULL;
-                MI_Session_Close(&miSession, NULL, NULL);
-                return GetCimMIError(r, extendedError, ID_MODMAN_MAPPING_CLASSNAME_NOTFOUND);
-            }
-            if( Tcscasecmp( miClassArray->data[xCount]->classDecl->name , className.string) == 0 )
-            {
-                ((*moduleLoader)->schemaToRegistrationMapping)[xCount] = yCount;
-                break;
-            }
+            ClassIndex_Delete((*moduleLoader)->classIndex);
+            DSC_free((*moduleLoader)->schemaToRegistrationMapping);
+            DSC_free(*moduleLoader);
+            *moduleLoader = NULL;
+            MI_Session_Close(&miSession, NULL, NULL);
+            return GetCimMIError(r, extendedError, ID_MODMAN_MAPPING_CLASSNAME_NOTFOUND);
+        }
+        xCount = ClassIndex_Find((*moduleLoader)->classIndex, className.string);
+        if( xCount != (MI_Uint32)-1 &&
+            ((*moduleLoader)->schemaToRegistrationMapping)[xCount] == (MI_Uint32)-1 )
+        {
+            ((*moduleLoader)->schemaToRegistrationMapping)[xCount] = yCount;
         }
     }
 
@@ -618,6 +665,77 @@ MI_Result GetMappingTable(_In_ MI_Application *miApp,
     return MI_RESULT_OK;
 }
 
+MI_Result ClassIndex_New(_In_reads_(classCount) MI_Class **classes,
+                         MI_Uint32 classCount,
+                         _Outptr_ ClassIndex **classIndex)
+{
+    MI_Uint32 xCount = 0;
+    ClassIndex *tempIndex = NULL;
+
+    *classIndex = NULL;
+    tempIndex = (ClassIndex*) DSC_malloc(sizeof(ClassIndex), NitsHere());
+    if( tempIndex == NULL)
+    {
+        return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+    }
+    memset(tempIndex, 0, sizeof(ClassIndex));
+
+    if( classCount > 0)
+    {
+        tempIndex->buckets = (ClassIndexBucket*) DSC_malloc(sizeof(ClassIndexBucket) * classCount, NitsHere());
+        if( tempIndex->buckets == NULL)
+        {
+            DSC_free(tempIndex);
+            return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+        }
+    }
+
+    // Keep the load factor around one so lookups stay constant as modules are installed.
+    if( HashMap_Init(&tempIndex->map, classCount > 0 ? classCount : 1, ClassIndex_Hash, ClassIndex_Equal, ClassIndex_Release) != 0)
+    {
+        DSC_free(tempIndex->buckets);
+        DSC_free(tempIndex);
+        return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+    }
+
+    for( xCount = 0; xCount < classCount; xCount++)
+    {
+        tempIndex->buckets[xCount].next = NULL;
+        tempIndex->buckets[xCount].className = classes[xCount]->classDecl->name;
+        tempIndex->buckets[xCount].position = xCount;
+        // Insert keeps the existing bucket when the name was already indexed.
+        HashMap_Insert(&tempIndex->map, (HashBucket*)&tempIndex->buckets[xCount]);
+    }
+
+    *classIndex = tempIndex;
+    return MI_RESULT_OK;
+}
+
+MI_Uint32 ClassIndex_Find(_In_ ClassIndex *classIndex,
+                          _In_z_ const MI_Char *className)
+{
+    ClassIndexBucket searchBucket;
+    ClassIndexBucket *bucket = NULL;
+
+    searchBucket.className = className;
+    bucket = (ClassIndexBucket*) HashMap_Find(&classIndex->map, (const HashBucket*)&searchBucket);
+    if( bucket == NULL)
+    {
+        return (MI_Uint32)-1;
+    }
+    return bucket->position;
+}
+
+void ClassIndex_Delete(_In_opt_ ClassIndex *classIndex)
+{
+    if( classIndex)
+    {
+        HashMap_Destroy(&classIndex->map);
+        DSC_free(classIndex->buckets);
+        DSC_free(classIndex);
+    }
+}
+
 MI_Result GetFilteredResource( _In_ MI_Application *miApp,
                               _In_ MI_Instance *inInstance,
                               _Outptr_result_maybenull_ MI_Instance **outInstance,
@@ -737,8 +855,7 @@ MI_Result GetInstanceFromSingleMOF(_In_opt_ ModuleManager *moduleManager,
     MI_Result r = MI_RESULT_OK;
     /*Form full path to mof file*/
     MI_InstanceA *miTempInstanceArray = NULL;
-    MI_Uint8 *pbuffer = NULL;
-    MI_Uint32 contentSize;
+    DSC_FileView fileView = {0};
     MI_Uint32 readBytes;
     MI_ClassA miClassArray = {0};
 
@@ -748,7 +865,7 @@ MI_Result GetInstanceFromSingleMOF(_In_opt_ ModuleManager *moduleManager,
     }
     *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
 
-    r = ReadFileContent(mofModuleFilePath, &pbuffer, &contentSize, extendedError);
+    r = DSC_FileView_Open(mofModuleFilePath, &fileView, extendedError);
     if(r != MI_RESULT_OK)
     {
         return r;
@@ -761,20 +878,16 @@ MI_Result GetInstanceFromSingleMOF(_In_opt_ ModuleManager *moduleManager,
 
     miTempInstanceArray = NULL;
 
-    r = MI_Deserializer_DeserializeInstanceArray(deserializer, 0, strictOptions, 0, pbuffer, contentSize, &miClassArray, &readBytes, &miTempInstanceArray, extendedError);
+    r = MI_Deserializer_DeserializeInstanceArray(deserializer, 0, strictOptions, 0, fileView.data, fileView.size, &miClassArray, &readBytes, &miTempInstanceArray, extendedError);
     
     if( r != MI_RESULT_OK )
     {
         Print_MI_Instance(*extendedError);
-        DSC_free(pbuffer);
+        DSC_FileView_Close(&fileView);
         return r;
     }
 
-    if(pbuffer)
-    {
-        DSC_free(pbuffer);
-        pbuffer = NULL;
-    }
+    DSC_FileView_Close(&fileView);
 
     if( flags & VALIDATE_REGISTRATION_INSTANCE)
     {
@@ -1043,8 +1156,7 @@ MI_Result GetSystemSchema(_In_ MI_Application *miApp,
     MI_Char *filePath = NULL;
     MI_Result r = MI_RESULT_OK;
     MI_ClassA * miTempClassArray = NULL;
-    MI_Uint8 *pbuffer = NULL;
-    MI_Uint32 contentSize;
+    DSC_FileView fileView = {0};
     MI_Uint32 readBytes;
 
     if( miClassArray == NULL || miApp == NULL  || NitsShouldFault(NitsHere(), NitsAutomatic))
@@ -1070,23 +1182,20 @@ MI_Result GetSystemSchema(_In_ MI_Application *miApp,
         DSC_free(envResolvedPath);
     }
 
-    r = ReadFileContent(filePath, &pbuffer, &contentSize, extendedError);
+    r = DSC_FileView_Open(filePath, &fileView, extendedError);
     if(r != MI_RESULT_OK )
     {
         return r;
     }
 
-    r = MI_Deserializer_DeserializeClassArray(deserializer, 0, options, 0, pbuffer, contentSize, inputClasses, NULL, NULL, &readBytes, &miTempClassArray, extendedError);
+    r = MI_Deserializer_DeserializeClassArray(deserializer, 0, options, 0, fileView.data, fileView.size, inputClasses, NULL, NULL, &readBytes, &miTempClassArray, extendedError);
 
     if( filePath)
     {
         DSC_free(filePath);
     }
 
-    if(pbuffer)
-    {
-        DSC_free(pbuffer);
-    }
+    DSC_FileView_Close(&fileView);
 
     if( r != MI_RESULT_OK || NitsShouldFault(NitsHere(), NitsAutomatic))
     {
@@ -1129,8 +1238,7 @@ MI_Result GetSchemaFromSingleMOF(_In_ MI_Application *miApp,
     /*Form full path to mof file*/
     MI_Char *fullPath = NULL;
     MI_ClassA *miTempClassArray = NULL;
-    MI_Uint8 *pbuffer = NULL;
-    MI_Uint32 contentSize;
+    DSC_FileView fileView = {0};
     MI_Uint32 readBytes;
     size_t fullPathLength = Tcslen(mofModulePath) + 1 + Tcslen(schemaFileName) + 1; // mofModulePath\schemaFileName
     MI_DeserializerCallbacks cb;
@@ -1154,7 +1262,7 @@ MI_Result GetSchemaFromSingleMOF(_In_ MI_Application *miApp,
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_LCMHELPER_PRINTF_ERROR);
     }
 
-    r = ReadFileContent(fullPath, &pbuffer, &contentSize, extendedError);
+    r = DSC_FileView_Open(fullPath, &fileView, extendedError);
     if(r != MI_RESULT_OK)
     {
         return r;
@@ -1171,9 +1279,9 @@ MI_Result GetSchemaFromSingleMOF(_In_ MI_Application *miApp,
     }
 
     cb.classObjectNeeded = SchemaCallback;
-    r = MI_Deserializer_DeserializeClassArray(deserializer, 0, options, &cb, pbuffer, contentSize, NULL, NULL, NULL, &readBytes, &miTempClassArray, extendedError);
+    r = MI_Deserializer_DeserializeClassArray(deserializer, 0, options, &cb, fileView.data, fileView.size, NULL, NULL, NULL, &readBytes, &miTempClassArray, extendedError);
     DSC_free(fullPath);
-    DSC_free(pbuffer);
+    DSC_FileView_Close(&fileView);
     if( r != MI_RESULT_OK || NitsShouldFault(NitsHere(), NitsAutomatic))
     {
         CleanUpDeserializerClassCache(miTempClassArray);
@@ -1466,6 +1574,8 @@ MI_Result GetSchemaFromMOFs(_In_ MI_Application *miApp,
     MI_Uint32 count=0;
     MI_Char *envResolvedPath = NULL;
     MI_Char **pathsForSchemas = NULL;
+    MI_Uint64 coreFingerprint = 0;
+    MI_Uint64 scan = 0;
 
     if( miClassArray == NULL || miApp == NULL  || NitsShouldFault(NitsHere(), NitsAutomatic))
     {
@@ -1508,9 +1618,13 @@ MI_Result GetSchemaFromMOFs(_In_ MI_Application *miApp,
     }
     pathsForSchemas[0] = (MI_Char*)GetSchemaSearchPath();
     pathsForSchemas[1] = (MI_Char*)GetSchemaSearchPathProgFiles();
+
+    /* Cached module classes are only valid against the core schema they were loaded with*/
+    SchemaCache_GetFingerprint(GetCoreSchemaPath(), MI_T(".mof"), &coreFingerprint);
+    scan = SchemaCache_BeginScan(coreFingerprint);
     for (count = 0; count < NUM_PATHS_TO_LOOK_FOR_PROVIDERS; count++)
     {
-        r= UpdateClassCacheWithSchemasMofs(miApp,deserializer,options,miClassArray,extendedError,pathsForSchemas[count]);
+        r= UpdateClassCacheWithSchemasMofs(miApp,deserializer,options,miClassArray,extendedError,pathsForSchemas[count],scan);
         if( r != MI_RESULT_OK)
         {
             goto clean_up;
@@ -1518,6 +1632,10 @@ MI_Result GetSchemaFromMOFs(_In_ MI_Application *miApp,
     }
 
 clean_up:
+    if (scan != 0)
+    {
+        SchemaCache_EndScan(scan, r == MI_RESULT_OK);
+    }
     if (pathsForSchemas)
     {
         DSC_free(pathsForSchemas);
@@ -1531,7 +1649,8 @@ MI_Result UpdateClassCacheWithSchemasMofs(_In_ MI_Application *miApp,
                             _In_ MI_OperationOptions * options,
                             _Inout_ MI_ClassA *miClassArray,
                             _Outptr_result_maybenull_ MI_Instance **extendedError,
-                            _In_z_ const MI_Char * schemaPath)
+                            _In_z_ const MI_Char * schemaPath,
+                            MI_Uint64 scan)
 {
     MI_Char *envResolvedPath = NULL;
     Internal_Dir *dirHandle = NULL;
@@ -1564,7 +1683,7 @@ MI_Result UpdateClassCacheWithSchemasMofs(_In_ MI_Application *miApp,
             (Tcscasecmp(MI_T(".."), dirEntry->name)!=0) &&
             (Tcscasecmp(MI_T("."), dirEntry->name)!=0))
         {
-            r = UpdateClassCache(miApp, deserializer, options, envResolvedPath, dirEntry->name, miClassArray, extendedError);
+            r = UpdateClassCache(miApp, deserializer, options, envResolvedPath, dirEntry->name, miClassArray, scan, extendedError);
             if( r != MI_RESULT_OK)
             {
                 DSC_free(envResolvedPath);
@@ -1588,12 +1707,15 @@ MI_Result UpdateClassCache(_In_ MI_Application *miApp,
                            _In_z_ MI_Char *rootPath,
                            _In_z_ MI_Char *directoryPath,
                            _Inout_ MI_ClassA *miClassArray,
+                           MI_Uint64 scan,
                            _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
     MI_Result r = MI_RESULT_OK;
     int result = 0;
     Internal_Dir *dirHandle = NULL;
     Internal_DirEnt *dirEntry = NULL;
+    MI_Uint64 fingerprint = 0;
+    MI_Uint32 firstClass = miClassArray->size;
 
     /*Form full path to schema module*/
     MI_Char *fullPath = NULL;
@@ -1617,6 +1739,15 @@ MI_Result UpdateClassCache(_In_ MI_Application *miApp,
         DSC_free(fullPath);
         return GetCimMIError(result, extendedError, ID_LCMHELPER_PRINTF_ERROR);
     }
+
+    /*Reuse the classes parsed last time when none of the schema files changed*/
+    if( SchemaCache_GetFingerprint(fullPath, SEARCH_PATTERN_SCHEMA, &fingerprint) == MI_RESULT_OK &&
+        SchemaCache_GetModuleClasses(scan, fullPath, fingerprint, miClassArray))
+    {
+        DSC_free(fullPath);
+        return MI_RESULT_OK;
+    }
+
     /*Find schema files*/
     dirHandle = Internal_Dir_Open(fullPath, NitsHere() );
 
@@ -1646,6 +1777,10 @@ MI_Result UpdateClassCache(_In_ MI_Application *miApp,
     }
 
     /*Update Cache*/
+    if( fingerprint != 0)
+    {
+        SchemaCache_SetModuleClasses(scan, fullPath, fingerprint, miClassArray, firstClass);
+    }
     DSC_free(fullPath);
     Internal_Dir_Close( dirHandle);
 
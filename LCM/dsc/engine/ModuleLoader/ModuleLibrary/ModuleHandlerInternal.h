@@ -49,7 +49,8 @@ MI_Result UpdateClassCacheWithSchemasMofs(_In_ MI_Application *miApp,
                             _In_ MI_OperationOptions * options,
                             _Inout_ MI_ClassA *miClassArray, 
                             _Outptr_result_maybenull_ MI_Instance **extendedError,
-                            _In_z_ const MI_Char * schemaPath);
+                            _In_z_ const MI_Char * schemaPath,
+                            MI_Uint64 scan);
 
 #ifdef __cplusplus
 extern "C"
@@ -68,6 +69,17 @@ extern "C"
         _Inout_ MI_ClassA *miClassArray, 
         _Outptr_result_maybenull_ MI_Instance **extendedError);
 
+    /* Case-insensitive class name index over a class array. Duplicate names resolve to the first class. */
+    MI_Result ClassIndex_New(_In_reads_(classCount) MI_Class **classes,
+        MI_Uint32 classCount,
+        _Outptr_ ClassIndex **classIndex);
+
+    /* Returns the position of className in the indexed array, or (MI_Uint32)-1 if it is not there. */
+    MI_Uint32 ClassIndex_Find(_In_ ClassIndex *classIndex,
+        _In_z_ const MI_Char *className);
+
+    void ClassIndex_Delete(_In_opt_ ClassIndex *classIndex);
+
 #ifdef __cplusplus
 }
 #endif
@@ -78,6 +90,7 @@ MI_Result UpdateClassCache(_In_ MI_Application *miApp,
                            _In_z_ MI_Char *rootPath, 
                            _In_z_ MI_Char *directoryPath, 
                            _Inout_ MI_ClassA *miClassArray,
+                           MI_Uint64 scan,
                            _Outptr_result_maybenull_ MI_Instance **extendedError);
 
 MI_Result GetSchemaFromSingleMOF(_In_ MI_Application *miApp,
@@ -111,6 +111,7 @@ BaseResourceConfiguration g_PSResourceProperties[] =
 BaseResourceConfiguration g_CimResourceProperties[] =
 {
     {MSFT_CimConfigurationProviderRegistration_Namespace,         MI_STRING},
+    {MSFT_CimConfigurationProviderRegistration_TimeoutSec,        MI_UINT32},
     {NULL,                                                        0}
 };
 
@@ -1660,8 +1661,7 @@ MI_Result ValidatePartialConfigMergedFile(_In_ ModuleManager *moduleManager,
     MI_Uint32 flags = 0;
     /*Form full path to mof file*/
     MI_InstanceA *miTempInstanceArray = NULL;
-    MI_Uint8 *pbuffer = NULL;
-    MI_Uint32 contentSize=0;
+    DSC_FileView fileView = {0};
     MI_Uint32 readBytes;
     MI_ClassA miClassArray = { 0 };
     ModuleLoaderObject *moduleLoader = NULL;
@@ -1680,7 +1680,7 @@ MI_Result ValidatePartialConfigMergedFile(_In_ ModuleManager *moduleManager,
     {
         return r;
     }
-    r = ReadFileContent(mofFilePath, &pbuffer, &contentSize, extendedError);
+    r = DSC_FileView_Open(mofFilePath, &fileView, extendedError);
     if (r != MI_RESULT_OK)
     {
         return r;
@@ -1689,7 +1689,7 @@ MI_Result ValidatePartialConfigMergedFile(_In_ ModuleManager *moduleManager,
     moduleLoader = (ModuleLoaderObject*)moduleManager->reserved2;
     miClassArray.size = moduleLoader->schemaCount;
     miClassArray.data = moduleLoader->providerSchema;
-    r = MI_Deserializer_DeserializeInstanceArray(moduleLoader->deserializer, 0, moduleLoader->strictOptions, 0, pbuffer, contentSize, &miClassArray, &readBytes, &miTempInstanceArray, extendedError);
+    r = MI_Deserializer_DeserializeInstanceArray(moduleLoader->deserializer, 0, moduleLoader->strictOptions, 0, fileView.data, fileView.size, &miClassArray, &readBytes, &miTempInstanceArray, extendedError);
     GOTO_CLEANUP_IF_FAILED(r, Exit);
 
     r = ValidateDSCDocumentInstance(miTempInstanceArray, flags | VALIDATE_DOCUMENT_INSTANCE, extendedError);
@@ -1701,7 +1701,7 @@ MI_Result ValidatePartialConfigMergedFile(_In_ ModuleManager *moduleManager,
     GOTO_CLEANUP_IF_FAILED(r, Exit);
 
 Exit:
-    DSCFREE_IF_NOT_NULL(pbuffer);
+    DSC_FileView_Close(&fileView);
     if (miTempInstanceArray != NULL)
     {
         CleanUpDeserializerInstanceCache(miTempInstanceArray);
@@ -0,0 +1,357 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "DSC_Systemcalls.h"
+#include "EngineHelper.h"
+#include "pal/hashmap.h"
+#include "SchemaCache.h"
+
+#define SCHEMACACHE_HASHMAP_SIZE 64
+#define SCHEMACACHE_FNV_OFFSET 14695981039346656037ULL
+#define SCHEMACACHE_FNV_PRIME 1099511628211ULL
+
+typedef struct _SchemaCacheEntry
+{
+    struct _SchemaCacheEntry *next;
+    MI_Char *modulePath;
+    MI_Uint64 fingerprint;
+    MI_Uint64 lastScan;             // latest scan the module was seen in
+    MI_ClassA classes;
+} SchemaCacheEntry;
+
+static pthread_mutex_t g_SchemaCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static HashMap g_SchemaCache;
+static MI_Boolean g_SchemaCacheInitialized = MI_FALSE;
+static MI_Uint64 g_SchemaCacheCoreFingerprint = 0;
+static MI_Uint64 g_SchemaCacheLastScan = 0;
+// First scan against the current core schema, older scans neither read nor fill the cache.
+static MI_Uint64 g_SchemaCacheFirstScan = 1;
+static MI_Uint64 g_SchemaCacheVersion = 0;
+
+NITS_EXTERN_C size_t SchemaCache_Hash(const HashBucket* bucket_)
+{
+    return HashMap_HashProc_AnsiString(((SchemaCacheEntry*)bucket_)->modulePath);
+}
+
+NITS_EXTERN_C int SchemaCache_Equal(
+    const HashBucket* bucket1_,
+    const HashBucket* bucket2_)
+{
+    SchemaCacheEntry* bucket1 = (SchemaCacheEntry*)bucket1_;
+    SchemaCacheEntry* bucket2 = (SchemaCacheEntry*)bucket2_;
+    return Tcscmp(bucket1->modulePath, bucket2->modulePath) == 0;
+}
+
+NITS_EXTERN_C void SchemaCache_Release(HashBucket* bucket_)
+{
+    SchemaCacheEntry* entry = (SchemaCacheEntry*)bucket_;
+    CleanUpClassCache(&entry->classes);
+    DSC_free(entry->modulePath);
+    DSC_free(entry);
+}
+
+static MI_Uint64 HashBytes(MI_Uint64 hash,
+                           _In_reads_bytes_(size) const void *data,
+                           size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+    size_t xCount = 0;
+    for( xCount = 0 ; xCount < size; xCount++)
+    {
+        hash ^= bytes[xCount];
+        hash *= SCHEMACACHE_FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Inode and ctime catch files replaced or rewritten with their old mtime preserved. */
+static MI_Boolean HashFileStat(_Inout_ MI_Uint64 *hash,
+                               _In_z_ const MI_Char *path)
+{
+    struct stat st;
+    long long values[4];
+    if( stat(path, &st) != 0)
+    {
+        return MI_FALSE;
+    }
+    values[0] = (long long)st.st_ino;
+    values[1] = (long long)st.st_size;
+    values[2] = (long long)st.st_mtime;
+    values[3] = (long long)st.st_ctime;
+    *hash = HashBytes(*hash, values, sizeof(values));
+    return MI_TRUE;
+}
+
+MI_Result SchemaCache_GetFingerprint(_In_z_ const MI_Char *path,
+                                     _In_opt_z_ const MI_Char *fileEndsWith,
+                                     _Out_ MI_Uint64 *fingerprint)
+{
+    Internal_Dir *dirHandle = NULL;
+    Internal_DirEnt *dirEntry = NULL;
+    MI_Char filePath[PAL_MAX_PATH_SIZE];
+    MI_Uint64 hash = SCHEMACACHE_FNV_OFFSET;
+
+    *fingerprint = 0;
+    if( !HashFileStat(&hash, path))
+    {
+        return MI_RESULT_NOT_FOUND;
+    }
+
+    if( fileEndsWith != NULL)
+    {
+        dirHandle = Internal_Dir_Open(path, NitsHere());
+        if( dirHandle == NULL)
+        {
+            return MI_RESULT_NOT_FOUND;
+        }
+        dirEntry = Internal_Dir_Read(dirHandle, (MI_Char*)fileEndsWith);
+        while( dirEntry != NULL)
+        {
+            if( !dirEntry->isDir)
+            {
+                if( Stprintf(filePath, PAL_MAX_PATH_SIZE, MI_T("%T/%T"), path, dirEntry->name) <= 0 ||
+                    !HashFileStat(&hash, filePath))
+                {
+                    Internal_Dir_Close(dirHandle);
+                    return MI_RESULT_NOT_FOUND;
+                }
+                hash = HashBytes(hash, dirEntry->name, (Tcslen(dirEntry->name) + 1) * sizeof(MI_Char));
+            }
+            dirEntry = Internal_Dir_Read(dirHandle, (MI_Char*)fileEndsWith);
+        }
+        Internal_Dir_Close(dirHandle);
+    }
+
+    *fingerprint = hash;
+    return MI_RESULT_OK;
+}
+
+static void ClearLocked()
+{
+    if( g_SchemaCacheInitialized)
+    {
+        HashMap_Destroy(&g_SchemaCache);
+        g_SchemaCacheInitialized = MI_FALSE;
+    }
+    g_SchemaCacheVersion++;
+}
+
+static MI_Boolean InitializeLocked()
+{
+    if( !g_SchemaCacheInitialized)
+    {
+        if( HashMap_Init(&g_SchemaCache, SCHEMACACHE_HASHMAP_SIZE, SchemaCache_Hash, SchemaCache_Equal, SchemaCache_Release) != 0)
+        {
+            return MI_FALSE;
+        }
+        g_SchemaCacheInitialized = MI_TRUE;
+    }
+    return MI_TRUE;
+}
+
+/* Clones classes[first .. size) into a new array owned by the caller. */
+static MI_Boolean CloneClasses(_In_ MI_ClassA *classes,
+                               MI_Uint32 firstClass,
+                               _Out_ MI_ClassA *clones)
+{
+    MI_Uint32 xCount = 0;
+
+    clones->data = NULL;
+    clones->size = 0;
+    if( firstClass >= classes->size)
+    {
+        return MI_TRUE;
+    }
+
+    clones->data = (MI_Class**) DSC_malloc(sizeof(MI_Class*) * (classes->size - firstClass), NitsHere());
+    if( clones->data == NULL)
+    {
+        return MI_FALSE;
+    }
+    for( xCount = firstClass ; xCount < classes->size; xCount++)
+    {
+        if( MI_Class_Clone(classes->data[xCount], &clones->data[clones->size]) != MI_RESULT_OK)
+        {
+            // CleanUpClassCache leaves an empty array allocated.
+            CleanUpClassCache(clones);
+            DSC_free(clones->data);
+            clones->data = NULL;
+            return MI_FALSE;
+        }
+        clones->size++;
+    }
+    return MI_TRUE;
+}
+
+MI_Uint64 SchemaCache_BeginScan(MI_Uint64 coreFingerprint)
+{
+    MI_Uint64 scan = 0;
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    scan = ++g_SchemaCacheLastScan;
+    if( coreFingerprint != g_SchemaCacheCoreFingerprint)
+    {
+        // Module classes embed the base classes they were parsed against.
+        ClearLocked();
+        g_SchemaCacheCoreFingerprint = coreFingerprint;
+        g_SchemaCacheFirstScan = scan;
+    }
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+    return scan;
+}
+
+void SchemaCache_EndScan(MI_Uint64 scan,
+                         MI_Boolean complete)
+{
+    HashMapIterator iterator;
+    const HashBucket *bucket = NULL;
+    SchemaCacheEntry *stale = NULL;
+
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    if( complete && g_SchemaCacheInitialized && scan >= g_SchemaCacheFirstScan)
+    {
+        do
+        {
+            stale = NULL;
+            HashMap_BeginIteration(&g_SchemaCache, &iterator);
+            while( (bucket = HashMap_Iterate(&g_SchemaCache, &iterator)) != NULL)
+            {
+                // A scan started later may have found a module installed after this one listed its path.
+                if( ((SchemaCacheEntry*)bucket)->lastScan < scan)
+                {
+                    stale = (SchemaCacheEntry*)bucket;
+                    break;
+                }
+            }
+            if( stale)
+            {
+                HashMap_Remove(&g_SchemaCache, (HashBucket*)stale);
+                g_SchemaCacheVersion++;
+            }
+        } while( stale != NULL);
+    }
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+}
+
+MI_Boolean SchemaCache_GetModuleClasses(MI_Uint64 scan,
+                                        _In_z_ const MI_Char *modulePath,
+                                        MI_Uint64 fingerprint,
+                                        _Inout_ MI_ClassA *miClassArray)
+{
+    SchemaCacheEntry searchEntry;
+    SchemaCacheEntry *entry = NULL;
+    MI_ClassA clones = {0};
+    MI_Instance *extendedError = NULL;
+    MI_Boolean found = MI_FALSE;
+
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    if( g_SchemaCacheInitialized && scan >= g_SchemaCacheFirstScan)
+    {
+        searchEntry.modulePath = (MI_Char*)modulePath;
+        entry = (SchemaCacheEntry*) HashMap_Find(&g_SchemaCache, (const HashBucket*)&searchEntry);
+    }
+    if( entry != NULL && entry->fingerprint == fingerprint &&
+        CloneClasses(&entry->classes, 0, &clones))
+    {
+        if( UpdateClassArray(&clones, miClassArray, &extendedError, MI_FALSE) == MI_RESULT_OK)
+        {
+            if( entry->lastScan < scan)
+            {
+                entry->lastScan = scan;
+            }
+            found = MI_TRUE;
+        }
+        else
+        {
+            CleanUpClassCache(&clones);
+            DSC_free(clones.data);
+        }
+    }
+    else if( entry != NULL && entry->fingerprint != fingerprint)
+    {
+        // Module changed on disk, the caller parses it again and replaces the entry.
+        HashMap_Remove(&g_SchemaCache, (HashBucket*)entry);
+        g_SchemaCacheVersion++;
+    }
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+
+    if( extendedError)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+    return found;
+}
+
+void SchemaCache_SetModuleClasses(MI_Uint64 scan,
+                                  _In_z_ const MI_Char *modulePath,
+                                  MI_Uint64 fingerprint,
+                                  _In_ MI_ClassA *miClassArray,
+                                  MI_Uint32 firstClass)
+{
+    SchemaCacheEntry *entry = NULL;
+    SchemaCacheEntry *replaced = NULL;
+    size_t pathLength = (Tcslen(modulePath) + 1) * sizeof(MI_Char);
+
+    // The module was parsed, so its classes are new even if they can't be cached.
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    g_SchemaCacheVersion++;
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+
+    entry = (SchemaCacheEntry*) DSC_malloc(sizeof(SchemaCacheEntry), NitsHere());
+    if( entry == NULL)
+    {
+        return;
+    }
+    memset(entry, 0, sizeof(SchemaCacheEntry));
+    entry->modulePath = (MI_Char*) DSC_malloc(pathLength, NitsHere());
+    if( entry->modulePath == NULL || !CloneClasses(miClassArray, firstClass, &entry->classes))
+    {
+        SchemaCache_Release((HashBucket*)entry);
+        return;
+    }
+    memcpy(entry->modulePath, modulePath, pathLength);
+    entry->fingerprint = fingerprint;
+
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    entry->lastScan = scan;
+    if( scan < g_SchemaCacheFirstScan || !InitializeLocked())
+    {
+        pthread_mutex_unlock(&g_SchemaCacheLock);
+        SchemaCache_Release((HashBucket*)entry);
+        return;
+    }
+    // Replace what was cached for an older version of the module, keeping the latest scan that saw it.
+    replaced = (SchemaCacheEntry*) HashMap_Find(&g_SchemaCache, (const HashBucket*)entry);
+    if( replaced != NULL && replaced->lastScan > entry->lastScan)
+    {
+        entry->lastScan = replaced->lastScan;
+    }
+    HashMap_Remove(&g_SchemaCache, (HashBucket*)entry);
+    HashMap_Insert(&g_SchemaCache, (HashBucket*)entry);
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+}
+
+MI_Uint64 SchemaCache_GetVersion()
+{
+    MI_Uint64 version = 0;
+    pthread_mutex_lock(&g_SchemaCacheLock);
+    version = g_SchemaCacheVersion;
+    pthread_mutex_unlock(&g_SchemaCacheLock);
+    return version;
+}
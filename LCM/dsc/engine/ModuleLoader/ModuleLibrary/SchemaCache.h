@@ -0,0 +1,82 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/**************************************************************************************************/
+/*                                                                                                */
+/* Process wide cache of the classes loaded from each module's *.schema.mof files. Every module   */
+/* directory is fingerprinted with the mtime and size of the directory and of its schema files,   */
+/* and the MOF parser only runs again for modules whose fingerprint changed. The cache is dropped */
+/* as a whole when the core or meta configuration schema changes.                                 */
+/*                                                                                                */
+/* The cache is in memory only and is not persisted, and registration instances are not cached.   */
+/* It pays off in long lived hosts (the OMI provider, dsc_host --serve); a one-shot dsc_host      */
+/* still parses every schema once per run.                                                        */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#ifndef __SCHEMACACHE_H_
+#define __SCHEMACACHE_H_
+
+#include <MI.h>
+#include <EngineHelperInternal.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Fingerprint of a directory and of the files in it ending with 'fileEndsWith', or of a single file when
+   'fileEndsWith' is NULL. Returns MI_RESULT_NOT_FOUND when the path doesn't exist. */
+MI_Result SchemaCache_GetFingerprint(_In_z_ const MI_Char *path,
+                                     _In_opt_z_ const MI_Char *fileEndsWith,
+                                     _Out_ MI_Uint64 *fingerprint);
+
+/* Starts a schema scan and returns its id, which is never 0. Everything cached is dropped when
+   'coreFingerprint' differs from the last scan. Scans may overlap, each one passes its own id to the
+   calls below. */
+MI_Uint64 SchemaCache_BeginScan(MI_Uint64 coreFingerprint);
+
+/* Ends 'scan'. When the scan got through every module path ('complete'), modules that neither it nor
+   a scan started after it looked up were removed from disk and are dropped; an aborted scan leaves
+   them cached. */
+void SchemaCache_EndScan(MI_Uint64 scan,
+                         MI_Boolean complete);
+
+/* Appends clones of the classes cached for 'modulePath' to miClassArray when the module still has
+   the same fingerprint. Returns MI_FALSE on a cache miss, miClassArray is left untouched in that case. */
+MI_Boolean SchemaCache_GetModuleClasses(MI_Uint64 scan,
+                                        _In_z_ const MI_Char *modulePath,
+                                        MI_Uint64 fingerprint,
+                                        _Inout_ MI_ClassA *miClassArray);
+
+/* Remembers miClassArray->data[firstClass .. miClassArray->size) as the classes of 'modulePath'.
+   Best effort, the module is simply parsed again on the next scan when this fails. */
+void SchemaCache_SetModuleClasses(MI_Uint64 scan,
+                                  _In_z_ const MI_Char *modulePath,
+                                  MI_Uint64 fingerprint,
+                                  _In_ MI_ClassA *miClassArray,
+                                  MI_Uint32 firstClass);
+
+/* Changes whenever a module's classes are parsed again, dropped or replaced, so callers holding on to
+   results derived from the module schema can tell that they are stale. */
+MI_Uint64 SchemaCache_GetVersion();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SCHEMACACHE_H_
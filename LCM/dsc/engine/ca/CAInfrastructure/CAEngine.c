@@ -27,12 +27,14 @@
 #include "ProviderCallbacks.h"
 #include "NativeResourceManager.h"
 #include "CAValidate.h"
+#include "CAScheduler.h"
 #include <curl/curl.h>
 
 #define _CA_IMPORT_ 1
 
 #include "Resources_LCM.h"
 #include "EventWrapper.h"
+#include "WebPullClient.h"
 
 #if defined(BUILD_OMS)
 
@@ -272,6 +274,7 @@ MI_Result UnInitCAHandler(_Outptr_result_maybenull_ MI_Instance **cimErrorDetail
 
     RecursiveLock_Release(&g_cs_CurrentWmiv2Operation);
     Sem_Destroy(&g_h_ConfigurationStoppedEvent);
+    PullSession_Cleanup();
 
     return MI_RESULT_OK;
 }
@@ -283,112 +286,190 @@ void MI_CALL FreeExecutionOrderContainer(_Inout_ ExecutionOrderContainer *contai
     {
         DSC_free(container->ExecutionList);
     }
+    if( container->executionPosition)
+    {
+        DSC_free(container->executionPosition);
+    }
+    if( container->dependencyStart)
+    {
+        DSC_free(container->dependencyStart);
+    }
+    if( container->dependencies)
+    {
+        DSC_free(container->dependencies);
+    }
     container->ExecutionList = NULL;
     container->executionListSize = 0;
     container->executionListCapacity = 0;
+    container->executionPosition = NULL;
+    container->dependencyStart = NULL;
+    container->dependencies = NULL;
+    container->resourceCount = 0;
 }
 
-/* Dependency resolver will create independent trees. Individual tree is
-    sorted and the sort order define the sequence in which the instances need to be executed.
-    Exception is resources which do not define any dependency. They all become part of a
-    default tree and put in the order they were defined in original document.*/
+typedef struct _ResourceIdBucket
+{
+    struct _ResourceIdBucket* next;
+    const MI_Char *resourceId;
+    MI_Uint32 index;
+} ResourceIdBucket;
 
-MI_Result MI_CALL ResolveDependency( _In_ MI_InstanceA *instanceA,
-                                  _Inout_ ExecutionOrderContainer *container,
-                                  _Outptr_result_maybenull_ MI_Instance **extendedError)
+NITS_EXTERN_C size_t ResourceIdHash(const HashBucket* bucket_)
+{
+    return HashMap_HashProc_PalStringCaseInsensitive(((ResourceIdBucket*)bucket_)->resourceId);
+}
+
+NITS_EXTERN_C int ResourceIdEqual(
+    const HashBucket* bucket1_,
+    const HashBucket* bucket2_)
+{
+    ResourceIdBucket* bucket1 = (ResourceIdBucket*)bucket1_;
+    ResourceIdBucket* bucket2 = (ResourceIdBucket*)bucket2_;
+    return Tcscasecmp(bucket1->resourceId, bucket2->resourceId) == 0;
+}
+
+NITS_EXTERN_C void ResourceIdRelease(HashBucket* bucket_)
+{
+    // Buckets are allocated as one array by BuildDependencyIndex.
+}
+
+/* Fills container->dependencyStart/dependencies with the resource index of every DependsOn entry,
+   resolved through a case-insensitive ResourceId index built once for the document. */
+MI_Result BuildDependencyIndex( _In_ MI_InstanceA *instanceA,
+                                _Inout_ ExecutionOrderContainer *container,
+                                _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
     MI_Result r = MI_RESULT_OK;
     MI_Uint32 xCount = 0;
-    MI_Sint32 *visitedNodes;
-    MI_Sint32 *resolvedNodes;
-    DSC_EventWriteMessageResolvingDependency();
-    if( container == NULL || instanceA == NULL || instanceA->size == 0 || NitsShouldFault(NitsHere(), NitsAutomatic))
-    {
-        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_NULLPARAM);
-    }
+    MI_Uint32 yCount = 0;
+    MI_Uint32 dependencyCount = 0;
+    MI_Value value;
+    HashMap resourceIdMap;
+    ResourceIdBucket *buckets = NULL;
+    ResourceIdBucket searchBucket;
 
-    if (extendedError == NULL)
+    if( HashMap_Init(&resourceIdMap, instanceA->size < 32 ? 32 : instanceA->size, ResourceIdHash, ResourceIdEqual, ResourceIdRelease) != 0)
     {
-        return MI_RESULT_INVALID_PARAMETER;
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
     }
-    *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
 
-    /*Algo to find cycles and create trees.
-          Create two lists. First one contain information about the nodes that have been visited.
-          Second one contain information about the nodes that have been resolved.*/
-    visitedNodes = (MI_Sint32*) DSC_malloc(sizeof(MI_Sint32) * instanceA->size, NitsHere());
-    if( visitedNodes == NULL)
+    buckets = (ResourceIdBucket*) DSC_malloc(sizeof(ResourceIdBucket) * instanceA->size, NitsHere());
+    container->dependencyStart = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * (instanceA->size + 1), NitsHere());
+    if( buckets == NULL || container->dependencyStart == NULL)
     {
-        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        r = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        goto Cleanup;
     }
 
-    resolvedNodes = (MI_Sint32*) DSC_malloc(sizeof(MI_Sint32) * instanceA->size, NitsHere());
-    if( resolvedNodes == NULL)
+    // Index ResourceIds and count dependencies. The first instance wins for a duplicated ResourceId,
+    // like the linear search did. Instances without ResourceId (meta configuration) can't be depended on.
+    for( xCount = 0 ; xCount < instanceA->size; xCount++)
     {
-        DSC_free(visitedNodes);
-        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        container->dependencyStart[xCount] = dependencyCount;
+
+        r = DSC_MI_Instance_GetElement(instanceA->data[xCount], OMI_BaseResource_ResourceId, &value, NULL, NULL, NULL);
+        if( r == MI_RESULT_OK && value.string != NULL)
+        {
+            buckets[xCount].resourceId = value.string;
+            buckets[xCount].index = xCount;
+            HashMap_Insert(&resourceIdMap, (HashBucket*)&buckets[xCount]);
+        }
+
+        r = MI_Instance_GetElement(instanceA->data[xCount], OMI_BaseResource_DependsOn, &value, NULL, NULL, NULL);
+        if( r == MI_RESULT_OK && value.string != NULL)
+        {
+            dependencyCount += value.stringa.size;
+        }
     }
+    container->dependencyStart[instanceA->size] = dependencyCount;
+    r = MI_RESULT_OK;
 
-    container->ExecutionList = (ResourceExecutionDetails*) DSC_malloc(sizeof(ResourceExecutionDetails) * instanceA->size, NitsHere());
-    if( container->ExecutionList == NULL )
+    container->dependencies = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * (dependencyCount + 1), NitsHere());
+    if( container->dependencies == NULL)
     {
-        DSC_free(resolvedNodes);
-        DSC_free(visitedNodes);
-        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        r = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        goto Cleanup;
     }
-    container->executionListCapacity = instanceA->size;
-
-
-    memset(resolvedNodes, -1 , sizeof(MI_Sint32) * instanceA->size);
-    memset( container->ExecutionList, -1, sizeof(ResourceExecutionDetails) * instanceA->size);
 
     for( xCount = 0 ; xCount < instanceA->size; xCount++)
     {
-        /*Check if node is already resolved. If yes return success.*/
-        if( resolvedNodes[xCount] == NODE_RESOLVED )
+        MI_Uint32 dependencyCursor = container->dependencyStart[xCount];
+
+        if( container->dependencyStart[xCount + 1] == dependencyCursor)
         {
             continue;
         }
 
-        memset(visitedNodes, -1 , sizeof(MI_Sint32) * instanceA->size);
-        r = ResolveDependencyInternal(xCount, instanceA, container, visitedNodes, resolvedNodes, extendedError);
+        r = MI_Instance_GetElement(instanceA->data[xCount], OMI_BaseResource_DependsOn, &value, NULL, NULL, NULL);
         if( r != MI_RESULT_OK)
         {
-            DSC_free(visitedNodes);
-            DSC_free(resolvedNodes);
-            FreeExecutionOrderContainer(container);
-            return r;
+            r = GetCimMIError(r, extendedError, ID_MODMAN_GETELEMENT_FAILED);
+            goto Cleanup;
         }
-    }
-    // All nodes should be visited here by now, if now we have some undefined error.
-    for( xCount = 0 ; xCount < instanceA->size; xCount++ )
-    {
-        if( resolvedNodes[xCount] != NODE_RESOLVED )
+
+        for( yCount = 0 ; yCount < value.stringa.size; yCount++)
         {
-            GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+            ResourceIdBucket *bucket;
+            searchBucket.resourceId = value.stringa.data[yCount];
+            bucket = (ResourceIdBucket*) HashMap_Find(&resourceIdMap, (const HashBucket*)&searchBucket);
+            if( bucket == NULL)
+            {
+                r = GetMissingDependencyError(instanceA, value.stringa.data[yCount], xCount, extendedError);
+                goto Cleanup;
+            }
+            container->dependencies[dependencyCursor++] = bucket->index;
         }
     }
 
-    DSC_free(visitedNodes);
-    DSC_free(resolvedNodes);
+Cleanup:
+    HashMap_Destroy(&resourceIdMap);
+    if( buckets)
+    {
+        DSC_free(buckets);
+    }
     return r;
 }
 
-/*This method assumes that all the parameters are valid and within range as appropriate. Like index is < instanceA->size etc.
-    Also memory for container is freed by the caller.*/
-MI_Result ResolveDependencyInternal( _In_ MI_Uint32 index,
-                                   _In_ MI_InstanceA *instanceA,
+static MI_Result GetDependencyCycleError( _In_ MI_InstanceA *instanceA,
+                                          _In_ MI_Uint32 index,
+                                          _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    const MI_Char* resourceID;
+    const MI_Char* sourceInfo;
+    resourceID = GetResourceId(instanceA->data[index]);
+    if(resourceID == NULL) {
+        return MI_RESULT_NOT_FOUND;
+    }
+    sourceInfo = GetSourceInfo(instanceA->data[index]);
+    if(sourceInfo == NULL)
+    {
+        return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCY_CYCLE, resourceID);
+    }
+    else
+    {
+        return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCY_CYCLE2, resourceID, sourceInfo);
+    }
+}
+
+/* Dependency resolver will create independent trees. Individual tree is
+    sorted and the sort order define the sequence in which the instances need to be executed.
+    Exception is resources which do not define any dependency. They all become part of a
+    default tree and put in the order they were defined in original document.*/
+
+MI_Result MI_CALL ResolveDependency( _In_ MI_InstanceA *instanceA,
                                   _Inout_ ExecutionOrderContainer *container,
-                                  _Inout_count_(instanceA->size) MI_Sint32 *visitedNodes,
-                                  _Inout_count_(instanceA->size) MI_Sint32 *resolvedNodes,
                                   _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
     MI_Result r = MI_RESULT_OK;
-    MI_Instance *currentInstance = NULL;
     MI_Uint32 xCount = 0;
-    MI_Uint32 dwIndex = 0;
-    MI_Value value;
-    const MI_Char *className = NULL;
+    MI_Sint32 *nodeState = NULL;
+    MI_Uint32 *stackNodes = NULL;
+    MI_Uint32 *stackCursors = NULL;
+    DSC_EventWriteMessageResolvingDependency();
+    if( container == NULL || instanceA == NULL || instanceA->size == 0 || NitsShouldFault(NitsHere(), NitsAutomatic))
+    {
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_NULLPARAM);
+    }
 
     if (extendedError == NULL)
     {
@@ -396,119 +477,115 @@ MI_Result ResolveDependencyInternal( _In_ MI_Uint32 index,
     }
     *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
 
-    if( index >= instanceA->size || NitsShouldFault(NitsHere(), NitsAutomatic))
+    /*Algo to find cycles and create trees.
+          Walk the dependencies depth first with an explicit stack and add a node to the list once
+          everything it depends on has been added. A node is visited while it is on the stack and
+          resolved once added; reaching a visited node again means there is a cycle in the graph.*/
+    nodeState = (MI_Sint32*) DSC_malloc(sizeof(MI_Sint32) * instanceA->size, NitsHere());
+    stackNodes = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * instanceA->size, NitsHere());
+    stackCursors = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * instanceA->size, NitsHere());
+    container->ExecutionList = (ResourceExecutionDetails*) DSC_malloc(sizeof(ResourceExecutionDetails) * instanceA->size, NitsHere());
+    container->executionPosition = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * instanceA->size, NitsHere());
+    if( nodeState == NULL || stackNodes == NULL || stackCursors == NULL ||
+        container->ExecutionList == NULL || container->executionPosition == NULL)
     {
-        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
+        r = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        goto Cleanup;
     }
+    container->executionListCapacity = instanceA->size;
+    container->resourceCount = instanceA->size;
 
-    // find dependencies
-    currentInstance = instanceA->data[index];
-    r = MI_Instance_GetClassName(currentInstance, &className);
-    if( r != MI_RESULT_OK )
-    {
-        return GetCimMIError(r, extendedError, ID_MODMAN_VALIDATE_PROVREGINS_CLASSNAME);
-    }
-    visitedNodes[index] = NODE_VISITED;
+    memset(nodeState, -1 , sizeof(MI_Sint32) * instanceA->size);
+    memset( container->ExecutionList, -1, sizeof(ResourceExecutionDetails) * instanceA->size);
+    memset( container->executionPosition, -1, sizeof(MI_Uint32) * instanceA->size);
 
-    r = MI_Instance_GetElement(currentInstance, OMI_BaseResource_DependsOn, &value, NULL, NULL, NULL);
-    if( r == MI_RESULT_NOT_FOUND || r == MI_RESULT_NO_SUCH_PROPERTY || value.string == NULL)
+    r = BuildDependencyIndex(instanceA, container, extendedError);
+    if( r != MI_RESULT_OK)
     {
-        // no dependency specified add it to the list.
-        resolvedNodes[index] = NODE_RESOLVED;
-        r = AddToList(container, index, extendedError);
-        return r;
+        goto Cleanup;
     }
-    else
+
+    for( xCount = 0 ; xCount < instanceA->size; xCount++)
     {
-        for( xCount = 0 ; xCount < value.stringa.size; xCount++)
+        MI_Uint32 stackSize = 0;
+
+        /*Check if node is already resolved. If yes return success.*/
+        if( nodeState[xCount] == NODE_RESOLVED )
         {
-            r = GetInstanceIndex(instanceA, value.stringa.data[xCount], index, &dwIndex, extendedError);
-            if( r != MI_RESULT_OK)
-            {
-                return r;
-            }
-            if( dwIndex >= instanceA->size || NitsShouldFault(NitsHere(), NitsAutomatic))
-            {
-                return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
-            }
-            /*Check if node is already resolved. If yes return success.*/
-            if( resolvedNodes[dwIndex] == NODE_RESOLVED)
-            {
-                continue;
-            }
+            continue;
+        }
 
-            /*If the node is visited but not resolved there is a cycle in the graph*/
-            if( visitedNodes[dwIndex] == NODE_VISITED || NitsShouldFault(NitsHere(), NitsAutomatic))
+        nodeState[xCount] = NODE_VISITED;
+        stackNodes[stackSize] = xCount;
+        stackCursors[stackSize] = container->dependencyStart[xCount];
+        stackSize++;
+
+        while( stackSize > 0)
+        {
+            MI_Uint32 node = stackNodes[stackSize - 1];
+
+            if( stackCursors[stackSize - 1] < container->dependencyStart[node + 1])
             {
-                const MI_Char* resourceID;
-                const MI_Char* sourceInfo;
-                resourceID = GetResourceId(instanceA->data[dwIndex]);
-                if(resourceID == NULL) {
-                    return MI_RESULT_NOT_FOUND;
-                }
-                sourceInfo = GetSourceInfo(instanceA->data[dwIndex]);
-                if(sourceInfo == NULL)
+                MI_Uint32 dependency = container->dependencies[stackCursors[stackSize - 1]++];
+
+                if( nodeState[dependency] == NODE_RESOLVED)
                 {
-                    return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCY_CYCLE, resourceID);
+                    continue;
                 }
-                else
+
+                /*If the node is visited but not resolved there is a cycle in the graph*/
+                if( nodeState[dependency] == NODE_VISITED || NitsShouldFault(NitsHere(), NitsAutomatic))
                 {
-                    return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCY_CYCLE2, resourceID, sourceInfo);
+                    r = GetDependencyCycleError(instanceA, dependency, extendedError);
+                    goto Cleanup;
                 }
+
+                nodeState[dependency] = NODE_VISITED;
+                stackNodes[stackSize] = dependency;
+                stackCursors[stackSize] = container->dependencyStart[dependency];
+                stackSize++;
+                continue;
             }
 
-            r = ResolveDependencyInternal(dwIndex, instanceA, container, visitedNodes, resolvedNodes, extendedError);
+            //Add it to resolved List.
+            stackSize--;
+            nodeState[node] = NODE_RESOLVED;
+            r = AddToList(container, node, extendedError);
             if( r != MI_RESULT_OK)
             {
-                return r;
+                goto Cleanup;
             }
         }
-        //Add it to resolved List.
-        resolvedNodes[index] = NODE_RESOLVED;
-        r = AddToList(container, index, extendedError);
-        if( r != MI_RESULT_OK)
-        {
-            return r;
-        }
+    }
 
+Cleanup:
+    if( r != MI_RESULT_OK)
+    {
+        FreeExecutionOrderContainer(container);
     }
-    return MI_RESULT_OK;
+    if( stackCursors)
+    {
+        DSC_free(stackCursors);
+    }
+    if( stackNodes)
+    {
+        DSC_free(stackNodes);
+    }
+    if( nodeState)
+    {
+        DSC_free(nodeState);
+    }
+    return r;
 }
 
-MI_Result GetInstanceIndex(_In_ MI_InstanceA *instanceA,
+MI_Result GetMissingDependencyError(_In_ MI_InstanceA *instanceA,
                               _In_z_ MI_Char *resourceId,
                               int currentInstanceIndex,
-                              _Out_ MI_Uint32 *resourceIndex,
                               _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
-    MI_Uint32 xCount = 0;
-    MI_Result r = MI_RESULT_OK;
-    MI_Value value;
     const MI_Char* currentResourceID;
     const MI_Char* currentSourceInfo;
 
-    *resourceIndex = 0;
-
-    if (extendedError == NULL)
-    {
-        return MI_RESULT_INVALID_PARAMETER;
-    }
-    *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
-
-    for( xCount = 0 ; xCount < instanceA->size; xCount++)
-    {
-        r = DSC_MI_Instance_GetElement(instanceA->data[xCount], OMI_BaseResource_ResourceId, &value, NULL, NULL, NULL);
-        if( r != MI_RESULT_OK )
-        {
-            return GetCimMIError(r, extendedError, ID_CAINFRA_INSTANCE_RESOURCEID);
-        }
-        if( Tcscasecmp(value.string, resourceId) == 0 )
-        {
-            *resourceIndex = xCount;
-            return MI_RESULT_OK;
-        }
-    }
-    // If here resource was not found. Throw an error.
     currentResourceID = GetResourceId(instanceA->data[currentInstanceIndex]);
     if(currentResourceID == NULL) {
         return MI_RESULT_NOT_FOUND;
@@ -531,7 +608,6 @@ MI_Result DependentResourceFailed( _In_ MI_Uint32 index,
                             _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
     MI_Result r = MI_RESULT_OK;
-    MI_Value value;
     MI_Uint32 xCount = 0;
     if (extendedError == NULL)
     {
@@ -539,35 +615,15 @@ MI_Result DependentResourceFailed( _In_ MI_Uint32 index,
     }
     *extendedError = NULL;      // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
     *bDependentFailed = MI_FALSE;
-    if( index >= instanceA->size || NitsShouldFault(NitsHere(), NitsAutomatic))
+    if( index >= instanceA->size || index >= container->resourceCount || NitsShouldFault(NitsHere(), NitsAutomatic))
     {
         return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
     }
-    /* Step1: get the resources on which resource with location index depends on.*/
-
-    r = MI_Instance_GetElement(instanceA->data[index], OMI_BaseResource_DependsOn, &value, NULL, NULL, NULL);
-    if( r == MI_RESULT_NOT_FOUND || r == MI_RESULT_NO_SUCH_PROPERTY || value.string == NULL)
-    {
-        // no dependencies we are good.
-        return MI_RESULT_OK;
-    }
-    else if ( r != MI_RESULT_OK )
-    {
-        return GetCimMIError(r, extendedError, ID_MODMAN_GETELEMENT_FAILED );
-    }
 
-    /* Step2: For each of dependent resources they should have already been processed. */
-    for ( xCount = 0 ; xCount < value.stringa.size && *bDependentFailed == MI_FALSE; xCount++)
+    /* For each of dependent resources they should have already been processed. */
+    for ( xCount = container->dependencyStart[index] ; xCount < container->dependencyStart[index + 1] && *bDependentFailed == MI_FALSE; xCount++)
     {
-        MI_Uint32 resourceIndex = 0;
-        r = GetInstanceIndex(instanceA, value.stringa.data[xCount],
-            index, &resourceIndex, extendedError);
-
-        if( r != MI_RESULT_OK )
-        {
-            return r;
-        }
-        r = DependentResourceProcessed(resourceIndex, container, bDependentFailed, extendedError);
+        r = DependentResourceProcessed(container->dependencies[xCount], container, bDependentFailed, extendedError);
         if( r != MI_RESULT_OK )
         {
             return r;
@@ -581,32 +637,37 @@ MI_Result DependentResourceProcessed (_In_ MI_Uint32 resourceIndex,
                                     _Inout_ MI_Boolean *bDependentFailed,
                                     _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
-    MI_Uint32 xCount = 0;
+    MI_Uint32 position = 0;
     if (extendedError == NULL)
     {
         return MI_RESULT_INVALID_PARAMETER;
     }
     *extendedError = NULL;
 
-    for( xCount = 0 ; xCount < container->executionListSize ; xCount++)
+    if( resourceIndex >= container->resourceCount)
     {
-        if( container->ExecutionList[xCount].resourceIndex == resourceIndex )
-        {
-            // status should be processed.
-            if( container->ExecutionList[xCount].resourceStatus == ResourceNotProcessed )
-            {
-                // We have some internal error.
-                return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
-            }
-            else if( container->ExecutionList[xCount].resourceStatus == ResourceProcessedAndFailed )
-            {
-                *bDependentFailed = MI_TRUE;
-            }
-            return MI_RESULT_OK;
-        }
+        // Here is impossible, something is messed up which we don't understant.
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
     }
-    // Here is impossible, something is messed up which we don't understant.
-    return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
+
+    position = container->executionPosition[resourceIndex];
+    if( position >= container->executionListSize)
+    {
+        // Here is impossible, something is messed up which we don't understant.
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
+    }
+
+    // status should be processed.
+    if( container->ExecutionList[position].resourceStatus == ResourceNotProcessed )
+    {
+        // We have some internal error.
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
+    }
+    else if( container->ExecutionList[position].resourceStatus == ResourceProcessedAndFailed )
+    {
+        *bDependentFailed = MI_TRUE;
+    }
+    return MI_RESULT_OK;
 }
 
 /*Caller will clean up the memory*/
@@ -614,21 +675,20 @@ MI_Result AddToList(_Inout_ ExecutionOrderContainer *container,
                             _In_ MI_Uint32 objectIndex,
                             _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
-    MI_Uint32 xCount = 0;
-
     if (extendedError == NULL)
     {
         return MI_RESULT_INVALID_PARAMETER;
     }
     *extendedError = NULL;      // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
 
-    for( xCount = 0; xCount < container->executionListSize; xCount++)
+    if( objectIndex >= container->resourceCount)
     {
-        if( objectIndex == container->ExecutionList[xCount].resourceIndex)
-        {
-            // Resource is already in the list, we are good.
-            return MI_RESULT_OK;
-        }
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError,ID_CAINFRA_DEPENDCY_OUTOFBOUNDS);
+    }
+    if( container->executionPosition[objectIndex] < container->executionListSize)
+    {
+        // Resource is already in the list, we are good.
+        return MI_RESULT_OK;
     }
     if( container->executionListSize == container->executionListCapacity )
     {
@@ -637,6 +697,7 @@ MI_Result AddToList(_Inout_ ExecutionOrderContainer *container,
     // Add it to the list at the end.
     container->ExecutionList[ container->executionListSize ].resourceIndex = objectIndex;
     container->ExecutionList[ container->executionListSize ].resourceStatus = ResourceNotProcessed;
+    container->executionPosition[objectIndex] = container->executionListSize;
     container->executionListSize++;
 
     return MI_RESULT_OK;
@@ -664,6 +725,7 @@ MI_Result SetResourcesInOrder(_In_ LCMProviderContext *lcmContext,
     MI_Char *certificateid = NULL;
     MI_Boolean bEncryptionEnabled = MI_FALSE;
     MI_Boolean canceled;
+    MI_Uint32 concurrency = 1;
     DSC_EventWriteMessageSettingResourcesOrder(executionOrder->executionListSize);
     moduleLoader = (ModuleLoaderObject*) moduleManager->reserved2;
 
@@ -682,6 +744,21 @@ MI_Result SetResourcesInOrder(_In_ LCMProviderContext *lcmContext,
         return r;
     }
 
+#if defined(BUILD_OMS)
+    // Native resources can be applied concurrently when enabled in dsc.conf. The scheduler needs
+    // the per class provider contexts of dsc_host, so it only runs there.
+    concurrency = CAScheduler_GetConcurrency();
+    if (g_DscHost == MI_TRUE && concurrency > 1 && executionOrder->executionListSize > 1)
+    {
+        if(certificateid != NULL)
+        {
+            DSC_free(certificateid);
+            certificateid = NULL;
+        }
+        return CAScheduler_SetResources(lcmContext, moduleManager, instanceA, miSession, executionOrder, flags, concurrency, resultStatus, resourceErrorList, extendedError);
+    }
+#endif
+
     // Instantiate native resource manager, responsible to load/unload native resource provider.
     r = NativeResourceManager_New(&providerContext, &(providerContext.nativeResourceManager));
     if( r != MI_RESULT_OK)
@@ -1346,6 +1423,26 @@ MI_Result MoveToDesiredState(_In_ ProviderCallbackContext *provContext,
     return r;
 }
 
+// Passes the TimeoutSec of the resource registration on to the provider, which
+// bounds every call it makes into its worker process by it.
+static MI_Result SetProviderTimeoutOption(_In_ const MI_Instance *regInstance,
+                                          _Inout_ MI_OperationOptions *sessionOptions)
+{
+    MI_Value value;
+    MI_Type type;
+    MI_Uint32 flags;
+
+    if (MI_Instance_GetElement(regInstance, MSFT_CimConfigurationProviderRegistration_TimeoutSec, &value, &type, &flags, NULL) != MI_RESULT_OK
+        || type != MI_UINT32
+        || (flags & MI_FLAG_NULL))
+    {
+        // Registrations without TimeoutSec leave the provider to its defaults.
+        return MI_RESULT_OK;
+    }
+
+    return MI_OperationOptions_SetCustomOption(sessionOptions, DSC_PROVIDERTIMEOUTSTRING, MI_UINT32, &value, MI_FALSE);
+}
+
 MI_Result Exec_WMIv2Provider(_In_ ProviderCallbackContext *provContext,
                              _In_ MI_Application *miApp,
                              _In_ MI_Session *miSession,
@@ -1513,6 +1610,10 @@ MI_Result Exec_WMIv2Provider(_In_ ProviderCallbackContext *provContext,
         }
         valueOperationOptions.string=g_ConfigurationDetails.jobGuidString;
         r =MI_OperationOptions_SetCustomOption(&sessionOptions,DSC_JOBIDSTRING,MI_STRING,&valueOperationOptions,MI_FALSE);
+        if( r == MI_RESULT_OK)
+        {
+            r = SetProviderTimeoutOption(regInstance, &sessionOptions);
+        }
         if( r != MI_RESULT_OK)
         {
             MI_OperationOptions_Delete(&sessionOptions);
@@ -2068,6 +2169,10 @@ MI_Result Get_WMIv2Provider(_In_ ProviderCallbackContext *provContext,
         valueOperationOptions.string=g_ConfigurationDetails.jobGuidString;
         
         r =MI_OperationOptions_SetCustomOption(&sessionOptions,DSC_JOBIDSTRING,MI_STRING,&valueOperationOptions,MI_FALSE);
+        if( r == MI_RESULT_OK)
+        {
+            r = SetProviderTimeoutOption(regInstance, &sessionOptions);
+        }
         if( r != MI_RESULT_OK)
         {
             MI_OperationOptions_Delete(&sessionOptions);
@@ -2301,7 +2406,7 @@ MI_Result  MI_CALL StopCurrentConfiguration(_Outptr_result_maybenull_ MI_Instanc
     }
     *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
 
-    g_CancelConfiguration = TRUE;
+    Atomic_Swap(&g_CancelConfiguration, TRUE);
     if (force == TRUE)
     {
         DSC_EventWriteMessageWaitCurrentConfig();
@@ -2320,13 +2425,13 @@ MI_Result  MI_CALL StopCurrentConfiguration(_Outptr_result_maybenull_ MI_Instanc
 
         if (r != MI_RESULT_OK)
         {
-            g_CancelConfiguration = FALSE;
+            Atomic_Swap(&g_CancelConfiguration, FALSE);
             return GetCimMIError(r, extendedError,ID_CA_CANCELWMIV2_FAILED);
         }
     }
 
     dwWaitResult = Sem_TimedWait(&g_h_ConfigurationStoppedEvent, STOP_CONFIGURATIONT_TIMEOUT);
-    g_CancelConfiguration = FALSE;
+    Atomic_Swap(&g_CancelConfiguration, FALSE);
     if (dwWaitResult != 0)
     {
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CA_FAILED_TO_WAIT_EVENT);
@@ -2546,6 +2651,10 @@ MI_Result Inventory_WMIv2Provider(_In_ ProviderCallbackContext *provContext,
     }
     valueOperationOptions.string=g_ConfigurationDetails.jobGuidString;
     r =MI_OperationOptions_SetCustomOption(&sessionOptions,DSC_JOBIDSTRING,MI_STRING,&valueOperationOptions,MI_FALSE);
+    if( r == MI_RESULT_OK)
+    {
+    r = SetProviderTimeoutOption(regInstance, &sessionOptions);
+    }
     if( r != MI_RESULT_OK)
     {
     MI_OperationOptions_Delete(&sessionOptions);
@@ -2577,6 +2686,18 @@ MI_Result Inventory_WMIv2Provider(_In_ ProviderCallbackContext *provContext,
     return r;
 }
 
+#if defined(BUILD_OMS)
+static void RegisterSIGCHLDHandler()
+{
+    struct sigaction sa;
+    sa.sa_handler = &handleSIGCHLDSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, 0);
+    DSC_EventWriteMessageRegisterProcessHandler();
+}
+#endif
+
 /*Get the current configuration for the desired state objects*/
 MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
                                     _In_ MI_Uint32 flags,
@@ -2593,17 +2714,17 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
     MI_InstanceA inventoryInstancesResult;
     MI_Session miSession = MI_SESSION_NULL;
     ProviderCallbackContext providerContext = {0};
-    MI_InstanceA * inventoryInstancesResultArray = NULL;
 
     MI_Char *certificateid = NULL;
     MI_Boolean bEncryptionEnabled = MI_FALSE;
     MI_Uint32 xCount = 0;
     MI_Uint32 index = 0;
-    MI_Instance * tempInstance;
     MI_Instance ** tempInstanceArray;
-    MI_Uint32 i = 0;
     MI_Uint32 j = 0;
-    MI_Uint32 totalInstanceCount = 0;
+    MI_Uint32 outCapacity = 0;
+#if defined(BUILD_OMS)
+    MI_Uint32 concurrency = 0;
+#endif
 
     if( outInstances == NULL  || NitsShouldFault(NitsHere(), NitsAutomatic))
     {
@@ -2635,8 +2756,6 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
     inventoryInstancesResult.data = NULL;
     inventoryInstancesResult.size = 0;
 
-    inventoryInstancesResultArray = (MI_InstanceA*)DSC_malloc(sizeof(MI_InstanceA) * instanceA->size, NitsHere());
-
     moduleLoader = (ModuleLoaderObject*) moduleManager->reserved2;
 
     /*Create MI session*/
@@ -2646,6 +2765,21 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
         return GetCimMIError(r, extendedError,ID_CAINFRA_NEWSESSION_FAILED);
     }
 
+#if defined(BUILD_OMS)
+    // Inventory resources are read only, so they can be collected concurrently when enabled in dsc.conf.
+    concurrency = CAScheduler_GetInventoryConcurrency();
+    if (g_DscHost == MI_TRUE && concurrency > 1 && instanceA->size > 1)
+    {
+        r = CAScheduler_PerformInventory(lcmContext, moduleManager, instanceA, &miSession, concurrency, PerformInventoryState, outInstances, extendedError);
+        MI_Session_Close(&miSession, NULL, NULL);
+        if (r == MI_RESULT_OK)
+        {
+            RegisterSIGCHLDHandler();
+        }
+        return r;
+    }
+#endif
+
     // Instantiate native resource manager, responsible to load/unload native resource provider.
     r = NativeResourceManager_New(&providerContext, &(providerContext.nativeResourceManager));
     if( r != MI_RESULT_OK)
@@ -2661,6 +2795,7 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
         r = moduleManager->ft->GetRegistrationInstance(moduleManager, instanceA->data[xCount]->classDecl->name, (const MI_Instance **)&regInstance, extendedError);
         if( r != MI_RESULT_OK)
         {
+            CleanUpInstanceCache(outInstances);
             MI_Session_Close(&miSession, NULL, NULL);
             return r;
         }
@@ -2669,6 +2804,7 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
         r = moduleManager->ft->GetProviderCompatibleInstance(moduleManager, instanceA->data[xCount], &filteredInstance, extendedError);
         if( r != MI_RESULT_OK)
         {
+            CleanUpInstanceCache(outInstances);
             MI_Session_Close(&miSession, NULL, NULL);
             return r;
         }
@@ -2694,34 +2830,37 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
             if( intlstr.str)
                 Intlstr_Free(intlstr);
 
+            CleanUpInstanceCache(outInstances);
             MI_Session_Close(&miSession, NULL, NULL);
             return r;
         }
 
-        inventoryInstancesResultArray[xCount].data = inventoryInstancesResult.data;
-        inventoryInstancesResultArray[xCount].size = inventoryInstancesResult.size;
-        totalInstanceCount += inventoryInstancesResult.size;
-    }
-
-    if (totalInstanceCount > 0)
-    {
-    outInstances->data = (MI_Instance**)DSC_malloc(sizeof(MI_Instance*) * totalInstanceCount, NitsHere());
-    outInstances->size = totalInstanceCount;
-
-    xCount = 0;
-    for (i = 0; i < instanceA->size; ++i)
-    {
-        for (j = 0; j < inventoryInstancesResultArray[i].size; ++j)
+        /* Move this resource's instances onto outInstances and release its array right away,
+           instead of holding every per resource array until the last resource is done. */
+        if (outInstances->size + inventoryInstancesResult.size > outCapacity)
         {
-        outInstances->data[xCount] = inventoryInstancesResultArray[i].data[j];
-        xCount += 1;
+            outCapacity = outCapacity * 2 > outInstances->size + inventoryInstancesResult.size ?
+                          outCapacity * 2 : outInstances->size + inventoryInstancesResult.size;
+            tempInstanceArray = (MI_Instance**)DSC_realloc(outInstances->data, sizeof(MI_Instance*) * outCapacity, NitsHere());
+            if (tempInstanceArray == NULL)
+            {
+                CleanUpInstanceCache(&inventoryInstancesResult);
+                CleanUpInstanceCache(outInstances);
+                MI_Session_Close(&miSession, NULL, NULL);
+                return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_LCMHELPER_MEMORY_ERROR);
+            }
+            outInstances->data = tempInstanceArray;
         }
-    }
-    }
-    else
-    {
-        outInstances->data = NULL;
-        outInstances->size = 0;
+        for (j = 0; j < inventoryInstancesResult.size; ++j)
+        {
+            outInstances->data[outInstances->size++] = inventoryInstancesResult.data[j];
+        }
+        if (inventoryInstancesResult.data != NULL)
+        {
+            DSC_free(inventoryInstancesResult.data);
+        }
+        inventoryInstancesResult.data = NULL;
+        inventoryInstancesResult.size = 0;
     }
 
     MI_Session_Close(&miSession, NULL, NULL);
@@ -2730,12 +2869,7 @@ MI_Result MI_CALL PerformInventory( _In_ LCMProviderContext *lcmContext,
     NativeResourceManager_Delete(providerContext.nativeResourceManager);
 
 #if defined(BUILD_OMS)
-    struct sigaction sa;
-    sa.sa_handler = &handleSIGCHLDSignal;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-    sigaction(SIGCHLD, &sa, 0);
-    DSC_EventWriteMessageRegisterProcessHandler();
+    RegisterSIGCHLDHandler();
 #endif
 
     return r;
@@ -43,6 +43,12 @@ typedef struct _ExecutionOrderContainer
     ResourceExecutionDetails *ExecutionList;    
     MI_Uint32 executionListCapacity;          // capacity of items in execution list
     MI_Uint32 executionListSize;              // Active size of ExecutionList.
+
+    // Indexed by the position of a resource in the instance document.
+    MI_Uint32 resourceCount;
+    MI_Uint32 *executionPosition;             // Position of the resource in ExecutionList.
+    MI_Uint32 *dependencyStart;               // Resources it depends on are dependencies[dependencyStart[i] .. dependencyStart[i + 1]).
+    MI_Uint32 *dependencies;
 } ExecutionOrderContainer;
 
 
@@ -22,7 +22,7 @@
 #define CONTAINER_DEFAULT_EXECUTION 0
 #define CONTAINER_REMAINING_EXECUTION 1
 #define NODE_VISITED 1
-#define NODE_RESOLVED 1
+#define NODE_RESOLVED 2
 
 #define LOGRESOURCE_CLASSNAME MI_T("MSFT_LogResource")
 #define LOGRESOURCE_MESSAGEPROPERTYNAME MI_T("Message")
@@ -67,17 +67,13 @@ MI_Result DependentResourceFailed( _In_ MI_Uint32 index,
                             _Out_ MI_Boolean *bDependentFailed,
                             _Outptr_result_maybenull_ MI_Instance **extendedError);
 
-MI_Result ResolveDependencyInternal( _In_ MI_Uint32 index,
-                                   _In_ MI_InstanceA *instanceA, 
-                                  _Inout_ ExecutionOrderContainer *container,
-                                  _Inout_count_(instanceA->size) MI_Sint32 *visitedNodes,
-                                  _Inout_count_(instanceA->size) MI_Sint32 *resolvedNodes,
-                                  _Outptr_result_maybenull_ MI_Instance **extendedError);
+MI_Result BuildDependencyIndex( _In_ MI_InstanceA *instanceA,
+                                _Inout_ ExecutionOrderContainer *container,
+                                _Outptr_result_maybenull_ MI_Instance **extendedError);
 
-MI_Result GetInstanceIndex(_In_ MI_InstanceA *instanceA, 
+MI_Result GetMissingDependencyError(_In_ MI_InstanceA *instanceA, 
                               _In_z_ MI_Char *resourceId, 
                               int currentInstanceIndex,
-                              _Out_ MI_Uint32 *resourceIndex, 
                               _Outptr_result_maybenull_ MI_Instance **extendedError);
 
 MI_Result AddToList(_Inout_ ExecutionOrderContainer *container, 
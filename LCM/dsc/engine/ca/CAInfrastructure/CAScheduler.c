@@ -0,0 +1,1234 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "CAScheduler.h"
+#include "ModuleHandlerInternal.h"
+#include "ProviderCallbacks.h"
+#include "NativeResourceManager.h"
+#include "Resources_LCM.h"
+#include "EventWrapper.h"
+#include <base/conf.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+  Threading model:
+
+  The thread calling CAScheduler_SetResources is the coordinator. It alone touches the module
+  manager, the LCM context, g_rnids and the execution list. Worker threads only run
+  MoveToDesiredState for native resources.
+
+  Everything logged on behalf of a resource, from its start message to the messages of its
+  provider, is captured in the resource (DSCLog_BeginCapture) and written when the resource is
+  committed, so the log reads the same as when resources are applied one after the other.
+
+  Every resource class gets a lane holding its own provider callback context, LCM context copy
+  and native resource manager. A lane runs one resource at a time, so a provider never sees two
+  concurrent calls and messages written on behalf of a resource carry the right resource id.
+
+  Resources that are not executed by a native provider (meta configuration, log resource) run
+  on the coordinator once nothing else is in flight.
+
+  Results are committed strictly in execution list order, so the status of each resource, the
+  errors written to the error stream and the early exits (test only, reboot, cancel) are the
+  same as when resources are applied one after the other.
+
+  Inventory reuses the workers and lanes. Inventory resources are read only and do not depend on
+  each other, so every resource is ready from the start, and the coordinator merges the instances
+  of each resource into the output strictly in document order.
+*/
+
+typedef enum _ScheduledResourceState
+{
+    ScheduledResourceWaiting = 0,   // some dependencies have not been processed yet
+    ScheduledResourceReady,         // all dependencies processed, not dispatched yet
+    ScheduledResourceRunning,
+    ScheduledResourceDone,
+    ScheduledResourceCommitted
+} ScheduledResourceState;
+
+typedef struct _ScheduledResource
+{
+    ScheduledResourceState state;
+    MI_Uint32 lane;
+    MI_Uint32 pendingDependencies;
+    MI_Boolean exclusive;           // must run on the coordinator with nothing else in flight
+    MI_Boolean dependencyFailed;
+    MI_Boolean executed;
+    const MI_Char *resourceId;
+    MI_Instance *filteredInstance;
+    MI_Instance *regInstance;
+    MI_Result result;
+    MI_Uint32 resultStatus;
+    MI_Boolean canceled;
+    MI_Instance *extendedError;
+    MI_InstanceA inventoryInstances;
+    DSCLogCapture log;
+} ScheduledResource;
+
+typedef struct _SchedulerLane
+{
+    const MI_Char *className;
+    MI_Boolean busy;
+    LCMProviderContext lcmContext;
+    ProviderCallbackContext providerContext;
+} SchedulerLane;
+
+typedef struct _ResourceScheduler
+{
+    // Immutable while workers run.
+    LCMProviderContext *lcmContext;
+    ModuleManager *moduleManager;
+    MI_InstanceA *instanceA;
+    MI_Application *miApp;
+    MI_Session *miSession;
+    ExecutionOrderContainer *executionOrder;    // NULL when collecting inventory
+    CAScheduler_InventoryFunction inventoryFunction;
+    MI_Uint32 count;
+    MI_Uint32 flags;
+    ResourceErrorList *resourceErrorList;
+    MI_Uint32 concurrency;
+
+    // Dependency graph in execution list positions: dependents of position i are
+    // dependents[dependentsStart[i] .. dependentsStart[i + 1]).
+    MI_Uint32 *dependentsStart;
+    MI_Uint32 *dependents;
+    MI_Uint32 *settleStack;
+
+    ScheduledResource *resources;
+    SchedulerLane *lanes;
+    MI_Uint32 laneCount;
+
+    // Coordinator only.
+    MI_Uint32 running;
+    MI_Uint32 nextCommit;
+    MI_Uint32 stopPosition;         // nothing at or after this position is started any more
+
+    // Shared with the workers, guarded by lock.
+    pthread_mutex_t lock;
+    pthread_cond_t workAvailable;
+    pthread_cond_t workCompleted;
+    MI_Uint32 *workQueue;
+    MI_Uint32 workHead;
+    MI_Uint32 workTail;
+    MI_Uint32 *completedQueue;
+    MI_Uint32 completedHead;
+    MI_Uint32 completedTail;
+    MI_Boolean shutdown;
+} ResourceScheduler;
+
+static MI_Uint32 ReadConcurrency(_In_z_ const char *confKey,
+                                 _In_ MI_Uint32 defaultConcurrency)
+{
+    Conf* conf = NULL;
+    MI_Uint32 concurrency = defaultConcurrency;
+
+    conf = Conf_Open(OMI_CONF_FILE_PATH);
+    if (!conf)
+    {
+        return concurrency;
+    }
+
+    for (;;)
+    {
+        const char* key;
+        const char* value;
+        int r = Conf_Read(conf, &key, &value);
+        if (r != 0)
+        {
+            break;
+        }
+
+        if (strcasecmp(key, confKey) == 0)
+        {
+            char* end = NULL;
+            unsigned long parsed = strtoul(value, &end, 10);
+            if (end == value || *end != '\0' || parsed == 0)
+            {
+                DSC_LOG_WARNING("Ignoring invalid %s value '%s' in dsc.conf\n", confKey, value);
+                continue;
+            }
+
+            concurrency = parsed > CA_RESOURCE_CONCURRENCY_MAX ? CA_RESOURCE_CONCURRENCY_MAX : (MI_Uint32)parsed;
+        }
+    }
+
+    Conf_Close(conf);
+    return concurrency;
+}
+
+/* More calls than there are python workers only queue up on the pool, where they can run into
+   the greeting timeout, so concurrency never exceeds the pool size. */
+static MI_Uint32 CapByWorkerPool(_In_ MI_Uint32 concurrency)
+{
+    MI_Uint32 workers = CA_PYTHON_WORKER_POOL_SIZE_DEFAULT;
+    const char *poolSize = getenv(CA_PYTHON_WORKER_POOL_SIZE_ENV);
+
+    // Same parsing as PythonWorkerPool::poolSize.
+    if (poolSize != NULL && atoi(poolSize) > 0)
+    {
+        workers = (MI_Uint32)atoi(poolSize);
+    }
+
+    return concurrency < workers ? concurrency : workers;
+}
+
+MI_Uint32 CAScheduler_GetConcurrency(void)
+{
+    return CapByWorkerPool(ReadConcurrency(CA_RESOURCE_CONCURRENCY_KEY, CA_RESOURCE_CONCURRENCY_DEFAULT));
+}
+
+MI_Uint32 CAScheduler_GetInventoryConcurrency(void)
+{
+    return CapByWorkerPool(ReadConcurrency(CA_INVENTORY_CONCURRENCY_KEY, CA_INVENTORY_CONCURRENCY_DEFAULT));
+}
+
+static MI_Instance* ScheduledInstance(_In_ ResourceScheduler *scheduler,
+                                      _In_ MI_Uint32 position)
+{
+    // Inventory has no execution list, resources are collected in document order.
+    if (scheduler->executionOrder == NULL)
+    {
+        return scheduler->instanceA->data[position];
+    }
+
+    return scheduler->instanceA->data[scheduler->executionOrder->ExecutionList[position].resourceIndex];
+}
+
+static MI_Boolean IsNativeResource(_In_ MI_Instance *instance)
+{
+    // Mirrors the dispatch in MoveToDesiredState: these classes go through the WMIv2 path,
+    // which relies on process wide state (g_CurrentWmiv2Operation, g_rnids).
+    if (Tcscasecmp(instance->classDecl->name, METACONFIG_CLASSNAME) == 0 ||
+        Tcscasecmp(instance->classDecl->name, MSFT_LOGRESOURCENAME) == 0)
+    {
+        return MI_FALSE;
+    }
+
+    return MI_TRUE;
+}
+
+/* Inverts the dependency index ResolveDependency built into dependents per execution list position. */
+static MI_Result BuildDependencyGraph(_Inout_ ResourceScheduler *scheduler,
+                                      _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    ExecutionOrderContainer *executionOrder = scheduler->executionOrder;
+    MI_Uint32 count = executionOrder->executionListSize;
+    MI_Uint32 dependencyCount = 0;
+    MI_Uint32 *cursors = NULL;
+    MI_Uint32 xCount = 0;
+    MI_Uint32 yCount = 0;
+
+    if (executionOrder->dependencyStart == NULL || executionOrder->resourceCount != scheduler->instanceA->size)
+    {
+        return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+    }
+    dependencyCount = executionOrder->dependencyStart[executionOrder->resourceCount];
+
+    scheduler->dependentsStart = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * (count + 1), NitsHere());
+    scheduler->dependents = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * (dependencyCount + 1), NitsHere());
+    cursors = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * (count + 1), NitsHere());
+    if (scheduler->dependentsStart == NULL || scheduler->dependents == NULL || cursors == NULL)
+    {
+        if (cursors != NULL)
+        {
+            DSC_free(cursors);
+        }
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+    memset(scheduler->dependentsStart, 0, sizeof(MI_Uint32) * (count + 1));
+
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        MI_Uint32 resourceIndex = executionOrder->ExecutionList[xCount].resourceIndex;
+
+        for (yCount = executionOrder->dependencyStart[resourceIndex]; yCount < executionOrder->dependencyStart[resourceIndex + 1]; yCount++)
+        {
+            MI_Uint32 dependencyPosition = executionOrder->executionPosition[executionOrder->dependencies[yCount]];
+
+            // The execution list is topologically sorted, anything else is an internal error.
+            if (dependencyPosition >= xCount)
+            {
+                DSC_free(cursors);
+                return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+            }
+
+            scheduler->dependentsStart[dependencyPosition + 1]++;
+            scheduler->resources[xCount].pendingDependencies++;
+        }
+    }
+
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        scheduler->dependentsStart[xCount + 1] += scheduler->dependentsStart[xCount];
+    }
+    memcpy(cursors, scheduler->dependentsStart, sizeof(MI_Uint32) * (count + 1));
+
+    // Dependents are visited in ascending position, so every list stays in execution list order.
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        MI_Uint32 resourceIndex = executionOrder->ExecutionList[xCount].resourceIndex;
+
+        for (yCount = executionOrder->dependencyStart[resourceIndex]; yCount < executionOrder->dependencyStart[resourceIndex + 1]; yCount++)
+        {
+            MI_Uint32 dependencyPosition = executionOrder->executionPosition[executionOrder->dependencies[yCount]];
+            scheduler->dependents[cursors[dependencyPosition]++] = xCount;
+        }
+    }
+
+    DSC_free(cursors);
+    return MI_RESULT_OK;
+}
+
+static MI_Result AssignLanes(_Inout_ ResourceScheduler *scheduler,
+                             _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Uint32 count = scheduler->count;
+    MI_Uint32 xCount = 0;
+    MI_Uint32 yCount = 0;
+
+    scheduler->lanes = (SchedulerLane*) DSC_malloc(sizeof(SchedulerLane) * count, NitsHere());
+    if (scheduler->lanes == NULL)
+    {
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+    memset(scheduler->lanes, 0, sizeof(SchedulerLane) * count);
+
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        MI_Instance *instance = ScheduledInstance(scheduler, xCount);
+        const MI_Char *className = instance->classDecl->name;
+        SchedulerLane *lane = NULL;
+
+        for (yCount = 0; yCount < scheduler->laneCount; yCount++)
+        {
+            if (Tcscasecmp(scheduler->lanes[yCount].className, className) == 0)
+            {
+                break;
+            }
+        }
+
+        if (yCount == scheduler->laneCount)
+        {
+            lane = &scheduler->lanes[yCount];
+            lane->className = className;
+            lane->lcmContext = *scheduler->lcmContext;
+            lane->providerContext.lcmProviderContext = &lane->lcmContext;
+
+            // Instantiate native resource manager, responsible to load/unload native resource provider.
+            r = NativeResourceManager_New(&lane->providerContext, &(lane->providerContext.nativeResourceManager));
+            if (r != MI_RESULT_OK)
+            {
+                return r;
+            }
+            scheduler->laneCount++;
+        }
+
+        scheduler->resources[xCount].lane = yCount;
+        scheduler->resources[xCount].exclusive = !IsNativeResource(instance);
+        scheduler->resources[xCount].resourceId = GetResourceId(instance);
+
+        //metaconfig doesn't have resourceID
+        if (scheduler->resources[xCount].resourceId == NULL &&
+            Tcscasecmp(className, METACONFIG_CLASSNAME) == 0)
+        {
+            scheduler->resources[xCount].resourceId = METACONFIG_CLASSNAME;
+        }
+    }
+
+    return r;
+}
+
+static MI_Boolean ResourceFailed(_In_ ScheduledResource *resource)
+{
+    return resource->dependencyFailed || (resource->executed && resource->result != MI_RESULT_OK);
+}
+
+/* Marks a resource as done and releases its dependents. Dependents of a failed resource are
+   failed without being executed, the same way DependentResourceFailed does it. */
+static void SettleResource(_Inout_ ResourceScheduler *scheduler,
+                           _In_ MI_Uint32 position)
+{
+    MI_Uint32 stackSize = 0;
+
+    scheduler->settleStack[stackSize++] = position;
+    while (stackSize > 0)
+    {
+        MI_Uint32 current = scheduler->settleStack[--stackSize];
+        ScheduledResource *resource = &scheduler->resources[current];
+        MI_Boolean failed = ResourceFailed(resource);
+        MI_Uint32 xCount = 0;
+
+        resource->state = ScheduledResourceDone;
+
+        for (xCount = scheduler->dependentsStart[current]; xCount < scheduler->dependentsStart[current + 1]; xCount++)
+        {
+            ScheduledResource *dependent = &scheduler->resources[scheduler->dependents[xCount]];
+            if (failed)
+            {
+                dependent->dependencyFailed = MI_TRUE;
+            }
+
+            if (--dependent->pendingDependencies == 0)
+            {
+                if (dependent->dependencyFailed)
+                {
+                    scheduler->settleStack[stackSize++] = scheduler->dependents[xCount];
+                }
+                else
+                {
+                    dependent->state = ScheduledResourceReady;
+                }
+            }
+        }
+    }
+}
+
+static void ExecuteResource(_Inout_ ResourceScheduler *scheduler,
+                            _In_ MI_Uint32 position)
+{
+    ScheduledResource *resource = &scheduler->resources[position];
+    SchedulerLane *lane = &scheduler->lanes[resource->lane];
+
+    lane->providerContext.resourceId = resource->resourceId;
+    DSCLog_BeginCapture(&resource->log);
+    if (scheduler->inventoryFunction != NULL)
+    {
+        resource->result = scheduler->inventoryFunction(&lane->providerContext, scheduler->miApp, scheduler->miSession,
+                                                        resource->filteredInstance, resource->regInstance,
+                                                        &resource->inventoryInstances, &resource->extendedError);
+    }
+    else
+    {
+        resource->canceled = MI_FALSE;
+        resource->result = MoveToDesiredState(&lane->providerContext, scheduler->miApp, scheduler->miSession,
+                                              resource->filteredInstance, resource->regInstance, scheduler->flags,
+                                              &resource->resultStatus, &resource->canceled,
+                                              scheduler->resourceErrorList, &resource->extendedError);
+    }
+    DSCLog_EndCapture();
+    resource->executed = MI_TRUE;
+}
+
+static void* SchedulerWorker(_In_ void *param)
+{
+    ResourceScheduler *scheduler = (ResourceScheduler*)param;
+    MI_Uint32 count = scheduler->count;
+
+    pthread_mutex_lock(&scheduler->lock);
+    for (;;)
+    {
+        MI_Uint32 position;
+
+        while (scheduler->workHead == scheduler->workTail && !scheduler->shutdown)
+        {
+            pthread_cond_wait(&scheduler->workAvailable, &scheduler->lock);
+        }
+
+        if (scheduler->workHead == scheduler->workTail)
+        {
+            break;
+        }
+
+        position = scheduler->workQueue[scheduler->workHead % count];
+        scheduler->workHead++;
+        pthread_mutex_unlock(&scheduler->lock);
+
+        ExecuteResource(scheduler, position);
+
+        pthread_mutex_lock(&scheduler->lock);
+        scheduler->completedQueue[scheduler->completedTail % count] = position;
+        scheduler->completedTail++;
+        pthread_cond_signal(&scheduler->workCompleted);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+
+    return NULL;
+}
+
+/* Called by the coordinator when a resource finished executing. */
+static void ResourceCompleted(_Inout_ ResourceScheduler *scheduler,
+                              _In_ MI_Uint32 position)
+{
+    ScheduledResource *resource = &scheduler->resources[position];
+
+    scheduler->lanes[resource->lane].busy = MI_FALSE;
+    scheduler->running--;
+
+    if (scheduler->inventoryFunction != NULL)
+    {
+        // Inventory resources do not depend on each other, the first failure ends the run.
+        resource->state = ScheduledResourceDone;
+        if (resource->result != MI_RESULT_OK && position < scheduler->stopPosition)
+        {
+            scheduler->stopPosition = position;
+        }
+        return;
+    }
+
+    SettleResource(scheduler, position);
+
+    // A result that ends the run once committed stops everything after it from starting;
+    // resources before it still run, as they would have run first one after the other.
+    if ((resource->canceled ||
+        ((scheduler->flags & LCM_EXECUTE_TESTONLY) && (resource->result != MI_RESULT_OK || resource->resultStatus == MI_FALSE))) &&
+        position < scheduler->stopPosition)
+    {
+        scheduler->stopPosition = position;
+    }
+}
+
+/* Reports the result of one resource, exactly like the sequential loop in SetResourcesInOrder.
+   Returns MI_TRUE when the configuration run ends with this resource, *exitResult is then set. */
+static MI_Boolean CommitResource(_Inout_ ResourceScheduler *scheduler,
+                                 _In_ MI_Uint32 position,
+                                 _Inout_ MI_Uint32 *resultStatus,
+                                 _Inout_ MI_Result *finalr,
+                                 _Out_ MI_Result *exitResult,
+                                 _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    ScheduledResource *resource = &scheduler->resources[position];
+    ExecutionOrderContainer *executionOrder = scheduler->executionOrder;
+    MI_Uint32 flags = scheduler->flags;
+
+    resource->state = ScheduledResourceCommitted;
+    DSCLog_WriteCapture(&resource->log);
+
+    if (resource->dependencyFailed)
+    {
+        executionOrder->ExecutionList[position].resourceStatus = ResourceProcessedAndFailed;
+        return MI_FALSE;
+    }
+
+    if (!resource->executed)
+    {
+        return MI_FALSE;
+    }
+
+    *resultStatus = resource->resultStatus;
+    DSC_LOG_INFO("MoveToDesiredState = %d, *resultStatus = %d\n", resource->result, *resultStatus);
+    MI_Instance_Delete(resource->filteredInstance);
+    resource->filteredInstance = NULL;
+
+    if (resource->result != MI_RESULT_OK)
+    {
+        DSC_LOG_INFO("SetResourcesInOrder failed in MoveToDesiredState\n");
+        // Failure case, update the resource status
+        Intlstr intlstr = Intlstr_Null;
+        executionOrder->ExecutionList[position].resourceStatus = ResourceProcessedAndFailed;
+        if (resource->canceled)
+        {
+            if (resource->extendedError)
+            {
+                MI_Instance_Delete(resource->extendedError);
+                resource->extendedError = NULL;
+            }
+
+            DSC_EventWriteConfigurationCancelledInTheMiddle(executionOrder->executionListSize, executionOrder->executionListSize - position);
+            *exitResult = GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CA_CANCEL_CONFIGURATION);
+            return MI_TRUE;
+        }
+        if (flags & LCM_EXECUTE_TESTONLY)
+        {
+            *extendedError = resource->extendedError;
+            resource->extendedError = NULL;
+            *exitResult = resource->result;
+            return MI_TRUE;
+        }
+
+        GetResourceString(ID_LCMHELPER_SENDCONFIGAPPLY_ERROR, &intlstr);
+
+        DSC_EventWriteLCMSendConfigurationError(CA_ACTIVITY_NAME,
+            resource->result,
+            intlstr.str,
+            resource->resourceId,
+            GetSourceInfo(scheduler->instanceA->data[executionOrder->ExecutionList[position].resourceIndex]),
+            (MI_Char*)GetErrorDetail(resource->extendedError));
+
+        if( intlstr.str)
+            Intlstr_Free(intlstr);
+
+        //send the error to WriteError stream.
+        LCM_WriteError(scheduler->lcmContext, resource->extendedError);
+
+        // we need to continue moving other resources to their desired state.
+        *finalr = resource->result;
+        DSC_LOG_INFO("SetResourcesInOrder finalr = %d\n", *finalr);
+        if (resource->extendedError)
+        {
+            MI_Instance_Delete(resource->extendedError);
+            resource->extendedError = NULL;
+        }
+
+        return MI_FALSE;
+    }
+
+    // Success Case
+    DSC_LOG_INFO("SetResourcesInOrder succeeded in MoveToDesiredState\n");
+
+    if (*resultStatus == MI_TRUE)
+    {
+        Destroy_StatusReport_RNIDS(g_rnids);
+        g_rnids = NULL;
+    }
+
+    executionOrder->ExecutionList[position].resourceStatus = ResourceProcessedAndSucceeded;
+    SetMessageInContext(ID_OUTPUT_OPERATION_END,ID_OUTPUT_ITEM_RESOURCE,scheduler->lcmContext);
+    LogCAMessage(scheduler->lcmContext, ID_OUTPUT_EMPTYSTRING, resource->resourceId);
+
+    // if resultStatus is 1 then they are in their current state otherwise not.
+    if (flags & LCM_EXECUTE_TESTONLY)
+    {
+        if (*resultStatus == MI_FALSE)
+        {
+            *exitResult = *finalr;
+            return MI_TRUE;
+        }
+    }
+    else if (DSC_RESTART_SYSTEM_FLAG & *resultStatus && *finalr == MI_RESULT_OK)
+    {
+        // Resources already in flight are allowed to finish, nothing new is started.
+        *exitResult = MI_RESULT_OK;
+        return MI_TRUE;
+    }
+
+    return MI_FALSE;
+}
+
+/* Loads the registration and the provider compatible instance of a ready resource and writes
+   its start messages, which are captured with the rest of its output. */
+static MI_Result PrepareResource(_Inout_ ResourceScheduler *scheduler,
+                                 _In_ MI_Uint32 position,
+                                 _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    ScheduledResource *resource = &scheduler->resources[position];
+    MI_Instance *instance = ScheduledInstance(scheduler, position);
+
+    DSCLog_BeginCapture(&resource->log);
+
+    // Like the sequential inventory loop, inventory does not report progress per resource.
+    if (scheduler->inventoryFunction == NULL)
+    {
+        if (scheduler->flags & LCM_EXECUTE_TESTONLY)
+        {
+            LogCAProgress(scheduler->lcmContext,MI_T("Test"),MI_T("Testing Configuration"), position, scheduler->instanceA->size);
+        }
+        else
+        {
+            LogCAProgress(scheduler->lcmContext,MI_T("Set"),MI_T("Applying Configuration"), position, scheduler->instanceA->size);
+        }
+        SetMessageInContext(ID_OUTPUT_OPERATION_START,ID_OUTPUT_ITEM_RESOURCE,scheduler->lcmContext);
+        LogCAMessage(scheduler->lcmContext, ID_OUTPUT_EMPTYSTRING, resource->resourceId);
+
+        DSC_EventWriteMessageRegisteringModule(instance->classDecl->name);
+    }
+
+    /* Get Registration Instance to find registration information.*/
+    r = scheduler->moduleManager->ft->GetRegistrationInstance(scheduler->moduleManager, instance->classDecl->name, (const MI_Instance **)&resource->regInstance, extendedError);
+    if (r == MI_RESULT_OK)
+    {
+        /*Get provider compatible instance*/
+        r = scheduler->moduleManager->ft->GetProviderCompatibleInstance(scheduler->moduleManager, instance, &resource->filteredInstance, extendedError);
+    }
+    DSCLog_EndCapture();
+
+    return r;
+}
+
+static void QueueResource(_Inout_ ResourceScheduler *scheduler,
+                          _In_ MI_Uint32 position)
+{
+    MI_Uint32 count = scheduler->count;
+
+    scheduler->resources[position].state = ScheduledResourceRunning;
+    scheduler->lanes[scheduler->resources[position].lane].busy = MI_TRUE;
+    scheduler->running++;
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->workQueue[scheduler->workTail % count] = position;
+    scheduler->workTail++;
+    pthread_cond_signal(&scheduler->workAvailable);
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+/* Moves completions reported by the workers to the coordinator; blocks for one if asked to. */
+static void CollectCompletions(_Inout_ ResourceScheduler *scheduler,
+                               _In_ MI_Boolean wait)
+{
+    MI_Uint32 count = scheduler->count;
+
+    pthread_mutex_lock(&scheduler->lock);
+    while (wait && scheduler->completedHead == scheduler->completedTail)
+    {
+        pthread_cond_wait(&scheduler->workCompleted, &scheduler->lock);
+    }
+
+    while (scheduler->completedHead != scheduler->completedTail)
+    {
+        MI_Uint32 position = scheduler->completedQueue[scheduler->completedHead % count];
+        scheduler->completedHead++;
+        ResourceCompleted(scheduler, position);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+/* Starts as many ready resources as lanes and workers allow, in execution list order.
+   Returns MI_FALSE when the run has to stop; *exitResult then holds the reason. */
+static MI_Boolean DispatchResources(_Inout_ ResourceScheduler *scheduler,
+                                    _Out_ MI_Result *exitResult,
+                                    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Uint32 count = scheduler->count;
+    MI_Uint32 position = 0;
+
+    for (position = scheduler->nextCommit; position < scheduler->stopPosition && scheduler->running < scheduler->concurrency; position++)
+    {
+        ScheduledResource *resource = &scheduler->resources[position];
+
+        if (resource->state != ScheduledResourceReady)
+        {
+            continue;
+        }
+
+        // Resources that must run alone are a barrier: nothing after them starts first.
+        if (resource->exclusive && scheduler->running > 0)
+        {
+            break;
+        }
+
+        if (scheduler->lanes[resource->lane].busy)
+        {
+            continue;
+        }
+
+        // Like the sequential inventory loop, inventory is not canceled with the configuration.
+        if (scheduler->inventoryFunction == NULL && g_CancelConfiguration == TRUE)
+        {
+            DSC_EventWriteConfigurationCancelledInTheMiddle(count, count - scheduler->nextCommit);
+            *exitResult = GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CA_CANCEL_CONFIGURATION);
+            return MI_FALSE;
+        }
+
+        if (NitsShouldFault(NitsHere(), NitsAutomatic))
+        {
+            *exitResult = GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+            return MI_FALSE;
+        }
+
+        *exitResult = PrepareResource(scheduler, position, extendedError);
+        if (*exitResult != MI_RESULT_OK)
+        {
+            return MI_FALSE;
+        }
+
+        if (resource->exclusive)
+        {
+            resource->state = ScheduledResourceRunning;
+            scheduler->lanes[resource->lane].busy = MI_TRUE;
+            scheduler->running++;
+            ExecuteResource(scheduler, position);
+            ResourceCompleted(scheduler, position);
+            return MI_TRUE;
+        }
+
+        QueueResource(scheduler, position);
+    }
+
+    return MI_TRUE;
+}
+
+static void DestroyScheduler(_Inout_ ResourceScheduler *scheduler)
+{
+    MI_Uint32 xCount = 0;
+
+    if (scheduler->resources != NULL)
+    {
+        for (xCount = 0; xCount < scheduler->count; xCount++)
+        {
+            // Output of resources that ran but were never committed still goes out, in order.
+            DSCLog_WriteCapture(&scheduler->resources[xCount].log);
+            if (scheduler->resources[xCount].filteredInstance != NULL)
+            {
+                MI_Instance_Delete(scheduler->resources[xCount].filteredInstance);
+            }
+            if (scheduler->resources[xCount].extendedError != NULL)
+            {
+                MI_Instance_Delete(scheduler->resources[xCount].extendedError);
+            }
+            CleanUpInstanceCache(&scheduler->resources[xCount].inventoryInstances);
+            if (scheduler->resources[xCount].inventoryInstances.data != NULL)
+            {
+                DSC_free(scheduler->resources[xCount].inventoryInstances.data);
+            }
+        }
+        DSC_free(scheduler->resources);
+    }
+
+    // Like SetResourcesInOrder, native resource managers are left to the host process teardown,
+    // except for inventory, where PerformInventory deletes its native resource manager too.
+    if (scheduler->lanes != NULL)
+    {
+        if (scheduler->inventoryFunction != NULL)
+        {
+            for (xCount = 0; xCount < scheduler->laneCount; xCount++)
+            {
+                NativeResourceManager_Delete(scheduler->lanes[xCount].providerContext.nativeResourceManager);
+            }
+        }
+        DSC_free(scheduler->lanes);
+    }
+    if (scheduler->dependentsStart != NULL)
+    {
+        DSC_free(scheduler->dependentsStart);
+    }
+    if (scheduler->dependents != NULL)
+    {
+        DSC_free(scheduler->dependents);
+    }
+    if (scheduler->settleStack != NULL)
+    {
+        DSC_free(scheduler->settleStack);
+    }
+    if (scheduler->workQueue != NULL)
+    {
+        DSC_free(scheduler->workQueue);
+    }
+    if (scheduler->completedQueue != NULL)
+    {
+        DSC_free(scheduler->completedQueue);
+    }
+}
+
+/* Starts up to workerCount workers and returns how many are running. */
+static MI_Uint32 StartWorkers(_Inout_ ResourceScheduler *scheduler,
+                              _Out_writes_(workerCount) pthread_t *workers,
+                              _In_ MI_Uint32 workerCount)
+{
+    MI_Uint32 xCount = 0;
+
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->workAvailable, NULL);
+    pthread_cond_init(&scheduler->workCompleted, NULL);
+
+    for (xCount = 0; xCount < workerCount; xCount++)
+    {
+        if (pthread_create(&workers[xCount], NULL, SchedulerWorker, scheduler) != 0)
+        {
+            break;
+        }
+    }
+
+    if (xCount > 0 && xCount < scheduler->concurrency)
+    {
+        scheduler->concurrency = xCount;
+    }
+
+    return xCount;
+}
+
+static void StopWorkers(_Inout_ ResourceScheduler *scheduler,
+                        _In_reads_(workerCount) pthread_t *workers,
+                        _In_ MI_Uint32 workerCount)
+{
+    MI_Uint32 xCount = 0;
+
+    pthread_mutex_lock(&scheduler->lock);
+    scheduler->shutdown = MI_TRUE;
+    pthread_cond_broadcast(&scheduler->workAvailable);
+    pthread_mutex_unlock(&scheduler->lock);
+    for (xCount = 0; xCount < workerCount; xCount++)
+    {
+        pthread_join(workers[xCount], NULL);
+    }
+    pthread_cond_destroy(&scheduler->workCompleted);
+    pthread_cond_destroy(&scheduler->workAvailable);
+    pthread_mutex_destroy(&scheduler->lock);
+}
+
+MI_Result CAScheduler_SetResources(_In_ LCMProviderContext *lcmContext,
+                                   _In_ ModuleManager *moduleManager,
+                                   _In_ MI_InstanceA *instanceA,
+                                   _In_ MI_Session *miSession,
+                                   _In_ ExecutionOrderContainer *executionOrder,
+                                   _In_ MI_Uint32 flags,
+                                   _In_ MI_Uint32 concurrency,
+                                   _Inout_ MI_Uint32 *resultStatus,
+                                   _Outptr_result_maybenull_ ResourceErrorList *resourceErrorList,
+                                   _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Result finalr = MI_RESULT_OK;
+    MI_Result exitResult = MI_RESULT_OK;
+    MI_Boolean exited = MI_FALSE;
+    MI_Instance *dispatchError = NULL;
+    MI_Result dispatchResult = MI_RESULT_OK;
+    MI_Boolean dispatchFailed = MI_FALSE;
+    ResourceScheduler scheduler;
+    pthread_t *workers = NULL;
+    MI_Uint32 workerCount = 0;
+    MI_Uint32 count = executionOrder->executionListSize;
+    MI_Uint32 xCount = 0;
+
+    if (extendedError == NULL)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+    *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
+
+    DSC_EventWriteMessageSettingResourcesOrder(count);
+
+    memset(&scheduler, 0, sizeof(scheduler));
+    scheduler.lcmContext = lcmContext;
+    scheduler.moduleManager = moduleManager;
+    scheduler.instanceA = instanceA;
+    scheduler.miApp = ((ModuleLoaderObject*) moduleManager->reserved2)->application;
+    scheduler.miSession = miSession;
+    scheduler.executionOrder = executionOrder;
+    scheduler.count = count;
+    scheduler.flags = flags;
+    scheduler.resourceErrorList = resourceErrorList;
+    scheduler.concurrency = concurrency;
+    scheduler.stopPosition = count;
+
+    scheduler.resources = (ScheduledResource*) DSC_malloc(sizeof(ScheduledResource) * count, NitsHere());
+    scheduler.settleStack = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * count, NitsHere());
+    scheduler.workQueue = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * count, NitsHere());
+    scheduler.completedQueue = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * count, NitsHere());
+    if (scheduler.resources != NULL)
+    {
+        memset(scheduler.resources, 0, sizeof(ScheduledResource) * count);
+    }
+    if (scheduler.resources == NULL || scheduler.settleStack == NULL ||
+        scheduler.workQueue == NULL || scheduler.completedQueue == NULL)
+    {
+        DestroyScheduler(&scheduler);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    r = BuildDependencyGraph(&scheduler, extendedError);
+    if (r == MI_RESULT_OK)
+    {
+        r = AssignLanes(&scheduler, extendedError);
+    }
+    if (r != MI_RESULT_OK)
+    {
+        DestroyScheduler(&scheduler);
+        return r;
+    }
+
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        scheduler.resources[xCount].state = scheduler.resources[xCount].pendingDependencies == 0 ? ScheduledResourceReady : ScheduledResourceWaiting;
+    }
+
+    workerCount = concurrency < count ? concurrency : count;
+    workers = (pthread_t*) DSC_malloc(sizeof(pthread_t) * workerCount, NitsHere());
+    if (workers == NULL)
+    {
+        DestroyScheduler(&scheduler);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    workerCount = StartWorkers(&scheduler, workers, workerCount);
+    if (workerCount == 0)
+    {
+        dispatchFailed = MI_TRUE;
+        dispatchResult = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, &dispatchError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    DSC_LOG_INFO("Applying %d resources with up to %d workers\n", count, workerCount);
+
+    while (!dispatchFailed)
+    {
+        CollectCompletions(&scheduler, MI_FALSE);
+
+        // Commit the finished prefix of the execution list.
+        while (!exited && scheduler.nextCommit < count &&
+               scheduler.resources[scheduler.nextCommit].state == ScheduledResourceDone)
+        {
+            exited = CommitResource(&scheduler, scheduler.nextCommit, resultStatus, &finalr, &exitResult, extendedError);
+            scheduler.nextCommit++;
+        }
+
+        if (exited || scheduler.nextCommit == count)
+        {
+            break;
+        }
+
+        if (!DispatchResources(&scheduler, &dispatchResult, &dispatchError))
+        {
+            dispatchFailed = MI_TRUE;
+            break;
+        }
+
+        if (scheduler.running > 0)
+        {
+            CollectCompletions(&scheduler, MI_TRUE);
+        }
+        else if (scheduler.nextCommit < count &&
+                 scheduler.resources[scheduler.nextCommit].state != ScheduledResourceDone)
+        {
+            // Nothing in flight and nothing could be started: the graph is inconsistent.
+            dispatchFailed = MI_TRUE;
+            dispatchResult = GetCimMIError(MI_RESULT_FAILED, &dispatchError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+        }
+    }
+
+    // Let resources already in flight finish; their results are still reported below.
+    while (scheduler.running > 0)
+    {
+        CollectCompletions(&scheduler, MI_TRUE);
+    }
+
+    StopWorkers(&scheduler, workers, workerCount);
+    DSC_free(workers);
+
+    // Resources that never started leave gaps, report everything that did run in order.
+    for (; !exited && scheduler.nextCommit < count; scheduler.nextCommit++)
+    {
+        if (scheduler.resources[scheduler.nextCommit].state == ScheduledResourceDone)
+        {
+            exited = CommitResource(&scheduler, scheduler.nextCommit, resultStatus, &finalr, &exitResult, extendedError);
+        }
+    }
+
+    DestroyScheduler(&scheduler);
+
+    if (exited)
+    {
+        if (dispatchError != NULL)
+        {
+            MI_Instance_Delete(dispatchError);
+        }
+        return exitResult;
+    }
+
+    if (dispatchFailed)
+    {
+        *extendedError = dispatchError;
+        return dispatchResult;
+    }
+
+    return finalr;
+}
+
+/* Appends the instances of one collected resource to outInstances, or reports its failure the
+   same way the sequential loop in PerformInventory does. */
+static MI_Result MergeInventory(_Inout_ ResourceScheduler *scheduler,
+                                _In_ MI_Uint32 position,
+                                _Inout_ MI_InstanceA *outInstances,
+                                _Inout_ MI_Uint32 *outCapacity,
+                                _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    ScheduledResource *resource = &scheduler->resources[position];
+    MI_InstanceA *inventory = &resource->inventoryInstances;
+    MI_Instance **tempInstanceArray = NULL;
+    MI_Uint32 xCount = 0;
+
+    resource->state = ScheduledResourceCommitted;
+    DSCLog_WriteCapture(&resource->log);
+    MI_Instance_Delete(resource->filteredInstance);
+    resource->filteredInstance = NULL;
+
+    if (resource->result != MI_RESULT_OK)
+    {
+        Intlstr intlstr = Intlstr_Null;
+        GetResourceString(ID_LCMHELPER_GETINVENTORY_ERROR, &intlstr);
+
+        DSC_EventWriteLCMSendConfigurationError(CA_ACTIVITY_NAME,
+            resource->result,
+            (MI_Char*)intlstr.str,
+            resource->resourceId,
+            GetSourceInfo(ScheduledInstance(scheduler, position)),
+            (MI_Char*)GetErrorDetail(resource->extendedError));
+
+        if( intlstr.str)
+            Intlstr_Free(intlstr);
+
+        *extendedError = resource->extendedError;
+        resource->extendedError = NULL;
+        return resource->result;
+    }
+
+    if (outInstances->size + inventory->size > *outCapacity)
+    {
+        *outCapacity = *outCapacity * 2 > outInstances->size + inventory->size ?
+                       *outCapacity * 2 : outInstances->size + inventory->size;
+        tempInstanceArray = (MI_Instance**)DSC_realloc(outInstances->data, sizeof(MI_Instance*) * *outCapacity, NitsHere());
+        if (tempInstanceArray == NULL)
+        {
+            return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_LCMHELPER_MEMORY_ERROR);
+        }
+        outInstances->data = tempInstanceArray;
+    }
+    for (xCount = 0; xCount < inventory->size; xCount++)
+    {
+        outInstances->data[outInstances->size++] = inventory->data[xCount];
+    }
+    if (inventory->data != NULL)
+    {
+        DSC_free(inventory->data);
+    }
+    inventory->data = NULL;
+    inventory->size = 0;
+
+    return MI_RESULT_OK;
+}
+
+MI_Result CAScheduler_PerformInventory(_In_ LCMProviderContext *lcmContext,
+                                       _In_ ModuleManager *moduleManager,
+                                       _In_ MI_InstanceA *instanceA,
+                                       _In_ MI_Session *miSession,
+                                       _In_ MI_Uint32 concurrency,
+                                       _In_ CAScheduler_InventoryFunction inventoryFunction,
+                                       _Out_ MI_InstanceA *outInstances,
+                                       _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    ResourceScheduler scheduler;
+    pthread_t *workers = NULL;
+    MI_Uint32 workerCount = 0;
+    MI_Uint32 outCapacity = 0;
+    MI_Uint32 count = 0;
+    MI_Uint32 xCount = 0;
+
+    if (extendedError == NULL)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+    *extendedError = NULL;  // Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.
+
+    if (outInstances == NULL || instanceA == NULL || moduleManager == NULL || inventoryFunction == NULL || concurrency == 0)
+    {
+        return GetCimMIError(MI_RESULT_INVALID_PARAMETER, extendedError, ID_CAINFRA_INVENTORY_NULLPARAM);
+    }
+    outInstances->data = NULL;
+    outInstances->size = 0;
+    count = instanceA->size;
+    if (count == 0)
+    {
+        return MI_RESULT_OK;
+    }
+
+    memset(&scheduler, 0, sizeof(scheduler));
+    scheduler.lcmContext = lcmContext;
+    scheduler.moduleManager = moduleManager;
+    scheduler.instanceA = instanceA;
+    scheduler.miApp = ((ModuleLoaderObject*) moduleManager->reserved2)->application;
+    scheduler.miSession = miSession;
+    scheduler.inventoryFunction = inventoryFunction;
+    scheduler.count = count;
+    scheduler.concurrency = concurrency;
+    scheduler.stopPosition = count;
+
+    scheduler.resources = (ScheduledResource*) DSC_malloc(sizeof(ScheduledResource) * count, NitsHere());
+    scheduler.workQueue = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * count, NitsHere());
+    scheduler.completedQueue = (MI_Uint32*) DSC_malloc(sizeof(MI_Uint32) * count, NitsHere());
+    if (scheduler.resources != NULL)
+    {
+        memset(scheduler.resources, 0, sizeof(ScheduledResource) * count);
+    }
+    if (scheduler.resources == NULL || scheduler.workQueue == NULL || scheduler.completedQueue == NULL)
+    {
+        DestroyScheduler(&scheduler);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    r = AssignLanes(&scheduler, extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        DestroyScheduler(&scheduler);
+        return r;
+    }
+
+    for (xCount = 0; xCount < count; xCount++)
+    {
+        scheduler.resources[xCount].state = ScheduledResourceReady;
+    }
+
+    workerCount = concurrency < count ? concurrency : count;
+    workers = (pthread_t*) DSC_malloc(sizeof(pthread_t) * workerCount, NitsHere());
+    if (workers == NULL)
+    {
+        DestroyScheduler(&scheduler);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    workerCount = StartWorkers(&scheduler, workers, workerCount);
+    if (workerCount == 0)
+    {
+        r = GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    DSC_LOG_INFO("Collecting inventory of %d resources with up to %d workers\n", count, workerCount);
+
+    while (r == MI_RESULT_OK)
+    {
+        CollectCompletions(&scheduler, MI_FALSE);
+
+        // Merge the collected prefix of the document.
+        while (r == MI_RESULT_OK && scheduler.nextCommit < count &&
+               scheduler.resources[scheduler.nextCommit].state == ScheduledResourceDone)
+        {
+            r = MergeInventory(&scheduler, scheduler.nextCommit, outInstances, &outCapacity, extendedError);
+            scheduler.nextCommit++;
+        }
+
+        if (r != MI_RESULT_OK || scheduler.nextCommit == count)
+        {
+            break;
+        }
+
+        if (!DispatchResources(&scheduler, &r, extendedError))
+        {
+            break;
+        }
+
+        if (scheduler.running > 0)
+        {
+            CollectCompletions(&scheduler, MI_TRUE);
+        }
+        else if (scheduler.resources[scheduler.nextCommit].state != ScheduledResourceDone)
+        {
+            // Nothing in flight and nothing could be started.
+            r = GetCimMIError(MI_RESULT_FAILED, extendedError, ID_CAINFRA_DEPENDCYRESOLVER_OUTOFBOUNDS);
+        }
+    }
+
+    // Resources still in flight have to finish before their lanes go away; their results are dropped.
+    while (scheduler.running > 0)
+    {
+        CollectCompletions(&scheduler, MI_TRUE);
+    }
+
+    StopWorkers(&scheduler, workers, workerCount);
+    DSC_free(workers);
+    DestroyScheduler(&scheduler);
+
+    if (r != MI_RESULT_OK)
+    {
+        CleanUpInstanceCache(outInstances);
+        if (outInstances->data != NULL)
+        {
+            DSC_free(outInstances->data);
+            outInstances->data = NULL;
+        }
+    }
+
+    return r;
+}
@@ -0,0 +1,105 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/**************************************************************************************************/
+/*                                                                                                */
+/* The CA scheduler applies the resources of a configuration concurrently. Resources are          */
+/* dispatched as soon as everything they depend on has been processed, at most one resource of a  */
+/* given class runs at a time, and results are reported in the order of the execution list.      */
+/* Inventory is collected the same way, with results merged in document order.                  */
+/*                                                                                                */
+/* The scheduler is only built with BUILD_OMS and only used when the LCM runs in dsc_host         */
+/* (g_DscHost); everywhere else resources are applied one after the other.                       */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#ifndef __CASCHEDULER_H_
+#define __CASCHEDULER_H_
+
+#include <nits.h>
+#include "MI.h"
+#include "DSC_Systemcalls.h"
+#include "EngineHelper.h"
+#include "LocalConfigManagerHelperForCA.h"
+#include <ModuleHandler.h>
+#include "CAEngine.h"
+#include "CAEngineInternal.h"
+
+// dsc.conf key selecting how many resources may be applied at the same time.
+#define CA_RESOURCE_CONCURRENCY_KEY "ResourceConcurrency"
+#define CA_RESOURCE_CONCURRENCY_DEFAULT 1
+#define CA_RESOURCE_CONCURRENCY_MAX 16
+
+// dsc.conf key selecting how many inventory resources may be collected at the same time.
+#define CA_INVENTORY_CONCURRENCY_KEY "InventoryConcurrency"
+#define CA_INVENTORY_CONCURRENCY_DEFAULT 4
+
+// Python resources are served by a pool of client.py workers, see Providers/PythonWorkerPool.cpp.
+// Neither Set/Test nor inventory has more calls in flight than there are workers.
+#define CA_PYTHON_WORKER_POOL_SIZE_ENV "DSC_PYTHON_WORKER_POOL_SIZE"
+#define CA_PYTHON_WORKER_POOL_SIZE_DEFAULT 4
+
+/* Collects the inventory of one resource, PerformInventoryState outside of tests. */
+typedef MI_Result (*CAScheduler_InventoryFunction)(_In_ ProviderCallbackContext *provContext,
+                                                   _In_ MI_Application *miApp,
+                                                   _In_ MI_Session *miSession,
+                                                   _In_ MI_Instance *instance,
+                                                   _In_ const MI_Instance *regInstance,
+                                                   _Outptr_result_maybenull_ MI_InstanceA *outputInstances,
+                                                   _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Returns the number of resources that may be applied concurrently, as configured in dsc.conf and
+   bounded by the size of the python worker pool. A missing file or key means resources are
+   applied one after the other. */
+MI_Uint32 CAScheduler_GetConcurrency(void);
+
+/* Returns the number of inventory resources that may be collected concurrently, as configured in
+   dsc.conf and bounded by the size of the python worker pool. */
+MI_Uint32 CAScheduler_GetInventoryConcurrency(void);
+
+/* Same contract as SetResourcesInOrder, with up to 'concurrency' native resources in flight. */
+MI_Result CAScheduler_SetResources(_In_ LCMProviderContext *lcmContext,
+                                   _In_ ModuleManager *moduleManager,
+                                   _In_ MI_InstanceA *instanceA,
+                                   _In_ MI_Session *miSession,
+                                   _In_ ExecutionOrderContainer *executionOrder,
+                                   _In_ MI_Uint32 flags,
+                                   _In_ MI_Uint32 concurrency,
+                                   _Inout_ MI_Uint32 *resultStatus,
+                                   _Outptr_result_maybenull_ ResourceErrorList *resourceErrorList,
+                                   _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+/* Same contract as the resource loop of PerformInventory, with up to 'concurrency' resources in
+   flight. The instances of every resource are appended to outInstances in document order. */
+MI_Result CAScheduler_PerformInventory(_In_ LCMProviderContext *lcmContext,
+                                       _In_ ModuleManager *moduleManager,
+                                       _In_ MI_InstanceA *instanceA,
+                                       _In_ MI_Session *miSession,
+                                       _In_ MI_Uint32 concurrency,
+                                       _In_ CAScheduler_InventoryFunction inventoryFunction,
+                                       _Out_ MI_InstanceA *outInstances,
+                                       _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__CASCHEDULER_H_
@@ -15,6 +15,7 @@
 */
 
 #include "CAValidate.h"
+#include "pal/hashmap.h"
 
 MI_Boolean IsSameMiValue(
     _In_ MI_Value* value0,
@@ -208,6 +209,209 @@ MI_Boolean IsMatchedKeyProperties(
     return MI_FALSE;
 }
 
+static MI_Boolean IsKeyProperty(
+    _In_ const MI_PropertyDecl* property)
+{
+    MI_Uint32 j;
+
+    for (j = 0; j < property->numQualifiers; j++)
+    {
+        if (Tcscasecmp(property->qualifiers[j]->name, MI_T("Key")) == 0)
+        {
+            return MI_TRUE;
+        }
+    }
+
+    return MI_FALSE;
+}
+
+static size_t HashBytes(
+    size_t hash,
+    _In_reads_bytes_(size) const void* data,
+    size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+
+    /* fnv1-a, continued from hash */
+    for (i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+/* Hashes a key value so that values IsSameMiValue considers equal hash equally. */
+static size_t HashMiValue(
+    size_t hash,
+    _In_ MI_Value* value,
+    MI_Type type)
+{
+    MI_Uint64 number = 0;
+
+    hash = HashBytes(hash, &type, sizeof(type));
+    switch (type)
+    {
+        case MI_BOOLEAN:
+            number = value->boolean ? 1 : 0;
+            break;
+        case MI_UINT8:
+            number = value->uint8;
+            break;
+        case MI_SINT8:
+            number = (MI_Uint64)value->sint8;
+            break;
+        case MI_UINT16:
+            number = value->uint16;
+            break;
+        case MI_SINT16:
+            number = (MI_Uint64)value->sint16;
+            break;
+        case MI_UINT32:
+            number = value->uint32;
+            break;
+        case MI_SINT32:
+            number = (MI_Uint64)value->sint32;
+            break;
+        case MI_UINT64:
+            number = value->uint64;
+            break;
+        case MI_SINT64:
+            number = (MI_Uint64)value->sint64;
+            break;
+        case MI_CHAR16:
+            number = value->char16;
+            break;
+        case MI_REAL32:
+            // 0.0 and -0.0 compare equal.
+            return value->real32 == 0 ? hash : HashBytes(hash, &value->real32, sizeof(value->real32));
+        case MI_REAL64:
+            return value->real64 == 0 ? hash : HashBytes(hash, &value->real64, sizeof(value->real64));
+        case MI_DATETIME:
+            return HashBytes(hash, &value->datetime, sizeof(value->datetime));
+        case MI_STRING:
+            return value->string == NULL ? hash : HashBytes(hash, value->string, Tcslen(value->string) * sizeof(MI_Char));
+        default:
+            // Never equal to anything, see IsSameMiValue.
+            return hash;
+    }
+
+    return HashBytes(hash, &number, sizeof(number));
+}
+
+typedef struct _KeyFingerprintBucket
+{
+    struct _KeyFingerprintBucket* next;
+    MI_Instance* instance;
+    size_t fingerprint;
+    MI_Uint32 index;
+    MI_Uint32 duplicateIndex;
+} KeyFingerprintBucket;
+
+/* Computes the fingerprint of the class name and key values of an instance.
+   *hasKey is MI_FALSE when the instance has no key to compare. */
+static MI_Result GetKeyFingerprint(
+    _In_ MI_Instance* instance,
+    _Out_ size_t* fingerprint,
+    _Out_ MI_Boolean* hasKey)
+{
+    MI_PropertyDecl** properties = (MI_PropertyDecl**)instance->classDecl->properties;
+    MI_Result result;
+    MI_Value value;
+    MI_Type type;
+    MI_Uint32 i;
+
+    *hasKey = MI_FALSE;
+    *fingerprint = HashMap_HashProc_PalStringCaseInsensitive(instance->classDecl->name);
+    for (i = 0; i < instance->classDecl->numProperties; i++)
+    {
+        if (IsKeyProperty(properties[i]))
+        {
+            result = MI_Instance_GetElement(instance, properties[i]->name, &value, &type, NULL, NULL);
+            if (result != MI_RESULT_OK)
+            {
+                return result;
+            }
+            *fingerprint = HashMiValue(*fingerprint, &value, type);
+            *hasKey = MI_TRUE;
+        }
+    }
+
+    return MI_RESULT_OK;
+}
+
+/* The pairwise scan only read the keys of instances that share their class with another one. */
+static MI_Boolean HasSameClassInstance(
+    _In_ MI_InstanceA *instanceA,
+    MI_Uint32 index)
+{
+    MI_Uint32 i;
+
+    for (i = 0; i < instanceA->size; i++)
+    {
+        if (i != index && Tcscasecmp(instanceA->data[i]->classDecl->name, instanceA->data[index]->classDecl->name) == 0)
+        {
+            return MI_TRUE;
+        }
+    }
+
+    return MI_FALSE;
+}
+
+NITS_EXTERN_C size_t KeyFingerprintHash(const HashBucket* bucket_)
+{
+    return ((KeyFingerprintBucket*)bucket_)->fingerprint;
+}
+
+/* Full comparison, the same one IsMatchedKeyProperties makes, run only when fingerprints collide. */
+NITS_EXTERN_C int KeyFingerprintEqual(
+    const HashBucket* bucket1_,
+    const HashBucket* bucket2_)
+{
+    KeyFingerprintBucket* bucket1 = (KeyFingerprintBucket*)bucket1_;
+    KeyFingerprintBucket* bucket2 = (KeyFingerprintBucket*)bucket2_;
+    MI_PropertyDecl** properties;
+    MI_Value value0, value1;
+    MI_Type type0, type1;
+    MI_Uint32 i;
+
+    if (bucket1->fingerprint != bucket2->fingerprint
+        || Tcscasecmp(bucket1->instance->classDecl->name, bucket2->instance->classDecl->name) != 0)
+    {
+        return 0;
+    }
+
+    properties = (MI_PropertyDecl**)bucket1->instance->classDecl->properties;
+    for (i = 0; i < bucket1->instance->classDecl->numProperties; i++)
+    {
+        if (IsKeyProperty(properties[i]))
+        {
+            if (MI_Instance_GetElement(bucket1->instance, properties[i]->name, &value0, &type0, NULL, NULL) != MI_RESULT_OK
+                || MI_Instance_GetElement(bucket2->instance, properties[i]->name, &value1, &type1, NULL, NULL) != MI_RESULT_OK
+                || type0 != type1
+                || (type0 == MI_STRING && (value0.string == NULL || value1.string == NULL))
+                || !IsSameMiValue(&value0, &value1, type0))
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+NITS_EXTERN_C void KeyFingerprintRelease(HashBucket* bucket_)
+{
+    MI_UNREFERENCED_PARAMETER(bucket_);
+    // Buckets are allocated as one array by ValidateIfDuplicatedInstances.
+}
+
+/* Instances are indexed by a fingerprint of their class name and key values, so each one is
+   compared in full only against the instances it collides with. Among all duplicates, the
+   pair reported is the one the pairwise scan found first: the earliest instance that has a
+   duplicate, with its first duplicate. */
 MI_Result ValidateIfDuplicatedInstances(
     _In_ MI_InstanceA *instanceA,
     _Outptr_result_maybenull_ MI_Instance **extendedError)
@@ -215,58 +419,119 @@ MI_Result ValidateIfDuplicatedInstances(
     MI_Result miResult = MI_RESULT_OK;
     MI_Instance* instance0;
     MI_Instance* instance1;
-    MI_Char* keywords;
+    MI_Char* keywords = NULL;
     const MI_Char* resourceId0;
     const MI_Char* resourceId1;
-    MI_Uint32 i, j;
-    
+    MI_Uint32 i;
+    MI_Boolean hasKey;
+    HashMap keyMap;
+    KeyFingerprintBucket* buckets;
+    KeyFingerprintBucket* bucket;
+    KeyFingerprintBucket* firstDuplicate = NULL;
+
     if (extendedError == NULL)
     {        
         return MI_RESULT_INVALID_PARAMETER; 
     }
     *extendedError = NULL;	// Explicitly set *extendedError to NULL as _Outptr_ requires setting this at least once.	
 
+    if (instanceA->size < 2)
+    {
+        return MI_RESULT_OK;
+    }
+
+    if (HashMap_Init(&keyMap, instanceA->size < 32 ? 32 : instanceA->size, KeyFingerprintHash, KeyFingerprintEqual, KeyFingerprintRelease) != 0)
+    {
+        return CreateMemoryError(extendedError);
+    }
+
+    buckets = (KeyFingerprintBucket*)DSC_malloc(sizeof(KeyFingerprintBucket) * instanceA->size, NitsHere());
+    if (buckets == NULL)
+    {
+        HashMap_Destroy(&keyMap);
+        return CreateMemoryError(extendedError);
+    }
+
     for (i = 0; i < instanceA->size; i++)
     {
         instance0 = instanceA->data[i];
-        if (instance0->classDecl->superClass != NULL &&Tcscasecmp(instance0->classDecl->superClass, BASE_RESOURCE_CLASSNAME) == 0)
+        if (instance0->classDecl->superClass == NULL
+            || Tcscasecmp(instance0->classDecl->superClass, BASE_RESOURCE_CLASSNAME) != 0)
         {
-            for (j = i + 1; j < instanceA->size; j++)
-            {
-                instance1 = instanceA->data[j];
-                if (Tcscasecmp(instance0->classDecl->name, instance1->classDecl->name) == 0
-                    && IsMatchedKeyProperties(instance0, instance1, &keywords, &miResult, extendedError))
-                {
-                    if (miResult != MI_RESULT_OK && *extendedError)
-                    {
-                        return miResult;
-                    }
+            continue;
+        }
 
-                    resourceId0 = GetResourceId(instance0);
-                    resourceId1 = GetResourceId(instance1);
-                    if (resourceId0 == NULL || resourceId1 == NULL)
-                    {
-                        miResult = CreateMemoryError(extendedError);
-                        DSC_free(keywords);
-                        return miResult;
-                    }
+        miResult = GetKeyFingerprint(instance0, &buckets[i].fingerprint, &hasKey);
+        if (miResult != MI_RESULT_OK)
+        {
+            // A key that can't be read fails validation, as it did when compared pairwise.
+            if (HasSameClassInstance(instanceA, i))
+            {
+                goto Cleanup;
+            }
+            miResult = MI_RESULT_OK;
+            continue;
+        }
+        if (!hasKey)
+        {
+            continue;
+        }
 
-                    miResult = GetCimMIError4Params(MI_RESULT_ALREADY_EXISTS, extendedError, ID_CA_DUPLICATE_KEYS, instance0->classDecl->name, resourceId0, resourceId1, keywords);
-                    if (keywords)
-                    {
-                        DSC_free(keywords);
-                    }
+        buckets[i].instance = instance0;
+        buckets[i].index = i;
+        buckets[i].duplicateIndex = 0;
 
-                    return miResult;
-                }
-                else if (miResult != MI_RESULT_OK)
-                {
-                    return miResult;
-                }
+        bucket = (KeyFingerprintBucket*)HashMap_Find(&keyMap, (const HashBucket*)&buckets[i]);
+        if (bucket == NULL)
+        {
+            HashMap_Insert(&keyMap, (HashBucket*)&buckets[i]);
+        }
+        else if (bucket->duplicateIndex == 0)
+        {
+            bucket->duplicateIndex = i;
+            if (firstDuplicate == NULL || bucket->index < firstDuplicate->index)
+            {
+                firstDuplicate = bucket;
             }
         }
     }
 
-    return MI_RESULT_OK;
-}
+    if (firstDuplicate == NULL)
+    {
+        goto Cleanup;
+    }
+
+    instance0 = firstDuplicate->instance;
+    instance1 = instanceA->data[firstDuplicate->duplicateIndex];
+
+    // Builds the list of matching keys for the message.
+    if (!IsMatchedKeyProperties(instance0, instance1, &keywords, &miResult, extendedError))
+    {
+        goto Cleanup;
+    }
+
+    if (miResult != MI_RESULT_OK && *extendedError)
+    {
+        goto Cleanup;
+    }
 
+    resourceId0 = GetResourceId(instance0);
+    resourceId1 = GetResourceId(instance1);
+    if (resourceId0 == NULL || resourceId1 == NULL)
+    {
+        miResult = CreateMemoryError(extendedError);
+        goto Cleanup;
+    }
+
+    miResult = GetCimMIError4Params(MI_RESULT_ALREADY_EXISTS, extendedError, ID_CA_DUPLICATE_KEYS, instance0->classDecl->name, resourceId0, resourceId1, keywords);
+
+Cleanup:
+    if (keywords)
+    {
+        DSC_free(keywords);
+    }
+    HashMap_Destroy(&keyMap);
+    DSC_free(buckets);
+
+    return miResult;
+}
@@ -209,9 +209,10 @@ static MI_Result PostIndication(_In_ MI_Context* context, _In_ const MI_Instance
 
 static MI_Result Canceled(_In_ const MI_Context* context, _Out_ MI_Boolean* flag)
 {
-    NativeResourceProvider* nativeResourceProvider = (NativeResourceProvider*)context;
-     DSC_EventUnSupportedHostMethodCalled(MI_T("Canceled"));
-    return MI_RESULT_NOT_SUPPORTED;
+    // Providers may run on a scheduler thread while StopConfiguration sets the flag on another,
+    // so read it with a barrier; comparing FALSE to FALSE leaves it unchanged.
+    *flag = Atomic_CompareAndSwap(&g_CancelConfiguration, FALSE, FALSE) ? MI_TRUE : MI_FALSE;
+    return MI_RESULT_OK;
 }
 
 static MI_Result RegisterCancel(_In_ MI_Context* context, _In_ MI_CancelCallback callback, void* callbackData)
@@ -252,6 +253,30 @@ static MI_Result GetLocale(_In_ const MI_Context* context, MI_LocaleType localeT
 static MI_Result GetCustomOption(_In_ MI_Context* context, _In_z_ const MI_Char* name, _Out_opt_  MI_Type* valueType, _Out_opt_  MI_Value* value)
 {
     NativeResourceProvider* nativeResourceProvider = (NativeResourceProvider*)context;
+    const MI_Instance* registration = nativeResourceProvider->_private.resourceProviderRegistration;
+    MI_Value timeout;
+    MI_Type timeoutType;
+    MI_Uint32 timeoutFlags;
+
+    // The same option the engine sets on the MI_Session_Invoke of an OMI provider
+    if (name != NULL && Tcscasecmp(name, DSC_PROVIDERTIMEOUTSTRING) == 0)
+    {
+        if (registration == NULL
+            || MI_Instance_GetElement(registration, MSFT_CimConfigurationProviderRegistration_TimeoutSec, &timeout, &timeoutType, &timeoutFlags, NULL) != MI_RESULT_OK
+            || timeoutType != MI_UINT32
+            || (timeoutFlags & MI_FLAG_NULL))
+        {
+            return MI_RESULT_NO_SUCH_PROPERTY;
+        }
+
+        if (valueType != NULL)
+            *valueType = MI_UINT32;
+        if (value != NULL)
+            *value = timeout;
+
+        return MI_RESULT_OK;
+    }
+
     DSC_EventUnSupportedHostMethodCalled(MI_T("GetCustomOption"));
     return MI_RESULT_NOT_SUPPORTED;
 }
@@ -392,6 +417,7 @@ MI_Result NativeResourceProvider_New(const _In_z_ MI_Char* resourceProviderPath,
     nativeResourceProviderLocal->_private.callbackContext = callbackContext;
     nativeResourceProviderLocal->_private.outputResource = NULL;
     nativeResourceProviderLocal->_private.result = MI_RESULT_OK;
+    nativeResourceProviderLocal->_private.resourceProviderRegistration = NULL;
 
     size_t resourceProviderPathSize = Tcslen(resourceProviderPath) + 1;
     nativeResourceProviderLocal->resourceProviderPath = (MI_Char*)DSC_malloc(sizeof(MI_Char) * resourceProviderPathSize, NitsHere());
@@ -487,7 +513,7 @@ MI_Result NativeResourceProvider_Delete(_In_ NativeResourceProvider* nativeResou
 /*                                                                                                */
 /**************************************************************************************************/
 
-static MI_Result InvokeMethod(_In_ NativeResourceProvider* resourceProvider, const _In_z_ MI_Char* methodName, const _In_ MI_Instance* inputResource, _Outptr_result_maybenull_ MI_Instance** outputResource, _Outptr_result_maybenull_ MI_Instance** extendedError) {
+static MI_Result InvokeMethod(_In_ NativeResourceProvider* resourceProvider, const _In_z_ MI_Char* methodName, const _In_ MI_Instance* inputResource, _In_ const MI_Instance *resourceProviderRegistration, _Outptr_result_maybenull_ MI_Instance** outputResource, _Outptr_result_maybenull_ MI_Instance** extendedError) {
     if (outputResource == NULL)
     {
         return MI_RESULT_INVALID_PARAMETER;
@@ -565,7 +591,9 @@ static MI_Result InvokeMethod(_In_ NativeResourceProvider* resourceProvider, con
     MI_Char* str = (MI_Char*)DSC_malloc(length * sizeof(MI_Char), NitsHere()); 
     memcpy(str, inputResource->classDecl->name, length * sizeof(MI_Char));
 
+    resourceProvider->_private.resourceProviderRegistration = resourceProviderRegistration;
     methodDecl->function(resourceProvider->_private.resourceClassDeclSelf, resourceProviderMiContext, NULL, str, methodName, NULL, inputResourceInstance);
+    resourceProvider->_private.resourceProviderRegistration = NULL;
 
     // Set the output resource to the instance posted by the provider, but only if the result is MI_RESULT_OK. 
     // If no instance has been posted, return MI_RESULT_NOT_FOUND.
@@ -647,7 +675,7 @@ MI_Result NativeResourceProvider_GetTargetResource(
 
     // Invoke GetTargetResource
     MI_Instance* outputResource = NULL;
-    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_GetMethodName, nativeResource, &outputResource, extendedError);
+    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_GetMethodName, nativeResource, resourceProviderRegistration, &outputResource, extendedError);
     EH_CheckResult(returnValue);
 
     // Get the output resource returned by GetTargetResource and remove (filter) the system properties (resource properties from base classes)
@@ -721,7 +749,7 @@ MI_Result NativeResourceProvider_TestTargetResource(
 
     // Invoke TestTargetResource
     MI_Instance* outputResource = NULL;
-    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_TestMethodName, nativeResource, &outputResource, extendedError);
+    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_TestMethodName, nativeResource, resourceProviderRegistration, &outputResource, extendedError);
     EH_CheckResult(returnValue);
 
 
@@ -794,7 +822,7 @@ MI_Result NativeResourceProvider_GetInventory(
 
     // Invoke GetTargetResource
     MI_Instance* outputResource = NULL;
-    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_InventoryMethodName, nativeResource, &outputResource, extendedError);
+    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_InventoryMethodName, nativeResource, resourceProviderRegistration, &outputResource, extendedError);
     EH_CheckResult(returnValue);
     // For Inventory output is send via streaming
 
@@ -854,7 +882,7 @@ MI_Result NativeResourceProvider_SetTargetResource(
 
     // Invoke SetTargetResource
     MI_Instance* outputResource = NULL;
-    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_SetMethodName, nativeResource, &outputResource, extendedError);
+    returnValue = InvokeMethod(resourceProvider, OMI_BaseResource_SetMethodName, nativeResource, resourceProviderRegistration, &outputResource, extendedError);
     EH_CheckResult(returnValue);
 
     // Get the output resource returned by SetTargetResource
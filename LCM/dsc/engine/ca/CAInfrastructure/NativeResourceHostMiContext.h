@@ -77,6 +77,10 @@ typedef struct {
         // Value returned by the resource provider via PostResult. The value will be MI_RESULT_OK
         // if the provider hasn't posted a result yet
         MI_Result result;
+
+        // Registration of the resource class for the method currently being invoked; the provider
+        // reads its TimeoutSec through GetCustomOption. NULL outside of a method invocation.
+        const MI_Instance* resourceProviderRegistration;
     } _private;
 
 } NativeResourceProvider;
@@ -0,0 +1,430 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "StatusReport.h"
+#include "EventWrapper.h"
+
+#define STATUSREPORT_INITIAL_CAPACITY 1024
+
+/*
+  Writes JSON straight into a growing buffer. The status report nests JSON documents as
+  string values, so everything written while inside BeginEmbedded/EndEmbedded is escaped
+  once more per level instead of being built separately and escaped afterwards.
+*/
+typedef struct _JsonWriter
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+    MI_Uint32 depth;
+    MI_Boolean failed;
+} JsonWriter;
+
+static void JsonWriter_PutChar(
+    _Inout_ JsonWriter *writer,
+    char c)
+{
+    if (writer->failed)
+    {
+        return;
+    }
+
+    if (writer->length + 1 >= writer->capacity)
+    {
+        size_t capacity = writer->capacity == 0 ? STATUSREPORT_INITIAL_CAPACITY : writer->capacity * 2;
+        char *data = (char*)DSC_realloc(writer->data, capacity, NitsHere());
+        if (data == NULL)
+        {
+            writer->failed = MI_TRUE;
+            return;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+
+    writer->data[writer->length++] = c;
+    writer->data[writer->length] = '\0';
+}
+
+static void JsonWriter_PutEscaped(
+    _Inout_ JsonWriter *writer,
+    char c,
+    MI_Uint32 depth)
+{
+    char escaped[7];
+    const char *p;
+
+    if (depth == 0)
+    {
+        JsonWriter_PutChar(writer, c);
+        return;
+    }
+
+    switch (c)
+    {
+        case '"':  strcpy(escaped, "\\\""); break;
+        case '\\': strcpy(escaped, "\\\\"); break;
+        case '\b': strcpy(escaped, "\\b"); break;
+        case '\f': strcpy(escaped, "\\f"); break;
+        case '\n': strcpy(escaped, "\\n"); break;
+        case '\r': strcpy(escaped, "\\r"); break;
+        case '\t': strcpy(escaped, "\\t"); break;
+        default:
+            if ((unsigned char)c < 0x20)
+            {
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)c);
+            }
+            else
+            {
+                escaped[0] = c;
+                escaped[1] = '\0';
+            }
+            break;
+    }
+
+    for (p = escaped; *p != '\0'; p++)
+    {
+        JsonWriter_PutEscaped(writer, *p, depth - 1);
+    }
+}
+
+static void JsonWriter_Raw(
+    _Inout_ JsonWriter *writer,
+    _In_z_ const char *text)
+{
+    for (; *text != '\0'; text++)
+    {
+        JsonWriter_PutEscaped(writer, *text, writer->depth);
+    }
+}
+
+static void JsonWriter_String(
+    _Inout_ JsonWriter *writer,
+    _In_opt_z_ const char *value)
+{
+    // NULL fields read "(null)", as they did when printf put them on the script's command line.
+    if (value == NULL)
+    {
+        value = "(null)";
+    }
+
+    JsonWriter_Raw(writer, "\"");
+    for (; *value != '\0'; value++)
+    {
+        JsonWriter_PutEscaped(writer, *value, writer->depth + 1);
+    }
+    JsonWriter_Raw(writer, "\"");
+}
+
+static void JsonWriter_Member(
+    _Inout_ JsonWriter *writer,
+    _In_z_ const char *separator,
+    _In_z_ const char *name,
+    _In_opt_z_ const char *value)
+{
+    JsonWriter_Raw(writer, separator);
+    JsonWriter_String(writer, name);
+    JsonWriter_Raw(writer, ":");
+    JsonWriter_String(writer, value);
+}
+
+static void JsonWriter_BeginEmbedded(
+    _Inout_ JsonWriter *writer)
+{
+    JsonWriter_Raw(writer, "\"");
+    writer->depth++;
+}
+
+static void JsonWriter_EndEmbedded(
+    _Inout_ JsonWriter *writer)
+{
+    writer->depth--;
+    JsonWriter_Raw(writer, "\"");
+}
+
+static void WriteResourceNotInDesiredState(
+    _Inout_ JsonWriter *writer,
+    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+    _In_z_ const char *timestamp)
+{
+    // Without a failing resource the report blames the LCM itself.
+    if (rnids == NULL || (rnids->InDesiredState != NULL && rnids->InDesiredState[0] == '\0'))
+    {
+        JsonWriter_Member(writer, "{", "SourceInfo", "(null)");
+        JsonWriter_Member(writer, ",", "ModuleName", "PsDesiredStateConfiguration");
+        JsonWriter_Member(writer, ",", "DurationInSeconds", "0");
+        JsonWriter_Member(writer, ",", "InstanceName", "LCM");
+        JsonWriter_Member(writer, ",", "StartDate", timestamp);
+        JsonWriter_Member(writer, ",", "ResourceName", "(null)");
+        JsonWriter_Member(writer, ",", "ModuleVersion", "1.1");
+        JsonWriter_Member(writer, ",", "RebootRequested", "False");
+        JsonWriter_Member(writer, ",", "ResourceId", "[DSC]LCM");
+        JsonWriter_Member(writer, ",", "ConfigurationName", "(null)");
+        JsonWriter_Member(writer, ",", "InDesiredState", "False");
+    }
+    else
+    {
+        JsonWriter_Member(writer, "{", "SourceInfo", rnids->SourceInfo);
+        JsonWriter_Member(writer, ",", "ModuleName", rnids->ModuleName);
+        JsonWriter_Member(writer, ",", "DurationInSeconds", "0");
+        JsonWriter_Member(writer, ",", "InstanceName", rnids->InstanceName);
+        JsonWriter_Member(writer, ",", "StartDate", timestamp);
+        JsonWriter_Member(writer, ",", "ResourceName", rnids->ResourceName);
+        JsonWriter_Member(writer, ",", "ModuleVersion", rnids->ModuleVersion);
+        JsonWriter_Member(writer, ",", "RebootRequested", rnids->RebootRequested);
+        JsonWriter_Member(writer, ",", "ResourceId", rnids->ResourceId);
+        JsonWriter_Member(writer, ",", "ConfigurationName", rnids->ConfigurationName);
+        JsonWriter_Member(writer, ",", "InDesiredState", rnids->InDesiredState);
+    }
+    JsonWriter_Raw(writer, "}");
+}
+
+MI_Result StatusReport_Format(
+    _In_z_ const char *jobId,
+    MI_Boolean isEndReport,
+    _In_opt_z_ const char *errorMessage,
+    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+    _In_z_ const char *timestamp,
+    _In_z_ const char *nodeName,
+    _In_z_ const char *ipAddress,
+    _Outptr_result_z_ char **report)
+{
+    JsonWriter writer = {0};
+    MI_Boolean hasError = (errorMessage != NULL && errorMessage[0] != '\0');
+
+    *report = NULL;
+
+    JsonWriter_Member(&writer, "{", "JobId", jobId);
+    if (isEndReport)
+    {
+        JsonWriter_Member(&writer, ",", "ConfigurationVersion", "2.0.0");
+        JsonWriter_Member(&writer, ",", "ReportFormatVersion", "2.0");
+        JsonWriter_Member(&writer, ",", "LCMVersion", "2.0");
+        JsonWriter_Member(&writer, ",", "EndTime", timestamp);
+
+        JsonWriter_Raw(&writer, ",\"Errors\":[");
+        if (hasError)
+        {
+            JsonWriter_BeginEmbedded(&writer);
+            JsonWriter_Member(&writer, "{", "Locale", "en-US");
+            JsonWriter_Member(&writer, ",", "ErrorCode", "1");
+            JsonWriter_Member(&writer, ",", "ErrorMessage", errorMessage);
+            JsonWriter_Member(&writer, ",", "ResourceId", "DSCEngine");
+            JsonWriter_Member(&writer, ",", "ErrorSource", "DSCEngine");
+            JsonWriter_Raw(&writer, "}");
+            JsonWriter_EndEmbedded(&writer);
+        }
+        JsonWriter_Raw(&writer, "]");
+    }
+    else
+    {
+        JsonWriter_Member(&writer, ",", "OperationType", "Consistency");
+        JsonWriter_Member(&writer, ",", "NodeName", nodeName);
+        JsonWriter_Member(&writer, ",", "IpAddress", ipAddress);
+        JsonWriter_Member(&writer, ",", "ReportFormatVersion", "2.0");
+        JsonWriter_Member(&writer, ",", "LCMVersion", "2.0");
+        JsonWriter_Member(&writer, ",", "StartTime", timestamp);
+        JsonWriter_Raw(&writer, ",\"Errors\":[]");
+    }
+
+    JsonWriter_Raw(&writer, ",\"StatusData\":[");
+    JsonWriter_BeginEmbedded(&writer);
+    JsonWriter_Member(&writer, "{", "Locale", "en-US");
+    if (isEndReport && hasError)
+    {
+        JsonWriter_Raw(&writer, ",\"ResourcesNotInDesiredState\":[");
+        WriteResourceNotInDesiredState(&writer, rnids, timestamp);
+        JsonWriter_Raw(&writer, "]");
+        JsonWriter_Member(&writer, ",", "Error", errorMessage);
+    }
+    JsonWriter_Raw(&writer, "}");
+    JsonWriter_EndEmbedded(&writer);
+    JsonWriter_Raw(&writer, "]}\n");
+
+    if (writer.failed)
+    {
+        if (writer.data)
+        {
+            DSC_free(writer.data);
+        }
+        return MI_RESULT_SERVER_LIMITS_EXCEEDED;
+    }
+
+    *report = writer.data;
+    return MI_RESULT_OK;
+}
+
+// Same shape as "date +%Y-%m-%dT%T.%N%:z".
+static void GetReportTimestamp(
+    _Out_writes_z_(size) char *buffer,
+    size_t size)
+{
+    struct timespec now;
+    struct tm local;
+    char dateTime[32];
+    char zone[8];
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    localtime_r(&now.tv_sec, &local);
+    strftime(dateTime, sizeof(dateTime), "%Y-%m-%dT%H:%M:%S", &local);
+    if (strftime(zone, sizeof(zone), "%z", &local) != 5)
+    {
+        strcpy(zone, "+0000");
+    }
+
+    snprintf(buffer, size, "%s.%09ld%.3s:%s", dateTime, (long)now.tv_nsec, zone, zone + 3);
+}
+
+static MI_Boolean IsAddressOfInterface(
+    _In_z_ const char *addressName,
+    _In_z_ const char *interfaceName)
+{
+    size_t length = strlen(interfaceName);
+
+    // IPv4 labels such as eth0:1 belong to eth0.
+    return strncmp(addressName, interfaceName, length) == 0 &&
+           (addressName[length] == '\0' || addressName[length] == ':');
+}
+
+static void AppendAddresses(
+    _In_ struct ifaddrs *addresses,
+    _In_opt_z_ const char *interfaceName,
+    int family,
+    _Inout_updates_z_(size) char *buffer,
+    size_t size,
+    _Inout_ size_t *length)
+{
+    struct ifaddrs *address;
+    char text[INET6_ADDRSTRLEN];
+    const void *raw;
+    size_t textLength;
+
+    for (address = addresses; address != NULL; address = address->ifa_next)
+    {
+        if (address->ifa_addr == NULL || address->ifa_addr->sa_family != family)
+        {
+            continue;
+        }
+
+        if (interfaceName != NULL && !IsAddressOfInterface(address->ifa_name, interfaceName))
+        {
+            continue;
+        }
+
+        raw = (family == AF_INET) ? (const void*)&((struct sockaddr_in*)address->ifa_addr)->sin_addr
+                                  : (const void*)&((struct sockaddr_in6*)address->ifa_addr)->sin6_addr;
+        if (inet_ntop(family, raw, text, sizeof(text)) == NULL)
+        {
+            continue;
+        }
+
+        textLength = strlen(text);
+        text[textLength++] = ';';
+        if (*length + textLength >= size)
+        {
+            textLength = size - 1 - *length;
+        }
+        memcpy(buffer + *length, text, textLength);
+        *length += textLength;
+        buffer[*length] = '\0';
+    }
+}
+
+// Same list "ip addr" gave the script: every address, interfaces in index order with
+// IPv4 before IPv6, each followed by ';' and the whole list cut to 254 characters.
+static void GetIpAddresses(
+    _Out_writes_z_(size) char *buffer,
+    size_t size)
+{
+    struct ifaddrs *addresses = NULL;
+    struct if_nameindex *interfaces;
+    struct if_nameindex *current;
+    size_t length = 0;
+
+    buffer[0] = '\0';
+
+    if (getifaddrs(&addresses) != 0)
+    {
+        return;
+    }
+
+    interfaces = if_nameindex();
+    if (interfaces == NULL)
+    {
+        AppendAddresses(addresses, NULL, AF_INET, buffer, size, &length);
+        AppendAddresses(addresses, NULL, AF_INET6, buffer, size, &length);
+    }
+    else
+    {
+        for (current = interfaces; current->if_index != 0 && current->if_name != NULL; current++)
+        {
+            AppendAddresses(addresses, current->if_name, AF_INET, buffer, size, &length);
+            AppendAddresses(addresses, current->if_name, AF_INET6, buffer, size, &length);
+        }
+        if_freenameindex(interfaces);
+    }
+
+    freeifaddrs(addresses);
+}
+
+MI_Result StatusReport_Create(
+    _In_z_ const char *jobId,
+    MI_Boolean isEndReport,
+    _In_opt_z_ const char *errorMessage,
+    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+    _Outptr_result_z_ char **report)
+{
+    MI_Result r;
+    char timestamp[STATUSREPORT_TIMESTAMP_LENGTH];
+    char nodeName[256] = {0};
+    char ipAddress[STATUSREPORT_MAX_IPADDRESS_LENGTH + 1] = {0};
+    FILE *fp;
+
+    GetReportTimestamp(timestamp, sizeof(timestamp));
+    if (!isEndReport)
+    {
+        if (gethostname(nodeName, sizeof(nodeName) - 1) != 0)
+        {
+            nodeName[0] = '\0';
+        }
+        GetIpAddresses(ipAddress, sizeof(ipAddress));
+    }
+
+    r = StatusReport_Format(jobId, isEndReport, errorMessage, rnids, timestamp, nodeName, ipAddress, report);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
+
+    fp = File_OpenT(LAST_STATUSREPORT_FILE_PATH, MI_T("w"));
+    if (fp == NULL)
+    {
+        DSC_TELEMETRY_WARNING("Failed to save the status report to '%s'", LAST_STATUSREPORT_FILE_PATH);
+        return MI_RESULT_OK;
+    }
+    fputs(*report, fp);
+    File_Close(fp);
+
+    return MI_RESULT_OK;
+}
@@ -0,0 +1,49 @@
+
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef __STATUSREPORT_H_
+#define __STATUSREPORT_H_
+
+#include "MI.h"
+#include <EngineHelper.h>
+#include <DSC_Systemcalls.h>
+
+// Same limit StatusReport.sh applied with "cut -c 1-254".
+#define STATUSREPORT_MAX_IPADDRESS_LENGTH 254
+#define STATUSREPORT_TIMESTAMP_LENGTH 64
+
+// Builds the body POSTed to SendReport, byte for byte what StatusReport.sh used to print
+// (trailing newline included). The report is the StartTime one unless isEndReport is set;
+// errorMessage and rnids only apply to end reports. Caller frees *report with DSC_free.
+MI_Result StatusReport_Format(
+    _In_z_ const char *jobId,
+    MI_Boolean isEndReport,
+    _In_opt_z_ const char *errorMessage,
+    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+    _In_z_ const char *timestamp,
+    _In_z_ const char *nodeName,
+    _In_z_ const char *ipAddress,
+    _Outptr_result_z_ char **report);
+
+// Formats the report for this node and now, and keeps a copy in last_statusreport.
+MI_Result StatusReport_Create(
+    _In_z_ const char *jobId,
+    MI_Boolean isEndReport,
+    _In_opt_z_ const char *errorMessage,
+    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+    _Outptr_result_z_ char **report);
+
+#endif //__STATUSREPORT_H_
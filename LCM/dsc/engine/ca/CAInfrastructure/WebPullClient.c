@@ -32,8 +32,13 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 
 #include "WebPullClient.h"
+#include "StatusReport.h"
+#include "PythonInterpreter.h"
 
 typedef struct ModuleClassList ModuleClassList;
 struct ModuleClassList {
@@ -115,18 +120,20 @@ static void CleanupHeaderChunk(struct HeaderChunk * chunk)
 struct SSLOptions g_sslOptions;
 MI_Char* InhaleTextFile(MI_Char* filePath);
 
-static MI_Result GetSSLOptions(_Outptr_result_maybenull_ MI_Instance **extendedError)
+static MI_Result GetSSLOptionsFromFile(_In_z_ const char *confPath,
+                                       _Outptr_result_maybenull_ MI_Instance **extendedError)
 {
     Conf* conf = NULL;
     MI_Char* text;
 
     g_sslOptions.DoNotCheckCertificate = MI_FALSE;
     g_sslOptions.NoSSLv3 = MI_FALSE;
+    g_sslOptions.UseHttp2 = MI_FALSE;
     g_sslOptions.cipherList[0] = '\0';
     g_sslOptions.CABundle[0] = '\0';
     g_sslOptions.Proxy[0] = '\0';
 
-    conf = Conf_Open(OMI_CONF_FILE_PATH);
+    conf = Conf_Open(confPath);
     if (!conf)
     {
         return GetCimMIError(MI_RESULT_NOT_FOUND, extendedError, ID_PULL_DSCCONF_NOTOPENABLE);
@@ -180,6 +187,22 @@ static MI_Result GetSSLOptions(_Outptr_result_maybenull_ MI_Instance **extendedE
                 return GetCimMIError2Params(MI_RESULT_INVALID_PARAMETER, extendedError, ID_PULL_DSCCONF_INVALIDVALUE, key, value);
             }
         }
+        else if (strcasecmp(key, "UseHttp2") == 0)
+        {
+            if (strcasecmp(value, "true") == 0)
+            {
+                g_sslOptions.UseHttp2 = MI_TRUE;
+            }
+            else if (strcasecmp(value, "false") == 0)
+            {
+                g_sslOptions.UseHttp2 = MI_FALSE;
+            }
+            else
+            {
+                Conf_Close(conf);
+                return GetCimMIError2Params(MI_RESULT_INVALID_PARAMETER, extendedError, ID_PULL_DSCCONF_INVALIDVALUE, key, value);
+            }
+        }
         else if (strcasecmp(key, "sslciphersuite") == 0)
         {
             size_t valueLength = strlen(value);
@@ -264,6 +287,11 @@ static MI_Result GetSSLOptions(_Outptr_result_maybenull_ MI_Instance **extendedE
 
 }
 
+static MI_Result GetSSLOptions(_Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    return GetSSLOptionsFromFile(OMI_CONF_FILE_PATH, extendedError);
+}
+
 static size_t HeaderCallback(void *contents, size_t size, size_t nmemb, void *userp)
 {
   size_t realsize = size * nmemb;
@@ -491,15 +519,34 @@ static ModuleClassList** ClassListContainsClass(ModuleClassList** firstClassList
     return current;
 }
 
+/* Finalizes the digest and compares it with the hex checksum sent by the server. */
+static MI_Boolean ChecksumMatchesDigest(_In_z_ const MI_Char *checksum, _Inout_ SHA256_CTX *ctx)
+{
+    char const alphabet[] = "0123456789ABCDEF";
+    unsigned char hashedValue[SHA256TRANSFORM_DIGEST_LEN];
+    MI_Char computedHash[SHA256TRANSFORM_DIGEST_LEN*2 + 1];
+    int iCount = 0;
+
+    SHA256_Final(hashedValue, ctx);
+
+    computedHash[SHA256TRANSFORM_DIGEST_LEN*2] = '\0';
+    for(iCount=0; iCount < SHA256TRANSFORM_DIGEST_LEN; iCount++)
+    {
+        computedHash[2*iCount] = alphabet[ hashedValue[iCount]/16];
+        computedHash[2*iCount+1] = alphabet[ hashedValue[iCount]%16];
+    }
+
+    if( Tcscasecmp(checksum, computedHash) != 0 )
+        return MI_FALSE;
+
+    return MI_TRUE;
+}
+
 MI_Boolean ValidateChecksum(_In_z_ MI_Char *checksum, _In_z_ const MI_Char* path)
 {
     MI_Uint8 buffer[BUFFER_SIZE_1KB]; // 1 KB at a time
-    MI_Char *computedHash = NULL;
     size_t bytesRead;
     SHA256_CTX Ctx;
-    char const alphabet[] = "0123456789ABCDEF";
-    unsigned char hashedValue[SHA256TRANSFORM_DIGEST_LEN];
-    int iCount = 0;
     FILE * fp = NULL;
     if( checksum == NULL)
         return MI_FALSE;
@@ -525,24 +572,9 @@ MI_Boolean ValidateChecksum(_In_z_ MI_Char *checksum, _In_z_ const MI_Char* path
     }
     while( bytesRead >= BUFFER_SIZE_1KB );
 
-    SHA256_Final(hashedValue, &Ctx);
-
     File_Close(fp);
-    // validate the checksum.
-    // Use the buffer for memory
-    computedHash = (MI_Char*) buffer;
-    computedHash[SHA256TRANSFORM_DIGEST_LEN*2] = '\0';
-    for(iCount=0; iCount < SHA256TRANSFORM_DIGEST_LEN; iCount++)
-    {
-        computedHash[2*iCount] = alphabet[ hashedValue[iCount]/16];
-        computedHash[2*iCount+1] = alphabet[ hashedValue[iCount]%16];
-    }
-
-    if( Tcscasecmp(checksum, (const MI_Char*)computedHash) != 0 )
-        return MI_FALSE;
-
-    return MI_TRUE;
 
+    return ChecksumMatchesDigest(checksum, &Ctx);
 }
 
 MI_INLINE MI_Boolean IsValidUuid(_In_z_ MI_Char* systemUuid)
@@ -1260,6 +1292,197 @@ MI_Char *GetSystemUuid()
     return systemUUid;
         }
 
+/*
+    Process-wide pull session.  Every request to the pull server used to create
+    its own easy handle, so a single pull cycle resolved the server name and did
+    a full TCP + TLS handshake for GetAction, GetConfiguration, every module and
+    the status report.  The session keeps a small pool of easy handles that are
+    reset between requests (curl_easy_reset keeps the connection, DNS and TLS
+    session caches) and ties them together with a share handle so that
+    concurrent requests reuse the same caches.
+*/
+#define PULL_SESSION_MAX_HANDLES 4
+
+static pthread_mutex_t g_pullSessionLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_pullShareLocks[CURL_LOCK_DATA_LAST];
+static CURLSH *g_pullShare = NULL;
+static CURL *g_pullHandles[PULL_SESSION_MAX_HANDLES];
+static MI_Uint32 g_pullHandleCount = 0;
+
+static void PullSession_LockShare(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    MI_UNREFERENCED_PARAMETER(handle);
+    MI_UNREFERENCED_PARAMETER(access);
+    MI_UNREFERENCED_PARAMETER(userptr);
+    pthread_mutex_lock(&g_pullShareLocks[data]);
+}
+
+static void PullSession_UnlockShare(CURL *handle, curl_lock_data data, void *userptr)
+{
+    MI_UNREFERENCED_PARAMETER(handle);
+    MI_UNREFERENCED_PARAMETER(userptr);
+    pthread_mutex_unlock(&g_pullShareLocks[data]);
+}
+
+/* Must be called with g_pullSessionLock held. */
+static void PullSession_InitShareLocked()
+{
+    int i;
+
+    if (g_pullShare != NULL)
+    {
+        return;
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    g_pullShare = curl_share_init();
+    if (g_pullShare == NULL)
+    {
+        // Requests still work without the share handle, they just do not share caches.
+        return;
+    }
+
+    for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+    {
+        pthread_mutex_init(&g_pullShareLocks[i], NULL);
+    }
+
+    curl_share_setopt(g_pullShare, CURLSHOPT_LOCKFUNC, PullSession_LockShare);
+    curl_share_setopt(g_pullShare, CURLSHOPT_UNLOCKFUNC, PullSession_UnlockShare);
+    curl_share_setopt(g_pullShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(g_pullShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+    // Sharing the connection cache needs curl 7.57.0 or later.
+    curl_share_setopt(g_pullShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
+/* Returns an easy handle with no options set other than the session share handle. */
+static CURL* PullSession_Acquire()
+{
+    CURL *curl = NULL;
+
+    pthread_mutex_lock(&g_pullSessionLock);
+
+    PullSession_InitShareLocked();
+
+    if (g_pullHandleCount > 0)
+    {
+        curl = g_pullHandles[--g_pullHandleCount];
+        g_pullHandles[g_pullHandleCount] = NULL;
+        curl_easy_reset(curl);
+    }
+    else
+    {
+        curl = curl_easy_init();
+    }
+
+    if (curl != NULL && g_pullShare != NULL)
+    {
+        curl_easy_setopt(curl, CURLOPT_SHARE, g_pullShare);
+    }
+
+    pthread_mutex_unlock(&g_pullSessionLock);
+
+    return curl;
+}
+
+static void PullSession_LogTimings(CURL *curl)
+{
+    char *effectiveUrl = NULL;
+    long responseCode = 0;
+    long newConnections = 0;
+    double nameLookup = 0;
+    double connect = 0;
+    double appConnect = 0;
+    double startTransfer = 0;
+    double total = 0;
+
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &total);
+    if (total <= 0)
+    {
+        // The request was never performed.
+        return;
+    }
+
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effectiveUrl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnections);
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &nameLookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &appConnect);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &startTransfer);
+
+    DSC_LOG_INFO("Pull request '%s' returned %ld: new connections %ld, dns %.3fs, connect %.3fs, tls %.3fs, ttfb %.3fs, total %.3fs\n",
+                 effectiveUrl ? effectiveUrl : "", responseCode, newConnections,
+                 nameLookup, connect, appConnect, startTransfer, total);
+}
+
+/* Returns the handle to the pool so the next request can reuse its connection. */
+static void PullSession_Release(CURL *curl)
+{
+    if (curl == NULL)
+    {
+        return;
+    }
+
+    PullSession_LogTimings(curl);
+
+    pthread_mutex_lock(&g_pullSessionLock);
+
+    if (g_pullHandleCount < PULL_SESSION_MAX_HANDLES)
+    {
+        g_pullHandles[g_pullHandleCount++] = curl;
+        curl = NULL;
+    }
+
+    pthread_mutex_unlock(&g_pullSessionLock);
+
+    if (curl != NULL)
+    {
+        curl_easy_cleanup(curl);
+    }
+}
+
+/* Drops the pooled handles and the share handle; the next request starts a new session. */
+void PullSession_Cleanup()
+{
+    int i;
+
+    pthread_mutex_lock(&g_pullSessionLock);
+
+    while (g_pullHandleCount > 0)
+    {
+        curl_easy_cleanup(g_pullHandles[--g_pullHandleCount]);
+        g_pullHandles[g_pullHandleCount] = NULL;
+    }
+
+    // A request still in flight keeps the share handle alive until the next cleanup.
+    if (g_pullShare != NULL && curl_share_cleanup(g_pullShare) == CURLSHE_OK)
+    {
+        g_pullShare = NULL;
+        for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+        {
+            pthread_mutex_destroy(&g_pullShareLocks[i]);
+        }
+    }
+
+    pthread_mutex_unlock(&g_pullSessionLock);
+}
+
+/* HTTP/2 is opt-in through UseHttp2 in dsc.conf; ALPN falls back to HTTP/1.1 when the server does not offer it. */
+static long PullSession_HttpVersion()
+{
+#if LIBCURL_VERSION_NUM >= 0x072f00
+    if (g_sslOptions.UseHttp2 == MI_TRUE)
+    {
+        return CURL_HTTP_VERSION_2TLS;
+    }
+#endif
+    return CURL_HTTP_VERSION_1_1;
+}
+
 MI_Result SetGeneralCurlOptions(CURL* curl,
 				_Outptr_result_maybenull_ MI_Instance **extendedError)
 {
@@ -1304,6 +1527,76 @@ MI_Result SetGeneralCurlOptions(CURL* curl,
     return MI_RESULT_OK;
 }
 
+MI_Result PullSession_Probe(_In_z_ const char *confPath,
+                            _In_z_ const char *url,
+                            MI_Uint32 requests,
+                            _Out_ MI_Uint32 *newConnections,
+                            _Out_ MI_Boolean *offeredHttp2,
+                            _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Uint32 xCount = 0;
+    CURL *curl = NULL;
+    CURLcode res = CURLE_OK;
+    long connections = 0;
+    long responseCode = 0;
+    struct Chunk dataChunk;
+
+    *newConnections = 0;
+    *offeredHttp2 = MI_FALSE;
+
+    r = GetSSLOptionsFromFile(confPath, extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
+    *offeredHttp2 = PullSession_HttpVersion() != CURL_HTTP_VERSION_1_1 ? MI_TRUE : MI_FALSE;
+
+    for (xCount = 0; xCount < requests; xCount++)
+    {
+        curl = PullSession_Acquire();
+        if (!curl)
+        {
+            return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
+        }
+
+        r = SetGeneralCurlOptions(curl, extendedError);
+        if (r != MI_RESULT_OK)
+        {
+            PullSession_Release(curl);
+            return r;
+        }
+
+        dataChunk.data = (char *)malloc(1);
+        dataChunk.size = 0;
+
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &dataChunk);
+
+        res = curl_easy_perform(curl);
+        free(dataChunk.data);
+        if (res != CURLE_OK)
+        {
+            PullSession_Release(curl);
+            return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, url, curl_easy_strerror(res));
+        }
+
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connections);
+        PullSession_Release(curl);
+
+        if (responseCode != HTTP_SUCCESS_CODE)
+        {
+            return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, url, "unexpected response code");
+        }
+        *newConnections += (MI_Uint32)connections;
+    }
+
+    return MI_RESULT_OK;
+}
+
 MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
                                   _In_z_ const MI_Char *certificateID,
                                   _In_z_ const MI_Char *checkSum,
@@ -1356,7 +1649,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
         return GetCimMIError(r, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
     }
 
-    curl = curl_easy_init();
+    curl = PullSession_Acquire();
     if (!curl)
     {
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
@@ -1376,7 +1669,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
     if (r != MI_RESULT_OK)
     {
 	DSC_free(bodyContent);
-	curl_easy_cleanup(curl);
+	PullSession_Release(curl);
 	return r;
     }
 
@@ -1392,7 +1685,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
     list = curl_slist_append(list, "Content-Type: application/json; charset=utf-8");
     list = curl_slist_append(list, "ProtocolVersion: 2.0");
 
-    res = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    res = curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
     res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
     res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, bodyContent);
     res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
@@ -1403,7 +1696,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
     if (res != CURLE_OK)
     {
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
     }
     res = curl_easy_setopt(curl, CURLOPT_SSLKEY, OAAS_KEYPATH);
@@ -1416,7 +1709,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
             *getActionStatusCode = GetDscActionCommandFailure;
             DSC_free(bodyContent);
             curl_slist_free_all(list);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETCIPHERLIST);
         }
     }
@@ -1429,7 +1722,7 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
             *getActionStatusCode = GetDscActionCommandFailure;
             DSC_free(bodyContent);
             curl_slist_free_all(list);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETNOSSLV3);
         }
     }
@@ -1444,14 +1737,14 @@ MI_Result  IssueGetActionRequest( _In_z_ const MI_Char *configurationID,
         free(headerChunk.data);
         free(dataChunk.data);
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
 
         return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, url, curl_easy_strerror(res));
     }
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
     curl_slist_free_all(list);
-    curl_easy_cleanup(curl);
+    PullSession_Release(curl);
 
     if (responseCode != HTTP_SUCCESS_CODE)
     {
@@ -1525,7 +1818,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
     DSC_EventWriteGetDscDocumentWebDownloadManagerServerUrl(configurationID, url);
     Stprintf(outputResult,3, MI_T("OK"));
 
-    curl = curl_easy_init();
+    curl = PullSession_Acquire();
     if (!curl)
     {
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
@@ -1543,7 +1836,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
     r = SetGeneralCurlOptions(curl, extendedError);
     if (r != MI_RESULT_OK)
     {
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return r;
     }
 
@@ -1556,7 +1849,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
     list = curl_slist_append(list, "ProtocolVersion: 2.0");
 
 
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
@@ -1567,7 +1860,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
     if (res != CURLE_OK)
     {
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
     }
     curl_easy_setopt(curl, CURLOPT_SSLKEY, OAAS_KEYPATH);
@@ -1581,7 +1874,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
             *getActionStatusCode = GetConfigurationCommandFailure;
 
             curl_slist_free_all(list);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
 
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETCIPHERLIST);
         }
@@ -1595,7 +1888,7 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
             *getActionStatusCode = GetConfigurationCommandFailure;
 
             curl_slist_free_all(list);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETNOSSLV3);
         }
     }
@@ -1609,13 +1902,13 @@ MI_Result  IssueGetConfigurationRequest( _In_z_ const MI_Char *configurationID,
         CleanupHeaderChunk(&headerChunk);
         free(dataChunk.data);
         DSC_free(outputResult);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
 
         return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, url, curl_easy_strerror(res));
     }
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-    curl_easy_cleanup(curl);
+    PullSession_Release(curl);
 
     if (responseCode != HTTP_SUCCESS_CODE)
     {
@@ -1815,90 +2108,162 @@ MI_Result CreateTmpDirectoryPath(_Outptr_result_maybenull_z_  MI_Char** director
    return MI_RESULT_FAILED;
 }
 
-MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
-                                  _In_z_ const MI_Char *moduleName,
-                                  _In_z_ const MI_Char *moduleVersion,
-                                  _In_z_ const MI_Char *certificateID,
-                                  _In_z_ const MI_Char *filePath,
-                                  _Outptr_result_maybenull_z_  MI_Char** result,
-                                  _Out_ MI_Uint32* getActionStatusCode,
-                                  _In_reads_z_(URL_SIZE) const MI_Char *url,
-                                  _In_ MI_Uint32 port,
-                                  _In_reads_z_(SUBURL_SIZE) const MI_Char *subUrl,
-                                  MI_Boolean bIsHttps,
-                                  _Outptr_result_maybenull_ MI_Instance **extendedError)
-{
-    MI_Result r = MI_RESULT_OK;
-    MI_Char *outputResult = (MI_Char*)DSC_malloc((Tcslen(MI_T("OK"))+1) * sizeof(MI_Char), NitsHere());
+#define PULL_MODULE_DOWNLOAD_CONCURRENCY PULL_SESSION_MAX_HANDLES
 
-    CURL *curl = NULL;
-    CURLcode res = CURLE_OK;
+/*
+    A single module download.  The body is streamed to "<zip>.part" and hashed
+    as it arrives, so a module is never held in memory and the checksum does
+    not need a second pass over the file.  The part file is renamed to the zip
+    only once the checksum matches.
+*/
+typedef struct _ModuleDownload
+{
+    CURL *curl;
+    struct curl_slist *headers;
     struct HeaderChunk headerChunk;
-    struct Chunk dataChunk;
-    char configurationUrl[MAX_URL_LENGTH];
-    long responseCode = 0;
-    size_t i;
-    char* checksumResponse = NULL;
-    char* checksumAlgorithmResponse = NULL;
-    struct curl_slist *list = NULL;
-    char agentIdHeader[101];
+    MI_Boolean headerChunkInitialized;
+    FILE *fp;
+    MI_Boolean writeFailed;
+    SHA256_CTX hashContext;
+    const MI_Char *moduleName;
+    const MI_Char *moduleVersion;
+    MI_Boolean queuedForInstall;
+    int installResult;
+    char filePath[MAX_URL_LENGTH];
+    char partPath[MAX_URL_LENGTH];
+} ModuleDownload;
+
+static size_t ModuleDownload_WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    ModuleDownload *download = (ModuleDownload *)userp;
+    size_t realsize = size * nmemb;
+    //Handle size overflow due to multiplication
+    if( nmemb != 0 && realsize / nmemb != size ) {
+        return 0;
+    }
 
-    *result = NULL;
-    if( outputResult == NULL )
+    if (realsize > 0 && fwrite(contents, 1, realsize, download->fp) != realsize)
     {
-        *getActionStatusCode = GetConfigurationCommandFailure;
-        return GetCimMIError(r, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+        download->writeFailed = MI_TRUE;
+        return 0;
     }
-    DSC_EventWriteGetDscDocumentWebDownloadManagerServerUrl(configurationID, url);
-    Stprintf(outputResult,3, MI_T("OK"));
 
-    curl = curl_easy_init();
-    if (!curl)
+    SHA256_Update(&download->hashContext, (unsigned char *)contents, realsize);
+    return realsize;
+}
+
+static void ModuleDownload_Cleanup(_Inout_ ModuleDownload *download)
+{
+    if (download->fp != NULL)
     {
-        return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
+        File_Close(download->fp);
+        download->fp = NULL;
     }
 
-
-    if (bIsHttps)
+    if (download->curl != NULL)
     {
-        Snprintf(configurationUrl, MAX_URL_LENGTH, "https://%s:%d/%s/Modules(ModuleName='%s',ModuleVersion='%s')/ModuleContent", url, port, subUrl, moduleName, moduleVersion);
+        PullSession_Release(download->curl);
+        download->curl = NULL;
     }
-    else
+
+    if (download->headers != NULL)
     {
-        Snprintf(configurationUrl, MAX_URL_LENGTH, "http://%s:%d/%s/Modules(ModuleName='%s',ModuleVersion='%s')/ModuleContent", url, port, subUrl, moduleName, moduleVersion);
+        curl_slist_free_all(download->headers);
+        download->headers = NULL;
     }
 
+    if (download->headerChunkInitialized)
+    {
+        CleanupHeaderChunk(&download->headerChunk);
+        download->headerChunkInitialized = MI_FALSE;
+    }
 
-    r = SetGeneralCurlOptions(curl, extendedError);
-    if (r != MI_RESULT_OK)
+    if (download->partPath[0] != '\0')
     {
-	curl_easy_cleanup(curl);
-	return r;
+        // Only left behind when the download did not complete.
+        File_RemoveT(download->partPath);
+        download->partPath[0] = '\0';
     }
+}
 
-    InitHeaderChunk(&headerChunk);
-    dataChunk.data = (char *)malloc(1);
-    dataChunk.size = 0;
+/* Prepares the easy handle for a module download; the caller performs it and always calls ModuleDownload_Cleanup. */
+static MI_Result ModuleDownload_Start(_Out_ ModuleDownload *download,
+                                      _In_z_ const MI_Char *configurationID,
+                                      _In_z_ const MI_Char *moduleName,
+                                      _In_z_ const MI_Char *moduleVersion,
+                                      _In_z_ const MI_Char *filePath,
+                                      _Out_ MI_Uint32* getActionStatusCode,
+                                      _In_reads_z_(URL_SIZE) const MI_Char *url,
+                                      _In_ MI_Uint32 port,
+                                      _In_reads_z_(SUBURL_SIZE) const MI_Char *subUrl,
+                                      MI_Boolean bIsHttps,
+                                      _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    CURLcode res = CURLE_OK;
+    char moduleUrl[MAX_URL_LENGTH];
+    char agentIdHeader[101];
+    CURL *curl = NULL;
 
-    curl_easy_setopt(curl, CURLOPT_URL, configurationUrl);
+    memset(download, 0, sizeof(ModuleDownload));
+    download->moduleName = moduleName;
+    download->moduleVersion = moduleVersion;
+    Snprintf(download->filePath, MAX_URL_LENGTH, "%s", filePath);
 
-    list = curl_slist_append(list, "ProtocolVersion: 2.0");
-    Snprintf(agentIdHeader, 100, "AgentId: %s", configurationID);
+    curl = download->curl = PullSession_Acquire();
+    if (!curl)
+    {
+        *getActionStatusCode = GetConfigurationCommandFailure;
+        return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
+    }
+
+    if (bIsHttps)
+    {
+        Snprintf(moduleUrl, MAX_URL_LENGTH, "https://%s:%d/%s/Modules(ModuleName='%s',ModuleVersion='%s')/ModuleContent", url, port, subUrl, moduleName, moduleVersion);
+    }
+    else
+    {
+        Snprintf(moduleUrl, MAX_URL_LENGTH, "http://%s:%d/%s/Modules(ModuleName='%s',ModuleVersion='%s')/ModuleContent", url, port, subUrl, moduleName, moduleVersion);
+    }
+
+    r = SetGeneralCurlOptions(curl, extendedError);
+    if (r != MI_RESULT_OK)
+    {
+        *getActionStatusCode = GetConfigurationCommandFailure;
+        return r;
+    }
+
+    Snprintf(download->partPath, MAX_URL_LENGTH, "%s.part", filePath);
+    download->fp = File_OpenT(download->partPath, MI_T("w"));
+    if (download->fp == NULL)
+    {
+        download->partPath[0] = '\0';
+        *getActionStatusCode = GetConfigurationCommandFailure;
+        return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_PULL_CONFIGURATIONSAVEFAILED, filePath);
+    }
+
+    SHA256_Init(&download->hashContext);
+    InitHeaderChunk(&download->headerChunk);
+    download->headerChunkInitialized = MI_TRUE;
+
+    download->headers = curl_slist_append(download->headers, "ProtocolVersion: 2.0");
+    Snprintf(agentIdHeader, 100, "AgentId: %s", configurationID);
     agentIdHeader[100] = '\0';
-    list = curl_slist_append(list, agentIdHeader);
+    download->headers = curl_slist_append(download->headers, agentIdHeader);
 
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_URL, moduleUrl);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, download->headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ModuleDownload_WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, download);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headerChunk);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &dataChunk);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &download->headerChunk);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, download);
 
     res = curl_easy_setopt(curl, CURLOPT_SSLCERT, OAAS_CERTPATH);
     if (res != CURLE_OK)
     {
-        curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        *getActionStatusCode = GetConfigurationCommandFailure;
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
     }
     curl_easy_setopt(curl, CURLOPT_SSLKEY, OAAS_KEYPATH);
@@ -1909,7 +2274,6 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
         if (res != CURLE_OK)
         {
             *getActionStatusCode = GetConfigurationCommandFailure;
-            curl_easy_cleanup(curl);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETCIPHERLIST);
         }
     }
@@ -1920,53 +2284,65 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
         if (res != CURLE_OK)
         {
             *getActionStatusCode = GetConfigurationCommandFailure;
-            curl_easy_cleanup(curl);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOSETNOSSLV3);
         }
     }
 
-    res = curl_easy_perform(curl);
+    return MI_RESULT_OK;
+}
 
-    curl_slist_free_all(list);
-    if (res != CURLE_OK)
+/* Validates a performed download and moves it into place next to its .checksum file. */
+static MI_Result ModuleDownload_Finish(_Inout_ ModuleDownload *download,
+                                       CURLcode res,
+                                       _In_z_ const MI_Char *configurationID,
+                                       _Out_ MI_Uint32* getActionStatusCode,
+                                       _In_reads_z_(URL_SIZE) const MI_Char *url,
+                                       _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    long responseCode = 0;
+    size_t i;
+    char* checksumResponse = NULL;
+    char* checksumAlgorithmResponse = NULL;
+    int closeResult;
+
+    closeResult = File_Close(download->fp);
+    download->fp = NULL;
+
+    if (download->writeFailed || closeResult != 0)
     {
         *getActionStatusCode = GetConfigurationCommandFailure;
-        CleanupHeaderChunk(&headerChunk);
-        free(dataChunk.data);
-        DSC_free(outputResult);
-        curl_easy_cleanup(curl);
+        return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_PULL_CONFIGURATIONSAVEFAILED, download->filePath);
+    }
 
+    if (res != CURLE_OK)
+    {
+        *getActionStatusCode = GetConfigurationCommandFailure;
         return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, url, curl_easy_strerror(res));
     }
 
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-    curl_easy_cleanup(curl);
-
+    curl_easy_getinfo(download->curl, CURLINFO_RESPONSE_CODE, &responseCode);
     if (responseCode != HTTP_SUCCESS_CODE)
     {
         MI_Char statusCodeValue[MAX_STATUSCODE_SIZE] = {0};
         *getActionStatusCode = GetConfigurationCommandFailure;
-        CleanupHeaderChunk(&headerChunk);
-        free(dataChunk.data);
-        DSC_free(outputResult);
         Stprintf(statusCodeValue, MAX_STATUSCODE_SIZE, MI_T("%d"), responseCode);
-        return GetCimMIError4Params(MI_RESULT_FAILED, extendedError, ID_PULL_SERVERHTTPERRORCODEMODULE, url, statusCodeValue, moduleName, moduleVersion);
+        return GetCimMIError4Params(MI_RESULT_FAILED, extendedError, ID_PULL_SERVERHTTPERRORCODEMODULE, url, statusCodeValue, download->moduleName, download->moduleVersion);
     }
 
-    for (i = 0; i < headerChunk.size; ++i)
+    for (i = 0; i < download->headerChunk.size; ++i)
     {
         if (checksumResponse != NULL && checksumAlgorithmResponse != NULL)
         {
             break;
         }
 
-        if ( Tcscasecmp(headerChunk.headerKeys[i], "Checksum") == 0 )
+        if ( Tcscasecmp(download->headerChunk.headerKeys[i], "Checksum") == 0 )
         {
-            checksumResponse = headerChunk.headerValues[i];
+            checksumResponse = download->headerChunk.headerValues[i];
         }
-        else if ( Tcscasecmp(headerChunk.headerKeys[i], "ChecksumAlgorithm") == 0 )
+        else if ( Tcscasecmp(download->headerChunk.headerKeys[i], "ChecksumAlgorithm") == 0 )
         {
-            checksumAlgorithmResponse = headerChunk.headerValues[i];
+            checksumAlgorithmResponse = download->headerChunk.headerValues[i];
         }
     }
     if (checksumResponse == NULL || checksumAlgorithmResponse == NULL)
@@ -1981,27 +2357,19 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_INVALIDCHECKSUMALGORITHM);
     }
 
-    if( dataChunk.size > 0 )
-    {
-        FILE *fp = File_OpenT(filePath, MI_T("a"));
-        if(fp == NULL)
-        {
-            *getActionStatusCode = GetConfigurationCommandFailure;
-            return GetCimMIError1Param(MI_RESULT_FAILED, extendedError,
-                                       ID_PULL_CONFIGURATIONSAVEFAILED, filePath);
-        }
-        fwrite( dataChunk.data, 1, dataChunk.size, fp);
-        File_Close(fp);
-    }
-
-    if( !ValidateChecksum(checksumResponse, filePath) )
+    if( !ChecksumMatchesDigest(checksumResponse, &download->hashContext) )
     {
         DSC_EventWriteWebDownloadManagerGetDocChecksumValidation(NULL, NULL);
         *getActionStatusCode = ConfigurationChecksumValidationFailure;
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CHECKSUMMISMATCH);
     }
 
-
+    if (rename(download->partPath, download->filePath) != 0)
+    {
+        *getActionStatusCode = GetConfigurationCommandFailure;
+        return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_PULL_CONFIGURATIONSAVEFAILED, download->filePath);
+    }
+    download->partPath[0] = '\0';
 
     DSC_EventWriteLCMPullConfigurationChecksumValidationResult(configurationID, (MI_Uint32)MI_RESULT_OK);
 
@@ -2009,7 +2377,7 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
     {
         MI_Char checksumFileName[MAX_URL_LENGTH];
         FILE *fp = NULL;
-        Stprintf(checksumFileName, MAX_URL_LENGTH,MI_T("%s.checksum"), filePath);
+        Stprintf(checksumFileName, MAX_URL_LENGTH,MI_T("%s.checksum"), download->filePath);
         fp = File_OpenT(checksumFileName,MI_T("w"));
         if( fp != NULL )
         {
@@ -2019,13 +2387,51 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
         else
         {
             *getActionStatusCode = GetConfigurationCommandFailure;
-            DSC_free(outputResult);
             return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_PULLGETCONFIGURATION_CHECKSUMSAVEFAILED, checksumFileName);
         }
     }
 
-    CleanupHeaderChunk(&headerChunk);
-    free(dataChunk.data);
+    return MI_RESULT_OK;
+}
+
+MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
+                                  _In_z_ const MI_Char *moduleName,
+                                  _In_z_ const MI_Char *moduleVersion,
+                                  _In_z_ const MI_Char *certificateID,
+                                  _In_z_ const MI_Char *filePath,
+                                  _Outptr_result_maybenull_z_  MI_Char** result,
+                                  _Out_ MI_Uint32* getActionStatusCode,
+                                  _In_reads_z_(URL_SIZE) const MI_Char *url,
+                                  _In_ MI_Uint32 port,
+                                  _In_reads_z_(SUBURL_SIZE) const MI_Char *subUrl,
+                                  MI_Boolean bIsHttps,
+                                  _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Char *outputResult = (MI_Char*)DSC_malloc((Tcslen(MI_T("OK"))+1) * sizeof(MI_Char), NitsHere());
+    ModuleDownload download;
+
+    *result = NULL;
+    if( outputResult == NULL )
+    {
+        *getActionStatusCode = GetConfigurationCommandFailure;
+        return GetCimMIError(r, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+    DSC_EventWriteGetDscDocumentWebDownloadManagerServerUrl(configurationID, url);
+    Stprintf(outputResult,3, MI_T("OK"));
+
+    r = ModuleDownload_Start(&download, configurationID, moduleName, moduleVersion, filePath, getActionStatusCode, url, port, subUrl, bIsHttps, extendedError);
+    if (r == MI_RESULT_OK)
+    {
+        r = ModuleDownload_Finish(&download, curl_easy_perform(download.curl), configurationID, getActionStatusCode, url, extendedError);
+    }
+    ModuleDownload_Cleanup(&download);
+
+    if (r != MI_RESULT_OK)
+    {
+        DSC_free(outputResult);
+        return r;
+    }
 
     *result = outputResult;
     DSC_EventWriteWebDownloadManagerGetDocGetCall(configurationID, *result );
@@ -2033,6 +2439,188 @@ MI_Result  IssueGetModuleRequest( _In_z_ const MI_Char *configurationID,
     return MI_RESULT_OK;
 }
 
+/*
+    A single InstallModule.py process installs every module of a pull.  The
+    zip paths are written to its stdin as downloads complete, so installs
+    overlap with the downloads still in flight and the init files are only
+    regenerated once.  The installer writes a "<exit code> <zip path>" line per
+    module to a status file, since the LCM reaps its children and the exit
+    status of the process itself may be lost.
+*/
+typedef struct _ModuleInstaller
+{
+    FILE *pipe;
+    int isPython2;
+    const char *verifyFlag;
+    char statusPath[MAX_URL_LENGTH];
+} ModuleInstaller;
+
+static MI_Result ModuleInstaller_Add(_Inout_ ModuleInstaller *installer,
+                                     _Inout_ ModuleDownload *download,
+                                     _In_z_ const MI_Char *directoryPath,
+                                     _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    sigset_t pipeSignal;
+    sigset_t oldMask;
+    struct timespec noWait = {0, 0};
+    int written;
+
+    if (installer->pipe == NULL)
+    {
+        char command[MAX_URL_LENGTH * 2];
+
+        installer->isPython2 = !PythonInterpreter_IsPython3();
+        DSC_LOG_INFO("Using %s in WebPullClient.\n", PythonInterpreter_GetCommand());
+
+        Snprintf(installer->statusPath, MAX_URL_LENGTH, "%s/InstallModule.status", directoryPath);
+        File_RemoveT(installer->statusPath);
+
+        if (installer->isPython2 == 1)
+        {
+            DSC_LOG_INFO("Calling InstallModule with python2");
+            Snprintf(command, sizeof(command), "%s --batch %s %s", DSC_SCRIPT_PATH "/InstallModule.py", installer->statusPath, installer->verifyFlag);
+        }
+        else
+        {
+            DSC_LOG_INFO("Calling InstallModule with python3");
+            Snprintf(command, sizeof(command), "%s --batch %s %s %s", "/usr/bin/python3 " DSC_SCRIPT_PATH "/python3/InstallModule.py", installer->statusPath, installer->verifyFlag, " 2>&1");
+        }
+
+        DSC_LOG_INFO("executing '%T'\n", command);
+        installer->pipe = popen(command, "w");
+        if (installer->pipe == NULL)
+        {
+            return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEFAILED, download->moduleName, download->moduleVersion);
+        }
+    }
+
+    // If the installer died, the write fails with EPIPE; keep SIGPIPE from killing the LCM.
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+
+    written = fprintf(installer->pipe, "%s\n", download->filePath);
+    if (fflush(installer->pipe) != 0)
+    {
+        written = -1;
+    }
+
+    while (sigtimedwait(&pipeSignal, NULL, &noWait) > 0)
+    {
+    }
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+    download->queuedForInstall = MI_TRUE;
+    download->installResult = -1;
+
+    if (written < 0)
+    {
+        return GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEFAILED, download->moduleName, download->moduleVersion);
+    }
+
+    return MI_RESULT_OK;
+}
+
+/* Waits for the installer and removes any module it failed to install; the first failure is reported. */
+static MI_Result ModuleInstaller_Finish(_Inout_ ModuleInstaller *installer,
+                                        _Inout_updates_(downloadCount) ModuleDownload *downloads,
+                                        MI_Uint32 downloadCount,
+                                        _Inout_ MI_Uint32 * numModulesInstalled,
+                                        _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    char line[MAX_URL_LENGTH + 32];
+    char stringBuffer[MAX_URL_LENGTH];
+    FILE *fp = NULL;
+    MI_Uint32 i;
+    int retval;
+
+    if (installer->pipe == NULL)
+    {
+        return MI_RESULT_OK;
+    }
+
+    retval = pclose(installer->pipe);
+    installer->pipe = NULL;
+    DSC_LOG_INFO("Installer for pulled modules returned %d\n", retval);
+
+    fp = File_OpenT(installer->statusPath, MI_T("r"));
+    if (fp != NULL)
+    {
+        while (fgets(line, sizeof(line), fp) != NULL)
+        {
+            char *path = strchr(line, ' ');
+            char *end;
+
+            if (path == NULL)
+            {
+                continue;
+            }
+            *path++ = '\0';
+            end = path + strlen(path);
+            while (end > path && (end[-1] == '\n' || end[-1] == '\r'))
+            {
+                *--end = '\0';
+            }
+
+            for (i = 0; i < downloadCount; ++i)
+            {
+                if (downloads[i].queuedForInstall && strcmp(downloads[i].filePath, path) == 0)
+                {
+                    downloads[i].installResult = atoi(line);
+                    break;
+                }
+            }
+        }
+        File_Close(fp);
+        File_RemoveT(installer->statusPath);
+    }
+
+    for (i = 0; i < downloadCount; ++i)
+    {
+        if (!downloads[i].queuedForInstall)
+        {
+            continue;
+        }
+
+        if (downloads[i].installResult == 0)
+        {
+            *numModulesInstalled = *numModulesInstalled + 1;
+            continue;
+        }
+
+        // Attempt to remove the module as a last resort.  If it fails too, a reinstall may be necessary.
+        if (installer->isPython2 == 1)
+        {
+            DSC_LOG_INFO("Calling RemoveModule with python2");
+            Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s", DSC_SCRIPT_PATH "/RemoveModule.py", downloads[i].moduleName);
+        }
+        else
+        {
+            DSC_LOG_INFO("Calling RemoveModule with python3");
+            Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s %s", "/usr/bin/python3 " DSC_SCRIPT_PATH "/python3/RemoveModule.py", downloads[i].moduleName, " 2>&1");
+        }
+
+        retval = system(stringBuffer);
+        DSC_LOG_INFO("Executed '%T', returned %d\n", stringBuffer, retval);
+        if (r != MI_RESULT_OK)
+        {
+            continue;
+        }
+
+        if ( retval == 0 || (retval == -1 && errno == ECHILD) )
+        {
+            r = GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEFAILED, downloads[i].moduleName, downloads[i].moduleVersion);
+        }
+        else
+        {
+            r = GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEANDREMOVEMODULEFAILED, downloads[i].moduleName, downloads[i].moduleVersion);
+        }
+    }
+
+    return r;
+}
+
 MI_Result MI_CALL Pull_GetModules(_Out_ MI_Uint32 * numModulesInstalled,
                                   const MI_Char *configurationID,
                                   const MI_Char *certificateID,
@@ -2050,11 +2638,20 @@ MI_Result MI_CALL Pull_GetModules(_Out_ MI_Uint32 * numModulesInstalled,
     ModuleTable moduleTable;
     ModuleTableEntry* current;
     MI_Result r;
+    MI_Result installResult;
     MI_Value value;
-    int retval = 0;
     char zipPath[MAX_URL_LENGTH];
-    char stringBuffer[MAX_URL_LENGTH];
     char * verifyFlag = "1";
+    ModuleDownload *downloads = NULL;
+    ModuleInstaller installer;
+    MI_Instance *installError = NULL;
+    MI_Uint32 moduleCount = 0;
+    MI_Uint32 startedCount = 0;
+    MI_Uint32 activeCount = 0;
+    MI_Uint32 i;
+    CURLM *multi = NULL;
+
+    memset(&installer, 0, sizeof(ModuleInstaller));
 
     moduleTable.first = NULL;
     r = GetModuleNameVersionTable(fileName, &moduleTable, extendedError);
@@ -2083,110 +2680,139 @@ MI_Result MI_CALL Pull_GetModules(_Out_ MI_Uint32 * numModulesInstalled,
 	    verifyFlag = "0";
 	}
     }
+    installer.verifyFlag = verifyFlag;
+    r = MI_RESULT_OK;
 
     // moduleTable now has the modules we need to pull
-    current = moduleTable.first;
-    while (current != NULL)
+    for (current = moduleTable.first; current != NULL; current = current->next)
     {
-        Snprintf(zipPath, MAX_URL_LENGTH, "%s/%s_%s.zip", directoryPath, current->moduleName, current->moduleVersionClassTuple->moduleVersion);
-        r = IssueGetModuleRequest(configurationID,
-                                  current->moduleName,
-                                  current->moduleVersionClassTuple->moduleVersion,
-                                  certificateID,
-                                  zipPath,
-                                  result,
-                                  getActionStatusCode,
-                                  url,
-                                  port,
-                                  subUrl,
-                                  bIsHttps,
-                                  extendedError);
+        moduleCount++;
+    }
+
+    if (moduleCount == 0)
+    {
+        CleanupModuleTable(moduleTable);
+        return MI_RESULT_OK;
+    }
+
+    downloads = (ModuleDownload*)DSC_malloc(moduleCount * sizeof(ModuleDownload), NitsHere());
+    if (downloads == NULL)
+    {
+        CleanupModuleTable(moduleTable);
+        return GetCimMIError(MI_RESULT_SERVER_LIMITS_EXCEEDED, extendedError, ID_ENGINEHELPER_MEMORY_ERROR);
+    }
+
+    multi = curl_multi_init();
+    if (multi == NULL)
+    {
+        DSC_free(downloads);
+        CleanupModuleTable(moduleTable);
+        return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    if (g_sslOptions.UseHttp2 == MI_TRUE)
+    {
+        curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+#endif
+
+    // Keep up to PULL_MODULE_DOWNLOAD_CONCURRENCY downloads in flight and hand each
+    // module to the installer as soon as its checksum has been validated.
+    current = moduleTable.first;
+    while (r == MI_RESULT_OK && (current != NULL || activeCount > 0))
+    {
+        CURLMsg *message;
+        int pending = 0;
+        int running = 0;
+
+        while (r == MI_RESULT_OK && current != NULL && activeCount < PULL_MODULE_DOWNLOAD_CONCURRENCY)
+        {
+            ModuleDownload *download = &downloads[startedCount++];
+
+            Snprintf(zipPath, MAX_URL_LENGTH, "%s/%s_%s.zip", directoryPath, current->moduleName, current->moduleVersionClassTuple->moduleVersion);
+            r = ModuleDownload_Start(download,
+                                     configurationID,
+                                     current->moduleName,
+                                     current->moduleVersionClassTuple->moduleVersion,
+                                     zipPath,
+                                     getActionStatusCode,
+                                     url,
+                                     port,
+                                     subUrl,
+                                     bIsHttps,
+                                     extendedError);
+            if (r == MI_RESULT_OK)
+            {
+                curl_multi_add_handle(multi, download->curl);
+                activeCount++;
+            }
+            current = current->next;
+        }
 
         if (r != MI_RESULT_OK)
         {
-            CleanupModuleTable(moduleTable);
-            return r;
-        }
-        // Determine python version
-        char data[BUFSIZ];
-        int isPython2 = 1;
-        DSC_LOG_INFO("Assuming python2 in WebPullClient\n");
-
-	    // Look for python3
-        FILE * pipe = popen("python3 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");
-        fgets(data, BUFSIZ, pipe);
-        if (data[0] == '3') {
-            DSC_LOG_INFO("Found python3 in WebPullClient.\n");
-            isPython2 = 0;
-        } else {
-            // If python3 does not exist, look for python2
-            memset(&data[0], 0, sizeof(data));
-            pipe = popen("python2 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");
-            fgets(data, BUFSIZ, pipe);
-            if (data[0] == '2') {
-                DSC_LOG_INFO("Found python2 in WebPullClient.\n");
-                    isPython2 = 1;
-            }
+            break;
         }
 
-      	if (isPython2 == 1)
-      	{
-        	DSC_LOG_INFO("Calling InstallModule with python2");
-      		Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s %s", DSC_SCRIPT_PATH "/InstallModule.py", zipPath, verifyFlag);
-      	}
-      	else
-      	{
-		DSC_LOG_INFO("Calling InstallModule with python3");
-		Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s %s %s", "/usr/bin/python3 " DSC_SCRIPT_PATH "/python3/InstallModule.py", zipPath, verifyFlag, " 2>&1");
-      	}
-        DSC_LOG_INFO("executing '%T'\n", stringBuffer);
-        retval = system(stringBuffer);
-        DSC_LOG_INFO("Executed '%T', returned %d\n", stringBuffer, retval);
+        curl_multi_perform(multi, &running);
 
-        if (retval != 0)
+        while (r == MI_RESULT_OK && (message = curl_multi_info_read(multi, &pending)) != NULL)
         {
-            if (retval == -1 && errno == ECHILD)
+            ModuleDownload *download = NULL;
+            CURL *easy = message->easy_handle;
+            CURLcode res = message->data.result;
+
+            if (message->msg != CURLMSG_DONE)
             {
-                // This is an OK condition.  We weren't able to find the child process to reap after it completes.
+                continue;
             }
-            else
-            {
-                // Attempt to remove the module as a last resort.  If it fails too, a reinstall may be necessary.
-                if (isPython2 == 1)
-                {
-                    DSC_LOG_INFO("Calling RemoveModule with python2");
-                    Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s", DSC_SCRIPT_PATH "/RemoveModule.py", current->moduleName);
-                }
-                else
-                {
-                    DSC_LOG_INFO("Calling RemoveModule with python3");
-                    Snprintf(stringBuffer, MAX_URL_LENGTH, "%s %s %s", "/usr/bin/python3 " DSC_SCRIPT_PATH "/python3/RemoveModule.py", current->moduleName, " 2>&1");
-                }
 
-                retval = system(stringBuffer);
-                DSC_LOG_INFO("Executed '%T', returned %d\n", stringBuffer, retval);
-                if ( retval == 0 || (retval == -1 && errno == ECHILD) )
-                {
-                    r = GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEFAILED, current->moduleName, current->moduleVersionClassTuple->moduleVersion);
-                }
-                else
-                {
-                    r = GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_INSTALLMODULEANDREMOVEMODULEFAILED, current->moduleName, current->moduleVersionClassTuple->moduleVersion);
-                }
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char**)&download);
+            curl_multi_remove_handle(multi, easy);
+            activeCount--;
 
-                CleanupModuleTable(moduleTable);
-                return r;
+            r = ModuleDownload_Finish(download, res, configurationID, getActionStatusCode, url, extendedError);
+            ModuleDownload_Cleanup(download);
+            if (r == MI_RESULT_OK)
+            {
+                r = ModuleInstaller_Add(&installer, download, directoryPath, extendedError);
             }
         }
 
-        *numModulesInstalled = *numModulesInstalled + 1;
-        current = current->next;
+        if (r == MI_RESULT_OK && activeCount > 0)
+        {
+            curl_multi_wait(multi, NULL, 0, 1000, NULL);
+        }
     }
 
-    CleanupModuleTable(moduleTable);
+    // After a failure, abandon whatever is still in flight.
+    for (i = 0; i < startedCount; ++i)
+    {
+        if (downloads[i].curl != NULL)
+        {
+            curl_multi_remove_handle(multi, downloads[i].curl);
+        }
+        ModuleDownload_Cleanup(&downloads[i]);
+    }
+    curl_multi_cleanup(multi);
 
-    return MI_RESULT_OK;
+    // Modules already handed to the installer are installed even if a later download failed.
+    installResult = ModuleInstaller_Finish(&installer, downloads, startedCount, numModulesInstalled,
+                                           r == MI_RESULT_OK ? extendedError : &installError);
+    if (r == MI_RESULT_OK)
+    {
+        r = installResult;
+    }
+    else if (installError != NULL)
+    {
+        MI_Instance_Delete(installError);
+    }
 
+    DSC_free(downloads);
+    CleanupModuleTable(moduleTable);
+
+    return r;
 }
 
 MI_Result MI_CALL Pull_GetConfigurationWebDownloadManager(_In_ LCMProviderContext *lcmContext,
@@ -2475,8 +3101,7 @@ static MI_Result GetModuleNameVersionTable(MI_Char* mofFileLocation,
 {
     MI_Result r = MI_RESULT_OK;
     MI_InstanceA *miInstanceArray = NULL;
-    MI_Uint8 *pbuffer = NULL;
-    MI_Uint32 contentSize;
+    DSC_FileView fileView = {0};
     MI_Uint32 readBytes;
     MI_ClassA miClassArray = {0};
     MI_Application *miApp = NULL;
@@ -2526,7 +3151,7 @@ static MI_Result GetModuleNameVersionTable(MI_Char* mofFileLocation,
         return GetCimMIError1Param(MI_RESULT_FAILED, extendedError, ID_PULL_INITIALIZEMODULETABLEFAILED, "Creating New Deserializer Failed");
     }
 
-    r = ReadFileContent(mofFileLocation, &pbuffer, &contentSize, extendedError);
+    r = DSC_FileView_Open(mofFileLocation, &fileView, extendedError);
     if(r != MI_RESULT_OK)
     {
         MI_Application_Close(miApp);
@@ -2536,19 +3161,16 @@ static MI_Result GetModuleNameVersionTable(MI_Char* mofFileLocation,
     miClassArray.size = 0;
     miClassArray.data = NULL;
 
-    r = MI_Deserializer_DeserializeInstanceArray(&deserializer, 0, &options, 0, pbuffer, contentSize, &miClassArray, &readBytes, &miInstanceArray, extendedError);
+    r = MI_Deserializer_DeserializeInstanceArray(&deserializer, 0, &options, 0, fileView.data, fileView.size, &miClassArray, &readBytes, &miInstanceArray, extendedError);
     if (r != MI_RESULT_OK)
     {
+        DSC_FileView_Close(&fileView);
         MI_Application_Close(miApp);
         DSC_free(miApp);
         return r;
     }
 
-    if(pbuffer)
-    {
-        DSC_free(pbuffer);
-        pbuffer = NULL;
-    }
+    DSC_FileView_Close(&fileView);
 
     for (i = 0; i < miInstanceArray->size; ++i)
     {
@@ -2701,7 +3323,7 @@ MI_Result Pull_Register(MI_Char* serverURL,
         return r;
     }
 
-    curl = curl_easy_init();
+    curl = PullSession_Acquire();
     if (!curl)
     {
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
@@ -2723,7 +3345,7 @@ MI_Result Pull_Register(MI_Char* serverURL,
     list = curl_slist_append(list, "Content-Type: application/json; charset=utf-8");
     list = curl_slist_append(list, "ProtocolVersion: 2.0");
 
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &dataChunk);
     curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback);
@@ -2736,28 +3358,28 @@ MI_Result Pull_Register(MI_Char* serverURL,
     if (res != CURLE_OK)
       {
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
       }
     res = curl_easy_setopt(curl, CURLOPT_SSLCERT, OAAS_CERTPATH);
     if (res != CURLE_OK)
       {
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
       };
     res = curl_easy_setopt(curl, CURLOPT_SSLKEY, OAAS_KEYPATH);
     if (res != CURLE_OK)
       {
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
       }
 
     r = SetGeneralCurlOptions(curl, extendedError);
     if (r != MI_RESULT_OK)
     {
-	curl_easy_cleanup(curl);
+	PullSession_Release(curl);
 	return r;
     }
 
@@ -2768,7 +3390,7 @@ MI_Result Pull_Register(MI_Char* serverURL,
         // Error on communication
 
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         free(headerChunk.data);
         free(dataChunk.data);
 
@@ -2784,7 +3406,7 @@ MI_Result Pull_Register(MI_Char* serverURL,
         Stprintf(statusCodeValue, MAX_STATUSCODE_SIZE, MI_T("%d"), responseCode);
 
         curl_slist_free_all(list);
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
         free(headerChunk.data);
         free(dataChunk.data);
 
@@ -2792,7 +3414,7 @@ MI_Result Pull_Register(MI_Char* serverURL,
     }
 
     curl_slist_free_all(list);
-    curl_easy_cleanup(curl);
+    PullSession_Release(curl);
 
     free(headerChunk.data);
     free(dataChunk.data);
@@ -2800,8 +3422,6 @@ MI_Result Pull_Register(MI_Char* serverURL,
     return MI_RESULT_OK;
 }
 
-extern MI_Char* RunCommand(const MI_Char* command);
-
 MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
                                                       _In_ MI_Instance *metaConfig,
                                                       _In_ MI_Instance *statusReport,
@@ -2813,7 +3433,6 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
     MI_Result r = MI_RESULT_OK;
     const char *emptyString = "";
     MI_Char actionUrl[MAX_URL_LENGTH];
-    char dataBuffer[10000];
 
     char * getActionStatus = NULL;
     long responseCode = 0;
@@ -2830,8 +3449,7 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
     MI_Value endTime;
     MI_Uint32 flags;
     int i = 0;
-    const char* commandFormat = NULL;
-    const char* reportText = NULL;
+    char* reportText = NULL;
 
     int bAtLeastOneReportSuccess = 0;
 
@@ -2858,48 +3476,38 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
     {
         r = MI_Instance_GetElement((MI_Instance*)managerInstances.stringa.data[i], MSFT_ServerURL_Name, &serverURL, NULL, NULL, NULL);
 
-        r = MI_Instance_GetElement(statusReport, REPORTING_ENDTIME, &endTime, NULL, &flags, 0);
-        if (r != MI_RESULT_OK || (flags & MI_FLAG_NULL) || (endTime.datetime.u.timestamp.year == 0))
+        // Every report server gets the same body, so it is built once.
+        if (reportText == NULL)
         {
-            // not the End report
-            commandFormat =  DSC_SCRIPT_PATH "/StatusReport.sh %s StartTime";
-            snprintf(dataBuffer, 10000, commandFormat, g_ConfigurationDetails.jobGuidString);
-        }
-        else
-        {
-            if (g_currentError[0] == '\0')
+            MI_Boolean isEndReport = MI_TRUE;
+            char currentError[5001];
+
+            r = MI_Instance_GetElement(statusReport, REPORTING_ENDTIME, &endTime, NULL, &flags, 0);
+            if (r != MI_RESULT_OK || (flags & MI_FLAG_NULL) || (endTime.datetime.u.timestamp.year == 0))
             {
-                commandFormat =  DSC_SCRIPT_PATH "/StatusReport.sh %s EndTime";
-                snprintf(dataBuffer, 10000, commandFormat, g_ConfigurationDetails.jobGuidString);
+                // not the End report
+                isEndReport = MI_FALSE;
             }
-            else
-            {
-                if (g_rnids == NULL)
-                {
-                    commandFormat =  DSC_SCRIPT_PATH "/StatusReport.sh %s EndTime \"%s\"";
-                    snprintf(dataBuffer, 10000, commandFormat, g_ConfigurationDetails.jobGuidString, g_currentError);
-                }
-                else
-                {
-                    commandFormat =  DSC_SCRIPT_PATH "/StatusReport.sh %s EndTime \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" \"%s\" ";
-                    snprintf(dataBuffer, 10000, commandFormat, g_ConfigurationDetails.jobGuidString, g_currentError, g_rnids->SourceInfo,
-                             g_rnids->ModuleName, g_rnids->DurationInSeconds, g_rnids->InstanceName, g_rnids->StartDate, g_rnids->ResourceName,
-                             g_rnids->ModuleVersion, g_rnids->RebootRequested, g_rnids->ResourceId, g_rnids->ConfigurationName, g_rnids->InDesiredState);
-                    Destroy_StatusReport_RNIDS(g_rnids);
-                    g_rnids = NULL;
 
-                }
+            GetCurrentError(currentError, sizeof(currentError));
+            r = StatusReport_Create(g_ConfigurationDetails.jobGuidString, isEndReport, isEndReport ? currentError : NULL,
+                                    isEndReport ? g_rnids : NULL, &reportText);
+            if (isEndReport && currentError[0] != '\0' && g_rnids != NULL)
+            {
+                Destroy_StatusReport_RNIDS(g_rnids);
+                g_rnids = NULL;
+            }
+            if (r != MI_RESULT_OK)
+            {
+                curl_slist_free_all(list);
+                return MI_RESULT_FAILED;
             }
         }
 
-        reportText = RunCommand(dataBuffer);
-        if(reportText == NULL) {
-            return MI_RESULT_FAILED;
-        }
-
-        curl = curl_easy_init();
+        curl = PullSession_Acquire();
         if (!curl)
         {
+            DSC_free(reportText);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CURLFAILEDTOINITIALIZE);
         }
 
@@ -2907,7 +3515,7 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
         if (r != MI_RESULT_OK)
         {
             DSC_free(reportText);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
             return r;
         }
 
@@ -2919,7 +3527,7 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
         dataChunk.data = (char *)malloc(1);
         dataChunk.size = 0;
 
-        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, PullSession_HttpVersion());
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
         curl_easy_setopt(curl, CURLOPT_POSTFIELDS, reportText);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
@@ -2930,7 +3538,8 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
         if (res != CURLE_OK)
         {
             curl_slist_free_all(list);
-            curl_easy_cleanup(curl);
+            PullSession_Release(curl);
+            DSC_free(reportText);
             return GetCimMIError(MI_RESULT_FAILED, extendedError, ID_PULL_CERTOPTS_NOT_SUPPORTED);
         }
         curl_easy_setopt(curl, CURLOPT_SSLKEY, OAAS_KEYPATH);
@@ -2942,8 +3551,7 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
             // Error on communication.  Go to next report.
             GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_CURLPERFORMFAILED, actionUrl, curl_easy_strerror(res));
 
-            curl_easy_cleanup(curl);
-            DSC_free(reportText);
+            PullSession_Release(curl);
             free(headerChunk.data);
             free(dataChunk.data);
             continue;
@@ -2958,8 +3566,7 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
             Stprintf(statusCodeValue, MAX_STATUSCODE_SIZE, MI_T("%d"), responseCode);
             GetCimMIError2Params(MI_RESULT_FAILED, extendedError, ID_PULL_SERVERHTTPERRORCODEREGISTER, actionUrl, statusCodeValue);
 
-            curl_easy_cleanup(curl);
-            DSC_free(reportText);
+            PullSession_Release(curl);
             free(headerChunk.data);
             free(dataChunk.data);
             continue;
@@ -2967,9 +3574,8 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
 
         bAtLeastOneReportSuccess = 1;
 
-        curl_easy_cleanup(curl);
+        PullSession_Release(curl);
 
-        DSC_free(reportText);
         free(headerChunk.data);
         free(dataChunk.data);
 
@@ -2977,6 +3583,11 @@ MI_Result MI_CALL Pull_SendStatusReport(_In_ LCMProviderContext *lcmContext,
 
     curl_slist_free_all(list);
 
+    if (reportText)
+    {
+        DSC_free(reportText);
+    }
+
     if (bAtLeastOneReportSuccess == 1)
     {
         return MI_RESULT_OK;
@@ -22,6 +22,7 @@ struct SSLOptions
 {
     MI_Boolean DoNotCheckCertificate;
     MI_Boolean NoSSLv3;
+    MI_Boolean UseHttp2;
     char cipherList[MAX_SSLOPTION_STRING_LENGTH + 1];
     char CABundle[MAX_SSLOPTION_STRING_LENGTH + 1];
     char Proxy[MAX_SSLOPTION_STRING_LENGTH + 1];
@@ -178,6 +179,17 @@ MI_Result MI_CALL Pull_GetModules(_Out_ MI_Uint32 * numModulesInstalled,
                                   MI_Instance **extendedError);
 
 
+/* Releases the connections kept open between pull requests. */
+void PullSession_Cleanup();
 
+/* Sends 'requests' GETs for 'url' through the pull session, with the SSL options read from 'confPath'
+   instead of dsc.conf. Reports how many connections the requests opened and whether HTTP/2 was
+   offered. Lets the tests check that the session keeps a single connection to the pull server. */
+MI_Result PullSession_Probe(_In_z_ const char *confPath,
+                            _In_z_ const char *url,
+                            MI_Uint32 requests,
+                            _Out_ MI_Uint32 *newConnections,
+                            _Out_ MI_Boolean *offeredHttp2,
+                            _Outptr_result_maybenull_ MI_Instance **extendedError);
 
 #endif
@@ -28,6 +28,7 @@
 #include "EngineHelper.h"
 #include "EventWrapper.h"
 #include "dsc_host.h"
+#include "dsc_host_server.h"
 #include "dsc_library.h"
 #include "lcm/strings.h"
 
@@ -55,6 +56,7 @@ void PrintHelp()
     Tprintf(MI_T("Usage:\n"));
     Tprintf(MI_T("dsc_host [--help] [--version]\n"));
     Tprintf(MI_T("dsc_host <Output Folder Path> <Operation> [Operation Arguments] \n"));
+    Tprintf(MI_T("dsc_host --serve <Socket Path>\n"));
     Tprintf(MI_T("\n"));
     Tprintf(MI_T("Supported Operation values are:\n"));
     Tprintf(MI_T("  SendConfiguration <MOF Document Path>\n"));
@@ -83,6 +85,7 @@ void PrintHelp()
     Tprintf(MI_T("  /opt/dsc/bin/dsc_host /opt/dsc/output StopConfiguration force\n"));
     Tprintf(MI_T("  /opt/dsc/bin/dsc_host /opt/dsc/output PerformInventory\n"));
     Tprintf(MI_T("  /opt/dsc/bin/dsc_host /opt/dsc/output PerformInventoryOOB ./Inventory.mof\n"));
+    Tprintf(MI_T("  /opt/dsc/bin/dsc_host --serve /opt/dsc/dsc_host.sock\n"));
     Tprintf(MI_T("\n"));
 }
 
@@ -103,7 +106,8 @@ void SaveCurrentPID()
     }
 }
 
-int main(int argc, char *argv[])
+// Runs the operation named on a one-shot dsc_host command line and returns its exit code.
+static int RunOperation(int argc, char *argv[])
 {
     MI_Instance *extended_error = NULL;
     MI_Result result = MI_RESULT_OK;
@@ -112,38 +116,6 @@ int main(int argc, char *argv[])
     JSON_Value *operation_error_root_value = NULL;
     char* operation_name;
 
-    // Set umask to 0022
-    umask(S_IWGRP | S_IWOTH);
-
-    SaveCurrentPID();
-
-    // Check the user that has invoked the operation: root for DIY and omsagent for OMS
-#if defined(BUILD_OMS)
-    if (RunningAsRoot() == MI_TRUE)
-    {
-        Tprintf(MI_T("Unable to run omsconfig configurations as root. Please use omsagent credentials.\n"));
-        result = MI_RESULT_FAILED;
-        CreateMiInstanceErrorObject(&extended_error, MI_T("Unable to run omsconfig configurations as root. Please use omsagent credentials.\n"));
-        JSON_Value *value;
-        Convert_MIInstance_JSON(extended_error, &operation_error_root_value);
-        goto CleanUp;
-    }
-#else
-    if (RunningAsRoot() == MI_FALSE)
-    {
-        Tprintf(MI_T("Unable to run dsc configurations as non-root.  Please use root credentials.\n"));
-        result = MI_RESULT_FAILED;
-        CreateMiInstanceErrorObject(&extended_error, MI_T("Unable to run dsc configurations as non-root. Please use root credentials.\n"));
-        JSON_Value *value;
-        Convert_MIInstance_JSON(extended_error, &operation_error_root_value);
-        goto CleanUp;
-    }
-#endif
-
-#if defined(BUILD_OMS)
-    g_DscHost = MI_TRUE;
-#endif
-
     if(argc < 3)
     {
         if(argc > 1 && 0 == Tcscasecmp(argv[1], MI_T("--version")))
@@ -228,7 +200,7 @@ int main(int argc, char *argv[])
     }
 
     DSC_TELEMETRY_INFO("dsc_host starting operation '%s'", argv[2]);
-    DSC_TELEMETRY_INFO("dsc_host configuration '%s'", argv[3]);
+    DSC_TELEMETRY_INFO("dsc_host configuration '%s'", argc > 3 ? argv[3] : "");
     switch(current_operation)
     {
         case DscSupportedOperation_GetConfiguration:
@@ -258,14 +230,14 @@ int main(int argc, char *argv[])
         case DscSupportedOperation_SendConfiguration:
             {
                 operation_name = DSC_OPERATION_SEND_CONFIGURATION_STR;
-                MI_Boolean force = (Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
+                MI_Boolean force = (argc > 4 && Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
                 result = DscLib_SendConfiguration (argv[3], force, &operation_error_root_value); // CodeQL [cpp/path-injection] Safe Path: Currently only known paths are considered
                 break;
             }
         case DscSupportedOperation_SendConfigurationApply:
             {
                 operation_name = DSC_OPERATION_SEND_CONFIGURATION_APPLY_STR;
-                MI_Boolean force = (Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
+                MI_Boolean force = (argc > 4 && Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
                 result = DscLib_SendConfigurationApply (argv[3], force, &operation_error_root_value); // CodeQL [cpp/path-injection] Safe Path: Currently only known paths are considered
                 break;
             }
@@ -297,7 +269,7 @@ int main(int argc, char *argv[])
             {
                 operation_name = DSC_OPERATION_PERFORM_REQUIRED_CONFIGURATION_CHECKS_STR;
                 MI_Uint32 flags = TASK_REGULAR;
-                if (argc >= 3)
+                if (argc > 3)
                 {
                     flags = atoi(argv[3]);
                 }
@@ -307,7 +279,7 @@ int main(int argc, char *argv[])
         case DscSupportedOperation_StopConfiguration:
             {
                 operation_name = DSC_OPERATION_STOP_CONFIGURATION_STR;
-                MI_Boolean force = (Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
+                MI_Boolean force = (argc > 4 && Tcscasecmp(argv[4], MI_T("force")) == 0) ? MI_TRUE : MI_FALSE;
                 result = DscLib_StopConfiguration (force, &operation_error_root_value);
                 break;
             }
@@ -380,3 +352,70 @@ CleanUp:
 
     return result;
 }
+
+int main(int argc, char *argv[])
+{
+    MI_Instance *extended_error = NULL;
+    MI_Result result = MI_RESULT_OK;
+    JSON_Value *operation_error_root_value = NULL;
+    MI_Boolean serve_mode = (argc > 2 && Tcscasecmp(argv[1], MI_T(DSCHOST_SERVE_OPTION)) == 0) ? MI_TRUE : MI_FALSE;
+
+    // Set umask to 0022
+    umask(S_IWGRP | S_IWOTH);
+
+    // The service runs for days; its pid must not look like a stuck one-shot host to stop_old_host_instances.
+    if (serve_mode == MI_FALSE)
+    {
+        SaveCurrentPID();
+    }
+
+    // Check the user that has invoked the operation: root for DIY and omsagent for OMS
+#if defined(BUILD_OMS)
+    if (RunningAsRoot() == MI_TRUE)
+    {
+        Tprintf(MI_T("Unable to run omsconfig configurations as root. Please use omsagent credentials.\n"));
+        result = MI_RESULT_FAILED;
+        CreateMiInstanceErrorObject(&extended_error, MI_T("Unable to run omsconfig configurations as root. Please use omsagent credentials.\n"));
+        JSON_Value *value;
+        Convert_MIInstance_JSON(extended_error, &operation_error_root_value);
+        goto CleanUp;
+    }
+#else
+    if (RunningAsRoot() == MI_FALSE)
+    {
+        Tprintf(MI_T("Unable to run dsc configurations as non-root.  Please use root credentials.\n"));
+        result = MI_RESULT_FAILED;
+        CreateMiInstanceErrorObject(&extended_error, MI_T("Unable to run dsc configurations as non-root. Please use root credentials.\n"));
+        JSON_Value *value;
+        Convert_MIInstance_JSON(extended_error, &operation_error_root_value);
+        goto CleanUp;
+    }
+#endif
+
+#if defined(BUILD_OMS)
+    g_DscHost = MI_TRUE;
+#endif
+
+    if (serve_mode == MI_TRUE)
+    {
+        return DscHost_Serve(argv[2], RunOperation);
+    }
+
+    return RunOperation(argc, argv);
+
+CleanUp:
+
+    if (operation_error_root_value)
+    {
+        json_value_free(operation_error_root_value);
+    }
+
+    if (extended_error)
+    {
+        MI_Instance_Delete(extended_error);
+    }
+
+    Tprintf(MI_T("Operation failed.\n"));
+
+    return result;
+}
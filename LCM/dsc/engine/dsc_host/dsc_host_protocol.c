@@ -0,0 +1,248 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "parson.h"
+#include "dsc_host_protocol.h"
+
+static int WriteAll(int fd, const char* buffer, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = send(fd, buffer, length, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buffer += written;
+        length -= (size_t)written;
+    }
+
+    return 0;
+}
+
+static int ReadAll(int fd, char* buffer, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t received = recv(fd, buffer, length, 0);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (received == 0)
+        {
+            errno = ECONNRESET;
+            return -1;
+        }
+        buffer += received;
+        length -= (size_t)received;
+    }
+
+    return 0;
+}
+
+int DscHost_WriteFrame(
+    int fd,
+    const char* payload,
+    size_t length)
+{
+    unsigned char header[4];
+
+    if (length > DSCHOST_FRAME_MAX_SIZE)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    header[0] = (unsigned char)((length >> 24) & 0xFF);
+    header[1] = (unsigned char)((length >> 16) & 0xFF);
+    header[2] = (unsigned char)((length >> 8) & 0xFF);
+    header[3] = (unsigned char)(length & 0xFF);
+
+    if (WriteAll(fd, (const char*)header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+
+    return WriteAll(fd, payload, length);
+}
+
+int DscHost_ReadFrame(
+    int fd,
+    char** payload,
+    size_t* length)
+{
+    unsigned char header[4];
+    size_t frameLength;
+    char* buffer;
+
+    *payload = NULL;
+    *length = 0;
+
+    if (ReadAll(fd, (char*)header, sizeof(header)) != 0)
+    {
+        return -1;
+    }
+
+    frameLength = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+    if (frameLength > DSCHOST_FRAME_MAX_SIZE)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    buffer = (char*)malloc(frameLength + 1);
+    if (buffer == NULL)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if (ReadAll(fd, buffer, frameLength) != 0)
+    {
+        free(buffer);
+        return -1;
+    }
+    buffer[frameLength] = '\0';
+
+    *payload = buffer;
+    *length = frameLength;
+    return 0;
+}
+
+DscHostServiceResult DscHost_InvokeService(
+    const char* socketPath,
+    const char* outputPath,
+    const char* operation,
+    int argumentCount,
+    const char** arguments,
+    int* exitCode,
+    char** output)
+{
+    DscHostServiceResult result = DscHostService_Failed;
+    struct sockaddr_un address;
+    JSON_Value* request = NULL;
+    JSON_Value* response = NULL;
+    JSON_Object* requestObject;
+    JSON_Object* responseObject;
+    JSON_Array* requestArguments;
+    char* serializedRequest = NULL;
+    char* serializedResponse = NULL;
+    size_t responseLength = 0;
+    const char* responseOutput;
+    int fd;
+    int i;
+
+    *exitCode = -1;
+    *output = NULL;
+
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        return DscHostService_Unavailable;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return DscHostService_Unavailable;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return DscHostService_Unavailable;
+    }
+
+    request = json_value_init_object();
+    requestObject = json_value_get_object(request);
+    json_object_set_string(requestObject, DSCHOST_REQUEST_OPERATION, operation);
+    json_object_set_string(requestObject, DSCHOST_REQUEST_OUTPUT_PATH, outputPath);
+    json_object_set_boolean(requestObject, DSCHOST_REQUEST_LOCK_HELD, 0);
+    json_object_set_value(requestObject, DSCHOST_REQUEST_ARGUMENTS, json_value_init_array());
+    requestArguments = json_object_get_array(requestObject, DSCHOST_REQUEST_ARGUMENTS);
+    for (i = 0; i < argumentCount; i++)
+    {
+        json_array_append_string(requestArguments, arguments[i]);
+    }
+
+    serializedRequest = json_serialize_to_string(request);
+    if (serializedRequest == NULL
+        || DscHost_WriteFrame(fd, serializedRequest, strlen(serializedRequest)) != 0
+        || DscHost_ReadFrame(fd, &serializedResponse, &responseLength) != 0)
+    {
+        goto Cleanup;
+    }
+
+    response = json_parse_string(serializedResponse);
+    responseObject = json_value_get_object(response);
+    if (responseObject == NULL)
+    {
+        goto Cleanup;
+    }
+
+    *exitCode = (int)json_object_get_number(responseObject, DSCHOST_RESPONSE_EXIT_CODE);
+    responseOutput = json_object_get_string(responseObject, DSCHOST_RESPONSE_OUTPUT);
+    if (responseOutput != NULL)
+    {
+        *output = strdup(responseOutput);
+    }
+    result = DscHostService_Ok;
+
+Cleanup:
+    close(fd);
+
+    if (serializedRequest)
+    {
+        json_free_serialized_string(serializedRequest);
+    }
+
+    if (serializedResponse)
+    {
+        free(serializedResponse);
+    }
+
+    if (request)
+    {
+        json_value_free(request);
+    }
+
+    if (response)
+    {
+        json_value_free(response);
+    }
+
+    return result;
+}
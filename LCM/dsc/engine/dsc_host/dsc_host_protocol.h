@@ -0,0 +1,77 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _DSC_HOST_PROTOCOL_H
+#define _DSC_HOST_PROTOCOL_H
+
+#include <stddef.h>
+
+/*
+    'dsc_host --serve <socket>' answers one request per connection on a Unix
+    stream socket. Requests and responses are single frames: a 4 byte big-endian
+    payload length followed by a UTF-8 JSON document.
+
+    Request:  { "operation" : "TestConfiguration", "outputPath" : "/opt/dsc/output",
+                "arguments" : [ ... ], "lockHeld" : false }
+    Response: { "exitCode" : 0, "output" : "<what the one-shot dsc_host would have printed>" }
+
+    Set lockHeld when the caller already holds the dsc_host lock file for the
+    duration of the request; otherwise the service takes it itself.
+*/
+
+#define DSCHOST_SERVE_OPTION "--serve"
+#define DSCHOST_SOCKET_FILE_NAME "dsc_host.sock"
+#define DSCHOST_LOCK_FILE_PATH "/opt/dsc/dsc_host_lock"
+#define DSCHOST_FRAME_MAX_SIZE (16 * 1024 * 1024)
+
+#define DSCHOST_REQUEST_OPERATION "operation"
+#define DSCHOST_REQUEST_OUTPUT_PATH "outputPath"
+#define DSCHOST_REQUEST_ARGUMENTS "arguments"
+#define DSCHOST_REQUEST_LOCK_HELD "lockHeld"
+#define DSCHOST_RESPONSE_EXIT_CODE "exitCode"
+#define DSCHOST_RESPONSE_OUTPUT "output"
+
+typedef enum _DscHostServiceResult
+{
+    DscHostService_Ok = 0,
+    // Nothing is listening on the socket; the caller can run dsc_host itself.
+    DscHostService_Unavailable,
+    // The request was sent but no valid response came back.
+    DscHostService_Failed
+} DscHostServiceResult;
+
+// Returns 0 on success, -1 with errno set otherwise.
+int DscHost_WriteFrame(
+    int fd,
+    const char* payload,
+    size_t length);
+
+// On success *payload is a NUL terminated buffer the caller frees with free().
+int DscHost_ReadFrame(
+    int fd,
+    char** payload,
+    size_t* length);
+
+DscHostServiceResult DscHost_InvokeService(
+    const char* socketPath,
+    const char* outputPath,
+    const char* operation,
+    int argumentCount,
+    const char** arguments,
+    int* exitCode,
+    char** output);
+
+#endif
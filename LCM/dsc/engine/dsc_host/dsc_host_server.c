@@ -0,0 +1,344 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "DSC_Systemcalls.h"
+#include "EngineHelper.h"
+#include "EventWrapper.h"
+#include "parson.h"
+#include "dsc_host_server.h"
+
+static volatile sig_atomic_t g_StopRequested = 0;
+
+static void HandleStopSignal(int signalNumber)
+{
+    MI_UNREFERENCED_PARAMETER(signalNumber);
+    g_StopRequested = 1;
+}
+
+// Only the account dsc_host runs as (and root) may submit operations.
+static int IsPeerAllowed(int fd)
+{
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+    {
+        return 0;
+    }
+
+    return (credentials.uid == 0 || credentials.uid == geteuid()) ? 1 : 0;
+}
+
+static int AcquireHostLock()
+{
+    int retry;
+    int fd = open(DSCHOST_LOCK_FILE_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        DSC_TELEMETRY_ERROR("dsc_host service failed to open '%s' with errno = %d (%s)", DSCHOST_LOCK_FILE_PATH, errno, strerror(errno));
+        return -1;
+    }
+
+    for (retry = 0; retry < DSCHOST_LOCK_RETRY_COUNT && !g_StopRequested; retry++)
+    {
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+        {
+            return fd;
+        }
+
+        DSC_TELEMETRY_INFO("dsc_host lock file not acquired. retry (#%d) after %d seconds...", retry, DSCHOST_LOCK_RETRY_INTERVAL_SECONDS);
+        sleep(DSCHOST_LOCK_RETRY_INTERVAL_SECONDS);
+    }
+
+    close(fd);
+    return -1;
+}
+
+static void ReleaseHostLock(int fd)
+{
+    if (fd >= 0)
+    {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+}
+
+// Runs the operation with stdout redirected to a temporary file, so the caller
+// gets exactly what a one-shot dsc_host would have printed.
+static int RunCapturedOperation(
+    DscHostOperationHandler handler,
+    int argc,
+    char* argv[],
+    char** output)
+{
+    int exitCode;
+    int savedStdout;
+    long length;
+    FILE* capture;
+
+    *output = NULL;
+
+    capture = tmpfile();
+    if (capture == NULL)
+    {
+        return handler(argc, argv);
+    }
+
+    fflush(stdout);
+    savedStdout = dup(STDOUT_FILENO);
+    if (savedStdout < 0 || dup2(fileno(capture), STDOUT_FILENO) < 0)
+    {
+        if (savedStdout >= 0)
+        {
+            close(savedStdout);
+        }
+        fclose(capture);
+        return handler(argc, argv);
+    }
+
+    exitCode = handler(argc, argv);
+
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+
+    if (fseek(capture, 0, SEEK_END) == 0 && (length = ftell(capture)) >= 0 && length < DSCHOST_FRAME_MAX_SIZE)
+    {
+        *output = (char*)malloc((size_t)length + 1);
+        if (*output != NULL)
+        {
+            rewind(capture);
+            length = (long)fread(*output, 1, (size_t)length, capture);
+            (*output)[length] = '\0';
+        }
+    }
+
+    fclose(capture);
+    return exitCode;
+}
+
+static void SendResponse(
+    int fd,
+    int exitCode,
+    const char* output)
+{
+    JSON_Value* response = json_value_init_object();
+    JSON_Object* responseObject = json_value_get_object(response);
+    char* serializedResponse;
+
+    json_object_set_number(responseObject, DSCHOST_RESPONSE_EXIT_CODE, exitCode);
+    json_object_set_string(responseObject, DSCHOST_RESPONSE_OUTPUT, output != NULL ? output : "");
+
+    serializedResponse = json_serialize_to_string(response);
+    if (serializedResponse != NULL)
+    {
+        if (DscHost_WriteFrame(fd, serializedResponse, strlen(serializedResponse)) != 0)
+        {
+            DSC_TELEMETRY_WARNING("dsc_host service failed to send a response with errno = %d (%s)", errno, strerror(errno));
+        }
+        json_free_serialized_string(serializedResponse);
+    }
+
+    json_value_free(response);
+}
+
+static void HandleRequest(
+    int fd,
+    DscHostOperationHandler handler)
+{
+    char* serializedRequest = NULL;
+    size_t requestLength = 0;
+    JSON_Value* request = NULL;
+    JSON_Object* requestObject;
+    JSON_Array* requestArguments;
+    const char* operation;
+    const char* outputPath;
+    char* argv[DSCHOST_REQUEST_MAX_ARGUMENTS + 4] = {0};
+    int argc = 0;
+    size_t i;
+    size_t argumentCount;
+    int lockFd = -1;
+    int exitCode;
+    char* output = NULL;
+
+    if (DscHost_ReadFrame(fd, &serializedRequest, &requestLength) != 0)
+    {
+        DSC_TELEMETRY_WARNING("dsc_host service failed to read a request with errno = %d (%s)", errno, strerror(errno));
+        return;
+    }
+
+    request = json_parse_string(serializedRequest);
+    requestObject = json_value_get_object(request);
+    operation = json_object_get_string(requestObject, DSCHOST_REQUEST_OPERATION);
+    outputPath = json_object_get_string(requestObject, DSCHOST_REQUEST_OUTPUT_PATH);
+    requestArguments = json_object_get_array(requestObject, DSCHOST_REQUEST_ARGUMENTS);
+    argumentCount = json_array_get_count(requestArguments);
+
+    if (operation == NULL || outputPath == NULL || argumentCount > DSCHOST_REQUEST_MAX_ARGUMENTS)
+    {
+        SendResponse(fd, MI_RESULT_INVALID_PARAMETER, "Invalid dsc_host request\n");
+        goto Cleanup;
+    }
+
+    argv[argc++] = "dsc_host";
+    argv[argc++] = (char*)outputPath;
+    argv[argc++] = (char*)operation;
+    for (i = 0; i < argumentCount; i++)
+    {
+        const char* argument = json_array_get_string(requestArguments, i);
+        if (argument == NULL)
+        {
+            SendResponse(fd, MI_RESULT_INVALID_PARAMETER, "Invalid dsc_host request\n");
+            goto Cleanup;
+        }
+        argv[argc++] = (char*)argument;
+    }
+
+    // Same single-writer rule as the scripts: nobody else runs dsc_host while we do.
+    if (json_object_get_boolean(requestObject, DSCHOST_REQUEST_LOCK_HELD) != 1)
+    {
+        lockFd = AcquireHostLock();
+        if (lockFd < 0)
+        {
+            SendResponse(fd, MI_RESULT_FAILED, "dsc host lock already acquired by a different process\n");
+            goto Cleanup;
+        }
+    }
+
+    DSC_TELEMETRY_INFO("dsc_host service starting operation '%s'", operation);
+
+    exitCode = RunCapturedOperation(handler, argc, argv, &output);
+
+    ReleaseHostLock(lockFd);
+    DSCFlushTelemetry();
+
+    // Same value a caller would have seen as the exit status of a one-shot dsc_host.
+    SendResponse(fd, exitCode & 0xFF, output);
+
+Cleanup:
+    if (output)
+    {
+        free(output);
+    }
+
+    if (request)
+    {
+        json_value_free(request);
+    }
+
+    free(serializedRequest);
+}
+
+int DscHost_Serve(
+    const char* socketPath,
+    DscHostOperationHandler handler)
+{
+    struct sockaddr_un address;
+    struct sigaction action;
+    struct stat socketStat;
+    struct timeval timeout;
+    int listenFd;
+
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        Tprintf(MI_T("Socket path '%T' is too long\n"), socketPath);
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = HandleStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Replace a socket left behind by a previous instance, but never anything else.
+    if (lstat(socketPath, &socketStat) == 0 && S_ISSOCK(socketStat.st_mode))
+    {
+        unlink(socketPath);
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        Tprintf(MI_T("Failed to create socket with errno = %d (%T)\n"), errno, strerror(errno));
+        return MI_RESULT_FAILED;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0
+        || chmod(socketPath, S_IRUSR | S_IWUSR) != 0
+        || listen(listenFd, SOMAXCONN) != 0)
+    {
+        Tprintf(MI_T("Failed to listen on '%T' with errno = %d (%T)\n"), socketPath, errno, strerror(errno));
+        close(listenFd);
+        return MI_RESULT_FAILED;
+    }
+
+    DSC_TELEMETRY_INFO("dsc_host service listening on '%s'", socketPath);
+    DSCFlushTelemetry();
+
+    while (!g_StopRequested)
+    {
+        int clientFd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+        if (clientFd < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                DSC_TELEMETRY_ERROR("dsc_host service accept failed with errno = %d (%s)", errno, strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        if (!IsPeerAllowed(clientFd))
+        {
+            close(clientFd);
+            continue;
+        }
+
+        // A client that connects and then stalls must not hold up everyone else.
+        timeout.tv_sec = DSCHOST_REQUEST_TIMEOUT_SECONDS;
+        timeout.tv_usec = 0;
+        setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        HandleRequest(clientFd, handler);
+        close(clientFd);
+    }
+
+    close(listenFd);
+    unlink(socketPath);
+
+    DSC_TELEMETRY_INFO("dsc_host service on '%s' stopped", socketPath);
+    return MI_RESULT_OK;
+}
@@ -0,0 +1,37 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved.
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _DSC_HOST_SERVER_H
+#define _DSC_HOST_SERVER_H
+
+#include "dsc_host_protocol.h"
+
+// Lock retries match the ones PerformRequiredConfigurationChecks.py uses.
+#define DSCHOST_LOCK_RETRY_COUNT 60
+#define DSCHOST_LOCK_RETRY_INTERVAL_SECONDS 15
+#define DSCHOST_REQUEST_TIMEOUT_SECONDS 30
+#define DSCHOST_REQUEST_MAX_ARGUMENTS 8
+
+// Runs one operation given a one-shot dsc_host command line and returns its exit code.
+typedef int (*DscHostOperationHandler)(int argc, char* argv[]);
+
+// Serves requests on socketPath until SIGTERM or SIGINT. Requests run one at a time,
+// in this process, so the LCM state initialized by the first one is reused by the rest.
+int DscHost_Serve(
+    const char* socketPath,
+    DscHostOperationHandler handler);
+
+#endif
@@ -35,7 +35,7 @@ MI_Result  DscLib_GetConfiguration (
     MI_Result result = MI_RESULT_OK;
     MI_Instance *extended_errors = NULL;
     MI_InstanceA output_instances = {0};
-    MI_Uint8A configuration_mof_data = {0};
+    DSC_FileView configuration_mof_data = {0};
     MI_Real64 duration;
     ptrdiff_t start, finish;
 
@@ -54,17 +54,17 @@ MI_Result  DscLib_GetConfiguration (
     {
         // If a configuration file name is passed in the parameters, read from the passed configuration file.
         // Read file contents from the pending configuration file into configuration_mof_data
-        result = ReadFileContent(p_configuration_filename, &configuration_mof_data.data, &configuration_mof_data.size, &extended_errors);
+        result = DSC_FileView_Open(p_configuration_filename, &configuration_mof_data, &extended_errors);
     }
     else if (File_ExistT(GetCurrentConfigFileName()) != -1)
     {
         // Read file contents from the current configuration file (Current.mof) into configuration_mof_data
-        result = ReadFileContent(GetCurrentConfigFileName(), &configuration_mof_data.data, &configuration_mof_data.size, &extended_errors);
+        result = DSC_FileView_OpenReplaced(GetCurrentConfigFileName(), &configuration_mof_data, &extended_errors);
     }
     else if (File_ExistT(GetPendingConfigFileName()) != -1)
     {
         // Read file contents from the pending configuration file (Pending.mof) into configuration_mof_data
-        result = ReadFileContent(GetPendingConfigFileName(), &configuration_mof_data.data, &configuration_mof_data.size, &extended_errors);
+        result = DSC_FileView_OpenReplaced(GetPendingConfigFileName(), &configuration_mof_data, &extended_errors);
     }
     else
     {
@@ -129,6 +129,7 @@ Cleanup:
         MI_Instance_Delete(extended_errors);
     }
 
+    DSC_FileView_Close(&configuration_mof_data);
     DSC_free(context);
 
     return result;
@@ -363,7 +364,7 @@ MI_Result  DscLib_SetConfiguration (
 {
     MI_Result result = MI_RESULT_OK;
     MI_Instance *extended_errors = NULL;
-    MI_Uint8A configuration_mof_data = {0};
+    DSC_FileView configuration_mof_data = {0};
     MI_Real64 duration;
     ptrdiff_t start, finish;
 
@@ -380,7 +381,7 @@ MI_Result  DscLib_SetConfiguration (
     {
         // If a configuration file name is passed in the parameters, read from the passed configuration file.
         // Read file contents from the pending configuration file into configuration_mof_data
-        result = ReadFileContent(p_configuration_filename, &configuration_mof_data.data, &configuration_mof_data.size, &extended_errors);
+        result = DSC_FileView_Open(p_configuration_filename, &configuration_mof_data, &extended_errors);
     }
     else
     {
@@ -430,6 +431,7 @@ Cleanup:
         MI_Instance_Delete(extended_errors);
     }
 
+    DSC_FileView_Close(&configuration_mof_data);
     DSC_free(context);
 
     return result;
@@ -25,9 +25,15 @@
 #include "Resources_LCM.h"
 #include "strings.h"
 #include "LocalConfigManagerHelper.h"
+#include "BeginEndLcmOperation.h"
 #include "CAEngine.h"
+#include "CAValidate.h"
+#include "CAScheduler.h"
+#include "StatusReport.h"
 #include "ModuleHandlerInternal.h"
 #include "ModuleValidator.h"
+#include "SchemaCache.h"
+#include "WebPullClient.h"
 #include "lcm.traps.h"
 
 #if defined(_MSC_VER)
@@ -132,6 +138,53 @@ MI_Result NITS_CALL LCMTEST_RegisterTask(
     return RegisterTask(currentMetaConfigInstance, propName, taskName, defaultValue, cimErrorDetails);
 }
 
+MI_Result NITS_CALL LCMTEST_UpdateCurrentStatus(
+	_In_opt_ MI_Boolean *complianceStatus,
+	_In_opt_ MI_Uint32 *getActionStatusCode,
+	_In_opt_ MI_Uint32 *lcmStatusCode,
+	_In_opt_z_ MI_Char *registeredServerURLs,
+	_Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+	return UpdateCurrentStatus(complianceStatus, getActionStatusCode, lcmStatusCode, registeredServerURLs, extendedError);
+}
+
+// Starts and ends an LCM operation the way the Invoke_*_Internal task procedures do.
+MI_Result NITS_CALL LCMTEST_BeginLcmOperation(
+	_In_z_ const MI_Char *methodName,
+	_Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
+{
+	MI_Result r = TryBeginLcmOperation(methodName, cimErrorDetails);
+	if (r == MI_RESULT_OK)
+	{
+		SetLCMStatusBusy();
+	}
+	return r;
+}
+
+void NITS_CALL LCMTEST_EndLcmOperation(
+	_In_z_ const MI_Char *methodName)
+{
+	EndLcmOperation(methodName);
+	SetLCMStatusReady();
+	ResetJobId();
+}
+
+void NITS_CALL LCMTEST_GetLatestStatus(
+	_Out_ MI_Boolean *complianceStatus,
+	_Out_ MI_Uint32 *getActionStatusCode,
+	_Out_ MI_Uint32 *lcmStatusCode)
+{
+	GetLatestStatus(complianceStatus, getActionStatusCode, lcmStatusCode);
+}
+
+MI_Boolean NITS_CALL LCMTEST_GetJobId(
+	_Out_writes_z_(size) MI_Char *jobId,
+	_In_ MI_Uint32 size)
+{
+	Tcslcpy(jobId, g_ConfigurationDetails.jobGuidString, size);
+	return g_ConfigurationDetails.hasSetDetail;
+}
+
 MI_Result NITS_CALL CATest_InitCAHandler(_Outptr_result_maybenull_ MI_Instance **cimErrorDetails)
 {
     return InitCAHandler(cimErrorDetails);
@@ -252,6 +305,107 @@ MI_Result NITS_CALL CATest_ValidateInfrastructureSchema (_In_ MI_ClassA *miClass
     return ValidateInfrastructureSchema(miClassArray, extendedError);
 }
 
+MI_Result NITS_CALL CATest_ClassIndex_New (_In_reads_(classCount) MI_Class **classes,
+                    MI_Uint32 classCount,
+                    _Outptr_ ClassIndex **classIndex)
+{
+    return ClassIndex_New(classes, classCount, classIndex);
+}
+
+MI_Uint32 NITS_CALL CATest_ClassIndex_Find (_In_ ClassIndex *classIndex,
+                    _In_z_ const MI_Char *className)
+{
+    return ClassIndex_Find(classIndex, className);
+}
+
+void NITS_CALL CATest_ClassIndex_Delete (_In_opt_ ClassIndex *classIndex)
+{
+    ClassIndex_Delete(classIndex);
+}
+
+MI_Result NITS_CALL CATest_ValidateIfDuplicatedInstances (_In_ MI_InstanceA *instanceA,
+                    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    return ValidateIfDuplicatedInstances(instanceA, extendedError);
+}
+
+MI_Result NITS_CALL CATest_StatusReport_Format (_In_z_ const char *jobId,
+                    MI_Boolean isEndReport,
+                    _In_opt_z_ const char *errorMessage,
+                    _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+                    _In_z_ const char *timestamp,
+                    _In_z_ const char *nodeName,
+                    _In_z_ const char *ipAddress,
+                    _Outptr_result_z_ char **report)
+{
+    return StatusReport_Format(jobId, isEndReport, errorMessage, rnids, timestamp, nodeName, ipAddress, report);
+}
+
+MI_Result NITS_CALL CATest_CAScheduler_PerformInventory (_In_ LCMProviderContext *lcmContext,
+                    _In_ ModuleManager *moduleManager,
+                    _In_ MI_InstanceA *instanceA,
+                    _In_ MI_Uint32 concurrency,
+                    _In_ CAScheduler_InventoryFunction inventoryFunction,
+                    _Out_ MI_InstanceA *outInstances,
+                    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Result r = MI_RESULT_OK;
+    MI_Session miSession = MI_SESSION_NULL;
+
+    r = DSC_MI_Application_NewSession(((ModuleLoaderObject*) moduleManager->reserved2)->application, NULL, NULL, NULL, NULL, NULL, &miSession);
+    if (r != MI_RESULT_OK)
+    {
+        return r;
+    }
+
+    r = CAScheduler_PerformInventory(lcmContext, moduleManager, instanceA, &miSession, concurrency, inventoryFunction, outInstances, extendedError);
+    MI_Session_Close(&miSession, NULL, NULL);
+    return r;
+}
+
+MI_Uint64 NITS_CALL CATest_SchemaCache_BeginScan (MI_Uint64 coreFingerprint)
+{
+    return SchemaCache_BeginScan(coreFingerprint);
+}
+
+void NITS_CALL CATest_SchemaCache_EndScan (MI_Uint64 scan,
+                    MI_Boolean complete)
+{
+    SchemaCache_EndScan(scan, complete);
+}
+
+MI_Boolean NITS_CALL CATest_SchemaCache_GetModuleClasses (MI_Uint64 scan,
+                    _In_z_ const MI_Char *modulePath,
+                    MI_Uint64 fingerprint,
+                    _Inout_ MI_ClassA *miClassArray)
+{
+    return SchemaCache_GetModuleClasses(scan, modulePath, fingerprint, miClassArray);
+}
+
+void NITS_CALL CATest_SchemaCache_SetModuleClasses (MI_Uint64 scan,
+                    _In_z_ const MI_Char *modulePath,
+                    MI_Uint64 fingerprint,
+                    _In_ MI_ClassA *miClassArray,
+                    MI_Uint32 firstClass)
+{
+    SchemaCache_SetModuleClasses(scan, modulePath, fingerprint, miClassArray, firstClass);
+}
+
+MI_Result NITS_CALL CATest_PullSession_Probe (_In_z_ const char *confPath,
+                    _In_z_ const char *url,
+                    MI_Uint32 requests,
+                    _Out_ MI_Uint32 *newConnections,
+                    _Out_ MI_Boolean *offeredHttp2,
+                    _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    return PullSession_Probe(confPath, url, requests, newConnections, offeredHttp2, extendedError);
+}
+
+void NITS_CALL CATest_PullSession_Cleanup ()
+{
+    PullSession_Cleanup();
+}
+
 NitsTrapValue(LCMTraps)
     LCMTest_ExpandPath,
     LCMTest_GetMetaConfig,
@@ -266,6 +420,11 @@ NitsTrapValue(LCMTraps)
     LCMTEST_LCM_Pull_Execute,
     LCMTEST_GetLCMStatusCodeHistory,
     LCMTEST_RegisterTask,
+    LCMTEST_UpdateCurrentStatus,
+    LCMTEST_BeginLcmOperation,
+    LCMTEST_EndLcmOperation,
+    LCMTEST_GetLatestStatus,
+    LCMTEST_GetJobId,
 
 NitsEndTrapValue
 
@@ -285,6 +444,18 @@ NitsTrapValue(CATraps)
     CATest_Update,
     CATest_GetCoreSchema,
     CATest_ValidateInfrastructureSchema,
+    CATest_ClassIndex_New,
+    CATest_ClassIndex_Find,
+    CATest_ClassIndex_Delete,
+    CATest_ValidateIfDuplicatedInstances,
+    CATest_StatusReport_Format,
+    CATest_CAScheduler_PerformInventory,
+    CATest_SchemaCache_BeginScan,
+    CATest_SchemaCache_EndScan,
+    CATest_SchemaCache_GetModuleClasses,
+    CATest_SchemaCache_SetModuleClasses,
+    CATest_PullSession_Probe,
+    CATest_PullSession_Cleanup,
 
 NitsEndTrapValue
 
@@ -74,6 +74,29 @@ MI_Result (NITS_CALL * _LCMTEST_RegisterTask)(
 	_In_ MI_Uint32 defaultValue,
 	_Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
 
+MI_Result (NITS_CALL * _LCMTEST_UpdateCurrentStatus)(
+	_In_opt_ MI_Boolean *complianceStatus,
+	_In_opt_ MI_Uint32 *getActionStatusCode,
+	_In_opt_ MI_Uint32 *lcmStatusCode,
+	_In_opt_z_ MI_Char *registeredServerURLs,
+	_Outptr_result_maybenull_ MI_Instance **extendedError);
+
+MI_Result (NITS_CALL * _LCMTEST_BeginLcmOperation)(
+	_In_z_ const MI_Char *methodName,
+	_Outptr_result_maybenull_ MI_Instance **cimErrorDetails);
+
+void (NITS_CALL * _LCMTEST_EndLcmOperation)(
+	_In_z_ const MI_Char *methodName);
+
+void (NITS_CALL * _LCMTEST_GetLatestStatus)(
+	_Out_ MI_Boolean *complianceStatus,
+	_Out_ MI_Uint32 *getActionStatusCode,
+	_Out_ MI_Uint32 *lcmStatusCode);
+
+MI_Boolean (NITS_CALL * _LCMTEST_GetJobId)(
+	_Out_writes_z_(size) MI_Char *jobId,
+	_In_ MI_Uint32 size);
+
 NitsEndTrapTable
 
 NitsTrapTable(CATraps, 0)
@@ -152,6 +175,66 @@ NitsTrapTable(CATraps, 0)
     MI_Result ( NITS_CALL * _CATest_ValidateInfrastructureSchema) (_In_ MI_ClassA *miClassArray, 
                                        _Outptr_result_maybenull_ MI_Instance **extendedError );    
 
+    MI_Result ( NITS_CALL * _CATest_ClassIndex_New) (_In_reads_(classCount) MI_Class **classes,
+                        MI_Uint32 classCount,
+                        _Outptr_ ClassIndex **classIndex);
+
+    MI_Uint32 ( NITS_CALL * _CATest_ClassIndex_Find) (_In_ ClassIndex *classIndex,
+                        _In_z_ const MI_Char *className);
+
+    void ( NITS_CALL * _CATest_ClassIndex_Delete) (_In_opt_ ClassIndex *classIndex);
+
+    MI_Result ( NITS_CALL * _CATest_ValidateIfDuplicatedInstances) (_In_ MI_InstanceA *instanceA,
+                        _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+    MI_Result ( NITS_CALL * _CATest_StatusReport_Format) (_In_z_ const char *jobId,
+                        MI_Boolean isEndReport,
+                        _In_opt_z_ const char *errorMessage,
+                        _In_opt_ StatusReport_ResourceNotInDesiredState *rnids,
+                        _In_z_ const char *timestamp,
+                        _In_z_ const char *nodeName,
+                        _In_z_ const char *ipAddress,
+                        _Outptr_result_z_ char **report);
+
+    MI_Result ( NITS_CALL * _CATest_CAScheduler_PerformInventory) (_In_ LCMProviderContext *lcmContext,
+                        _In_ ModuleManager *moduleManager,
+                        _In_ MI_InstanceA *instanceA,
+                        _In_ MI_Uint32 concurrency,
+                        _In_ MI_Result (*inventoryFunction)(_In_ ProviderCallbackContext *provContext,
+                                                            _In_ MI_Application *miApp,
+                                                            _In_ MI_Session *miSession,
+                                                            _In_ MI_Instance *instance,
+                                                            _In_ const MI_Instance *regInstance,
+                                                            _Outptr_result_maybenull_ MI_InstanceA *outputInstances,
+                                                            _Outptr_result_maybenull_ MI_Instance **extendedError),
+                        _Out_ MI_InstanceA *outInstances,
+                        _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+    MI_Uint64 ( NITS_CALL * _CATest_SchemaCache_BeginScan) (MI_Uint64 coreFingerprint);
+
+    void ( NITS_CALL * _CATest_SchemaCache_EndScan) (MI_Uint64 scan,
+                        MI_Boolean complete);
+
+    MI_Boolean ( NITS_CALL * _CATest_SchemaCache_GetModuleClasses) (MI_Uint64 scan,
+                        _In_z_ const MI_Char *modulePath,
+                        MI_Uint64 fingerprint,
+                        _Inout_ MI_ClassA *miClassArray);
+
+    void ( NITS_CALL * _CATest_SchemaCache_SetModuleClasses) (MI_Uint64 scan,
+                        _In_z_ const MI_Char *modulePath,
+                        MI_Uint64 fingerprint,
+                        _In_ MI_ClassA *miClassArray,
+                        MI_Uint32 firstClass);
+
+    MI_Result ( NITS_CALL * _CATest_PullSession_Probe) (_In_z_ const char *confPath,
+                        _In_z_ const char *url,
+                        MI_Uint32 requests,
+                        _Out_ MI_Uint32 *newConnections,
+                        _Out_ MI_Boolean *offeredHttp2,
+                        _Outptr_result_maybenull_ MI_Instance **extendedError);
+
+    void ( NITS_CALL * _CATest_PullSession_Cleanup) ();
+
 NitsEndTrapTable
 
 NitsTrapExport(CATraps);
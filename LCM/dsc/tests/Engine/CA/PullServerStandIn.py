@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+#============================================================================
+# Copyright (c) Microsoft Corporation. All rights reserved. See license.txt for license information.
+#============================================================================
+# Stand-in pull server for the pull session tests.  Serves HTTPS with HTTP/1.1
+# keep-alive on an ephemeral port of the loopback interface, answering every
+# GET with 200, prints the port on stdout and runs until it is killed.
+#
+# usage: PullServerStandIn.py <work directory>
+
+import os
+import ssl
+import subprocess
+import sys
+
+try:
+    from http.server import BaseHTTPRequestHandler, HTTPServer
+    from socketserver import ThreadingMixIn
+except ImportError:
+    from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+    from SocketServer import ThreadingMixIn
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+
+    def do_GET(self):
+        body = 'OK'.encode('ascii')
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/plain')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, *args):
+        pass
+
+
+class Server(ThreadingMixIn, HTTPServer):
+    daemon_threads = True
+
+
+def main(workDir):
+    certFile = os.path.join(workDir, 'PullServerStandIn.crt')
+    keyFile = os.path.join(workDir, 'PullServerStandIn.key')
+    devNull = open(os.devnull, 'w')
+    subprocess.check_call(['openssl', 'req', '-x509', '-newkey', 'rsa:2048',
+                           '-nodes', '-subj', '/CN=localhost', '-days', '1',
+                           '-keyout', keyFile, '-out', certFile],
+                          stdout=devNull, stderr=devNull)
+
+    server = Server(('127.0.0.1', 0), Handler)
+    if hasattr(ssl, 'SSLContext'):
+        if hasattr(ssl, 'PROTOCOL_TLS_SERVER'):
+            context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        else:
+            context = ssl.SSLContext(ssl.PROTOCOL_SSLv23)
+        context.load_cert_chain(certFile, keyFile)
+        # HTTP/1.1 only, a client offering h2 has to fall back to it
+        if hasattr(context, 'set_alpn_protocols'):
+            context.set_alpn_protocols(['http/1.1'])
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    else:
+        server.socket = ssl.wrap_socket(server.socket, certfile=certFile,
+                                        keyfile=keyFile, server_side=True)
+
+    sys.stdout.write('%d\n' % server.server_address[1])
+    sys.stdout.flush()
+    server.serve_forever()
+
+
+if __name__ == '__main__':
+    main(sys.argv[1])
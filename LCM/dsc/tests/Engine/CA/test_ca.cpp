@@ -18,6 +18,7 @@
 #include <EngineHelperInternal.h>
 #include <pal/format.h>
 #include <pal/shlib.h>
+#include <pal/alloc.h>
 #include <ModuleHandler.h>
 #include <CAEngine.h>
 #include <lcm.traps.h>
@@ -40,9 +41,14 @@
     #define TEST_DEPENDENCY_10 MI_T("DependencyResolver10.mof")
     #define TEST_DEPENDENCY_11 MI_T("DependencyResolver11.mof")
     #define TEST_DEPENDENCY_12 MI_T("DependencyResolver12.mof")
+    #define TEST_STATUSREPORT_GOLDEN MI_T("StatusReport.golden")
     #define FMT MI_T("%S\\%S")
 #else
     #include <unistd.h>
+    #include <time.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <sys/wait.h>
     #define _GetCurrentDir getcwd
     #define TEST_DOCUMENT_NAME CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/testinstance.mof")
     #define TEST_DEPENDENCY_1 CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/DependencyResolver1.mof")
@@ -57,6 +63,8 @@
     #define TEST_DEPENDENCY_10 CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/DependencyResolver10.mof")
     #define TEST_DEPENDENCY_11 CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/DependencyResolver11.mof")
     #define TEST_DEPENDENCY_12 CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/DependencyResolver12.mof")
+    #define TEST_STATUSREPORT_GOLDEN CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/StatusReport.golden")
+    #define TEST_PULL_SERVER_STANDIN CONFIG_SRCDIR MI_T("/dsc/tests/Engine/CA") MI_T("/PullServerStandIn.py")
     #define FMT MI_T("%s/%s")
     #define DSCCORE_LIB CONFIG_LIBDIR MI_T("/libdsccore.so")
 #endif
@@ -609,3 +617,580 @@ NitsDRTCommonTest1(TestResolveDependencies, InitCA, PtrVal)
     }
 NitsEndTest
 
+#if !defined(_MSC_VER)
+//==============================================================================
+//
+//ResolveDependencies() scaling
+//
+//==============================================================================
+#define TEST_DEPENDENCY_SCALING MI_T("/tmp/DependencyResolverScaling.mof")
+
+// Resource i depends on resources i+1 and 2i+1, so nearly every resource has to be
+// reordered behind resources defined after it.
+static bool WriteScalingDocument(MI_Uint32 resourceCount)
+{
+    FILE *fp = fopen(TEST_DEPENDENCY_SCALING, "w");
+    MI_Uint32 xCount = 0;
+    if( fp == NULL)
+    {
+        return false;
+    }
+    for( xCount = 0 ; xCount < resourceCount; xCount++)
+    {
+        fprintf(fp, "instance of TEST_Test1\n{\n    ResourceId = \"[TEST_Test1]r%u\";\n", xCount);
+        fprintf(fp, "    ModuleName=\"PsModuleForTEST_Test1\";\n    ModuleVersion=\"1.0\";\n    Id1 = \"%u\";\n", xCount);
+        if( 2 * xCount + 1 < resourceCount)
+        {
+            fprintf(fp, "    DependsOn={\"[TEST_Test1]r%u\", \"[TEST_Test1]R%u\"};\n", xCount + 1, 2 * xCount + 1);
+        }
+        else if( xCount + 1 < resourceCount)
+        {
+            fprintf(fp, "    DependsOn={\"[TEST_Test1]r%u\"};\n", xCount + 1);
+        }
+        fprintf(fp, "};\n\n");
+    }
+    fclose(fp);
+    return true;
+}
+
+NitsDRTCommonTest1(TestResolveDependenciesScaling, InitCA, PtrVal)
+
+    MI_Instance *extendedError = NULL;
+    MI_Uint32 sizes[] = { 10, 100, 1000, 10000, 100000 };
+    MI_Uint32 sizeIndex = 0;
+    MI_Uint32 xCount = 0;
+    ModuleManager *moduleManager = NULL;
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_InitializeModuleManager)(0, &extendedError, &moduleManager);
+
+    if(NitsCompare(r, MI_RESULT_OK, MI_T("InitializeModuleManager failed")) &&
+       NitsAssert(moduleManager != NULL, MI_T("ModuleManager is NULL")) &&
+       NitsAssert(moduleManager->ft != NULL, MI_T("ModuleManager function table is null")) )
+    {
+        for( sizeIndex = 0 ; sizeIndex < sizeof(sizes)/sizeof(sizes[0]); sizeIndex++)
+        {
+            MI_InstanceA resourceInstances = {0};
+            MI_Instance *documentIns = NULL;
+            ExecutionOrderContainer container = {0};
+            struct timespec start, end;
+            MI_Char message[256];
+
+            if( !NitsAssert(WriteScalingDocument(sizes[sizeIndex]), MI_T("Failed to write scaling document")))
+            {
+                break;
+            }
+            if( !NitsCompare(NitsGetTrap(h, CATraps, _CATEST_LoadInstanceDocumentFromLocation)(moduleManager, 0, TEST_DEPENDENCY_SCALING, &extendedError, &resourceInstances, &documentIns), MI_RESULT_OK, MI_T("ResolveDependency scaling: LoadInstanceDocumentFromLocation Failed")))
+            {
+                break;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            r = NitsGetTrap(h, CATraps, _CATest_ResolveDependency)(&resourceInstances, &container, &extendedError);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            if(NitsCompare(r, MI_RESULT_OK, MI_T("ResolveDependency Failed for scaling document")) &&
+               NitsCompare(container.executionListSize, sizes[sizeIndex], MI_T("Scaling document: unexpected container.executionListSize")))
+            {
+                // Every resource has to come after the resources it depends on.
+                for( xCount = 0 ; xCount + 1 < sizes[sizeIndex]; xCount++)
+                {
+                    if( !NitsAssert(container.executionPosition[xCount + 1] < container.executionPosition[xCount], MI_T("Resource ordered before its dependency")) ||
+                        (2 * xCount + 1 < sizes[sizeIndex] &&
+                         !NitsAssert(container.executionPosition[2 * xCount + 1] < container.executionPosition[xCount], MI_T("Resource ordered before its dependency"))))
+                    {
+                        break;
+                    }
+                }
+                Stprintf(message, 256, MI_T("ResolveDependency: %u resources in %ld us"), sizes[sizeIndex],
+                         (long)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000));
+                NitsTrace(message);
+            }
+            NitsGetTrap(h, CATraps, _CATest_FreeExecutionOrderContainer)(&container);
+        }
+        unlink(TEST_DEPENDENCY_SCALING);
+        moduleManager->ft->Close(moduleManager,&extendedError);
+    }
+    if( extendedError != NULL)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+NitsEndTest
+
+//==============================================================================
+//
+//ValidateIfDuplicatedInstances() on large documents
+//
+//==============================================================================
+#define TEST_DUPLICATE_KEYS MI_T("/tmp/DuplicateKeys.mof")
+#define TEST_DUPLICATE_KEYS_RESOURCES 5000
+
+// Every resource gets its own Id1 key, except resource duplicate, which reuses the key of
+// resource original when original is less than resourceCount.
+static bool WriteDuplicateKeyDocument(MI_Uint32 resourceCount, MI_Uint32 original, MI_Uint32 duplicate)
+{
+    FILE *fp = fopen(TEST_DUPLICATE_KEYS, "w");
+    MI_Uint32 xCount = 0;
+    if( fp == NULL)
+    {
+        return false;
+    }
+    for( xCount = 0 ; xCount < resourceCount; xCount++)
+    {
+        fprintf(fp, "instance of TEST_Test1\n{\n    ResourceId = \"[TEST_Test1]r%u\";\n", xCount);
+        fprintf(fp, "    ModuleName=\"PsModuleForTEST_Test1\";\n    ModuleVersion=\"1.0\";\n    Id1 = \"%u\";\n};\n\n",
+                (xCount == duplicate && original < resourceCount) ? original : xCount);
+    }
+    fclose(fp);
+    return true;
+}
+
+// The error names both resources of the reported pair.
+static bool MessageNamesResources(_In_ MI_Instance *extendedError, MI_Uint32 original, MI_Uint32 duplicate)
+{
+    MI_Value value;
+    MI_Uint32 flags = 0;
+    char resourceId[64];
+
+    if( extendedError == NULL ||
+        MI_Instance_GetElement(extendedError, MI_T("Message"), &value, NULL, &flags, NULL) != MI_RESULT_OK ||
+        (flags & MI_FLAG_NULL))
+    {
+        return false;
+    }
+    snprintf(resourceId, sizeof(resourceId), "[TEST_Test1]r%u", original);
+    if( strstr(value.string, resourceId) == NULL)
+    {
+        return false;
+    }
+    snprintf(resourceId, sizeof(resourceId), "[TEST_Test1]r%u", duplicate);
+    return strstr(value.string, resourceId) != NULL;
+}
+
+NitsDRTCommonTest1(TestValidateIfDuplicatedInstancesLargeDocument, InitCA, PtrVal)
+
+    struct
+    {
+        MI_Uint32 original;
+        MI_Uint32 duplicate;
+    } cases[] = {
+        { TEST_DUPLICATE_KEYS_RESOURCES, TEST_DUPLICATE_KEYS_RESOURCES },       // every key is unique
+        { 0, TEST_DUPLICATE_KEYS_RESOURCES - 1 },                               // first and last resource
+        { TEST_DUPLICATE_KEYS_RESOURCES - 2, TEST_DUPLICATE_KEYS_RESOURCES - 1 }, // last two resources
+        { 3, 4000 },                                                            // far apart in the middle
+    };
+    MI_Instance *extendedError = NULL;
+    MI_Uint32 caseIndex = 0;
+    ModuleManager *moduleManager = NULL;
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_InitializeModuleManager)(0, &extendedError, &moduleManager);
+
+    if(NitsCompare(r, MI_RESULT_OK, MI_T("InitializeModuleManager failed")) &&
+       NitsAssert(moduleManager != NULL, MI_T("ModuleManager is NULL")) &&
+       NitsAssert(moduleManager->ft != NULL, MI_T("ModuleManager function table is null")) )
+    {
+        for( caseIndex = 0 ; caseIndex < sizeof(cases)/sizeof(cases[0]); caseIndex++)
+        {
+            MI_InstanceA resourceInstances = {0};
+            MI_Instance *documentIns = NULL;
+
+            if( !NitsAssert(WriteDuplicateKeyDocument(TEST_DUPLICATE_KEYS_RESOURCES, cases[caseIndex].original, cases[caseIndex].duplicate), MI_T("Failed to write duplicate key document")) ||
+                !NitsCompare(NitsGetTrap(h, CATraps, _CATEST_LoadInstanceDocumentFromLocation)(moduleManager, 0, TEST_DUPLICATE_KEYS, &extendedError, &resourceInstances, &documentIns), MI_RESULT_OK, MI_T("Duplicate keys: LoadInstanceDocumentFromLocation Failed")))
+            {
+                break;
+            }
+
+            r = NitsGetTrap(h, CATraps, _CATest_ValidateIfDuplicatedInstances)(&resourceInstances, &extendedError);
+            if( cases[caseIndex].original >= TEST_DUPLICATE_KEYS_RESOURCES)
+            {
+                NitsCompare(r, MI_RESULT_OK, MI_T("ValidateIfDuplicatedInstances reported a duplicate in a document without one"));
+            }
+            else if( NitsCompare(r, MI_RESULT_ALREADY_EXISTS, MI_T("ValidateIfDuplicatedInstances did not report the duplicate key")))
+            {
+                NitsAssert(MessageNamesResources(extendedError, cases[caseIndex].original, cases[caseIndex].duplicate), MI_T("Duplicate key error does not name the duplicated resources"));
+            }
+            if( extendedError != NULL)
+            {
+                MI_Instance_Delete(extendedError);
+                extendedError = NULL;
+            }
+        }
+        unlink(TEST_DUPLICATE_KEYS);
+        moduleManager->ft->Close(moduleManager,&extendedError);
+    }
+    if( extendedError != NULL)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+NitsEndTest
+
+//==============================================================================
+//
+//StatusReport_Format() against the output of StatusReport.sh
+//
+//==============================================================================
+#define STATUSREPORT_TEST_JOBID "0A1B2C3D-4E5F-4071-8293-A4B5C6D7E8F9"
+#define STATUSREPORT_TEST_TIMESTAMP "2026-10-17T08:30:15.123456789+00:00"
+#define STATUSREPORT_TEST_NODENAME "dsc-node01"
+#define STATUSREPORT_TEST_IPADDRESS "10.0.0.4;127.0.0.1;::1;fe80::20d:3aff:fe12:3456;"
+
+// Formats one report and checks it against the golden output at *offset, moving past it.
+static bool MatchStatusReport(NitsTrapHandle h, const char *expected, size_t expectedLength, size_t *offset,
+                              MI_Boolean isEndReport, const char *errorMessage, StatusReport_ResourceNotInDesiredState *rnids)
+{
+    char *report = NULL;
+    size_t length;
+    bool matched;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_StatusReport_Format)(STATUSREPORT_TEST_JOBID, isEndReport, errorMessage, rnids,
+                                                                      STATUSREPORT_TEST_TIMESTAMP, STATUSREPORT_TEST_NODENAME,
+                                                                      STATUSREPORT_TEST_IPADDRESS, &report);
+    if( r != MI_RESULT_OK || report == NULL)
+    {
+        return false;
+    }
+    length = strlen(report);
+    matched = (*offset + length <= expectedLength) && memcmp(expected + *offset, report, length) == 0;
+    *offset += length;
+    PAL_Free(report);
+    return matched;
+}
+
+// StatusReport.golden holds what StatusReport.sh printed for the same four reports.
+NitsDRTCommonTest1(TestStatusReportGolden, InitCA, PtrVal)
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    StatusReport_ResourceNotInDesiredState rnids = { (char*)"::5::9::nxFile", (char*)"nxFile", (char*)"0", (char*)"[nxFile]Example", (char*)"0",
+                                                     (char*)"MSFT_nxFileResource", (char*)"1.0", (char*)"False", (char*)"[nxFile]Example",
+                                                     (char*)"", (char*)"False" };
+    char expected[8192];
+    size_t expectedLength;
+    size_t offset = 0;
+    FILE *fp = File_OpenT(TEST_STATUSREPORT_GOLDEN, MI_T("rb"));
+
+    if( !NitsAssert(fp != NULL, MI_T("Failed to open StatusReport.golden")))
+    {
+        NitsReturn;
+    }
+    expectedLength = fread(expected, 1, sizeof(expected), fp);
+    File_Close(fp);
+
+    if( NitsAssert(MatchStatusReport(h, expected, expectedLength, &offset, MI_FALSE, NULL, NULL), MI_T("StartTime report differs from StatusReport.golden")) &&
+        NitsAssert(MatchStatusReport(h, expected, expectedLength, &offset, MI_TRUE, "", NULL), MI_T("EndTime report differs from StatusReport.golden")) &&
+        NitsAssert(MatchStatusReport(h, expected, expectedLength, &offset, MI_TRUE, "Failed to apply the configuration.", NULL), MI_T("EndTime report with error differs from StatusReport.golden")) &&
+        NitsAssert(MatchStatusReport(h, expected, expectedLength, &offset, MI_TRUE, "The resource failed to apply.", &rnids), MI_T("EndTime report with resource differs from StatusReport.golden")))
+    {
+        NitsCompare((MI_Uint32)offset, (MI_Uint32)expectedLength, MI_T("StatusReport.golden has more reports than were formatted"));
+    }
+NitsEndTest
+
+//==============================================================================
+//
+//CAScheduler_PerformInventory() ordering
+//
+//==============================================================================
+#define TEST_INVENTORY_DOCUMENT_TEMPLATE "/tmp/InventoryOrderingXXXXXX.mof"
+#define TEST_INVENTORY_RESOURCES 12
+
+static pthread_mutex_t s_inventoryLock = PTHREAD_MUTEX_INITIALIZER;
+static MI_Uint32 s_inventoryInFlight = 0;
+static MI_Uint32 s_inventoryMaxInFlight = 0;
+static MI_Uint32 s_inventoryFailAt = TEST_INVENTORY_RESOURCES;
+
+// Resources alternate between two classes, so up to two of them are collected at a time.
+// path holds TEST_INVENTORY_DOCUMENT_TEMPLATE and receives the name of the new document.
+static bool WriteInventoryDocument(char *path)
+{
+    int fd = mkstemps(path, 4);
+    FILE *fp = NULL;
+    MI_Uint32 xCount = 0;
+    if( fd == -1)
+    {
+        return false;
+    }
+    fp = fdopen(fd, "w");
+    if( fp == NULL)
+    {
+        close(fd);
+        unlink(path);
+        return false;
+    }
+    for( xCount = 0 ; xCount < TEST_INVENTORY_RESOURCES; xCount++)
+    {
+        const char *className = (xCount % 2) ? "TEST_Test3User" : "TEST_Test1";
+        fprintf(fp, "instance of %s\n{\n    ResourceId = \"[%s]r%u\";\n", className, className, xCount);
+        fprintf(fp, "    ModuleName=\"PsModuleFor%s\";\n    ModuleVersion=\"1.0\";\n    %s = \"%u\";\n};\n\n",
+                className, (xCount % 2) ? "id1" : "Id1", xCount);
+    }
+    fclose(fp);
+    return true;
+}
+
+// Stands in for PerformInventoryState. Resource rN returns N % 3 instances holding N and their
+// number; earlier resources take longer, so resources finish out of document order.
+static MI_Result FakeInventory(_In_ ProviderCallbackContext *provContext,
+                               _In_ MI_Application *miApp,
+                               _In_ MI_Session *miSession,
+                               _In_ MI_Instance *instance,
+                               _In_ const MI_Instance *regInstance,
+                               _Outptr_result_maybenull_ MI_InstanceA *outputInstances,
+                               _Outptr_result_maybenull_ MI_Instance **extendedError)
+{
+    MI_Uint32 position = (MI_Uint32)atoi(strrchr(provContext->resourceId, 'r') + 1);
+    MI_Uint32 xCount = 0;
+    MI_Value value;
+    MI_Result r = MI_RESULT_OK;
+
+    outputInstances->data = NULL;
+    outputInstances->size = 0;
+
+    pthread_mutex_lock(&s_inventoryLock);
+    if( ++s_inventoryInFlight > s_inventoryMaxInFlight)
+    {
+        s_inventoryMaxInFlight = s_inventoryInFlight;
+    }
+    pthread_mutex_unlock(&s_inventoryLock);
+
+    usleep((TEST_INVENTORY_RESOURCES - position) * 5000);
+
+    if( position == s_inventoryFailAt)
+    {
+        r = MI_RESULT_FAILED;
+    }
+    else if( position % 3 != 0)
+    {
+        outputInstances->data = (MI_Instance**)PAL_Malloc(sizeof(MI_Instance*) * (position % 3));
+        for( xCount = 0 ; outputInstances->data != NULL && xCount < position % 3; xCount++)
+        {
+            if( MI_Application_NewInstance(miApp, MI_T("TEST_InventoryItem"), NULL, &outputInstances->data[xCount]) != MI_RESULT_OK)
+            {
+                r = MI_RESULT_FAILED;
+                break;
+            }
+            outputInstances->size++;
+            value.uint32 = position;
+            MI_Instance_AddElement(outputInstances->data[xCount], MI_T("Position"), &value, MI_UINT32, 0);
+            value.uint32 = xCount;
+            MI_Instance_AddElement(outputInstances->data[xCount], MI_T("Item"), &value, MI_UINT32, 0);
+        }
+    }
+
+    pthread_mutex_lock(&s_inventoryLock);
+    s_inventoryInFlight--;
+    pthread_mutex_unlock(&s_inventoryLock);
+    return r;
+}
+
+// Every resource's instances have to follow the document order, whatever the concurrency.
+static bool InventoryInDocumentOrder(_In_ MI_InstanceA *outInstances)
+{
+    MI_Uint32 position = 0;
+    MI_Uint32 item = 0;
+    MI_Uint32 xCount = 0;
+    MI_Value value;
+
+    for( position = 0 ; position < TEST_INVENTORY_RESOURCES; position++)
+    {
+        for( item = 0 ; item < position % 3; item++, xCount++)
+        {
+            if( xCount >= outInstances->size ||
+                MI_Instance_GetElement(outInstances->data[xCount], MI_T("Position"), &value, NULL, NULL, NULL) != MI_RESULT_OK ||
+                value.uint32 != position ||
+                MI_Instance_GetElement(outInstances->data[xCount], MI_T("Item"), &value, NULL, NULL, NULL) != MI_RESULT_OK ||
+                value.uint32 != item)
+            {
+                return false;
+            }
+        }
+    }
+    return xCount == outInstances->size;
+}
+
+NitsDRTCommonTest1(TestPerformInventoryOrdering, InitCA, PtrVal)
+
+    MI_Instance *extendedError = NULL;
+    ModuleManager *moduleManager = NULL;
+    MI_InstanceA resourceInstances = {0};
+    MI_Instance *documentIns = NULL;
+    LCMProviderContext lcmContext = {0};
+    MI_Uint32 concurrency[] = { 1, 4 };
+    MI_Uint32 xCount = 0;
+    char documentPath[] = TEST_INVENTORY_DOCUMENT_TEMPLATE;
+    bool documentWritten = WriteInventoryDocument(documentPath);
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_InitializeModuleManager)(0, &extendedError, &moduleManager);
+
+    if(NitsCompare(r, MI_RESULT_OK, MI_T("InitializeModuleManager failed")) &&
+       NitsAssert(moduleManager != NULL, MI_T("ModuleManager is NULL")) &&
+       NitsAssert(moduleManager->ft != NULL, MI_T("ModuleManager function table is null")) &&
+       NitsAssert(documentWritten, MI_T("Failed to write inventory document")) &&
+       NitsCompare(NitsGetTrap(h, CATraps, _CATEST_LoadInstanceDocumentFromLocation)(moduleManager, 0, documentPath, &extendedError, &resourceInstances, &documentIns), MI_RESULT_OK, MI_T("Inventory ordering: LoadInstanceDocumentFromLocation Failed")))
+    {
+        for( xCount = 0 ; xCount < sizeof(concurrency)/sizeof(concurrency[0]); xCount++)
+        {
+            MI_InstanceA outInstances = {0};
+
+            s_inventoryMaxInFlight = 0;
+            s_inventoryFailAt = TEST_INVENTORY_RESOURCES;
+            r = NitsGetTrap(h, CATraps, _CATest_CAScheduler_PerformInventory)(&lcmContext, moduleManager, &resourceInstances, concurrency[xCount], FakeInventory, &outInstances, &extendedError);
+            if( NitsCompare(r, MI_RESULT_OK, MI_T("CAScheduler_PerformInventory failed")))
+            {
+                NitsAssert(InventoryInDocumentOrder(&outInstances), MI_T("Inventory instances are not in document order"));
+                // One lane per class, so two classes never have more than two calls in flight.
+                NitsCompare(s_inventoryMaxInFlight, concurrency[xCount] > 1 ? 2 : 1, MI_T("Unexpected number of inventory calls in flight"));
+            }
+            CleanUpInstanceCache(&outInstances);
+
+            // The first failed resource is reported and no partial inventory is returned.
+            s_inventoryFailAt = 5;
+            r = NitsGetTrap(h, CATraps, _CATest_CAScheduler_PerformInventory)(&lcmContext, moduleManager, &resourceInstances, concurrency[xCount], FakeInventory, &outInstances, &extendedError);
+            NitsCompare(r, MI_RESULT_FAILED, MI_T("CAScheduler_PerformInventory did not report the failed resource"));
+            NitsCompare(outInstances.size, 0, MI_T("CAScheduler_PerformInventory returned a partial inventory"));
+            if( extendedError != NULL)
+            {
+                MI_Instance_Delete(extendedError);
+                extendedError = NULL;
+            }
+        }
+    }
+    if( documentWritten)
+    {
+        unlink(documentPath);
+    }
+    if( moduleManager != NULL)
+    {
+        moduleManager->ft->Close(moduleManager,&extendedError);
+    }
+    if( extendedError != NULL)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+NitsEndTest
+
+//==============================================================================
+//
+//Pull session connection reuse against a local HTTPS stand-in
+//
+//==============================================================================
+#define TEST_PULL_SESSION_DIRECTORY_TEMPLATE "/tmp/PullSessionXXXXXX"
+#define TEST_PULL_SESSION_REQUESTS 5
+
+// Starts PullServerStandIn.py with workDir and reads the port it listens on. Returns the child's pid or -1.
+static pid_t StartPullServerStandIn(const char *workDir, int *port)
+{
+    int fds[2];
+    pid_t child;
+    FILE *fp = NULL;
+
+    *port = 0;
+    if( pipe(fds) != 0)
+    {
+        return -1;
+    }
+    child = fork();
+    if( child == 0)
+    {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execlp("python3", "python3", TEST_PULL_SERVER_STANDIN, workDir, (char*)NULL);
+        execlp("python", "python", TEST_PULL_SERVER_STANDIN, workDir, (char*)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    if( child > 0)
+    {
+        fp = fdopen(fds[0], "r");
+        if( fp == NULL || fscanf(fp, "%d", port) != 1 || *port <= 0)
+        {
+            kill(child, SIGTERM);
+            waitpid(child, NULL, 0);
+            child = -1;
+        }
+    }
+    if( fp != NULL)
+    {
+        fclose(fp);
+    }
+    else
+    {
+        close(fds[0]);
+    }
+    return child;
+}
+
+static bool WritePullSessionConf(const char *path, bool useHttp2)
+{
+    FILE *fp = fopen(path, "w");
+    if( fp == NULL)
+    {
+        return false;
+    }
+    // The stand-in has a self-signed certificate.
+    fprintf(fp, "DoNotCheckCertificate=true\nUseHttp2=%s\n", useHttp2 ? "true" : "false");
+    fclose(fp);
+    return true;
+}
+
+// Every request of a pull cycle has to go over the first connection, with UseHttp2 off or on; the stand-in only
+// speaks HTTP/1.1, so an HTTP/2 offer falls back to it through ALPN.
+NitsDRTCommonTest1(TestPullSessionReusesConnection, InitCA, PtrVal)
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    char workDir[] = TEST_PULL_SESSION_DIRECTORY_TEMPLATE;
+    char confPath[sizeof(workDir) + 16];
+    char certPath[sizeof(workDir) + 32];
+    char keyPath[sizeof(workDir) + 32];
+    char url[64];
+    int port = 0;
+    pid_t server = -1;
+    int pass = 0;
+    MI_Instance *extendedError = NULL;
+
+    if( !NitsAssert(mkdtemp(workDir) != NULL, MI_T("Failed to create the pull session work directory")))
+    {
+        NitsReturn;
+    }
+    snprintf(confPath, sizeof(confPath), "%s/dsc.conf", workDir);
+    snprintf(certPath, sizeof(certPath), "%s/PullServerStandIn.crt", workDir);
+    snprintf(keyPath, sizeof(keyPath), "%s/PullServerStandIn.key", workDir);
+
+    server = StartPullServerStandIn(workDir, &port);
+    if( NitsAssert(server > 0, MI_T("Failed to start PullServerStandIn.py")))
+    {
+        snprintf(url, sizeof(url), "https://127.0.0.1:%d/api/Nodes", port);
+        for( pass = 0 ; pass < 2; pass++)
+        {
+            bool useHttp2 = pass == 1;
+            MI_Uint32 newConnections = 0;
+            MI_Boolean offeredHttp2 = MI_FALSE;
+            MI_Result r;
+
+            // Each pass starts without a cached connection.
+            NitsGetTrap(h, CATraps, _CATest_PullSession_Cleanup)();
+            if( !NitsAssert(WritePullSessionConf(confPath, useHttp2), MI_T("Failed to write the pull session dsc.conf")))
+            {
+                break;
+            }
+            r = NitsGetTrap(h, CATraps, _CATest_PullSession_Probe)(confPath, url, TEST_PULL_SESSION_REQUESTS,
+                                                                  &newConnections, &offeredHttp2, &extendedError);
+            if( NitsCompare(r, MI_RESULT_OK, MI_T("Pull requests to the stand-in failed")))
+            {
+                NitsCompare(newConnections, 1, useHttp2 ? MI_T("Pull requests with UseHttp2=true did not share one connection")
+                                                         : MI_T("Pull requests with UseHttp2=false did not share one connection"));
+                NitsAssert(offeredHttp2 == (useHttp2 ? MI_TRUE : MI_FALSE), MI_T("UseHttp2 from dsc.conf was not applied"));
+            }
+            if( extendedError != NULL)
+            {
+                MI_Instance_Delete(extendedError);
+                extendedError = NULL;
+            }
+        }
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+    }
+    NitsGetTrap(h, CATraps, _CATest_PullSession_Cleanup)();
+
+    unlink(confPath);
+    unlink(certPath);
+    unlink(keyPath);
+    rmdir(workDir);
+NitsEndTest
+#endif
+
@@ -20,6 +20,7 @@
 #include <pal/file.h>
 #include <pal/format.h>
 #include <pal/strings.h>
+#include <pal/alloc.h>
 #include <PAL_Extension.h>
 #include <EngineHelperInternal.h>
 
@@ -27,6 +28,12 @@
 #include <CAEngine.h>
 #include <MSFT_DSCMetaConfiguration.h>
 #include <lcm.traps.h>
+#ifndef _MSC_VER
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#endif
 // #include <EtwWaiter.h>
 
 enum methodNames
@@ -123,6 +130,7 @@ using namespace std;
     #define CONFIGURATION_CURRENT_CHECKSUM CONFIG_SYSCONFDIR MI_T("/dsc/configuration/Current.mof.checksum") 
     #define CONFIGURATION_PREVIOUS CONFIG_SYSCONFDIR MI_T("/dsc/configuration/Previous.mof")
     #define METACONFIG_LOCATION_MOF CONFIG_SYSCONFDIR MI_T("/dsc/configuration/MetaConfig.mof")
+    #define CONFIGURATION_ENGINECACHE CONFIG_SYSCONFDIR MI_T("/dsc/configuration/DSCEngineCache.mof")
     #define DSCCORE_LIB CONFIG_LIBDIR MI_T("/libdsccore.so")
     #define CRONTAB MI_T("/etc/crontab")
     #define CRONTABBAK MI_T("/etc/crontab.bak")
@@ -1194,6 +1202,314 @@ NitsDRTCommonTest1(TestSendConfiguration_SaveToPendingOnly, InitLCM, PtrVal)
 
 NitsEndTest
 
+#ifndef _MSC_VER
+// The status cache is replaced by rename, so whenever the LCM dies it leaves a whole
+// file behind: the one from before the interrupted write or the one after it.
+static MI_Boolean IsCompleteEngineCache(_In_z_ const MI_Char *path)
+{
+    MI_Uint8 *content = NULL;
+    MI_Uint32 length = 0;
+    MI_Boolean complete = MI_FALSE;
+
+    if (ReadTestFile(path, &content, &length) != MI_RESULT_OK || content == NULL)
+    {
+        return MI_FALSE;
+    }
+
+    while (length > 0 && (content[length - 1] == '\n' || content[length - 1] == '\r' || content[length - 1] == ' '))
+    {
+        length--;
+    }
+
+    if (length > 2 && content[length - 2] == '}' && content[length - 1] == ';' &&
+        memmem(content, length, "DSC_InternalStateCache", sizeof("DSC_InternalStateCache") - 1) != NULL)
+    {
+        complete = MI_TRUE;
+    }
+
+    free(content);
+    return complete;
+}
+
+NitsDRTCommonTest1(TestEngineCacheSurvivesKillBetweenWrites, InitLCM, PtrVal)
+    MI_Instance *cimErrorDetails = NULL;
+    MI_Char *cachePath = NULL;
+    MI_Uint32 lcmStatus = LCM_STATUSCODE_READY;
+    NitsTrapHandle h = NitsContext()->_InitLCM->_Ptr->ptr;
+    MI_Result miResult;
+    int round;
+
+    miResult = NitsGetTrap(h, LCMTraps, _LCMTest_ExpandPath)(CONFIGURATION_ENGINECACHE, &cachePath, &cimErrorDetails);
+    if (!NitsAssert(miResult == MI_RESULT_OK && cachePath != NULL, MI_T("expand engine cache path failed")))
+    {
+        if (cimErrorDetails != NULL)
+        {
+            MI_Instance_Delete(cimErrorDetails);
+        }
+        NitsReturn;
+    }
+
+    // Leaving the busy state writes the cache; this is the state every kill must preserve or replace.
+    miResult = NitsGetTrap(h, LCMTraps, _LCMTEST_UpdateCurrentStatus)(NULL, NULL, &lcmStatus, NULL, &cimErrorDetails);
+    NitsCompare(miResult, MI_RESULT_OK, MI_T("UpdateCurrentStatus failed"));
+    NitsAssert(IsCompleteEngineCache(cachePath), MI_T("engine cache was not written"));
+
+    for (round = 0; round < 20; round++)
+    {
+        pid_t child = fork();
+        if (!NitsAssert(child >= 0, MI_T("fork failed")))
+        {
+            break;
+        }
+
+        if (child == 0)
+        {
+            MI_Boolean compliant = MI_FALSE;
+            for (;;)
+            {
+                MI_Instance *childError = NULL;
+                compliant = compliant ? MI_FALSE : MI_TRUE;
+                lcmStatus = LCM_STATUSCODE_BUSY;
+                NitsGetTrap(h, LCMTraps, _LCMTEST_UpdateCurrentStatus)(&compliant, NULL, &lcmStatus, NULL, &childError);
+                lcmStatus = LCM_STATUSCODE_READY;
+                NitsGetTrap(h, LCMTraps, _LCMTEST_UpdateCurrentStatus)(NULL, NULL, &lcmStatus, NULL, &childError);
+            }
+        }
+
+        // Stagger the kills so they land at different points of the write cycle.
+        usleep(500 + round * 750);
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+
+        NitsAssert(IsCompleteEngineCache(cachePath), MI_T("engine cache is torn after the writer was killed"));
+    }
+
+    PAL_Free(cachePath);
+    if (cimErrorDetails != NULL)
+    {
+        MI_Instance_Delete(cimErrorDetails);
+    }
+NitsEndTest
+
+typedef struct _ConcurrentGetMeta
+{
+    NitsTrapHandle h;
+    pthread_barrier_t started;
+    pthread_barrier_t release;
+    MI_Result result;
+    MI_Char jobId[JOB_UUID_LENGTH];
+} ConcurrentGetMeta;
+
+static void *RunConcurrentGetMeta(void *param)
+{
+    ConcurrentGetMeta *getMeta = (ConcurrentGetMeta*)param;
+    MI_Instance *cimErrorDetails = NULL;
+
+    getMeta->result = NitsGetTrap(getMeta->h, LCMTraps, _LCMTEST_BeginLcmOperation)(MSFT_DSCLocalConfigManager_GetMetaConfiguration, &cimErrorDetails);
+    NitsGetTrap(getMeta->h, LCMTraps, _LCMTEST_GetJobId)(getMeta->jobId, JOB_UUID_LENGTH / sizeof(MI_Char));
+    pthread_barrier_wait(&getMeta->started);
+    pthread_barrier_wait(&getMeta->release);
+
+    if (getMeta->result == MI_RESULT_OK)
+    {
+        NitsGetTrap(getMeta->h, LCMTraps, _LCMTEST_EndLcmOperation)(MSFT_DSCLocalConfigManager_GetMetaConfiguration);
+    }
+    if (cimErrorDetails != NULL)
+    {
+        MI_Instance_Delete(cimErrorDetails);
+    }
+    return NULL;
+}
+
+// Two GetMetaConfiguration operations run at once: the LCM stays busy and keeps one job id until the last one ends.
+// GetConfiguration is not read-only, so it cannot start while they run.
+NitsDRTCommonTest1(TestConcurrentGetMetaConfigurationStatus, InitLCM, PtrVal)
+    NitsTrapHandle h = NitsContext()->_InitLCM->_Ptr->ptr;
+    ConcurrentGetMeta getMetas[2];
+    pthread_t threads[2];
+    MI_Instance *cimErrorDetails = NULL;
+    MI_Boolean complianceStatus;
+    MI_Uint32 getActionStatusCode;
+    MI_Uint32 lcmStatus;
+    MI_Char jobId[JOB_UUID_LENGTH];
+    MI_Result miResult;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        memset(&getMetas[i], 0, sizeof(getMetas[i]));
+        getMetas[i].h = h;
+        pthread_barrier_init(&getMetas[i].started, NULL, 2);
+        pthread_barrier_init(&getMetas[i].release, NULL, 2);
+        pthread_create(&threads[i], NULL, RunConcurrentGetMeta, &getMetas[i]);
+        pthread_barrier_wait(&getMetas[i].started);
+    }
+
+    NitsCompare(getMetas[0].result, MI_RESULT_OK, MI_T("first GetMetaConfiguration failed to start"));
+    NitsCompare(getMetas[1].result, MI_RESULT_OK, MI_T("second GetMetaConfiguration was not allowed to run alongside the first"));
+    NitsAssert(Tcscmp(getMetas[0].jobId, getMetas[1].jobId) == 0, MI_T("concurrent GetMetaConfiguration operations have different job ids"));
+
+    miResult = NitsGetTrap(h, LCMTraps, _LCMTEST_BeginLcmOperation)(MSFT_DSCLocalConfigManager_GetConfiguration, &cimErrorDetails);
+    NitsAssert(miResult != MI_RESULT_OK, MI_T("GetConfiguration started alongside GetMetaConfiguration"));
+    if (miResult == MI_RESULT_OK)
+    {
+        NitsGetTrap(h, LCMTraps, _LCMTEST_EndLcmOperation)(MSFT_DSCLocalConfigManager_GetConfiguration);
+    }
+    if (cimErrorDetails != NULL)
+    {
+        MI_Instance_Delete(cimErrorDetails);
+    }
+
+    NitsGetTrap(h, LCMTraps, _LCMTEST_GetLatestStatus)(&complianceStatus, &getActionStatusCode, &lcmStatus);
+    NitsCompare(lcmStatus, LCM_STATUSCODE_BUSY, MI_T("LCM is not busy while two GetMetaConfiguration operations run"));
+
+    // The first operation ends; the second still runs.
+    pthread_barrier_wait(&getMetas[0].release);
+    pthread_join(threads[0], NULL);
+
+    NitsGetTrap(h, LCMTraps, _LCMTEST_GetLatestStatus)(&complianceStatus, &getActionStatusCode, &lcmStatus);
+    NitsCompare(lcmStatus, LCM_STATUSCODE_BUSY, MI_T("LCM went ready while a GetMetaConfiguration operation still runs"));
+    NitsAssert(NitsGetTrap(h, LCMTraps, _LCMTEST_GetJobId)(jobId, JOB_UUID_LENGTH / sizeof(MI_Char)), MI_T("job id was reset while a GetMetaConfiguration operation still runs"));
+    NitsAssert(Tcscmp(jobId, getMetas[1].jobId) == 0, MI_T("job id changed while a GetMetaConfiguration operation still runs"));
+
+    pthread_barrier_wait(&getMetas[1].release);
+    pthread_join(threads[1], NULL);
+
+    NitsGetTrap(h, LCMTraps, _LCMTEST_GetLatestStatus)(&complianceStatus, &getActionStatusCode, &lcmStatus);
+    NitsCompare(lcmStatus, LCM_STATUSCODE_READY, MI_T("LCM is not ready after the last GetMetaConfiguration operation ended"));
+    NitsAssert(!NitsGetTrap(h, LCMTraps, _LCMTEST_GetJobId)(jobId, JOB_UUID_LENGTH / sizeof(MI_Char)), MI_T("job id was not reset after the last GetMetaConfiguration operation ended"));
+
+    for (i = 0; i < 2; i++)
+    {
+        pthread_barrier_destroy(&getMetas[i].started);
+        pthread_barrier_destroy(&getMetas[i].release);
+    }
+NitsEndTest
+
+typedef struct _OverlappingInvoke
+{
+    const MI_Char *methodName;
+    MI_Uint8 *configurationData;
+    MI_Uint32 configurationSize;
+    pthread_barrier_t *start;
+    MI_Result invokeResult;
+    MI_Result resultCode;
+} OverlappingInvoke;
+
+// Invokes an LCM method through OMI; no Nits asserts here since it runs on its own thread.
+static void *RunOverlappingInvoke(void *param)
+{
+    OverlappingInvoke *invoke = (OverlappingInvoke*)param;
+    MI_Application application = MI_APPLICATION_NULL;
+    MI_Session session = MI_SESSION_NULL;
+    MI_Operation operation = MI_OPERATION_NULL;
+    MI_Instance *parameter = NULL;
+    MI_Value value;
+    const MI_Instance *result;
+    const MI_Instance *extendedInfo;
+    MI_Boolean moreResults;
+    const MI_Char *errorMessage;
+
+    invoke->invokeResult = MI_RESULT_FAILED;
+    invoke->resultCode = MI_RESULT_FAILED;
+
+    if (MI_Application_Initialize(0, NULL, NULL, &application) != MI_RESULT_OK)
+    {
+        pthread_barrier_wait(invoke->start);
+        return NULL;
+    }
+
+    if (MI_Application_NewInstance(&application, MI_T("__Parameter"), NULL, &parameter) == MI_RESULT_OK)
+    {
+        if (invoke->configurationData != NULL)
+        {
+            value.uint8a.data = invoke->configurationData;
+            value.uint8a.size = invoke->configurationSize;
+            MI_Instance_AddElement(parameter, MI_T("ConfigurationData"), &value, MI_UINT8A, 0);
+        }
+
+        if (MI_Application_NewSession(&application, NULL, NULL, NULL, NULL, NULL, &session) == MI_RESULT_OK)
+        {
+            pthread_barrier_wait(invoke->start);
+            MI_Session_Invoke(&session, 0, 0, LCM_PRO_NAMESPACE, LCM_CLASSNAME, invoke->methodName, NULL, parameter, NULL, &operation);
+            invoke->invokeResult = MI_Operation_GetInstance(&operation, &result, &moreResults, &invoke->resultCode, &errorMessage, &extendedInfo);
+            MI_Operation_Close(&operation);
+            MI_Session_Close(&session, NULL, NULL);
+        }
+        else
+        {
+            pthread_barrier_wait(invoke->start);
+        }
+        MI_Instance_Delete(parameter);
+    }
+    else
+    {
+        pthread_barrier_wait(invoke->start);
+    }
+
+    MI_Application_Close(&application);
+    return NULL;
+}
+
+// Two GetConfiguration calls and a TestConfiguration call overlap through the engine. Each must
+// get the result it gets when it runs alone, since the task queue runs them one at a time.
+NitsDRTTest1(TestOverlappingGetAndTestConfiguration, InitLCMWithoutHandler, PtrVal)
+    OverlappingInvoke invokes[3];
+    pthread_t threads[3];
+    pthread_barrier_t start;
+    MI_Uint8 *pbuffer = NULL;
+    MI_Uint32 size = 0;
+    MI_Result aloneTestResult;
+    int i;
+
+    if (!NitsCompare(ReadTestFile(TEST_CONFIG_FILE, &pbuffer, &size), S_OK, MI_T("ReadTestFile Failed.")))
+    {
+        NitsReturn;
+    }
+
+    // Baseline: TestConfiguration on its own.
+    memset(&invokes[0], 0, sizeof(invokes[0]));
+    invokes[0].methodName = MI_T("TestConfiguration");
+    invokes[0].start = &start;
+    pthread_barrier_init(&start, NULL, 1);
+    RunOverlappingInvoke(&invokes[0]);
+    pthread_barrier_destroy(&start);
+    NitsCompare(invokes[0].invokeResult, MI_RESULT_OK, MI_T("TestConfiguration alone did not complete"));
+    aloneTestResult = invokes[0].resultCode;
+
+    pthread_barrier_init(&start, NULL, 3);
+    for (i = 0; i < 3; i++)
+    {
+        memset(&invokes[i], 0, sizeof(invokes[i]));
+        invokes[i].start = &start;
+        if (i < 2)
+        {
+            invokes[i].methodName = MI_T("GetConfiguration");
+            invokes[i].configurationData = pbuffer;
+            invokes[i].configurationSize = size;
+        }
+        else
+        {
+            invokes[i].methodName = MI_T("TestConfiguration");
+        }
+        pthread_create(&threads[i], NULL, RunOverlappingInvoke, &invokes[i]);
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        pthread_join(threads[i], NULL);
+        NitsCompare(invokes[i].invokeResult, MI_RESULT_OK, MI_T("overlapping invoke did not complete"));
+    }
+    pthread_barrier_destroy(&start);
+
+    NitsCompare(invokes[0].resultCode, MI_RESULT_OK, MI_T("first overlapping GetConfiguration failed"));
+    NitsCompare(invokes[1].resultCode, MI_RESULT_OK, MI_T("second overlapping GetConfiguration failed"));
+    NitsCompare(invokes[2].resultCode, aloneTestResult, MI_T("overlapping TestConfiguration result differs from running it alone"));
+
+    free(pbuffer);
+NitsEndTest
+#endif
+
 void MI_CALL TestWriteMessage(
     _In_     MI_Operation *operation,
     _In_opt_ void *callbackContext, 
@@ -36,6 +36,8 @@ using namespace std;
     #define FMT MI_T("%S\\%S")
 #else
     #include <unistd.h>
+    #include <time.h>
+    #include <sys/resource.h>
     #define _GetCurrentDir getcwd
     #define TEST_DOCUMENT_LOCATION MI_T("dsc/tests/Engine/ModuleLoader/testModuleLoader2.mof")
     #define FMT MI_T("%s/%s")
@@ -445,3 +447,240 @@ NitsDRTCommonTest1(TestBaseConfigSchema, InitCA, PtrVal)
 
 NitsEndTest
 
+#ifndef _MSC_VER
+//==============================================================================
+//
+// Overlapping schema scans only drop modules that no later scan has seen.
+//
+//==============================================================================
+
+#define SCHEMACACHE_TEST_CORE 0x5C4E3A11ULL
+#define SCHEMACACHE_TEST_MODULE_X MI_T("/SchemaCacheTest/ModuleX")
+#define SCHEMACACHE_TEST_MODULE_Y MI_T("/SchemaCacheTest/ModuleY")
+
+NitsDRTCommonTest1(TestSchemaCacheOverlappingScans, InitCA, PtrVal)
+
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_ClassA noClasses = {0};
+    MI_Uint64 first = 0;
+    MI_Uint64 second = 0;
+    MI_Uint64 third = 0;
+    MI_Uint64 fourth = 0;
+
+    // Both scans run at once, the second one also finds a module installed meanwhile.
+    first = NitsGetTrap(h, CATraps, _CATest_SchemaCache_BeginScan)(SCHEMACACHE_TEST_CORE);
+    second = NitsGetTrap(h, CATraps, _CATest_SchemaCache_BeginScan)(SCHEMACACHE_TEST_CORE);
+    NitsAssert(first != 0 && second != 0 && first != second, MI_T("Scans must get distinct ids"));
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_SetModuleClasses)(first, SCHEMACACHE_TEST_MODULE_X, 1, &noClasses, 0);
+    NitsAssert(NitsGetTrap(h, CATraps, _CATest_SchemaCache_GetModuleClasses)(second, SCHEMACACHE_TEST_MODULE_X, 1, &noClasses),
+               MI_T("Module cached by a concurrent scan was not found"));
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_SetModuleClasses)(second, SCHEMACACHE_TEST_MODULE_Y, 2, &noClasses, 0);
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_EndScan)(second, MI_TRUE);
+
+    // The first scan ends after a third one started and must not evict what the second one saw.
+    third = NitsGetTrap(h, CATraps, _CATest_SchemaCache_BeginScan)(SCHEMACACHE_TEST_CORE);
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_EndScan)(first, MI_TRUE);
+    NitsAssert(NitsGetTrap(h, CATraps, _CATest_SchemaCache_GetModuleClasses)(third, SCHEMACACHE_TEST_MODULE_X, 1, &noClasses),
+               MI_T("Module seen by both scans was evicted"));
+    NitsAssert(NitsGetTrap(h, CATraps, _CATest_SchemaCache_GetModuleClasses)(third, SCHEMACACHE_TEST_MODULE_Y, 2, &noClasses),
+               MI_T("Module seen by a later scan was evicted by an earlier one"));
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_EndScan)(third, MI_TRUE);
+
+    // A complete scan that no longer finds a module still drops it.
+    fourth = NitsGetTrap(h, CATraps, _CATest_SchemaCache_BeginScan)(SCHEMACACHE_TEST_CORE);
+    NitsAssert(NitsGetTrap(h, CATraps, _CATest_SchemaCache_GetModuleClasses)(fourth, SCHEMACACHE_TEST_MODULE_X, 1, &noClasses),
+               MI_T("Module X is no longer cached"));
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_EndScan)(fourth, MI_TRUE);
+    fourth = NitsGetTrap(h, CATraps, _CATest_SchemaCache_BeginScan)(SCHEMACACHE_TEST_CORE);
+    NitsAssert(!NitsGetTrap(h, CATraps, _CATest_SchemaCache_GetModuleClasses)(fourth, SCHEMACACHE_TEST_MODULE_Y, 2, &noClasses),
+               MI_T("Module missing from a complete scan was kept"));
+    NitsGetTrap(h, CATraps, _CATest_SchemaCache_EndScan)(fourth, MI_FALSE);
+
+NitsEndTest
+
+//==============================================================================
+//
+// Class name lookups as the number of installed module classes grows.
+//
+//==============================================================================
+
+#define CLASSINDEX_LOOKUP_ROUNDS 1000
+#define CLASSINDEX_NAME_SIZE 32
+
+NitsDRTCommonTest1(TestClassIndexScaling, InitCA, PtrVal)
+
+    MI_Instance *extendedError = NULL;
+    MI_Uint32 sizes[] = { 10, 100, 1000 };
+    MI_Uint32 sizeIndex = 0;
+    MI_Uint32 xCount = 0;
+    MI_Uint32 round = 0;
+    ModuleManager *moduleManager = NULL;
+    ModuleLoaderObject *moduleLoader = NULL;
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_InitializeModuleManager)(0, &extendedError, &moduleManager);
+
+    if(NitsCompare(r, MI_RESULT_OK, MI_T("InitializeModuleManager failed")) &&
+       NitsAssert(moduleManager != NULL, MI_T("ModuleManager is NULL")) &&
+       NitsAssert(moduleManager->ft != NULL, MI_T("ModuleManager function table is null")) )
+    {
+        NitsCompare( NitsGetTrap(h, CATraps, _CATest_Update)(moduleManager, &extendedError), MI_RESULT_OK, MI_T("Update API Failed"));
+        moduleLoader = (ModuleLoaderObject*)moduleManager->reserved2;
+        for( sizeIndex = 0 ; moduleLoader != NULL && sizeIndex < sizeof(sizes)/sizeof(sizes[0]); sizeIndex++)
+        {
+            MI_ClassA *classes = NULL;
+            ClassIndex *classIndex = NULL;
+            MI_Uint32 length = 0;
+            MI_Uint32 mismatches = 0;
+            char *mof = (char*) malloc(sizes[sizeIndex] * 64);
+            MI_Char *names = (MI_Char*) malloc(sizes[sizeIndex] * CLASSINDEX_NAME_SIZE * sizeof(MI_Char));
+            struct timespec start, end;
+            long long elapsed = 0;
+            MI_Char message[256];
+
+            if( !NitsAssert(mof != NULL && names != NULL, MI_T("Out of memory")))
+            {
+                free(mof);
+                free(names);
+                break;
+            }
+            // Each generated class stands in for one installed module; look them up in a different case.
+            for( xCount = 0 ; xCount < sizes[sizeIndex]; xCount++)
+            {
+                length += sprintf(mof + length, "class Bench_Class%u\n{\n    string Name;\n};\n", xCount);
+                Stprintf(names + xCount * CLASSINDEX_NAME_SIZE, CLASSINDEX_NAME_SIZE, MI_T("BENCH_CLASS%u"), xCount);
+            }
+
+            r = MI_Deserializer_DeserializeClassArray(moduleLoader->deserializer, 0, moduleLoader->options, 0, (MI_Uint8*)mof, length,
+                                                      NULL, NULL, NULL, NULL, &classes, &extendedError);
+            if( NitsCompare(r, MI_RESULT_OK, MI_T("Failed to deserialize generated classes")) &&
+                NitsCompare(classes->size, sizes[sizeIndex], MI_T("Unexpected number of generated classes")) &&
+                NitsCompare(NitsGetTrap(h, CATraps, _CATest_ClassIndex_New)(classes->data, classes->size, &classIndex), MI_RESULT_OK, MI_T("ClassIndex_New failed")))
+            {
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                for( round = 0 ; round < CLASSINDEX_LOOKUP_ROUNDS; round++)
+                {
+                    for( xCount = 0 ; xCount < sizes[sizeIndex]; xCount++)
+                    {
+                        if( NitsGetTrap(h, CATraps, _CATest_ClassIndex_Find)(classIndex, names + xCount * CLASSINDEX_NAME_SIZE) != xCount)
+                        {
+                            mismatches++;
+                        }
+                    }
+                }
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                NitsCompare(mismatches, 0, MI_T("ClassIndex_Find returned the wrong class"));
+                NitsCompare(NitsGetTrap(h, CATraps, _CATest_ClassIndex_Find)(classIndex, MI_T("Bench_Missing")), (MI_Uint32)-1, MI_T("ClassIndex_Find found a missing class"));
+
+                elapsed = (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec);
+                Stprintf(message, 256, MI_T("ClassIndex: %u classes, %ld ns per lookup"), sizes[sizeIndex],
+                         (long)(elapsed / ((long long)CLASSINDEX_LOOKUP_ROUNDS * sizes[sizeIndex])));
+                NitsTrace(message);
+            }
+            NitsGetTrap(h, CATraps, _CATest_ClassIndex_Delete)(classIndex);
+            if( classes != NULL)
+            {
+                MI_Deserializer_ReleaseClassArray(classes);
+            }
+            free(mof);
+            free(names);
+        }
+        NitsCompare(NitsGetTrap(h, CATraps, _CATest_Close)(moduleManager, &extendedError), MI_RESULT_OK, MI_T("ModuleManager Close Failed"));
+    }
+    if( extendedError != NULL)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+
+NitsEndTest
+
+//==============================================================================
+//
+// MOF parser cost as the number of aliased instances in a document grows.
+//
+//==============================================================================
+
+#define MOFPARSER_BENCH_CLASS "class Bench_Instance\n{\n    string Name;\n};\n"
+#define MOFPARSER_BENCH_INSTANCE_SIZE 80
+// The DRT run stops at 10000 instances; setting this in the environment runs the sizes up to 1000000 as well.
+#define MOFPARSER_BENCH_FULL_ENV "DSC_TEST_BENCHMARK"
+#define MOFPARSER_BENCH_DRT_SIZES 3
+
+NitsDRTCommonTest1(TestMofParserScaling, InitCA, PtrVal)
+
+    MI_Instance *extendedError = NULL;
+    MI_Uint32 sizes[] = { 100, 1000, 10000, 100000, 1000000 };
+    MI_Uint32 sizeCount = getenv(MOFPARSER_BENCH_FULL_ENV) != NULL ? sizeof(sizes)/sizeof(sizes[0]) : MOFPARSER_BENCH_DRT_SIZES;
+    MI_Uint32 sizeIndex = 0;
+    MI_Uint32 xCount = 0;
+    ModuleManager *moduleManager = NULL;
+    ModuleLoaderObject *moduleLoader = NULL;
+    MI_ClassA *classes = NULL;
+    NitsTrapHandle h = NitsContext()->_InitCA->_Ptr->ptr;
+    MI_Result r = NitsGetTrap(h, CATraps, _CATest_InitializeModuleManager)(0, &extendedError, &moduleManager);
+
+    if(NitsCompare(r, MI_RESULT_OK, MI_T("InitializeModuleManager failed")) &&
+       NitsAssert(moduleManager != NULL, MI_T("ModuleManager is NULL")) &&
+       NitsAssert(moduleManager->ft != NULL, MI_T("ModuleManager function table is null")) )
+    {
+        NitsCompare( NitsGetTrap(h, CATraps, _CATest_Update)(moduleManager, &extendedError), MI_RESULT_OK, MI_T("Update API Failed"));
+        moduleLoader = (ModuleLoaderObject*)moduleManager->reserved2;
+        if( moduleLoader != NULL)
+        {
+            r = MI_Deserializer_DeserializeClassArray(moduleLoader->deserializer, 0, moduleLoader->options, 0, (MI_Uint8*)MOFPARSER_BENCH_CLASS, sizeof(MOFPARSER_BENCH_CLASS) - 1,
+                                                      NULL, NULL, NULL, NULL, &classes, &extendedError);
+            NitsCompare(r, MI_RESULT_OK, MI_T("Failed to deserialize benchmark class"));
+        }
+        for( sizeIndex = 0 ; classes != NULL && sizeIndex < sizeCount; sizeIndex++)
+        {
+            MI_InstanceA *instances = NULL;
+            MI_Uint32 length = 0;
+            char *mof = (char*) malloc((size_t)sizes[sizeIndex] * MOFPARSER_BENCH_INSTANCE_SIZE);
+            struct timespec start, end;
+            struct rusage usageBefore, usageAfter;
+            MI_Char message[256];
+
+            if( !NitsAssert(mof != NULL, MI_T("Out of memory")))
+            {
+                break;
+            }
+            for( xCount = 0 ; xCount < sizes[sizeIndex]; xCount++)
+            {
+                length += sprintf(mof + length, "instance of Bench_Instance as $I%u\n{\n    Name = \"%u\";\n};\n", xCount, xCount);
+            }
+
+            // Peak RSS only grows, sizes are increasing so the growth is what this size needed.
+            getrusage(RUSAGE_SELF, &usageBefore);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            r = MI_Deserializer_DeserializeInstanceArray(moduleLoader->deserializer, 0, moduleLoader->options, 0, (MI_Uint8*)mof, length,
+                                                         classes, NULL, &instances, &extendedError);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            getrusage(RUSAGE_SELF, &usageAfter);
+
+            if( NitsCompare(r, MI_RESULT_OK, MI_T("Failed to deserialize generated instances")) &&
+                NitsCompare(instances->size, sizes[sizeIndex], MI_T("Unexpected number of generated instances")))
+            {
+                Stprintf(message, 256, MI_T("MofParser: %u instances in %ld ms, peak RSS %ld KB (grew by %ld KB)"), sizes[sizeIndex],
+                         (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000),
+                         (long)usageAfter.ru_maxrss, (long)(usageAfter.ru_maxrss - usageBefore.ru_maxrss));
+                NitsTrace(message);
+            }
+            if( instances != NULL)
+            {
+                MI_Deserializer_ReleaseInstanceArray(instances);
+            }
+            free(mof);
+        }
+        if( classes != NULL)
+        {
+            MI_Deserializer_ReleaseClassArray(classes);
+        }
+        NitsCompare(NitsGetTrap(h, CATraps, _CATest_Close)(moduleManager, &extendedError), MI_RESULT_OK, MI_T("ModuleManager Close Failed"));
+    }
+    if( extendedError != NULL)
+    {
+        MI_Instance_Delete(extendedError);
+    }
+
+NitsEndTest
+#endif
@@ -7,7 +7,7 @@ import time
 import datetime
 import os
 import os.path
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from imp            import load_source
 from os.path        import dirname, isfile, join, realpath
 from fcntl          import flock, LOCK_EX, LOCK_UN, LOCK_NB
@@ -81,7 +81,7 @@ if use_omsconfig_host:
                 sleep(60)
 
         if dschostlock_acquired:
-            p = subprocess.Popen(parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            p = start_dsc_host(parameters)
             stdout, stderr = p.communicate()
             print(stdout)
         else:
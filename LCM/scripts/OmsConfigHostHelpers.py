@@ -5,6 +5,10 @@ import datetime
 import os
 import math
 import signal
+import socket
+import struct
+import subprocess
+import sys
 
 def write_omsconfig_host_telemetry(message, pathToCurrentScript='', level = 'INFO'):
     omsagent_telemetry_path = '/var/opt/microsoft/omsconfig/status'
@@ -109,3 +113,63 @@ def stop_old_host_instances(dsc_host_lock_path):
             write_omsconfig_host_log('Killed dsc_host with pid = ' + str(last_host_pid) + ' since it was taking longer than 3 hours.', 'stop_old_host_instances', 'WARNING')
         except:
             pass
+
+dsc_host_socket_path = '/opt/dsc/dsc_host.sock'
+
+class DscHostServiceResult(object):
+    """Result of an operation run by 'dsc_host --serve'. Offers the parts of Popen the scripts use."""
+    def __init__(self, returncode, stdout):
+        self.returncode = returncode
+        self.stdout = stdout
+
+    def communicate(self):
+        return self.stdout, ''
+
+    def wait(self):
+        return self.returncode
+
+def recv_dsc_host_frame(sock, length):
+    data = b''
+    while len(data) < length:
+        chunk = sock.recv(length - len(data))
+        if not chunk:
+            raise socket.error('dsc_host service closed the connection')
+        data += chunk
+    return data
+
+def start_dsc_host(parameters, dsc_host_lock_held = True):
+    """Runs the dsc_host command line in parameters.
+
+    When a dsc_host service is listening on dsc_host_socket_path the operation is sent to it
+    instead of starting a new process. Returns a Popen object, or a finished DscHostServiceResult.
+    """
+    sock = None
+    if os.path.exists(dsc_host_socket_path):
+        try:
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            sock.connect(dsc_host_socket_path)
+        except socket.error:
+            sock.close()
+            sock = None
+
+    if sock is None:
+        return subprocess.Popen(parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    # The request is sent from here on, so failures are reported rather than retried with a new process.
+    try:
+        request = {}
+        request['operation'] = parameters[2]
+        request['outputPath'] = parameters[1]
+        request['arguments'] = parameters[3:]
+        request['lockHeld'] = dsc_host_lock_held
+        payload = json.dumps(request).encode('utf-8')
+        sock.sendall(struct.pack('>I', len(payload)) + payload)
+
+        length = struct.unpack('>I', recv_dsc_host_frame(sock, 4))[0]
+        response = json.loads(recv_dsc_host_frame(sock, length).decode('utf-8'))
+        return DscHostServiceResult(int(response['exitCode']), response['output'])
+    except (socket.error, ValueError, KeyError):
+        write_omsconfig_host_log('dsc_host service request failed: ' + str(sys.exc_info()[1]), 'start_dsc_host', 'ERROR')
+        return DscHostServiceResult(1, '')
+    finally:
+        sock.close()
@@ -6,7 +6,7 @@ from subprocess import PIPE, Popen
 from sys        import exc_info, exit, version_info, argv
 from traceback  import format_exc
 from fcntl      import flock, LOCK_EX, LOCK_UN, LOCK_NB
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time       import sleep
 
 pathToCurrentScript = realpath(__file__)
@@ -97,7 +97,7 @@ def run_perform_required_configuration_checks():
                     stop_old_host_instances(dsc_host_lock_path)
                 
             if dschostlock_acquired:
-                p = Popen(parameters, stdout=PIPE, stderr=PIPE)
+                p = start_dsc_host(parameters)
                 stdout, stderr = p.communicate()
                 print(stdout)
             else:
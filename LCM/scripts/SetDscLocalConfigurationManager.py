@@ -5,7 +5,7 @@ from subprocess           import PIPE, Popen
 from sys                  import argv, exc_info, exit, version_info
 from traceback            import format_exc
 from fcntl                import flock, LOCK_EX, LOCK_UN, LOCK_NB
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time                 import sleep
 import signal
 import sys
@@ -132,7 +132,7 @@ def apply_meta_config(args):
                         sleep(60)
 
                 if dschostlock_acquired:
-                    proc = Popen(parameters, stdout=PIPE, stderr=PIPE)
+                    proc = start_dsc_host(parameters)
                     exit_code = proc.wait()
                     stdout, stderr = proc.communicate()
                     print(stdout)
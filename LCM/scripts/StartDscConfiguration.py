@@ -6,7 +6,7 @@ from sys                  import argv
 from imp                  import load_source
 from os.path              import dirname, isfile, join, realpath
 from fcntl                import flock, LOCK_EX, LOCK_UN, LOCK_NB
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time                 import sleep
 import sys
 
@@ -194,7 +194,7 @@ def main(argv):
                     sleep(60)
 
             if dschostlock_acquired:
-                p = subprocess.Popen(host_parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                p = start_dsc_host(host_parameters)
                 stdout, stderr = p.communicate()
                 print(stdout)
             else:
@@ -2,7 +2,7 @@
 import fileinput
 import sys
 import subprocess
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from imp                  import load_source
 from os.path              import dirname, isfile, join, realpath
 from time                 import sleep
@@ -76,7 +76,7 @@ if use_omsconfig_host:
                     sleep(60)
 
             if dschostlock_acquired:
-                p = subprocess.Popen(parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+                p = start_dsc_host(parameters)
                 stdout, stderr = p.communicate()
                 exit_code = p.wait()
                 print(stdout)
@@ -7,7 +7,7 @@ import time
 import datetime
 import os
 import os.path
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 import warnings
 with warnings.catch_warnings():
     warnings.filterwarnings("ignore",category=DeprecationWarning)
@@ -83,7 +83,7 @@ if use_omsconfig_host:
                 sleep(60)
 
         if dschostlock_acquired:
-            p = subprocess.Popen(parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            p = start_dsc_host(parameters)
             stdout, stderr = p.communicate()
             stdout = stdout.decode() if isinstance(stdout, bytes) else stdout
             print(stdout)
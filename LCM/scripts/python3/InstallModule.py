@@ -31,6 +31,7 @@ except:
 def usage():
     print("Usage:")
     print("  InstallModule.py NAME_VERSION.zip [VERIFY_FLAG]")
+    print("  InstallModule.py --batch STATUS_FILE [VERIFY_FLAG] < ZIP_PATHS")
     sys.exit(1)
 
 def exitWithError(message, errorCode = 1):
@@ -90,19 +91,96 @@ def main(args):
     '''
 
     # Parameter validation
+    if len(args) >= 2 and args[0] == '--batch':
+        if len(args) > 3:
+            usage()
+
+        if len(args) == 3:
+            verifyChecksum = args[2] in ['1', 'True']
+        else:
+            verifyChecksum = False
+
+        installModuleBatch(args[1], verifyChecksum)
+        return
+
     if len(args) != 1 and len(args) != 2:
         usage()
 
     moduleZipFilePath = args[0]
 
-    if not os.path.isfile(moduleZipFilePath):
-        exitWithError("The provided module zip file path (" + moduleZipFilePath + ") does not point to an existing, accessible file.")
-
     if len(args) == 2:
         verifyChecksum = args[1] in ['1', 'True']
     else:
         verifyChecksum = False
 
+    installModule(moduleZipFilePath, verifyChecksum)
+
+    # Regenerate the DSC Python scripts init files
+    regenerateDscPythonScriptInitFiles()
+
+def installModuleBatch(statusFilePath, verifyChecksum):
+    '''
+    Installs every module zip file whose path is read from stdin, one per line.
+    A failed module does not stop the remaining ones from being installed.
+    A "<exit code> <zip path>" line is written to the status file for each module,
+    and the DSC init files are regenerated once for the whole batch.
+    '''
+    results = []
+    try:
+        # readline rather than iterating stdin, which reads ahead and waits for a full buffer
+        for line in iter(sys.stdin.readline, ''):
+            moduleZipFilePath = line.strip()
+            if not moduleZipFilePath:
+                continue
+
+            results.append([installModuleBatchEntry(moduleZipFilePath, verifyChecksum), moduleZipFilePath])
+
+        if [result for result in results if result[0] == 0]:
+            if installModuleBatchEntry(None, verifyChecksum) != 0:
+                for result in results:
+                    if result[0] == 0:
+                        result[0] = 1
+    finally:
+        # Whatever happened, report the modules handled so far
+        statusFileHandle = open(statusFilePath, "w")
+        try:
+            for result in results:
+                statusFileHandle.write(str(result[0]) + " " + result[1] + "\n")
+        finally:
+            statusFileHandle.close()
+
+    if [result for result in results if result[0] != 0]:
+        sys.exit(1)
+
+def installModuleBatchEntry(moduleZipFilePath, verifyChecksum):
+    '''
+    Installs one module of a batch, or regenerates the DSC init files when moduleZipFilePath is None.
+    Returns the exit code instead of exiting.
+    '''
+    try:
+        if moduleZipFilePath is None:
+            regenerateDscPythonScriptInitFiles()
+        else:
+            installModule(moduleZipFilePath, verifyChecksum)
+    except SystemExit:
+        code = sys.exc_info()[1].code
+        if isinstance(code, int) and code != 0:
+            return code
+        return 1
+    except KeyboardInterrupt:
+        raise
+    except Exception:
+        print("ERROR from InstallModule.py: " + str(moduleZipFilePath) + ": " + repr(sys.exc_info()[1]))
+        return 1
+    return 0
+
+def installModule(moduleZipFilePath, verifyChecksum):
+    '''
+    Installs a single module zip file. The caller regenerates the DSC init files.
+    '''
+    if not os.path.isfile(moduleZipFilePath):
+        exitWithError("The provided module zip file path (" + moduleZipFilePath + ") does not point to an existing, accessible file.")
+
     moduleZipFileName = os.path.basename(moduleZipFilePath)
     indexOfLastUnderScoreInModuleZipFileName = moduleZipFileName.rfind("_")
 
@@ -362,8 +440,6 @@ def main(args):
         else:
             exitWithError("Permissions on file: " + resourceOmiRegistrationFileDestinationPath + " set incorrectly: " + filePermission)
 
-    # Regenerate the DSC Python scripts init files
-    regenerateDscPythonScriptInitFiles()
 
 if __name__ == "__main__":
     main(sys.argv[1:])
\ No newline at end of file
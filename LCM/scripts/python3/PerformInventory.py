@@ -4,14 +4,13 @@ import warnings
 with warnings.catch_warnings():
     warnings.filterwarnings("ignore",category=DeprecationWarning)
     from imp        import load_source
-from os                   import listdir, system
+from os                   import close, fsync, listdir, open as os_open, rename, system, O_RDONLY
 from os.path              import dirname, isfile, join, realpath
-from shutil               import move
 from subprocess           import Popen, PIPE
 from sys                  import argv, exc_info, exit, stdout, version_info
 from traceback            import format_exc
-from xml.dom.minidom      import parse
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from xml.dom              import pulldom
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time                 import sleep
 
 pathToCurrentScript = realpath(__file__)
@@ -66,6 +65,16 @@ def main(args):
         write_omsconfig_host_log('Python exception raised from PerformInventory.py: ' + formattedExceptionMessage, pathToCurrentScript, 'ERROR')
         raise
 
+def replace_report(temp_report_path, report_path):
+    # Readers of the report only ever see the old or the new one, and the rename
+    # itself is on disk once the directory has been synced
+    rename(temp_report_path, report_path)
+    dirfd = os_open(dirname(realpath(report_path)), O_RDONLY)
+    try:
+        fsync(dirfd)
+    finally:
+        close(dirfd)
+
 def perform_inventory(args):
     Variables = dict()
 
@@ -126,7 +135,6 @@ def perform_inventory(args):
     dsc_host_lock_path = join(dsc_host_base_path, 'dsc_host_lock')
     dsc_host_switch_path = join(dsc_host_base_path, 'dsc_host_ready')
     dsc_configuration_path = join(dsc_sysconfdir, 'configuration')
-    temp_report_path = join(dsc_configuration_path, 'Inventory.xml.temp')
     report_path = join(dsc_configuration_path, 'Inventory.xml')
     inventorylock_path = join(dsc_sysconfdir, 'inventory_lock')
 
@@ -141,6 +149,9 @@ def perform_inventory(args):
     if "outxml" in Variables:
         report_path = Variables["outxml"]
 
+    # Next to the report, so the rename that publishes it stays on one file system
+    temp_report_path = report_path + '.temp'
+
     parameters = []
 
     if use_omsconfig_host:
@@ -216,9 +227,9 @@ def perform_inventory(args):
 
             if dschostlock_acquired or (not use_omsconfig_host):
                 try:
-                    system("rm -f " + dsc_reportdir + "/*")
+                    system("rm -f " + dsc_reportdir + "/* " + dsc_reportdir + "/.??*")
 
-                    process = Popen(parameters, stdout = PIPE, stderr = PIPE)
+                    process = start_dsc_host(parameters) if use_omsconfig_host else Popen(parameters, stdout = PIPE, stderr = PIPE)
                     stdout, stderr = process.communicate()
                     retval = process.returncode
 
@@ -230,28 +241,33 @@ def perform_inventory(args):
                         write_omsconfig_host_log('dsc_host failed with code = ' + str(retval), pathToCurrentScript)
                         exit(retval)
 
-                    # Combine reports together
+                    # Combine reports together.  Each VALUE is copied to the temporary report as it is
+                    # parsed, so a large inventory is never held in memory as a whole.
                     reportFiles = listdir(dsc_reportdir)
 
-                    final_xml_report = '<INSTANCE CLASSNAME="Inventory"><PROPERTY.ARRAY NAME="Instances" TYPE="string" EmbeddedObject="object"><VALUE.ARRAY>'
-                    values = []
-                    for reportFileName in reportFiles:
-                        reportFilePath = join(dsc_reportdir, reportFileName)
-
-                        if not isfile(reportFilePath):
-                            continue
-                        report = parse(reportFilePath)
-                        for valueNode in report.getElementsByTagName('VALUE'):
-                            values.append(valueNode.toxml())
-
-                    final_xml_report = final_xml_report + "".join(values) + "</VALUE.ARRAY></PROPERTY.ARRAY></INSTANCE>"
-
                     # Ensure temporary inventory report file permission is set correctly before opening
                     operationStatusUtility.ensure_file_permissions(temp_report_path, '644')
 
                     tempReportFileHandle = open(temp_report_path, 'w')
                     try:
-                        tempReportFileHandle.write(final_xml_report)
+                        tempReportFileHandle.write('<INSTANCE CLASSNAME="Inventory"><PROPERTY.ARRAY NAME="Instances" TYPE="string" EmbeddedObject="object"><VALUE.ARRAY>')
+                        for reportFileName in reportFiles:
+                            # Providers write their report under a hidden name and rename it once it is complete
+                            if reportFileName.startswith('.'):
+                                continue
+                            reportFilePath = join(dsc_reportdir, reportFileName)
+
+                            if not isfile(reportFilePath):
+                                continue
+                            report = pulldom.parse(reportFilePath)
+                            for event, node in report:
+                                if event == pulldom.START_ELEMENT and node.tagName == 'VALUE':
+                                    report.expandNode(node)
+                                    tempReportFileHandle.write(node.toxml())
+                        tempReportFileHandle.write("</VALUE.ARRAY></PROPERTY.ARRAY></INSTANCE>")
+                        # The report replaces Inventory.xml below, make sure it is on disk first
+                        tempReportFileHandle.flush()
+                        fsync(tempReportFileHandle.fileno())
                     finally:
                         if (tempReportFileHandle):
                             tempReportFileHandle.close()
@@ -259,8 +275,8 @@ def perform_inventory(args):
                     # Ensure temporary inventory report file permission is set correctly after opening
                     operationStatusUtility.ensure_file_permissions(temp_report_path, '644')
 
-                    system("rm -f " + dsc_reportdir + "/*")
-                    move(temp_report_path, report_path)
+                    system("rm -f " + dsc_reportdir + "/* " + dsc_reportdir + "/.??*")
+                    replace_report(temp_report_path, report_path)
 
                     # Ensure inventory report file permission is set correctly
                     operationStatusUtility.ensure_file_permissions(report_path, '644')
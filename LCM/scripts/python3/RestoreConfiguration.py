@@ -8,7 +8,7 @@ with warnings.catch_warnings():
     from imp                  import load_source
 from os.path              import dirname, isfile, join, realpath
 from fcntl                import flock, LOCK_EX, LOCK_UN, LOCK_NB
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time                 import sleep
 from sys                  import argv
 
@@ -77,7 +77,7 @@ if use_omsconfig_host:
                 sleep(60)
 
         if dschostlock_acquired:
-            p = subprocess.Popen(parameters, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            p = start_dsc_host(parameters)
             stdout, stderr = p.communicate()
             stdout = stdout.decode() if isinstance(stdout, bytes) else stdout
             print(stdout)
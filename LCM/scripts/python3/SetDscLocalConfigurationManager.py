@@ -9,7 +9,7 @@ from subprocess           import PIPE, Popen
 from sys                  import argv, exc_info, exit, version_info
 from traceback            import format_exc
 from fcntl                import flock, LOCK_EX, LOCK_UN, LOCK_NB
-from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances
+from OmsConfigHostHelpers import write_omsconfig_host_telemetry, write_omsconfig_host_switch_event, write_omsconfig_host_log, stop_old_host_instances, start_dsc_host
 from time                 import sleep
 import codecs 
 
@@ -135,7 +135,7 @@ def apply_meta_config(args):
                         sleep(60)
 
                 if dschostlock_acquired:
-                    p = Popen(parameters, stdout=PIPE, stderr=PIPE)
+                    p = start_dsc_host(parameters)
                     exit_code = p.wait()
                     stdout, stderr = p.communicate()
                     stdout = stdout.decode() if isinstance(stdout, bytes) else stdout
@@ -0,0 +1,282 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "InventoryReport.hpp"
+#include "debug_tags.hpp"
+
+#include <common/common.h>
+#include <xmlserializer/xmlserializer.h>
+#include <dsc_config.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <unistd.h>
+
+
+namespace
+{
+
+
+char const REPORT_SUFFIX[] = "_XXXXXX";
+// PerformInventory.py skips hidden files, so a report is only picked up once
+// commit has renamed it.
+char const PARTIAL_PREFIX[] = ".";
+
+char const ARRAY_OPEN[] = "<VALUE.ARRAY>";
+char const ARRAY_CLOSE[] = "</VALUE.ARRAY>";
+
+
+} // namespace (unnamed)
+
+
+namespace scx
+{
+
+
+/*static*/ char const InventoryReport::DEFAULT_DIRECTORY[] =
+    DSC_ETC_PATH "/InventoryReports/";
+/*static*/ MI_Uint32 const InventoryReport::INITIAL_BUFFER_LENGTH = 1000000;
+
+
+/*ctor*/
+InventoryReport::InventoryReport (
+    char const* const resourceName,
+    char const* const directory)
+    : m_ResourceName (resourceName)
+    , m_Directory (directory)
+    , m_pFile (NULL)
+    , m_SerializerOpen (false)
+    , m_HeadWritten (false)
+{
+    memset (&m_Application, 0, sizeof (MI_Application));
+    memset (&m_Serializer, 0, sizeof (MI_Serializer));
+}
+
+
+/*dtor*/
+InventoryReport::~InventoryReport ()
+{
+    discard ();
+    if (m_SerializerOpen)
+    {
+        XmlSerializer_Close (&m_Serializer);
+        MI_Application_Close (&m_Application);
+    }
+}
+
+
+int
+InventoryReport::write (
+    MI_Instance const& chunk)
+{
+    SCX_BOOKEND ("InventoryReport::write");
+    MI_Uint32 length = 0;
+    int rval = serialize (chunk, &length);
+    if (EXIT_SUCCESS == rval && NULL == m_pFile)
+    {
+        rval = open ();
+    }
+    if (EXIT_SUCCESS == rval)
+    {
+        char const* const pBegin =
+            reinterpret_cast<char const*> (&m_Buffer[0]);
+        char const* const pEnd = pBegin + length;
+        char const* pOpen = std::search (
+            pBegin, pEnd, ARRAY_OPEN, ARRAY_OPEN + strlen (ARRAY_OPEN));
+        char const* pClose = std::find_end (
+            pBegin, pEnd, ARRAY_CLOSE, ARRAY_CLOSE + strlen (ARRAY_CLOSE));
+        if (pEnd == pOpen || pEnd == pClose || pClose < pOpen)
+        {
+            // no instances in this chunk, it can only be the whole result
+            if (!m_HeadWritten)
+            {
+                m_Tail.assign (pBegin, length);
+            }
+        }
+        else
+        {
+            pOpen += strlen (ARRAY_OPEN);
+            if (!m_HeadWritten)
+            {
+                rval = append (pBegin, pOpen - pBegin);
+                m_HeadWritten = true;
+            }
+            if (EXIT_SUCCESS == rval)
+            {
+                rval = append (pOpen, pClose - pOpen);
+            }
+            m_Tail.assign (pClose, pEnd - pClose);
+        }
+    }
+    if (EXIT_SUCCESS != rval)
+    {
+        discard ();
+    }
+    return rval;
+}
+
+
+int
+InventoryReport::commit ()
+{
+    SCX_BOOKEND ("InventoryReport::commit");
+    int rval = NULL != m_pFile ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (EXIT_SUCCESS == rval)
+    {
+        rval = append (m_Tail.c_str (), m_Tail.length ());
+    }
+    if (EXIT_SUCCESS == rval)
+    {
+        FILE* const pFile = m_pFile;
+        m_pFile = NULL;
+        if (0 != fclose (pFile))
+        {
+            std::cerr << "Error writing " << m_PartialPath << ", errno = "
+                      << errno << std::endl;
+            rval = EXIT_FAILURE;
+        }
+        else if (0 != rename (m_PartialPath.c_str (), m_Path.c_str ()))
+        {
+            std::cerr << "Error renaming " << m_PartialPath << ", errno = "
+                      << errno << std::endl;
+            rval = EXIT_FAILURE;
+        }
+        if (EXIT_SUCCESS == rval)
+        {
+            m_PartialPath.erase ();
+        }
+    }
+    if (EXIT_SUCCESS != rval)
+    {
+        discard ();
+    }
+    return rval;
+}
+
+
+int
+InventoryReport::open ()
+{
+    std::string partialPath (m_Directory);
+    partialPath.append (PARTIAL_PREFIX);
+    partialPath.append (m_ResourceName);
+    partialPath.append (REPORT_SUFFIX);
+    std::vector<char> path (partialPath.begin (), partialPath.end ());
+    path.push_back ('\0');
+    int fd = mkstemp (&path[0]);
+    if (-1 == fd)
+    {
+        std::cerr << std::endl << "Error running mkstemp, errno = " << errno
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    m_PartialPath.assign (&path[0]);
+    m_Path.assign (m_Directory);
+    m_Path.append (m_PartialPath, m_Directory.length () +
+                   strlen (PARTIAL_PREFIX), std::string::npos);
+    m_pFile = fdopen (fd, "w");
+    if (NULL == m_pFile)
+    {
+        std::cerr << std::endl
+                  << "Error opening file descriptor for reportTemplate, errno = "
+                  << errno << std::endl;
+        close (fd);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+int
+InventoryReport::serialize (
+    MI_Instance const& chunk,
+    MI_Uint32* const pLengthOut)
+{
+    if (!m_SerializerOpen)
+    {
+        if (MI_RESULT_OK != MI_Application_Initialize (
+                0, NULL, NULL, &m_Application))
+        {
+            SCX_BOOKEND_PRINT ("MI_Application_Initialize failed");
+            return EXIT_FAILURE;
+        }
+        if (MI_RESULT_OK != XmlSerializer_Create (
+                &m_Application, 0, "MI_XML", &m_Serializer))
+        {
+            SCX_BOOKEND_PRINT ("XmlSerializer_Create failed");
+            MI_Application_Close (&m_Application);
+            return EXIT_FAILURE;
+        }
+        m_SerializerOpen = true;
+        m_Buffer.resize (INITIAL_BUFFER_LENGTH);
+    }
+    // the buffer is kept between chunks and only grows when the serializer
+    // asks for more
+    MI_Uint32 needed = 0;
+    MI_Result result = XmlSerializer_SerializeInstance (
+        &m_Serializer, 0, &chunk, &m_Buffer[0],
+        static_cast<MI_Uint32> (m_Buffer.size ()), &needed);
+    if (MI_RESULT_OK != result && m_Buffer.size () < needed)
+    {
+        m_Buffer.resize (needed);
+        result = XmlSerializer_SerializeInstance (
+            &m_Serializer, 0, &chunk, &m_Buffer[0],
+            static_cast<MI_Uint32> (m_Buffer.size ()), &needed);
+    }
+    if (MI_RESULT_OK != result)
+    {
+        SCX_BOOKEND_PRINT ("XmlSerializer_SerializeInstance failed");
+        return EXIT_FAILURE;
+    }
+    *pLengthOut = needed;
+    return EXIT_SUCCESS;
+}
+
+
+int
+InventoryReport::append (
+    char const* const pData,
+    size_t const length)
+{
+    if (0 != length && length != fwrite (pData, 1, length, m_pFile))
+    {
+        std::cerr << "Error writing " << m_PartialPath << ", errno = "
+                  << errno << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+void
+InventoryReport::discard ()
+{
+    if (NULL != m_pFile)
+    {
+        fclose (m_pFile);
+        m_pFile = NULL;
+    }
+    if (!m_PartialPath.empty ())
+    {
+        unlink (m_PartialPath.c_str ());
+        m_PartialPath.erase ();
+    }
+}
+
+
+} // namespace scx
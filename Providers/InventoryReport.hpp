@@ -0,0 +1,89 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef INCLUDED_INVENTORYREPORT_HPP
+#define INCLUDED_INVENTORYREPORT_HPP
+
+
+#include "PythonProvider.hpp"
+#include "MI.h"
+
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+namespace scx
+{
+
+
+// InventoryReport writes the InventoryReports/<resource>_XXXXXX file that
+// PerformInventory.py merges into Inventory.xml.  PythonProvider::inventory
+// hands it the result one chunk at a time; each chunk is serialized on its
+// own and only the members of its __Inventory array are appended, so the
+// file matches a single serialization of the whole result while memory stays
+// bounded by the chunk size.  The file is written under a hidden name and
+// only renamed into place by commit, a report that is never committed is
+// removed.
+class InventoryReport : public PythonProvider::InventorySink
+{
+public:
+    static char const DEFAULT_DIRECTORY[];
+
+    explicit /*ctor*/ InventoryReport (
+        char const* const resourceName,
+        char const* const directory = DEFAULT_DIRECTORY);
+
+    virtual /*dtor*/ ~InventoryReport ();
+
+    virtual int write (MI_Instance const& chunk);
+
+    int commit ();
+
+    // the name of the committed report
+    std::string const& path () const { return m_Path; }
+
+private:
+    /*ctor*/ InventoryReport (InventoryReport const&); // = delete
+    InventoryReport& operator = (InventoryReport const&); // = delete
+
+    int open ();
+    int serialize (MI_Instance const& chunk, MI_Uint32* const pLengthOut);
+    int append (char const* const pData, size_t const length);
+    void discard ();
+
+    static MI_Uint32 const INITIAL_BUFFER_LENGTH;
+
+    std::string const m_ResourceName;
+    std::string const m_Directory;
+    std::string m_PartialPath;
+    std::string m_Path;
+    FILE* m_pFile;
+    bool m_SerializerOpen;
+    MI_Application m_Application;
+    MI_Serializer m_Serializer;
+    std::vector<MI_Uint8> m_Buffer;
+    // true once the text up to the first instance has been written
+    bool m_HeadWritten;
+    // the text that closes the report, taken from the last chunk
+    std::string m_Tail;
+};
+
+
+} // namespace scx
+
+
+#endif // INCLUDED_INVENTORYREPORT_HPP
@@ -0,0 +1,81 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "LatencyHistogram.hpp"
+
+
+#include <cstring>
+#include <sstream>
+
+
+namespace scx
+{
+
+
+/*static*/ unsigned int const LatencyHistogram::BUCKET_MS[] =
+    { 10, 100, 1000, 5000, 30000, 60000, 300000, 900000 };
+
+
+/*ctor*/
+LatencyHistogram::LatencyHistogram ()
+{
+    memset (m_Count, 0, sizeof (m_Count));
+}
+
+
+void
+LatencyHistogram::record (
+    long long const elapsedMs)
+{
+    size_t bucket = 0;
+    while (BUCKET_COUNT > bucket &&
+           static_cast<long long> (BUCKET_MS[bucket]) < elapsedMs)
+    {
+        ++bucket;
+    }
+    ++m_Count[bucket];
+}
+
+
+std::string
+LatencyHistogram::format (
+    std::string const& label) const
+{
+    std::ostringstream strm;
+    strm << label << " latency histogram:";
+    for (size_t n = 0; BUCKET_COUNT > n; ++n)
+    {
+        strm << " <=" << BUCKET_MS[n] << "ms:" << m_Count[n];
+    }
+    strm << " >" << BUCKET_MS[BUCKET_COUNT - 1] << "ms:"
+         << m_Count[BUCKET_COUNT];
+    return strm.str ();
+}
+
+
+MI_Result
+LatencyHistogram::write (
+    MI_Context* const pContext,
+    std::string const& label) const
+{
+    if (0 == pContext)
+    {
+        return MI_RESULT_INVALID_PARAMETER;
+    }
+    return MI_Context_WriteVerbose (pContext, format (label).c_str ());
+}
+
+
+} // namespace scx
@@ -0,0 +1,63 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef INCLUDED_LATENCYHISTOGRAM_HPP
+#define INCLUDED_LATENCYHISTOGRAM_HPP
+
+
+#include "MI.h"
+
+
+#include <string>
+
+
+namespace scx
+{
+
+
+// LatencyHistogram counts the calls of one provider operation by how long
+// they took.  PythonProvider keeps one per operation and writes it to the
+// verbose channel after every call, which DoWriteMessage copies into dsc.log,
+// so the distribution is visible without a PRINT_BOOKENDS build.
+class LatencyHistogram
+{
+public:
+    static size_t const BUCKET_COUNT = 8;
+    // the upper bound of each bucket, calls over the last one share an open
+    // ended bucket
+    static unsigned int const BUCKET_MS[BUCKET_COUNT];
+
+    /*ctor*/ LatencyHistogram ();
+
+    void record (long long const elapsedMs);
+
+    unsigned long count (size_t const bucket) const { return m_Count[bucket]; }
+
+    // "<label> latency histogram: <=10ms:n ... >900000ms:n"
+    std::string format (std::string const& label) const;
+
+    MI_Result write (
+        MI_Context* const pContext,
+        std::string const& label) const;
+
+private:
+    unsigned long m_Count[BUCKET_COUNT + 1];
+};
+
+
+} // namespace scx
+
+
+#endif // INCLUDED_LATENCYHISTOGRAM_HPP
@@ -14,8 +14,11 @@
    THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 #include "PythonProvider.hpp"
+#include "PythonWorkerPool.hpp"
 #include "debug_tags.hpp"
 
+#include <LCM/dsc/engine/EngineHelper/PythonInterpreter.h>
+
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
@@ -25,8 +28,11 @@
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <poll.h>
 #include <sstream>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
@@ -49,68 +55,46 @@ char const DEFAULT_OMI_PATH[] = "/opt/omi/";
 char const SCRIPT_PATH_EXTENSION[] = "/lib/Scripts/";
 char const DEFAULT_DSC_SCRIPT[] = "client";
 char const PY_EXTENSION[] = ".py";
-char const PYTHON3_COMMAND[] =  "python3";
 
-std::string determinePythonVersion(){
-    
-    int buffer_length = 128;
-    char buffer[buffer_length]; 
-    char* result = (char*)malloc(1);
-    if(result == NULL) {
-        return "python";
-    }
-    *result = 0; 
-
-    // Check for python3
-    FILE* pipe = popen("python3 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");
-    if(!pipe) {
-        std::cout << "Couldn't start command." << std::endl;
-    }
-
-    while(fgets(buffer, 128, pipe) != NULL) {
-        char* temp = (char*)realloc(result, (result ? strlen(result) : 0) + buffer_length );
-        
-        if(NULL == temp) {
-            free(result);
-        }
-        
-        result = temp;
-        strcat(result,buffer);
-    }
+// sanity limit for a frame announced by client.py
+size_t const MAX_FRAME_SIZE = 256 * 1024 * 1024;
 
-    // If python3 --version exists
-    if(*result != '\0' && result[0] == '3') {
-        std::cout << "Found python3." << std::endl;
-    	return "python3";
-    }
+// custom option the LCM sets from the TimeoutSec of the resource class
+// registration (DSC_PROVIDERTIMEOUTSTRING in EngineHelperInternal.h)
+char const PROVIDER_TIMEOUT_OPTION[] = "DSC_PROVIDER_TIMEOUT_SEC";
 
-    // Look for python2
-    result = (char*)malloc(1);
-    if(result == NULL) {
-        return "python";
-    }
-    *result = 0;
-    pipe = popen("python2 -V 2>&1 | grep -Po '(?<=Python )(.+)'", "r");
-    if(!pipe) {
-    	std::cout << "Couldn't start command." << std::endl;
-    }
-    while(fgets(buffer, 128, pipe) != NULL) {
-        char* temp = (char*)realloc(result, (result ? strlen(result) : 0) + buffer_length );
+char const* const OP_NAMES[] = { "Test", "Set", "Get", "Inventory" };
 
-        if(NULL == temp) {
-            free(result);
-        }
-        
-        result = temp;
-        strcat(result,buffer);
+
+long long
+monotonicMs ()
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return static_cast<long long> (now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+
+// workers lead their own process group (forkExec, client.py pool_spawn); fall
+// back to the pid alone for a worker started before that
+void
+killWorkerGroup (
+    pid_t const pid)
+{
+    if (0 != killpg (pid, SIGKILL))
+    {
+        kill (pid, SIGKILL);
     }
+}
 
-    // If python2 --version exists
-    if(*result != '\0' && result[0] == '2') {
-        std::cout << "Found python2." << std::endl;
-	    return "python2";
+std::string determinePythonVersion(){
+    // probed once per process and cached on disk across processes
+    std::string command (PythonInterpreter_GetCommand ());
+    if (command != DEFAULT_PYTHON_VERSION)
+    {
+        std::cout << "Found " << command << "." << std::endl;
     }
-    return "python";
+    return command;
 }
 
 char_array::move_type
@@ -265,6 +249,10 @@ namespace scx
 
 /*static*/ unsigned char const PythonProvider::MI_NULL_FLAG = 64;
 /*static*/ MI_Boolean PythonProvider::CHILD_SIGNAL_REGISTERED = MI_FALSE;
+// TEST, SET, GET, INVENTORY
+/*static*/ unsigned int const PythonProvider::DEFAULT_TIMEOUT_SEC[] =
+    { 300, 1800, 300, 1800 };
+/*static*/ int const PythonProvider::CANCEL_CHECK_INTERVAL_MS = 250;
 
 template<typename T>
 /*static*/ int
@@ -335,6 +323,13 @@ PythonProvider::~PythonProvider ()
         waitpid(m_PreviousPid[xCount] , NULL, WNOHANG);
     }
     m_PreviousPid.clear();
+#if (PRINT_BOOKENDS)
+    // the latency histogram of each operation, once per provider lifetime
+    for (size_t op = 0; OP_COUNT > op; ++op)
+    {
+        SCX_BOOKEND_PRINT (m_Latency[op].format (m_Name + ' ' + OP_NAMES[op]));
+    }
+#endif
 }
 
 int
@@ -358,6 +353,7 @@ PythonProvider::init ()
 MI_Result
 PythonProvider::test (
     MI_Instance const& instance,
+    MI_Context* const pContext,
     MI_Boolean* const pTestResultOut)
 {
 #if PRINT_BOOKENDS
@@ -366,6 +362,7 @@ PythonProvider::test (
     SCX_BOOKEND_EX ("PythonProvider::test", strm.str ());
 #endif
     MI_Result rval = MI_RESULT_FAILED;
+    beginCall (TEST, pContext);
     int result = sendRequest (TEST, instance);
     if (EXIT_SUCCESS == result)
     {
@@ -385,6 +382,7 @@ PythonProvider::test (
     {
         SCX_BOOKEND_PRINT ("send failed");
     }
+    endCall (TEST, rval);
     return rval;
 }
 
@@ -392,6 +390,7 @@ PythonProvider::test (
 MI_Result
 PythonProvider::set (
     MI_Instance const& instance,
+    MI_Context* const pContext,
     MI_Result* const pSetResultOut)
 {
 #if PRINT_BOOKENDS
@@ -400,6 +399,7 @@ PythonProvider::set (
     SCX_BOOKEND_EX ("PythonProvider::set", strm.str ());
 #endif
     MI_Result rval = MI_RESULT_FAILED;
+    beginCall (SET, pContext);
     int result = sendRequest (SET, instance);
     if (EXIT_SUCCESS == result)
     {
@@ -421,6 +421,7 @@ PythonProvider::set (
     {
         SCX_BOOKEND_PRINT ("send failed");
     }
+    endCall (SET, rval);
     return rval;
 }
 
@@ -452,11 +453,16 @@ PythonProvider::get (
     //         ii: output error msg
     MI_Result rval = MI_RESULT_FAILED;
     int getResult = -1;
+    beginCall (GET, pContext);
     int result = sendRequest (GET, instance);
     if (EXIT_SUCCESS == result)
     {
         SCX_BOOKEND_PRINT ("send succeeded");
-        result = recv (&getResult);
+        result = recvFrame ();
+        if (EXIT_SUCCESS == result)
+        {
+            result = recv (&getResult);
+        }
         if (EXIT_SUCCESS == result)
         {
             if (0 == getResult)
@@ -496,6 +502,7 @@ PythonProvider::get (
     {
         SCX_BOOKEND_PRINT ("send failed");
     }
+    endCall (GET, rval);
     return rval;
 }
 
@@ -504,7 +511,8 @@ MI_Result
 PythonProvider::inventory (
     MI_Instance const& instance,
     MI_Context* const pContext,
-    MI_Instance* const pInstanceOut)
+    MI_Instance* const pInstanceOut,
+    InventorySink& sink)
 {
     std::ostringstream strm;
 #if PRINT_BOOKENDS
@@ -514,31 +522,62 @@ PythonProvider::inventory (
     strm.clear ();
 #endif
     // 1: send the request
-    // 2: read (int) RESULT
-    //     A: RESULT is affirmative (0)
+    // 2: read the next frame
+    // 3: read (int) RESULT
+    //     A: RESULT is INVENTORY_CHUNK (2) or affirmative (0)
     //         i: read (int) ARG_COUNT
     //         ii: read ARG
     //         iii: read ARG_TYPE
     //         iv: read ARG_VALUE
-    //         v: add ARG to new instance
-    //         iv: goto ii
-    //     B: RESULT is negative (non-0)
+    //         v: add ARG to the instance
+    //         vi: goto ii
+    //         vii: pass the instance to sink
+    //         viii: goto 2 if RESULT was INVENTORY_CHUNK
+    //     B: RESULT is negative (other)
     //         i: read (string) error msg
     //         ii: output error msg
+    // A sink failure does not stop the reads: the remaining frames are
+    // drained so the socket stays in step with the worker.
     MI_Result rval = MI_RESULT_FAILED;
-    int inventoryResult = -1;
+    int inventoryResult = INVENTORY_CHUNK;
+    int sinkResult = EXIT_SUCCESS;
+    beginCall (INVENTORY, pContext);
     int result = sendRequest (INVENTORY, instance);
     if (EXIT_SUCCESS == result)
     {
         SCX_BOOKEND_PRINT ("send succeeded");
-        result = recv (&inventoryResult);
+    }
+    else
+    {
+        SCX_BOOKEND_PRINT ("send failed");
+    }
+    while (EXIT_SUCCESS == result && INVENTORY_CHUNK == inventoryResult)
+    {
+        result = recvFrame ();
+        if (EXIT_SUCCESS == result)
+        {
+            result = recv (&inventoryResult);
+        }
         if (EXIT_SUCCESS == result)
         {
-            if (0 == inventoryResult)
+            if (0 == inventoryResult || INVENTORY_CHUNK == inventoryResult)
             {
-                SCX_BOOKEND_PRINT ("recv'd POSITIVE");
+                SCX_BOOKEND_PRINT (0 == inventoryResult ? "recv'd POSITIVE"
+                                                        : "recv'd CHUNK");
                 result = recv (pContext, pInstanceOut);
-                rval = EXIT_SUCCESS == result ? MI_RESULT_OK : MI_RESULT_FAILED;
+                if (EXIT_SUCCESS == result && EXIT_SUCCESS == sinkResult)
+                {
+                    sinkResult = sink.write (*pInstanceOut);
+                    if (EXIT_SUCCESS != sinkResult)
+                    {
+                        SCX_BOOKEND_PRINT ("inventory sink failed");
+                    }
+                }
+                if (EXIT_SUCCESS == result && 0 == inventoryResult)
+                {
+                    rval = EXIT_SUCCESS == sinkResult ? MI_RESULT_OK
+                                                      : MI_RESULT_FAILED;
+                }
             }
             else
             {
@@ -567,10 +606,7 @@ PythonProvider::inventory (
             }
         }
     }
-    else
-    {
-        SCX_BOOKEND_PRINT ("send failed");
-    }
+    endCall (INVENTORY, rval);
     return rval;
 }
 
@@ -585,6 +621,19 @@ PythonProvider::forkExec ()
     strm.str ("");
     strm.clear ();
 #endif
+    if (INVALID_SOCKET == m_FD && PythonWorkerPool::enabled ())
+    {
+        // prefer a warm worker shared with the other resource classes
+        char_array pyV (get_python_version ());
+        char_array fullName (get_script_path ());
+        if (EXIT_SUCCESS == PythonWorkerPool::acquire (
+                pyV.get (), fullName.get (), &m_FD, &m_WorkerPid))
+        {
+            SCX_BOOKEND_PRINT ("connected to python worker pool");
+            return EXIT_SUCCESS;
+        }
+        SCX_BOOKEND_PRINT ("python worker pool unavailable - forking a client");
+    }
     if (INVALID_SOCKET == m_FD)
     {
         int sockets[2];
@@ -599,6 +648,9 @@ PythonProvider::forkExec ()
             {
                 // fork succeded, this is the child process
                 SCX_BOOKEND_PRINT ("fork - succeeded: this is the child");
+                // lead a process group of our own so terminateWorker can kill
+                // the client together with anything the resource started
+                setpgid (0, 0);
                 // close the parent socket
                 close (sockets[1]);
                 // create the argument list including the child socket name as a
@@ -632,6 +684,9 @@ PythonProvider::forkExec ()
             else if (-1 != pid)
             {
 	    	m_pid=pid;
+                m_WorkerPid = -1;
+                // also set from this side so the group exists before any call
+                setpgid (pid, pid);
                 // fork succeeded, this is the parent process
                 SCX_BOOKEND_PRINT ("fork - succeeded: this is the parent");
                 close (sockets[0]);
@@ -727,40 +782,153 @@ PythonProvider::handleSocketClosed ()
 {
     close (m_FD);
     m_FD = INVALID_SOCKET;
+    m_WorkerPid = -1;
+}
+
+
+void
+PythonProvider::beginCall (
+    unsigned char const opType,
+    MI_Context* const pContext)
+{
+    m_pCallContext = pContext;
+    m_CallStartMs = monotonicMs ();
+    m_DeadlineMs = m_CallStartMs + 1000LL * callTimeout (opType);
+}
+
+
+void
+PythonProvider::endCall (
+    unsigned char const opType,
+    MI_Result const result)
+{
+    long long const elapsedMs = monotonicMs () - m_CallStartMs;
+    m_Latency[opType].record (elapsedMs);
+
+    std::ostringstream strm;
+    strm << m_Name << ' ' << OP_NAMES[opType] << ": " << elapsedMs << " ms ("
+         << (MI_RESULT_OK == result ? "succeeded" : "failed") << ')';
+    SCX_BOOKEND_PRINT (strm.str ());
+    // the verbose channel ends up in dsc.log regardless of PRINT_BOOKENDS
+    if (0 != m_pCallContext)
+    {
+        m_Latency[opType].write (
+            m_pCallContext, m_Name + ' ' + OP_NAMES[opType]);
+    }
+    m_pCallContext = 0;
+}
+
+
+unsigned int
+PythonProvider::callTimeout (
+    unsigned char const opType) const
+{
+    if (0 != m_pCallContext)
+    {
+        MI_Type type = MI_UINT32;
+        MI_Value value;
+        if (MI_RESULT_OK == MI_Context_GetCustomOption (
+                m_pCallContext, PROVIDER_TIMEOUT_OPTION, &type, &value) &&
+            MI_UINT32 == type &&
+            0 < value.uint32)
+        {
+            return value.uint32;
+        }
+    }
+    return DEFAULT_TIMEOUT_SEC[opType];
 }
 
 
 int
-PythonProvider::send (
-    char const* const str)
+PythonProvider::waitForSocket (
+    short const events)
 {
-    //SCX_BOOKEND ("PythonProvider::send (str)");
-    ssize_t const nStrLen = (0 == str) ? 0 : strlen (str);
-    int rval = send (static_cast<int>(nStrLen));
-    ssize_t nCharsSent = 0;
-    while (EXIT_SUCCESS == rval &&
-           nStrLen > nCharsSent)
+    //SCX_BOOKEND ("PythonProvider::waitForSocket");
+    // poll in short slices so a canceled call is noticed while the worker is
+    // still busy
+    for (;;)
     {
-        ssize_t nSent = write (m_FD, str + nCharsSent, nStrLen - nCharsSent);
-        if (-1 != nSent)
+        MI_Boolean canceled = MI_FALSE;
+        if (0 != m_pCallContext &&
+            MI_RESULT_OK == MI_Context_Canceled (m_pCallContext, &canceled) &&
+            canceled)
         {
-            nCharsSent += nSent;
+            terminateWorker ("call canceled");
+            return EXIT_FAILURE;
         }
-        else if (EINTR != errno)
+        long long const remainingMs = m_DeadlineMs - monotonicMs ();
+        if (0 >= remainingMs)
+        {
+            terminateWorker ("deadline exceeded");
+            return EXIT_FAILURE;
+        }
+        struct pollfd pfd;
+        pfd.fd = m_FD;
+        pfd.events = events;
+        pfd.revents = 0;
+        int const ready = poll (&pfd, 1, static_cast<int> (
+            std::min<long long> (remainingMs, CANCEL_CHECK_INTERVAL_MS)));
+        if (0 < ready)
+        {
+            // POLLHUP and POLLERR are reported by the read or write that
+            // follows
+            return EXIT_SUCCESS;
+        }
+        else if (-1 == ready && EINTR != errno)
         {
-            // error (check errno { EACCESS, EAGAIN, EWOULDBLOCK, EBADF,
-            //                      ECONNRESET, EDESTADDRREQ, EFAULT, EINVAL,
-            //                      EISCONN, EMSGSIZE, ENOBUFS, ENOMEM,
-            //                      ENOTCONN, ENOTSOCK, EOPNOTSUPP, EPIPE })
-            handleSocketClosed ();
-            rval = EXIT_FAILURE;
             std::ostringstream strm;
-            strm << "error on socket: (" << errno << ") \"" << errnoText
-                 << '\"';
+            strm << "poll failed on socket: (" << errno << ") \""
+                 << errnoText << '\"';
             SCX_BOOKEND_PRINT (strm.str ());
             std::cerr << strm.str () << std::endl;
+            handleSocketClosed ();
+            return EXIT_FAILURE;
         }
     }
+}
+
+
+void
+PythonProvider::terminateWorker (
+    char const* const reason)
+{
+    std::ostringstream strm;
+    strm << m_Name << ": " << reason << " after "
+         << (monotonicMs () - m_CallStartMs) << " ms, killing python worker";
+    if (0 < m_pid)
+    {
+        strm << ' ' << m_pid;
+        killWorkerGroup (m_pid);
+        waitpid (m_pid, NULL, 0);
+        m_pid = -2;
+    }
+    else if (0 < m_WorkerPid)
+    {
+        // pool workers are not our children; the pool reaps and replaces them
+        strm << ' ' << m_WorkerPid;
+        killWorkerGroup (m_WorkerPid);
+    }
+    handleSocketClosed ();
+    SCX_BOOKEND_PRINT (strm.str ());
+    std::cerr << strm.str () << std::endl;
+    if (0 != m_pCallContext)
+    {
+        MI_Context_WriteWarning (m_pCallContext, strm.str ().c_str ());
+    }
+}
+
+
+int
+PythonProvider::send (
+    char const* const str)
+{
+    //SCX_BOOKEND ("PythonProvider::send (str)");
+    size_t const nStrLen = (0 == str) ? 0 : strlen (str);
+    int rval = send (static_cast<int>(nStrLen));
+    if (EXIT_SUCCESS == rval)
+    {
+        m_SendBuffer.insert (m_SendBuffer.end (), str, str + nStrLen);
+    }
     return rval;
 }
 
@@ -1072,6 +1240,8 @@ PythonProvider::sendRequest (
     //     b: (string) OP_NAME
     //     c: (int) ARG_COUNT
     // 2: write each ARG
+    // 3: send it all as one frame
+    m_SendBuffer.clear ();
     if (EXIT_SUCCESS == rval)
     {
         rval = send (opType);
@@ -1084,6 +1254,176 @@ PythonProvider::sendRequest (
     {
         rval = send (instance);
     }
+    if (EXIT_SUCCESS == rval)
+    {
+        rval = flush ();
+    }
+    m_SendBuffer.clear ();
+    return rval;
+}
+
+
+int
+PythonProvider::flush ()
+{
+    //SCX_BOOKEND ("PythonProvider::flush");
+    // the frame header and the payload go out in a single sendmsg
+    unsigned int frameSize = static_cast<unsigned int> (m_SendBuffer.size ());
+    struct iovec iov[2];
+    iov[0].iov_base = &frameSize;
+    iov[0].iov_len = sizeof (frameSize);
+    iov[1].iov_base = m_SendBuffer.empty () ? 0 : &m_SendBuffer[0];
+    iov[1].iov_len = m_SendBuffer.size ();
+    int const iovCount = 2;
+    int iovIndex = 0;
+    int rval = EXIT_SUCCESS;
+    while (EXIT_SUCCESS == rval &&
+           iovCount > iovIndex)
+    {
+        struct msghdr msg;
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_iov = iov + iovIndex;
+        msg.msg_iovlen = iovCount - iovIndex;
+        ssize_t nSent = sendmsg (m_FD, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (-1 != nSent)
+        {
+            // skip what has been written, the rest goes in the next round
+            while (iovCount > iovIndex &&
+                   static_cast<size_t> (nSent) >= iov[iovIndex].iov_len)
+            {
+                nSent -= iov[iovIndex].iov_len;
+                ++iovIndex;
+            }
+            if (iovCount > iovIndex)
+            {
+                iov[iovIndex].iov_base =
+                    static_cast<char*> (iov[iovIndex].iov_base) + nSent;
+                iov[iovIndex].iov_len -= nSent;
+            }
+        }
+        else if (EAGAIN == errno || EWOULDBLOCK == errno)
+        {
+            rval = waitForSocket (POLLOUT);
+        }
+        else if (EINTR != errno)
+        {
+            // error (check errno { EACCESS, EBADF,
+            //                      ECONNRESET, EDESTADDRREQ, EFAULT, EINVAL,
+            //                      EISCONN, EMSGSIZE, ENOBUFS, ENOMEM,
+            //                      ENOTCONN, ENOTSOCK, EOPNOTSUPP, EPIPE })
+            handleSocketClosed ();
+            rval = EXIT_FAILURE;
+            std::ostringstream strm;
+            strm << "error on socket: (" << errno << ") \"" << errnoText
+                 << '\"';
+            SCX_BOOKEND_PRINT (strm.str ());
+            std::cerr << strm.str () << std::endl;
+        }
+    }
+    return rval;
+}
+
+
+int
+PythonProvider::readFully (
+    void* const pDataOut,
+    size_t const nBytes)
+{
+    //SCX_BOOKEND ("PythonProvider::readFully");
+    int rval = EXIT_SUCCESS;
+    size_t nBytesRead = 0;
+    char* const pData = static_cast<char*> (pDataOut);
+    while (EXIT_SUCCESS == rval &&
+           nBytes > nBytesRead)
+    {
+        ssize_t nRead = ::recv (m_FD, pData + nBytesRead,
+                                nBytes - nBytesRead, MSG_DONTWAIT);
+        if (0 < nRead)
+        {
+            nBytesRead += nRead;
+        }
+        else if (-1 == nRead && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            rval = waitForSocket (POLLIN);
+        }
+        else if (0 == nRead)
+        {
+            // socket closed
+            handleSocketClosed ();
+            rval = EXIT_FAILURE;
+            SCX_BOOKEND_PRINT ("socket closed unexpectedly");
+            std::cerr << "socket closed unexpectedly" << std::endl;
+        }
+        else if (EINTR != errno)
+        {
+            // Error - check errno { EBADF, ECONNRESET, EFAULT, EINVAL,
+            //                       EIO }
+            handleSocketClosed ();
+            rval = EXIT_FAILURE;
+            std::ostringstream strm;
+            strm << "error on socket: (" << errno << ") \"" << errnoText
+                 << '\"';
+            SCX_BOOKEND_PRINT (strm.str ());
+            std::cerr << strm.str () << std::endl;
+        }
+    }
+    return rval;
+}
+
+
+int
+PythonProvider::recvFrame ()
+{
+    //SCX_BOOKEND ("PythonProvider::recvFrame");
+    unsigned int frameSize = 0;
+    m_RecvBuffer.clear ();
+    m_RecvOffset = 0;
+    int rval = readFully (&frameSize, sizeof (frameSize));
+    if (EXIT_SUCCESS == rval &&
+        MAX_FRAME_SIZE < frameSize)
+    {
+        // the stream is out of sync, start over with a fresh socket
+        handleSocketClosed ();
+        rval = EXIT_FAILURE;
+        std::ostringstream strm;
+        strm << "invalid frame size: " << frameSize;
+        SCX_BOOKEND_PRINT (strm.str ());
+        std::cerr << strm.str () << std::endl;
+    }
+    if (EXIT_SUCCESS == rval &&
+        0 < frameSize)
+    {
+        m_RecvBuffer.resize (frameSize);
+        rval = readFully (&m_RecvBuffer[0], frameSize);
+    }
+    if (EXIT_SUCCESS != rval)
+    {
+        m_RecvBuffer.clear ();
+        SCX_BOOKEND_PRINT ("unable to read frame");
+        std::cerr << "unable to read frame" << std::endl;
+    }
+    return rval;
+}
+
+
+int
+PythonProvider::recvBytes (
+    void* const pDataOut,
+    size_t const nBytes)
+{
+    //SCX_BOOKEND ("PythonProvider::recvBytes");
+    int rval = EXIT_SUCCESS;
+    if (m_RecvBuffer.size () - m_RecvOffset < nBytes)
+    {
+        rval = EXIT_FAILURE;
+        SCX_BOOKEND_PRINT ("frame is too short");
+        std::cerr << "frame is too short" << std::endl;
+    }
+    else if (0 < nBytes)
+    {
+        memcpy (pDataOut, &m_RecvBuffer[m_RecvOffset], nBytes);
+        m_RecvOffset += nBytes;
+    }
     return rval;
 }
 
@@ -1097,49 +1437,17 @@ PythonProvider::recv (
     int rval = recv (&nStrLen);
     if (EXIT_SUCCESS == rval)
     {
-        if (0 != nStrLen)
+        if (0 > nStrLen ||
+            m_RecvBuffer.size () - m_RecvOffset < static_cast<size_t> (nStrLen))
         {
-            ssize_t nCharsRead = 0;
-            char_array pBuffer (new char[nStrLen]);
-            while (EXIT_SUCCESS == rval &&
-                   nStrLen > nCharsRead)
-            {
-                ssize_t nRead = read (m_FD, pBuffer.get () + nCharsRead,
-                                      nStrLen - nCharsRead);
-                if (0 < nRead)
-                {
-                    nCharsRead += nRead;
-                }
-                else if (0 == nRead)
-                {
-                    // socket closed
-                    handleSocketClosed ();
-                    rval = EXIT_FAILURE;
-                    SCX_BOOKEND_PRINT ("socket closed unexpectedly");
-                    std::cerr << "socket closed unexpectedly" << std::endl;
-                }
-                else if (EINTR != errno)
-                {
-                    // Error - check errno { EAGAIN, EBADF, EFAULT, EINVAL, EIO,
-                    //                       EISDIR }
-                    handleSocketClosed ();
-                    rval = EXIT_FAILURE;
-                    std::ostringstream strm;
-                    strm << "error on socket: (" << errno << ") \"" << errnoText
-                         << '\"';
-                    SCX_BOOKEND_PRINT (strm.str ());
-                    std::cerr << strm.str () << std::endl;
-                }
-            }
-            if (EXIT_SUCCESS == rval)
-            {
-                pStrOut->assign (pBuffer.get (), nStrLen);
-            }
-            else
-            {
-                SCX_BOOKEND_PRINT ("unable to read string text");
-                std::cerr << "unable to read string text" << std::endl;
-            }
+            rval = EXIT_FAILURE;
+            SCX_BOOKEND_PRINT ("unable to read string text");
+            std::cerr << "unable to read string text" << std::endl;
+        }
+        else if (0 != nStrLen)
+        {
+            pStrOut->assign (&m_RecvBuffer[m_RecvOffset], nStrLen);
+            m_RecvOffset += nStrLen;
         }
         else
         {
@@ -1214,7 +1522,11 @@ PythonProvider::recvResult (
     strm.clear ();
 #endif
     int result = -1;
-    int rval = recv (&result);
+    int rval = recvFrame ();
+    if (EXIT_SUCCESS == rval)
+    {
+        rval = recv (&result);
+    }
     if (EXIT_SUCCESS == rval)
     {
         if (0 == result)
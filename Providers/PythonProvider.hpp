@@ -18,11 +18,13 @@
 
 
 #include "debug_tags.hpp"
+#include "LatencyHistogram.hpp"
 #include "MI.h"
 #include "unique_ptr.hpp"
 
 
 #include <cstdlib>
+#include <cstring>
 #include <errno.h>
 #include <iomanip>
 #include <iostream>
@@ -52,10 +54,12 @@ public:
 
     MI_Result test (
         MI_Instance const& instance,
+        MI_Context* const pContext,
         MI_Boolean* const pTestResultOut);
 
     MI_Result set (
         MI_Instance const& instance,
+        MI_Context* const pContext,
         MI_Result* const pSetResultOut);
 
     MI_Result get (
@@ -63,10 +67,23 @@ public:
         MI_Context* const pContext,
         MI_Instance* const pInstanceOut);
 
+    // receives an inventory result one chunk at a time
+    class InventorySink
+    {
+    public:
+        virtual /*dtor*/ ~InventorySink () {}
+
+        virtual int write (MI_Instance const& chunk) = 0;
+    };
+
+    // Large results arrive as a series of frames, each holding a slice of
+    // __Inventory.  Every slice is decoded into pInstanceOut, replacing the
+    // previous one, and handed to sink before the next frame is read.
     MI_Result inventory (
         MI_Instance const& instance,
         MI_Context* const pContext,
-        MI_Instance* const pInstanceOut);
+        MI_Instance* const pInstanceOut,
+        InventorySink& sink);
 
 private:
     /*ctor*/ PythonProvider (PythonProvider const&); // = delete
@@ -78,6 +95,19 @@ private:
     void handleSocketClosed ();
     static void handleChildSignal(int sig);
 
+    // Every request runs against a deadline taken from the registration of
+    // the resource class (or the per operation default).  A worker that
+    // misses it, or whose call is canceled, is killed and the socket reset.
+    void beginCall (unsigned char const opType,
+                    MI_Context* const pContext);
+    void endCall (unsigned char const opType,
+                  MI_Result const result);
+    unsigned int callTimeout (unsigned char const opType) const;
+    int waitForSocket (short const events);
+    void terminateWorker (char const* const reason);
+
+    // send appends to m_SendBuffer; flush writes the buffer out as a single
+    // length prefixed frame
     template<typename T>
     int send (T const& val);
     int send (char const* const str);
@@ -103,6 +133,17 @@ private:
     int sendRequest (unsigned char const OpType,
                      MI_Instance const& instance);
 
+    int flush ();
+
+    // recvFrame reads the next frame into m_RecvBuffer; recv decodes from it
+    int recvFrame ();
+
+    int readFully (void* const pDataOut,
+                   size_t const nBytes);
+
+    int recvBytes (void* const pDataOut,
+                   size_t const nBytes);
+
     template<typename T>
     int recv (T* const pValOut);
     int recv (std::string* const pStrOut);
@@ -146,12 +187,26 @@ private:
     static unsigned char const SET = 1;
     static unsigned char const GET = 2;
     static unsigned char const INVENTORY = 3;
+    static size_t const OP_COUNT = 4;
+    // result code of a frame holding part of an inventory result, more follow
+    static int const INVENTORY_CHUNK = 2;
     static MI_Boolean CHILD_SIGNAL_REGISTERED;
 
+    static unsigned int const DEFAULT_TIMEOUT_SEC[OP_COUNT];
+    static int const CANCEL_CHECK_INTERVAL_MS;
+
     std::string const m_Name;
     int m_FD;
     int m_pid;
+    int m_WorkerPid;
     std::vector<int> m_PreviousPid;
+    MI_Context* m_pCallContext;
+    long long m_CallStartMs;
+    long long m_DeadlineMs;
+    LatencyHistogram m_Latency[OP_COUNT];
+    std::vector<char> m_SendBuffer;
+    std::vector<char> m_RecvBuffer;
+    size_t m_RecvOffset;
 };
 
 
@@ -167,8 +222,12 @@ PythonProvider::PythonProvider (
     : m_Name (name)
     , m_FD (PythonProvider::INVALID_SOCKET)
     , m_pid(-2)
+    , m_WorkerPid (-1)
+    , m_pCallContext (0)
+    , m_CallStartMs (0)
+    , m_DeadlineMs (0)
+    , m_RecvOffset (0)
 {
-    // empty
 }
 
 
@@ -178,37 +237,9 @@ PythonProvider::send (
     T const& val)
 {
     //SCX_BOOKEND ("PythonProvider::send (template)");
-    int rval = EXIT_SUCCESS;
-    ssize_t nBytesSent = 0;
-    ssize_t const nBytes = static_cast<ssize_t> (sizeof (T));
     char const* const pData = reinterpret_cast<char const*> (&val);
-    while (EXIT_SUCCESS == rval &&
-           -1 != nBytesSent &&
-           nBytes > nBytesSent)
-    {
-        ssize_t nSent = write (m_FD, pData + nBytesSent, nBytes - nBytesSent);
-        if (-1 != nSent)
-        {
-            nBytesSent += nSent;
-        }
-        else if (EINTR != errno)
-        {
-            // error (check errno { EACCESS, EAGAIN, EWOULDBLOCK, EBADF,
-            //                      ECONNRESET, EDESTADDRREQ, EFAULT, EINVAL,
-            //                      EISCONN, EMSGSIZE, ENOBUFS, ENOMEM,
-            //                      ENOTCONN, ENOTSOCK, EOPNOTSUPP, EPIPE })
-            handleSocketClosed ();
-            rval = EXIT_FAILURE;
-            std::ostringstream strm;
-            strm << "error on socket: (" << errno << ") \"" << errnoText
-                 << '\"';
-            SCX_BOOKEND_PRINT (strm.str ());
-            std::cerr << strm.str () << std::endl;
-            strm.str ("");
-            strm.clear ();
-        }
-    }
-    return rval;
+    m_SendBuffer.insert (m_SendBuffer.end (), pData, pData + sizeof (T));
+    return EXIT_SUCCESS;
 }
 
 
@@ -243,42 +274,8 @@ PythonProvider::recv (
     T* const pValOut)
 {
     //SCX_BOOKEND ("PythonProvider::recv (template)");
-    int rval = EXIT_SUCCESS;
-    ssize_t nBytesRead = 0;
-    ssize_t const nBytes = static_cast<ssize_t> (sizeof (T));
     T temp = T ();
-    char* const pData = reinterpret_cast<char*> (&temp);
-    while (EXIT_SUCCESS == rval &&
-           nBytes > nBytesRead)
-    {
-        ssize_t nRead = read (m_FD, pData + nBytesRead, nBytes - nBytesRead);
-        if (0 < nRead)
-        {
-            nBytesRead += nRead;
-        }
-        else if (0 == nRead)
-        {
-            // socket closed
-            handleSocketClosed ();
-            rval = EXIT_FAILURE;
-            SCX_BOOKEND_PRINT ("socket closed unexpectedly");
-            std::cerr << "socket closed unexpectedly" << std::endl;
-        }
-        else if (EINTR != errno)
-        {
-            // Error - check errno { EAGAIN, EBADF, EFAULT, EINVAL, EIO,
-            //                       EISDIR }
-            handleSocketClosed ();
-            rval = EXIT_FAILURE;
-            std::ostringstream strm;
-            strm << "error on socket: (" << errno << ") \"" << errnoText
-                 << '\"';
-            SCX_BOOKEND_PRINT (strm.str ());
-            std::cerr << strm.str () << std::endl;
-            strm.str ("");
-            strm.clear ();
-        }
-    }
+    int rval = recvBytes (&temp, sizeof (T));
     if (EXIT_SUCCESS == rval)
     {
         *pValOut = temp;
@@ -0,0 +1,309 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include "PythonWorkerPool.hpp"
+#include "PythonProvider.hpp"
+#include "debug_tags.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+#ifndef PYTHON_PID_DIR
+#define PYTHON_PID_DIR "/var/opt/omi"
+#endif
+
+
+namespace
+{
+
+
+char const POOL_ENABLED_ENV[] = "DSC_PYTHON_WORKER_POOL";
+char const POOL_SIZE_ENV[] = "DSC_PYTHON_WORKER_POOL_SIZE";
+char const POOL_ARG[] = "--pool";
+char const POOL_RUN_PATH[] = PYTHON_PID_DIR "/run/python/";
+char const POOL_SOCKET_PREFIX[] = "/dsc_python_worker.";
+char const POOL_SOCKET_EXTENSION[] = ".sock";
+
+
+void
+closeInheritedDescriptors ()
+{
+    long maxFD = sysconf (_SC_OPEN_MAX);
+    if (0 > maxFD)
+    {
+        maxFD = 1024;
+    }
+    // The pool outlives this process; it must not keep its sockets or the
+    // dsc_host lock file open.
+    for (int fd = 3; fd < maxFD; ++fd)
+    {
+        close (fd);
+    }
+}
+
+
+}
+
+
+namespace scx
+{
+
+
+/*static*/ int const PythonWorkerPool::GREETING_TIMEOUT_MS = 30000;
+/*static*/ unsigned int const PythonWorkerPool::DEFAULT_POOL_SIZE = 4;
+/*static*/ unsigned long PythonWorkerPool::s_Hits = 0;
+/*static*/ unsigned long PythonWorkerPool::s_Misses = 0;
+
+
+/*static*/ bool
+PythonWorkerPool::enabled ()
+{
+    char const* const pEnv = getenv (POOL_ENABLED_ENV);
+    return 0 == pEnv || 0 != strcmp (pEnv, "0");
+}
+
+
+/*static*/ unsigned long
+PythonWorkerPool::hits ()
+{
+    return s_Hits;
+}
+
+
+/*static*/ unsigned long
+PythonWorkerPool::misses ()
+{
+    return s_Misses;
+}
+
+
+/*static*/ unsigned int
+PythonWorkerPool::poolSize ()
+{
+    char const* const pEnv = getenv (POOL_SIZE_ENV);
+    if (0 != pEnv)
+    {
+        int size = atoi (pEnv);
+        if (0 < size)
+        {
+            return static_cast<unsigned int> (size);
+        }
+    }
+    return DEFAULT_POOL_SIZE;
+}
+
+
+/*static*/ std::string
+PythonWorkerPool::socketPath (
+    std::string const& pythonVersion)
+{
+    std::ostringstream strm;
+    strm << POOL_RUN_PATH << getuid () << POOL_SOCKET_PREFIX << pythonVersion
+         << POOL_SOCKET_EXTENSION;
+    return strm.str ();
+}
+
+
+/*static*/ int
+PythonWorkerPool::acquire (
+    std::string const& pythonVersion,
+    std::string const& scriptPath,
+    int* const pFDOut,
+    int* const pWorkerPidOut)
+{
+    SCX_BOOKEND ("PythonWorkerPool::acquire");
+    std::string const path (socketPath (pythonVersion));
+    int workerPid = -1;
+    int rval = connectWorker (path, pFDOut, &workerPid);
+    if (EXIT_SUCCESS == rval)
+    {
+        ++s_Hits;
+    }
+    else
+    {
+        ++s_Misses;
+        rval = launch (pythonVersion, scriptPath, path);
+        if (EXIT_SUCCESS == rval)
+        {
+            rval = connectWorker (path, pFDOut, &workerPid);
+        }
+    }
+    std::ostringstream strm;
+    if (EXIT_SUCCESS == rval)
+    {
+        *pWorkerPidOut = workerPid;
+        strm << "python worker pool: using worker " << workerPid;
+    }
+    else
+    {
+        strm << "python worker pool: no worker available at " << path;
+    }
+    strm << " (hits: " << s_Hits << ", misses: " << s_Misses << ')';
+    SCX_BOOKEND_PRINT (strm.str ());
+    return rval;
+}
+
+
+/*static*/ int
+PythonWorkerPool::connectWorker (
+    std::string const& path,
+    int* const pFDOut,
+    int* const pWorkerPidOut)
+{
+    struct sockaddr_un addr;
+    if (sizeof (addr.sun_path) <= path.length ())
+    {
+        SCX_BOOKEND_PRINT ("worker pool socket path is too long");
+        return EXIT_FAILURE;
+    }
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy (addr.sun_path, path.c_str ());
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (-1 == fd)
+    {
+        std::ostringstream strm;
+        strm << "PythonWorkerPool - socket failed: " << errno << ": \""
+             << errnoText << '\"';
+        SCX_BOOKEND_PRINT (strm.str ());
+        return EXIT_FAILURE;
+    }
+    fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+    int result = -1;
+    do
+    {
+        result = connect (fd, reinterpret_cast<struct sockaddr*> (&addr),
+                          sizeof (addr));
+    } while (-1 == result && EINTR == errno);
+    if (-1 == result)
+    {
+        // ENOENT or ECONNREFUSED: no pool is running for this interpreter
+        close (fd);
+        return EXIT_FAILURE;
+    }
+
+    // A worker greets each connection with its pid once it has accepted it.
+    // A pool that is retiring (its scripts changed) closes without a
+    // greeting, which is treated as a miss.
+    int workerPid = 0;
+    size_t nRead = 0;
+    char* const pData = reinterpret_cast<char*> (&workerPid);
+    while (sizeof (workerPid) > nRead)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll (&pfd, 1, GREETING_TIMEOUT_MS);
+        if (-1 == ready && EINTR == errno)
+        {
+            continue;
+        }
+        ssize_t n = (1 == ready)
+            ? read (fd, pData + nRead, sizeof (workerPid) - nRead) : -1;
+        if (0 < n)
+        {
+            nRead += n;
+        }
+        else if (-1 == n && EINTR == errno)
+        {
+            continue;
+        }
+        else
+        {
+            SCX_BOOKEND_PRINT ("worker pool did not greet the connection");
+            close (fd);
+            return EXIT_FAILURE;
+        }
+    }
+    *pFDOut = fd;
+    *pWorkerPidOut = workerPid;
+    return EXIT_SUCCESS;
+}
+
+
+/*static*/ int
+PythonWorkerPool::launch (
+    std::string const& pythonVersion,
+    std::string const& scriptPath,
+    std::string const& path)
+{
+    SCX_BOOKEND ("PythonWorkerPool::launch");
+    std::ostringstream strm;
+    strm << poolSize ();
+    std::string const size (strm.str ());
+    strm.str ("");
+    strm.clear ();
+
+    pid_t pid = fork ();
+    if (0 == pid)
+    {
+        closeInheritedDescriptors ();
+        char* args[] = {
+            const_cast<char*> (pythonVersion.c_str ()),
+            const_cast<char*> (scriptPath.c_str ()),
+            const_cast<char*> (POOL_ARG),
+            const_cast<char*> (path.c_str ()),
+            const_cast<char*> (size.c_str ()),
+            0 };
+        execvp (args[0], args);
+        _exit (EXIT_FAILURE);
+    }
+    else if (-1 == pid)
+    {
+        strm << "PythonWorkerPool::launch - fork failed: " << errno << ": \""
+             << errnoText << '\"';
+        SCX_BOOKEND_PRINT (strm.str ());
+        std::cerr << strm.str () << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The launcher exits once the pool socket is listening (or once it has
+    // found another pool already listening).  A process-wide SIGCHLD handler
+    // may reap it first, in which case waitpid reports ECHILD.
+    int status = 0;
+    pid_t result = -1;
+    do
+    {
+        result = waitpid (pid, &status, 0);
+    } while (-1 == result && EINTR == errno);
+    if (pid == result &&
+        (!WIFEXITED (status) || EXIT_SUCCESS != WEXITSTATUS (status)))
+    {
+        strm << "PythonWorkerPool::launch - pool launcher failed with status: "
+             << status;
+        SCX_BOOKEND_PRINT (strm.str ());
+        std::cerr << strm.str () << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+} // namespace scx
@@ -0,0 +1,80 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef INCLUDED_PYTHONWORKERPOOL_HPP
+#define INCLUDED_PYTHONWORKERPOOL_HPP
+
+
+#include <string>
+
+
+namespace scx
+{
+
+
+// PythonWorkerPool hands out connections to long-lived, pre-warmed client.py
+// workers.  The pool is a client.py process running in "--pool" mode that
+// imports the provider scripts once, forks a bounded number of workers and
+// listens on a per-uid Unix socket named after the python version.  Every
+// resource class and every dsc_host invocation that uses the same interpreter
+// connects to the same pool, so the interpreter start-up and the imports of
+// Scripts/ are paid once instead of once per resource class per run.
+class PythonWorkerPool
+{
+public:
+    static bool enabled ();
+
+    // Connects to a warm worker for pythonVersion, launching the pool on a
+    // miss.  On success *pFDOut is a connected socket that speaks the same
+    // protocol as the socketpair created by PythonProvider::forkExec and
+    // *pWorkerPidOut is the pid of the worker serving it.
+    static int acquire (
+        std::string const& pythonVersion,
+        std::string const& scriptPath,
+        int* const pFDOut,
+        int* const pWorkerPidOut);
+
+    static unsigned long hits ();
+    static unsigned long misses ();
+
+private:
+    /*ctor*/ PythonWorkerPool (); // = delete
+
+    static std::string socketPath (std::string const& pythonVersion);
+
+    static int connectWorker (
+        std::string const& path,
+        int* const pFDOut,
+        int* const pWorkerPidOut);
+
+    static int launch (
+        std::string const& pythonVersion,
+        std::string const& scriptPath,
+        std::string const& path);
+
+    static unsigned int poolSize ();
+
+    static int const GREETING_TIMEOUT_MS;
+    static unsigned int const DEFAULT_POOL_SIZE;
+
+    static unsigned long s_Hits;
+    static unsigned long s_Misses;
+};
+
+
+} // namespace scx
+
+
+#endif // INCLUDED_PYTHONWORKERPOOL_HPP
@@ -13,6 +13,7 @@ import time
 import imp
 protocol = imp.load_source('protocol', '../protocol.py')
 nxDSCLog = imp.load_source('nxDSCLog', '../nxDSCLog.py')
+filehashcache = imp.load_source('filehashcache', '../filehashcache.py')
 helperlib = imp.load_source('helperlib', '../helperlib.py')
 
 LG = nxDSCLog.DSCLog
@@ -374,8 +375,8 @@ def CopyFile(spath, dpath):
 def CompareFiles(DestinationPath, SourcePath, Checksum):
     """
     If the files differ in size, return -1.
-    Reading and computing the hash here is done in a block-by-block manner,
-    in case the file is quite large.
+    md5 digests come from filehashcache, so a file unchanged since it was
+    last hashed is not read again.
     """
     if SourcePath == DestinationPath:  # Files are the same!
         return 0
@@ -384,36 +385,23 @@ def CompareFiles(DestinationPath, SourcePath, Checksum):
     if stat_src.st_size != stat_dest.st_size:
         return -1
     if Checksum == "md5":
-        src_error = None
-        dest_error = None
-        src_hash = md5const()
-        dest_hash = md5const()
-        src_block = 'loopme'
-        dest_block = 'loopme'
-        src_file,src_error = opened_bin_w_error(SourcePath, 'rb')
-        if src_error:
+        try:
+            src_digest = filehashcache.GetFileDigest(SourcePath, md5const)
+        except (IOError, OSError):
+            src_error = sys.exc_info()[1]
             Print("Exception opening source file " + SourcePath + " Error : " + str(src_error), file=sys.stderr)
             LG().Log('ERROR', "Exception opening source file " + SourcePath + " Error : " + str(src_error))
             return -1
-        dest_file, dest_error = opened_bin_w_error(DestinationPath, 'rb')
-        if dest_error:
+        try:
+            dest_digest = filehashcache.GetFileDigest(DestinationPath, md5const)
+        except (IOError, OSError):
+            dest_error = sys.exc_info()[1]
             Print("Exception opening destination file " + DestinationPath + " Error : " + str(dest_error), file=sys.stderr)
             LG().Log('ERROR', "Exception opening destination file " + DestinationPath + " Error : " + str(dest_error))
-            src_file.close()
             return -1
-        while src_block != '' or dest_block != '':
-            src_block = src_file.read(BLOCK_SIZE)
-            dest_block = dest_file.read(BLOCK_SIZE)
-            src_hash.update(src_block)
-            dest_hash.update(dest_block)
-            if src_hash.hexdigest() != dest_hash.hexdigest():
-                src_file.close()
-                dest_file.close()
-                return -1  
-        if src_hash.hexdigest() == dest_hash.hexdigest():
-            src_file.close()
-            dest_file.close()
-            return 0  
+        if src_digest != dest_digest:
+            return -1
+        return 0
     elif Checksum == "ctime":
         if stat_src.st_ctime != stat_dest.st_ctime:
             return -1
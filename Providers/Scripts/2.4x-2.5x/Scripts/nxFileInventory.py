@@ -15,6 +15,7 @@ import copy
 import imp
 protocol = imp.load_source('protocol', '../protocol.py')
 nxDSCLog = imp.load_source('nxDSCLog', '../nxDSCLog.py')
+filehashcache = imp.load_source('filehashcache', '../filehashcache.py')
 LG = nxDSCLog.DSCLog
 try:
     import hashlib
@@ -107,11 +108,22 @@ def Inventory_Marshall(DestinationPath, Recurse, Links, Checksum, Type, MaxConte
     DestinationPath, Recurse, Links, Checksum, Type, MaxContentsReturnable, MaxOutputSize, UseSudo \
                      = init_locals(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsReturnable, MaxOutputSize, UseSudo)
     retval = 0
+    _Inventory = protocol.MI_InstanceStream(lambda: MarshallInventory(
+        DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsReturnable, MaxOutputSize, UseSudo),
+        MaxContentsReturnable, MaxOutputSize))
+    retd = {}
+    retd["__Inventory"] = _Inventory
+    return retval, retd
+
+
+def MarshallInventory(Inventory, MaxContentsReturnable, MaxOutputSize):
+    """
+    Yields the entries of Inventory in protocol form until the
+    estimated size of the report reaches MaxOutputSize.
+    """
     out_size_cur = 158 # xml output header + footer length.
     xml_overhead_array_element = 99 # xml output overhead per Inventory array entry.
     xml_overhead_param = 102 # xml output overhead per Inventory parameter.
-    _Inventory = []
-    Inventory = DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsReturnable, MaxOutputSize, UseSudo)
     for d in Inventory:
         if out_size_cur <  MaxOutputSize:
             out_size_cur += xml_overhead_array_element
@@ -133,15 +145,13 @@ def Inventory_Marshall(DestinationPath, Recurse, Links, Checksum, Type, MaxConte
         d['Group'] = protocol.MI_String(d['Group'])
         d['Owner'] = protocol.MI_String(d['Owner'])
         d['FileSize'] = protocol.MI_Uint64(d['FileSize'])
-        _Inventory.append(d)
-    _Inventory = protocol.MI_InstanceA(_Inventory)
-    retd = {}
-    retd["__Inventory"] = _Inventory
-    return retval, retd
+        yield d
 
 
 def DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsReturnable, MaxOutputSize, UseSudo):
-    Inventory = []
+    """
+    Generates the info dictionary of each file or directory that matches.
+    """
     full_path = DestinationPath.split('/')
     if full_path[-1] == '':
         full_path[-1] = '*'
@@ -158,15 +168,15 @@ def DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsRetu
     if not os.path.exists(top):
         print("Error: Unable to read 'DestinationPath': " + DestinationPath)
         LG().Log("ERROR","Unable to read 'DestinationPath': " + DestinationPath)
-        return Inventory
+        return
     if not wildcard_path:
         if Links == 'ignore' and os.path.islink(top):
-            return Inventory
+            return
         if Type != 'directory' and os.path.isfile(top): # This is s single file.
             d = GetFileInfo(top, Links, MaxContentsReturnable, Checksum)
             if 'DestinationPath' in d.keys():
-                Inventory.append(copy.deepcopy(d))
-            return Inventory
+                yield d
+            return
         if '*' not in full_path[-1] and '?' not in full_path[-1]:
             full_path.append('*') # It is a directory without the trailing '/', so add it.
     dirs = set()
@@ -190,7 +200,7 @@ def DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsRetu
                     d = GetFileInfo(os.path.join(dirpath, filename),\
                                     Links, MaxContentsReturnable, Checksum)
                     if 'DestinationPath' in d.keys():
-                        Inventory.append(copy.deepcopy(d))
+                        yield d
         for dirname in dirnames:
             if not ( Recurse and dlen+1 >= full_path_len ):
                 if ( do_wildcard and not fnmatch.fnmatch(dirname, full_path[dlen]) ) or \
@@ -205,9 +215,8 @@ def DoInventory(DestinationPath, Recurse, Links, Checksum, Type, MaxContentsRetu
             if Type != 'file' and ( dlen+1 == full_path_len  or  ( Recurse and dlen >= full_path_len ) ) :
                 d = GetDirInfo(os.path.join(dirpath, dirname), st, Checksum, Links)
                 if 'DestinationPath' in d.keys():
-                    Inventory.append(copy.deepcopy(d))
+                    yield d
         dirnames[:] = scandirs
-    return Inventory
 
 
 def GetFileInfo(fname, Links, MaxContentsReturnable, Checksum):
@@ -366,19 +375,14 @@ def StatFile(path):
     return d
 
 def GetChecksum(fname, Checksum):
-    src_error = None
-    src_block = 'loopme'
     if Checksum == "md5":
-        src_hash = md5const()
+        hash_factory = md5const
     else : # sha-256
-        src_hash = shaconst()
-    src_file, src_error = opened_bin_w_error(fname, 'rb')
-    if src_error:
+        hash_factory = shaconst
+    try:
+        return filehashcache.GetFileDigest(fname, hash_factory)
+    except (IOError, OSError):
         return ""
-    while src_block :
-        src_block = src_file.read(8192)
-        src_hash.update(src_block)
-    return src_hash.hexdigest()
 
 # From python2.7 os.py
 def walk(top, topdown=True, onerror=None, followlinks=False):
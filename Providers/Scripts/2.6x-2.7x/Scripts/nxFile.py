@@ -19,6 +19,7 @@ import time
 import imp
 protocol = imp.load_source('protocol', '../protocol.py')
 nxDSCLog = imp.load_source('nxDSCLog', '../nxDSCLog.py')
+filehashcache = imp.load_source('filehashcache', '../filehashcache.py')
 helperlib = imp.load_source('helperlib', '../helperlib.py')
 
 LG = nxDSCLog.DSCLog
@@ -382,8 +383,8 @@ def CopyFile(spath, dpath):
 def CompareFiles(DestinationPath, SourcePath, Checksum):
     """
     If the files differ in size, return -1.
-    Reading and computing the hash here is done in a block-by-block manner,
-    in case the file is quite large.
+    md5 digests come from filehashcache, so a file unchanged since it was
+    last hashed is not read again.
     """
     if SourcePath == DestinationPath:  # Files are the same!
         return 0
@@ -392,35 +393,25 @@ def CompareFiles(DestinationPath, SourcePath, Checksum):
     if stat_src.st_size != stat_dest.st_size:
         return -1
     if Checksum == "md5":
-        src_error = None
-        dest_error = None
-        src_hash = md5const()
-        dest_hash = md5const()
-        src_block = b'loopme'
-        dest_block = b'loopme'
-        with opened_bin_w_error(SourcePath, 'rb') as (src_file, src_error):
-            if src_error:
-                print("Exception opening source file " + SourcePath + " Error Code: " + str(src_error.errno) +
-                      " Error: " + src_error.message + src_error.strerror, file=sys.stderr)
-                LG().Log('ERROR', "Exception opening source file " + SourcePath + " Error Code: " + str(src_error.errno) +
-                        " Error: " + src_error.message + src_error.strerror)
-                return -1
-            with opened_bin_w_error(DestinationPath, 'rb') as (dest_file, dest_error):
-                if dest_error:
-                    print("Exception opening destination file " + DestinationPath + " Error Code: " + str(dest_error.errno) +
-                          " Error: " + dest_error.message + dest_error.strerror, file=sys.stderr)
-                    LG().Log('ERROR', "Exception opening destination file " + DestinationPath + " Error Code: " + str(dest_error.errno) +
-                          " Error: " + dest_error.message + dest_error.strerror)
-                    return -1
-                while src_block or dest_block :
-                    src_block = src_file.read(BLOCK_SIZE)
-                    dest_block = dest_file.read(BLOCK_SIZE)
-                    src_hash.update(src_block)
-                    dest_hash.update(dest_block)
-                    if src_hash.hexdigest() != dest_hash.hexdigest():
-                        return -1
-        if src_hash.hexdigest() == dest_hash.hexdigest():
-            return 0
+        try:
+            src_digest = filehashcache.GetFileDigest(SourcePath, md5const)
+        except (IOError, OSError) as src_error:
+            print("Exception opening source file " + SourcePath + " Error Code: " + str(src_error.errno) +
+                  " Error: " + src_error.message + src_error.strerror, file=sys.stderr)
+            LG().Log('ERROR', "Exception opening source file " + SourcePath + " Error Code: " + str(src_error.errno) +
+                    " Error: " + src_error.message + src_error.strerror)
+            return -1
+        try:
+            dest_digest = filehashcache.GetFileDigest(DestinationPath, md5const)
+        except (IOError, OSError) as dest_error:
+            print("Exception opening destination file " + DestinationPath + " Error Code: " + str(dest_error.errno) +
+                  " Error: " + dest_error.message + dest_error.strerror, file=sys.stderr)
+            LG().Log('ERROR', "Exception opening destination file " + DestinationPath + " Error Code: " + str(dest_error.errno) +
+                    " Error: " + dest_error.message + dest_error.strerror)
+            return -1
+        if src_digest != dest_digest:
+            return -1
+        return 0
     elif Checksum == "ctime":
         if stat_src.st_ctime != stat_dest.st_ctime:
             return -1
@@ -56,6 +56,18 @@ cache_file_dir = '/var/opt/microsoft/dsc/cache/nxPackage'
 global show_mof
 show_mof = False
 
+# Package database snapshot shared by every nxPackage resource a worker serves.
+# One stat_all query answers the per-resource stat queries until a Set
+# installs or removes something, the package database changes on disk, or
+# the snapshot is older than snapshot_max_age seconds.
+snapshot_max_age = 120
+package_db_system = {'apt': 'dpkg', 'yum': 'rpm', 'zypper': 'rpm'}
+package_db_paths = {'dpkg': ('/var/lib/dpkg/status',),
+                    'rpm': ('/var/lib/rpm/Packages', '/var/lib/rpm/rpmdb.sqlite',
+                            '/usr/lib/sysimage/rpm/rpmdb.sqlite')}
+package_tools = {}
+package_snapshots = {}
+
 
 def init_vars(Ensure, PackageManager, Name, FilePath, PackageGroup, Arguments, ReturnCode):
     if Ensure is not None and Ensure != '':
@@ -184,16 +196,21 @@ def Inventory_Marshall(Ensure, PackageManager, Name, FilePath, PackageGroup, Arg
 
 
 def GetPackageSystem():
+    if 'system' in package_tools:
+        return package_tools['system']
     ret = None
     for b in ('dpkg', 'rpm'):
         code, out = RunGetOutput('which ' + b, False, False)
         if code is 0:
             ret = b
+            package_tools['system'] = ret
             break
     return ret
 
 
 def GetPackageManager():
+    if 'manager' in package_tools:
+        return package_tools['manager']
     ret = None
     # choose default - almost surely one will match.
     for b in ('apt-get', 'zypper', 'yum'):
@@ -202,6 +219,7 @@ def GetPackageManager():
             ret = b
             if ret == 'apt-get':
                 ret = 'apt'
+            package_tools['manager'] = ret
             break
     return ret
 
@@ -367,7 +385,72 @@ def ShowMof(op, Ensure, PackageManager, Name, FilePath, PackageGroup, Arguments,
     f.close()
 
 
-def IsPackageInstalled(p):
+def PackageDbSignature(package_system):
+    signature = []
+    for path in package_db_paths.get(package_system, ()):
+        try:
+            st = os.stat(path)
+        except OSError:
+            continue
+        signature.append((path, st.st_ino, st.st_size, st.st_mtime))
+    return tuple(signature)
+
+
+def GetPackageSnapshot(p):
+    """
+    Returns the output of p's stat_all query and an index from package
+    name to the stat lines the per-package query would print for it.
+    The index is None when the query failed and must not be trusted.
+    """
+    cmd = 'LANG=en_US.UTF8 ' + p.cmds[p.PackageManager]['stat_all']
+    signature = PackageDbSignature(package_db_system.get(p.PackageManager))
+    snapshot = package_snapshots.get(cmd)
+    if snapshot is not None and snapshot['signature'] == signature \
+            and time.time() - snapshot['taken'] < snapshot_max_age:
+        return snapshot['out'], snapshot['index']
+    taken = time.time()
+    code, out = RunGetOutput(cmd, False)
+    if code != 0:
+        return out, None
+    index = {}
+    for pkg in re.split(p.record_delimiter, out):
+        f = re.split(p.field_delimiter, pkg.strip())
+        if len(f) is 8:
+            index.setdefault(f[0], []).append(p.field_delimiter.join(f[1:]) + '\n')
+    package_snapshots[cmd] = {'signature': signature, 'taken': taken, 'out': out, 'index': index}
+    return out, index
+
+
+def InvalidatePackageSnapshot():
+    package_snapshots.clear()
+
+
+def SnapshotStat(p, exact_output):
+    """
+    Answers p's stat query from the package snapshot as (code, out), or
+    returns None when only the package manager can answer it.  Names the
+    snapshot does not list are reported missing unless they could be the
+    name:arch or name-version.arch forms dpkg-query and rpm -q also accept,
+    or the caller needs the package manager's exact output.
+    """
+    if re.match('^[A-Za-z0-9+._:-]+$', p.Name) is None:
+        return None
+    out, index = GetPackageSnapshot(p)
+    if index is None:
+        return None
+    if p.Name in index:
+        return 0, ''.join(index[p.Name])
+    if exact_output:
+        return None
+    for i in range(1, len(p.Name)):
+        if p.Name[i] in '-.:' and p.Name[:i] in index:
+            return None
+    if package_db_system.get(p.PackageManager) == 'dpkg':
+        return 1, 'dpkg-query: no packages found matching ' + p.Name + '\n'
+    return 1, 'package ' + p.Name + ' is not installed\n'
+
+
+def IsPackageInstalled(p, exact_output=False):
     out = ''
     if p is None:
         return False, out
@@ -406,7 +489,13 @@ def IsPackageInstalled(p):
             return False, out
     else:
         cmd = 'LANG=en_US.UTF8 ' + p.cmds[p.PackageManager]['stat'] + p.Name
-    code, out = RunGetOutput(cmd, False)
+    answer = None
+    if p.PackageGroup is not True:
+        answer = SnapshotStat(p, exact_output)
+    if answer is None:
+        code, out = RunGetOutput(cmd, False)
+    else:
+        code, out = answer
     if p.PackageGroup is True:  # implemented for YUM only.
         if 'Installed' in out:
             return True, out
@@ -530,6 +619,7 @@ def DoEnableDisable(p):
     cmd = cmd.replace('%', p.Arguments)
     cmd = cmd.replace('^', p.CommandArguments)
     code, out = RunGetOutput(cmd, False)
+    InvalidatePackageSnapshot()
     if len(p.LocalPath) > 1:  # create cache entry and remove the tmp file
         WriteCacheInfo(p)
         RemoveFile(p.LocalPath)
@@ -672,7 +762,7 @@ def Get(Ensure, PackageManager, Name, FilePath, PackageGroup, Arguments, ReturnC
         LG().Log(
             'ERROR', 'ERROR - Unable to initialize nxPackageProvider. ' + e.message)
         return [retval, p.PackageDescription, p.Publisher, p.InstalledOn, p.Size, p.Version, installed]
-    installed, out = IsPackageInstalled(p)
+    installed, out = IsPackageInstalled(p, True)
     out = out.replace('(none)','0') # for rpm EPOCH. 
     ParseInfo(p, out)
     return [0, p.PackageManager, p.PackageDescription, p.Publisher, p.InstalledOn, p.Size, p.Version, installed, p.Architecture]
@@ -690,8 +780,7 @@ def GetAll(Ensure, PackageManager, Name,
         LG().Log(
             'ERROR', 'ERROR - Unable to initialize nxPackageProvider. ' + e.message)
         return [-1, ]
-    cmd = 'LANG=en_US.UTF8 ' + p.cmds[p.PackageManager]['stat_all']
-    code, out = RunGetOutput(cmd, False)
+    out = GetPackageSnapshot(p)[0]
     pkgs = ParseAllInfo(out, p)
     return [0, pkgs]
 
@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+#============================================================================
+# Copyright (c) Microsoft Corporation. All rights reserved. See license.txt for license information.
+#============================================================================
+# Round-trip microbenchmark for the provider wire protocol.
+#
+# Compares the framed transport (one frame per message, decoded from memory)
+# with the legacy transport (one send/recv per field) over a socketpair,
+# using a request shaped like the ones PythonProvider sends.
+#
+# usage: bench_protocol.py [iterations] [properties]
+import os
+import socket
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', '..'))
+import protocol
+
+protocol.DO_TRACE = False
+
+
+class FieldReader:
+    """ The legacy receive path: one recv per field."""
+    def __init__(self, fd):
+        self.fd = fd
+
+    def unpack(self, fmt):
+        return struct.unpack(fmt, protocol.recv_exactly(self.fd, struct.calcsize(fmt)))
+
+    def read_bytes(self, size):
+        return protocol.recv_exactly(self.fd, size)
+
+
+def make_values(count):
+    values = dict()
+    for n in range(count):
+        kind = n % 4
+        name = 'Property' + str(n)
+        if kind == 0:
+            values[name] = protocol.MI_String('/etc/some/path/file' + str(n))
+        elif kind == 1:
+            values[name] = protocol.MI_Boolean(n % 2)
+        elif kind == 2:
+            values[name] = protocol.MI_Uint32(n)
+        else:
+            values[name] = protocol.MI_StringA(['a', 'bb', 'ccc'])
+    return values
+
+
+def write_request(fd, values):
+    fd.sendall(struct.pack('@B', 2))
+    protocol.write_string(fd, 'nxFile')
+    protocol.write_values(fd, values)
+
+
+def read_request(fd):
+    op = fd.unpack('@B')[0]
+    name = protocol.read_string(fd)
+    return (op, name, protocol.read_values(fd))
+
+
+def round_trip_legacy(client, server, values):
+    write_request(client, values)
+    req = read_request(FieldReader(server))
+    protocol.write_values(server, req[2])
+    return protocol.read_values(FieldReader(client))
+
+
+def round_trip_framed(client, server, values):
+    writer = protocol.FrameWriter()
+    write_request(writer, values)
+    writer.flush(client)
+    req = read_request(protocol.read_frame(server))
+    writer = protocol.FrameWriter()
+    protocol.write_values(writer, req[2])
+    writer.flush(server)
+    return protocol.read_values(protocol.read_frame(client))
+
+
+def bench(name, round_trip, iterations, values):
+    client, server = socket.socketpair()
+    try:
+        result = round_trip(client, server, values)
+        if sorted(result.keys()) != sorted(values.keys()):
+            raise AssertionError(name + ': round trip lost values')
+        start = time.time()
+        for _ in range(iterations):
+            round_trip(client, server, values)
+        elapsed = time.time() - start
+    finally:
+        client.close()
+        server.close()
+    sys.stdout.write('%-8s %8d round trips %8.1f us each\n' %
+                     (name, iterations, elapsed * 1000000.0 / iterations))
+    return elapsed
+
+
+def main(argv):
+    iterations = 2000
+    count = 12
+    if 1 < len(argv):
+        iterations = int(argv[1])
+    if 2 < len(argv):
+        count = int(argv[2])
+    values = make_values(count)
+    legacy = bench('legacy', round_trip_legacy, iterations, values)
+    framed = bench('framed', round_trip_framed, iterations, values)
+    sys.stdout.write('speedup  %.2fx\n' % (legacy / framed))
+
+
+if __name__ == '__main__':
+    main(sys.argv)
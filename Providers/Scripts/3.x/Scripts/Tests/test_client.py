@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+#============================================================================
+# Copyright (c) Microsoft Corporation. All rights reserved. See license.txt for license information.
+#============================================================================
+import os
+import socket
+import sys
+import types
+
+try:
+    import unittest2
+except:
+    import unittest as unittest2
+
+ScriptsDir = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..', '..')
+sys.path.insert(0, ScriptsDir)
+import protocol
+
+protocol.DO_TRACE = False
+
+
+def load_client():
+    """ client.py starts serving as soon as it is imported, so only the
+        definitions above its main block are loaded."""
+    path = os.path.join(ScriptsDir, 'client.py')
+    source = open(path).read()
+    source = source[:source.index('\n##############################\n')]
+    module = types.ModuleType('client')
+    exec(compile(source, path, 'exec'), module.__dict__)
+    module.DO_TRACE = False
+    return module
+
+client = load_client()
+
+
+def make_instances(count):
+    return [{'Name': protocol.MI_String('item' + str(n))} for n in range(count)]
+
+
+class ClientInventoryFrameTestCases(unittest2.TestCase):
+    """
+    Test cases for the INVENTORY_CHUNK frames client.py sends
+    """
+    def setUp(self):
+        self.writer, self.reader = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+
+    def tearDown(self):
+        self.writer.close()
+        self.reader.close()
+
+    def read_frames(self):
+        """ Returns (result, values or error message) for every frame up to
+            and including the one that ends the result."""
+        frames = []
+        result = client.INVENTORY_CHUNK
+        while result == client.INVENTORY_CHUNK:
+            frame = protocol.read_frame(self.reader)
+            self.assertTrue(frame is not None, 'the result ended without a closing frame')
+            result = frame.unpack('@i')[0]
+            if result == 0 or result == client.INVENTORY_CHUNK:
+                frames.append((result, protocol.read_values(frame)))
+            else:
+                frames.append((result, protocol.read_string(frame)))
+        return frames
+
+    def names(self, values):
+        inventory = values.get('__Inventory')
+        if inventory is None or inventory.value is None:
+            return []
+        return [instance['Name'].value for instance in inventory.value]
+
+    def check_inventory(self, count, stream):
+        instances = make_instances(count)
+        if stream:
+            inventory = protocol.MI_InstanceStream(lambda: iter(instances))
+        else:
+            inventory = protocol.MI_InstanceA(instances)
+        client.write_inventory(self.writer, {'__Inventory': inventory,
+                                             'Tag': protocol.MI_String('tag')})
+        frames = self.read_frames()
+        # every frame but the last is a full slice, the last holds the rest
+        full, rest = divmod(max(count - 1, 0), client.INVENTORY_CHUNK_SIZE)
+        self.assertEqual(full + 1, len(frames))
+        names = []
+        for result, values in frames[:-1]:
+            self.assertEqual(client.INVENTORY_CHUNK, result)
+            self.assertEqual(client.INVENTORY_CHUNK_SIZE, len(self.names(values)))
+            self.assertFalse('Tag' in values)
+            names.extend(self.names(values))
+        result, values = frames[-1]
+        self.assertEqual(0, result)
+        self.assertEqual('tag', values['Tag'].value)
+        names.extend(self.names(values))
+        self.assertEqual(['item' + str(n) for n in range(count)], names)
+
+    def testInventoryFrames(self):
+        for count in (0, 1, 256, 257, 513):
+            self.check_inventory(count, False)
+
+    def testInventoryStreamFrames(self):
+        for count in (0, 1, 256, 257, 513):
+            self.check_inventory(count, True)
+
+    def testInventoryFailureAfterChunk(self):
+        def produce():
+            for instance in make_instances(300):
+                yield instance
+            raise IOError('the walk failed')
+        client.write_inventory(self.writer, {'__Inventory': protocol.MI_InstanceStream(produce)})
+        frames = self.read_frames()
+        self.assertEqual(2, len(frames))
+        self.assertEqual(client.INVENTORY_CHUNK, frames[0][0])
+        self.assertEqual(['item' + str(n) for n in range(client.INVENTORY_CHUNK_SIZE)],
+                         self.names(frames[0][1]))
+        self.assertEqual(1, frames[1][0])
+        self.assertEqual('Error occurred collecting the inventory', frames[1][1])
+
+    def testInventoryFailureBeforeChunk(self):
+        def produce():
+            raise IOError('the walk failed')
+        client.write_inventory(self.writer, {'__Inventory': protocol.MI_InstanceStream(produce)})
+        frames = self.read_frames()
+        self.assertEqual(1, len(frames))
+        self.assertEqual(1, frames[0][0])
+
+
+######################################
+if __name__ == '__main__':
+    s1=unittest2.TestLoader().loadTestsFromTestCase(ClientInventoryFrameTestCases)
+    alltests = unittest2.TestSuite([s1])
+    result = unittest2.TextTestRunner(stream=sys.stdout,verbosity=3).run(alltests)
+    sys.exit(not result.wasSuccessful())
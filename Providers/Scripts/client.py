@@ -1,8 +1,11 @@
 #============================================================================
 # Copyright (c) Microsoft Corporation. All rights reserved. See license.txt for license information.
 #============================================================================
+import errno
+import fcntl
 import os
 import protocol
+import signal
 import socket
 import struct
 import sys
@@ -13,6 +16,24 @@ DO_TRACE = True
 DO_VERBOSE_TRACE  = False
 ScriptsDir = "<DSC_SCRIPT_PATH>"
 VarDir = "<PYTHON_PID_DIR>"
+ConfigSysconfDir = "<CONFIG_SYSCONFDIR>"
+ConfigSysconfDirDsc = "<CONFIG_SYSCONFDIR_DSC>"
+DEFAULT_TIMEOUT_SEC = 85
+
+# Worker pool mode: client.py --pool <socket path> <pool size>
+POOL_ARG = '--pool'
+# Idle pooled workers exit after this long.  It has to outlast the gap between
+# consistency checks (ConfigurationModeFrequencyMins, 15 by default) or every
+# check starts a cold pool; PythonWorkerPoolIdleTimeoutSec in dsc.conf
+# overrides it.
+POOL_IDLE_TIMEOUT_SEC = 3600
+POOL_IDLE_TIMEOUT_CONF_KEY = 'pythonworkerpoolidletimeoutsec'
+POOL_MAX_SIZE = 16
+
+# Inventory results go back in frames of at most this many instances
+INVENTORY_CHUNK_SIZE = 256
+# result code of a frame that holds a slice of __Inventory, more frames follow
+INVENTORY_CHUNK = 2
 
 def trace (text):
     if DO_TRACE:
@@ -23,26 +44,16 @@ def verbose_trace (text):
         trace (text)
 
         
-def read_uchar (fd):
-    verbose_trace ('<read_uchar>')
-    buf = fd.recv (1)
-    if len (buf) < 1:
-        return None
-    val = struct.unpack ('@B',buf)[0]
-    verbose_trace ('  val: '+str(int (val)))
-    verbose_trace ('</read_uchar>')
-    return val
-
-
 def read_request (fd):
     verbose_trace ('<read_request>')
-    op_type = read_uchar (fd)
-    if op_type == None:
+    frame = protocol.read_frame (fd)
+    if frame == None:
         return None
+    op_type = frame.unpack ('@B')[0]
     verbose_trace ('  op_type: ' + str(op_type))
-    op_name = protocol.read_string (fd)
+    op_name = protocol.read_string (frame)
     verbose_trace ('  op_name: "'+ op_name +'"')
-    d = protocol.read_values (fd)
+    d = protocol.read_values (frame)
     verbose_trace ('</read_request>')
     return (op_type, op_name, d)
 
@@ -70,6 +81,41 @@ def write_failed (s, fail_code, text=''):
     trace ('</write_failed>')
 
 
+def write_inventory (fd, args):
+    """ Sends a successful Inventory result straight to fd.  __Inventory is
+        drawn from its iterable a slice at a time and each full slice that
+        has more instances behind it goes out as an INVENTORY_CHUNK frame,
+        so neither end holds more than a slice.  The last slice and the
+        other values close the result as an ordinary success frame, which
+        leaves a result that fits in one slice unchanged on the wire."""
+    trace ('<write_inventory>')
+    name = '__Inventory'
+    chunk = []
+    try:
+        for instance in args[name].value:
+            if len (chunk) == INVENTORY_CHUNK_SIZE:
+                writer = protocol.FrameWriter ()
+                write_int (writer, INVENTORY_CHUNK)
+                protocol.write_values (writer, {name: protocol.MI_InstanceA (chunk)})
+                writer.flush (fd)
+                chunk = []
+            chunk.append (instance)
+    except Exception:
+        sys.stderr.write ('\nException while collecting the inventory: ')
+        sys.stderr.write (repr (sys.exc_info ()[1]) + '\n')
+        writer = protocol.FrameWriter ()
+        write_failed (writer, 1, 'Error occurred collecting the inventory')
+        writer.flush (fd)
+        trace ('</write_inventory>')
+        return
+    rest = dict (args)
+    rest[name] = protocol.MI_InstanceA (chunk)
+    writer = protocol.FrameWriter ()
+    write_success (writer, rest)
+    writer.flush (fd)
+    trace ('</write_inventory>')
+
+
 def translate_input (d):
     """ This method is a convenience for a protocol chnage and should be
         removed when the handlers are updated."""
@@ -122,20 +168,27 @@ def handle_request (fd, req):
     else:
         rval = r[0]
         ret = r[1]
-    if rval == 0:
-        write_success (fd, ret)
+    if rval == 0 and req[0] == 3 and ret is not None and \
+            isinstance (ret.get ('__Inventory'), protocol.MI_InstanceA):
+        write_inventory (fd, ret)
     else:
-        write_failed (fd,1, 'Error occurred processing '+ repr (req))
+        # the whole response goes back as one frame
+        writer = protocol.FrameWriter ()
+        if rval == 0:
+            write_success (writer, ret)
+        else:
+            write_failed (writer,1, 'Error occurred processing '+ repr (req))
+        writer.flush (fd)
+    # Digests nxFile and nxFileInventory computed in this call outlive the
+    # worker.  An inventory computes them while it is being written.
+    if 'filehashcache' in sys.modules:
+        sys.modules['filehashcache'].Flush ()
     trace ('</handle_request>')
 
 
 
-def main (argv):
-    default_timeout_sec = 85
-    socket.setdefaulttimeout(default_timeout_sec)
-    fd = socket.fromfd (int (argv[1]), socket.AF_UNIX, socket.SOCK_STREAM)
+def serve (fd):
     read = 1
-    out = ''
     while 0 < read:
         try:
             req = read_request (fd)
@@ -157,6 +210,215 @@ def main (argv):
         except socket.error:
             read = -1;
             sys.stderr.write('exception encountered')
+        except struct.error:
+            read = -1;
+            sys.stderr.write('malformed request frame')
+
+
+def main (argv):
+    socket.setdefaulttimeout(DEFAULT_TIMEOUT_SEC)
+    fd = socket.fromfd (int (argv[1]), socket.AF_UNIX, socket.SOCK_STREAM)
+    serve (fd)
+
+
+def scripts_fingerprint ():
+    """ Identifies the provider scripts a pooled worker has imported.  A
+        worker whose fingerprint no longer matches the installed scripts
+        (a module was installed or updated) retires instead of serving
+        stale code."""
+    fingerprint = []
+    # the wire protocol lives in client.py and protocol.py
+    for source in (__file__, protocol.__file__):
+        source = os.path.splitext (os.path.abspath (source))[0] + '.py'
+        try:
+            st = os.stat (source)
+            fingerprint.append ((source, st.st_mtime, st.st_size))
+        except OSError:
+            pass
+    scripts_path = os.path.join (os.getcwd (), 'Scripts')
+    try:
+        names = os.listdir (scripts_path)
+    except OSError:
+        return fingerprint
+    names.sort ()
+    for name in names:
+        if not name.endswith ('.py'):
+            continue
+        try:
+            st = os.stat (os.path.join (scripts_path, name))
+        except OSError:
+            continue
+        fingerprint.append ((name, st.st_mtime, st.st_size))
+    return fingerprint
+
+
+def pool_idle_timeout ():
+    """ PythonWorkerPoolIdleTimeoutSec from dsc.conf when it is a positive
+        number of seconds, POOL_IDLE_TIMEOUT_SEC otherwise."""
+    timeout = POOL_IDLE_TIMEOUT_SEC
+    try:
+        conf = open (ConfigSysconfDir + '/' + ConfigSysconfDirDsc + '/dsc.conf')
+    except IOError:
+        return timeout
+    try:
+        for line in conf.readlines ():
+            fields = line.split ('=', 1)
+            if len (fields) != 2 or \
+                    fields[0].strip ().lower () != POOL_IDLE_TIMEOUT_CONF_KEY:
+                continue
+            try:
+                value = int (fields[1].strip ())
+            except ValueError:
+                trace ('ignoring invalid PythonWorkerPoolIdleTimeoutSec: ' +
+                       fields[1].strip ())
+                continue
+            if 0 < value:
+                timeout = value
+    finally:
+        conf.close ()
+    return timeout
+
+
+def pool_listen (sock_path, backlog):
+    """ Binds the pool socket.  Returns None when a live pool already owns
+        sock_path, which the launching provider treats as success."""
+    lock = open (sock_path + '.lock', 'w')
+    try:
+        fcntl.flock (lock.fileno (), fcntl.LOCK_EX)
+        probe = socket.socket (socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            try:
+                probe.connect (sock_path)
+                return None
+            except socket.error:
+                pass
+        finally:
+            probe.close ()
+        try:
+            os.unlink (sock_path)
+        except OSError:
+            pass
+        listener = socket.socket (socket.AF_UNIX, socket.SOCK_STREAM)
+        old_umask = os.umask (int ('077', 8))
+        try:
+            listener.bind (sock_path)
+        finally:
+            os.umask (old_umask)
+        listener.listen (backlog)
+        return listener
+    finally:
+        lock.close ()
+
+
+def pool_worker (listener, sock_path, sock_ino, fingerprint, idle_timeout):
+    """ Accept loop of one pre-warmed worker.  Every connection is greeted
+        with the worker pid so the provider knows a warm interpreter picked it
+        up, then served exactly like a socketpair from forkExec."""
+    listener.settimeout (idle_timeout)
+    while True:
+        try:
+            conn, addr = listener.accept ()
+        except socket.timeout:
+            return
+        except socket.error:
+            e = sys.exc_info ()[1]
+            if e.args and e.args[0] in (errno.EINTR, errno.EAGAIN, errno.EWOULDBLOCK):
+                continue
+            return
+        if scripts_fingerprint () != fingerprint:
+            # Close without the greeting; the provider relaunches the pool.
+            pool_retire (sock_path, sock_ino)
+            conn.close ()
+            return
+        conn.settimeout (DEFAULT_TIMEOUT_SEC)
+        try:
+            try:
+                write_int (conn, os.getpid ())
+                serve (conn)
+            except Exception:
+                sys.stderr.write ('\nException in pooled worker: ')
+                sys.stderr.write (repr(sys.exc_info())+'\n')
+        finally:
+            conn.close ()
+
+
+def pool_retire (sock_path, sock_ino):
+    """ Unlinks sock_path if it still names this pool's socket."""
+    try:
+        if os.stat (sock_path).st_ino == sock_ino:
+            os.unlink (sock_path)
+    except OSError:
+        pass
+
+
+def pool_spawn (listener, sock_path, sock_ino, fingerprint, idle_timeout):
+    pid = os.fork ()
+    if pid == 0:
+        # Lead a process group of our own, so a provider that kills this
+        # worker also kills whatever the resource scripts started.
+        os.setpgid (0, 0)
+        signal.signal (signal.SIGTERM, signal.SIG_DFL)
+        pool_worker (listener, sock_path, sock_ino, fingerprint, idle_timeout)
+        os._exit (0)
+    try:
+        # also set from this side, so the group exists before any greeting
+        os.setpgid (pid, pid)
+    except OSError:
+        pass
+    return pid
+
+
+def pool_current (sock_path, sock_ino, fingerprint):
+    """ True while sock_path is still this pool's socket and the scripts
+        have not changed under it."""
+    try:
+        if os.stat (sock_path).st_ino != sock_ino:
+            return False
+    except OSError:
+        return False
+    return scripts_fingerprint () == fingerprint
+
+
+def serve_pool (sock_path, pool_size):
+    pool_size = max (1, min (pool_size, POOL_MAX_SIZE))
+    listener = pool_listen (sock_path, pool_size * 4)
+    if listener is None:
+        trace ('pool already running at ' + sock_path)
+        return
+    sock_ino = os.stat (sock_path).st_ino
+    fingerprint = scripts_fingerprint ()
+    idle_timeout = pool_idle_timeout ()
+    # Detach from the provider that launched us.  Its waitpid on this process
+    # returning is the signal that the socket is ready for connect ().
+    if os.fork () != 0:
+        os._exit (0)
+    os.setsid ()
+    devnull = os.open ('/dev/null', os.O_RDWR)
+    for stdfd in (0, 1, 2):
+        os.dup2 (devnull, stdfd)
+    os.close (devnull)
+    workers = []
+    for n in range (pool_size):
+        workers.append (pool_spawn (listener, sock_path, sock_ino,
+                                    fingerprint, idle_timeout))
+    while workers:
+        try:
+            pid, status = os.wait ()
+        except OSError:
+            e = sys.exc_info ()[1]
+            if e.errno == errno.EINTR:
+                continue
+            break
+        if pid in workers:
+            workers.remove (pid)
+            # A provider kills the worker of a call that missed its deadline
+            # or was canceled.  Replace it unless the pool is retiring.
+            if os.WIFSIGNALED (status) and pool_current (sock_path, sock_ino, fingerprint):
+                workers.append (pool_spawn (listener, sock_path, sock_ino,
+                                            fingerprint, idle_timeout))
+    pool_retire (sock_path, sock_ino)
+    listener.close ()
+
 
 ##############################
 try:
@@ -196,7 +458,10 @@ try:
             traceback.print_tb (sys.exc_info()[2])
             sys.stderr.write ('\n') 
         if __name__ == '__main__':
-            main (sys.argv)
+            if sys.argv[1] == POOL_ARG:
+                serve_pool (sys.argv[2], int (sys.argv[3]))
+            else:
+                main (sys.argv)
     
     
     except:
@@ -206,5 +471,6 @@ try:
         sys.stderr.write ('\n')
 
 finally:
-    sys.stderr.write ('Exiting - closing socket\n' )
-    (socket.fromfd(int (sys.argv[1]), socket.AF_UNIX, socket.SOCK_STREAM)).close()
+    if sys.argv[1] != POOL_ARG:
+        sys.stderr.write ('Exiting - closing socket\n' )
+        (socket.fromfd(int (sys.argv[1]), socket.AF_UNIX, socket.SOCK_STREAM)).close()
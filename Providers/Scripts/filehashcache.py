@@ -0,0 +1,206 @@
+#!/usr/bin/env python
+# ============================================================================
+#  Copyright (C) Microsoft Corporation, All rights reserved.
+# ============================================================================
+
+# Content digests for nxFile and nxFileInventory, remembered across runs.
+# Entries are keyed by (algorithm, st_dev, st_ino, st_size, st_mtime_ns, st_ctime_ns),
+# so any write, truncate, rename over or chmod of a file makes its entry unreachable.
+# Pooled client.py workers keep the table in memory between requests and
+# client.py calls Flush() after every request to merge it back to disk.
+#
+# This module is loaded by the 2.4x-2.5x resources too, so it stays 2.4 syntax.
+
+import os
+import sys
+import time
+import fcntl
+import imp
+
+scriptFolderPath = os.path.dirname(os.path.realpath(__file__))
+helperlib = imp.load_source('helperlib', os.path.join(scriptFolderPath, 'helperlib.py'))
+
+CacheDir = helperlib.PYTHON_PID_DIR + '/cache/' + repr(os.getuid())
+CacheFile = CacheDir + '/filehash.cache'
+CacheHeader = 'filehashcache 1'
+
+READ_SIZE = 1048576
+MAX_ENTRIES = 16384
+MAX_HASH_ATTEMPTS = 3
+# A file modified in the same timestamp tick we hashed it in could change again
+# without its mtime moving, so files that recent are hashed but not remembered.
+RACY_WINDOW_SEC = 2
+
+_entries = {}
+_touched = {}
+_dirty = False
+_loaded_signature = None
+
+
+def _StatKey(algorithm, st):
+    mtime_ns = getattr(st, 'st_mtime_ns', None)
+    if mtime_ns is None:
+        mtime_ns = int(st.st_mtime * 1000000000)
+    ctime_ns = getattr(st, 'st_ctime_ns', None)
+    if ctime_ns is None:
+        ctime_ns = int(st.st_ctime * 1000000000)
+    return (algorithm, int(st.st_dev), int(st.st_ino), int(st.st_size), int(mtime_ns), int(ctime_ns))
+
+
+def _FileSignature(path):
+    try:
+        st = os.stat(path)
+    except OSError:
+        return None
+    return (st.st_ino, st.st_size, st.st_mtime)
+
+
+def _ReadEntries(path):
+    entries = {}
+    try:
+        F = open(path, 'r')
+    except IOError:
+        return entries
+    try:
+        if F.readline().rstrip('\n') != CacheHeader:
+            return entries
+        for line in F:
+            fields = line.split()
+            if len(fields) != 7:
+                continue
+            try:
+                key = (fields[0], int(fields[1]), int(fields[2]), int(fields[3]), int(fields[4]), int(fields[5]))
+            except ValueError:
+                continue
+            entries[key] = fields[6]
+    finally:
+        F.close()
+    return entries
+
+
+def _Load():
+    """
+    (Re)reads the cache file when another worker has replaced it since we
+    last looked.  Digests we computed but have not flushed are kept.
+    """
+    global _entries, _loaded_signature
+    signature = _FileSignature(CacheFile)
+    if signature == _loaded_signature:
+        return
+    entries = _ReadEntries(CacheFile)
+    if _dirty:
+        for key in _touched.keys():
+            if key in _entries:
+                entries[key] = _entries[key]
+    _entries = entries
+    _loaded_signature = signature
+
+
+def _AlgorithmName(hash_factory):
+    # hashlib objects know their name; the 2.4 md5 and sha modules only their size.
+    file_hash = hash_factory()
+    name = getattr(file_hash, 'name', None)
+    if name is None:
+        name = 'digest' + str(file_hash.digest_size * 8)
+    return name.lower()
+
+
+def _HashOpenFile(F, hash_factory):
+    file_hash = hash_factory()
+    block = F.read(READ_SIZE)
+    while block:
+        file_hash.update(block)
+        block = F.read(READ_SIZE)
+    return file_hash.hexdigest()
+
+
+def GetFileDigest(path, hash_factory):
+    """
+    Returns the hash_factory hex digest of path, hashing it only when no digest is known
+    for its current (dev, inode, size, mtime, ctime).  A file that changes
+    while it is read is hashed again; if it never holds still, the last
+    digest is returned without being remembered.  IOError and OSError from
+    opening the file are left to the caller.
+    """
+    global _dirty
+    _Load()
+    algorithm = _AlgorithmName(hash_factory)
+    key = _StatKey(algorithm, os.stat(path))
+    if key in _entries:
+        _touched[key] = True
+        return _entries[key]
+
+    digest = None
+    for attempt in range(MAX_HASH_ATTEMPTS):
+        F = open(path, 'rb')
+        try:
+            before = _StatKey(algorithm, os.fstat(F.fileno()))
+            digest = _HashOpenFile(F, hash_factory)
+            after = _StatKey(algorithm, os.fstat(F.fileno()))
+        finally:
+            F.close()
+        # The path must still name the file we read, or a rename raced us.
+        if before == after and after == _StatKey(algorithm, os.stat(path)):
+            if time.time() - after[4] / 1000000000.0 >= RACY_WINDOW_SEC:
+                _entries[after] = digest
+                _touched[after] = True
+                _dirty = True
+            return digest
+    return digest
+
+
+def Flush():
+    """
+    Merges the digests computed since the last flush into the cache file.
+    Writers serialize on a lock file and replace the cache by rename, so
+    readers never see a partial file.  Failures only cost a re-hash later.
+    """
+    global _dirty, _entries, _touched, _loaded_signature
+    if not _dirty:
+        return
+    lock_file = None
+    temp_path = CacheFile + '.' + str(os.getpid())
+    try:
+        try:
+            if not os.path.isdir(CacheDir):
+                os.makedirs(CacheDir, int('700', 8))
+            lock_file = open(CacheFile + '.lock', 'w')
+            fcntl.flock(lock_file.fileno(), fcntl.LOCK_EX)
+
+            merged = _ReadEntries(CacheFile)
+            for key in _touched.keys():
+                if key in _entries:
+                    merged[key] = _entries[key]
+            if len(merged) > MAX_ENTRIES:
+                kept = {}
+                for key in _touched.keys():
+                    if key in merged:
+                        kept[key] = merged[key]
+                for key in merged.keys():
+                    if len(kept) >= MAX_ENTRIES:
+                        break
+                    kept[key] = merged[key]
+                merged = kept
+
+            F = open(temp_path, 'w')
+            try:
+                F.write(CacheHeader + '\n')
+                for key in merged.keys():
+                    F.write('%s %d %d %d %d %d %s\n' % (key + (merged[key],)))
+                F.flush()
+                os.fsync(F.fileno())
+            finally:
+                F.close()
+            os.rename(temp_path, CacheFile)
+
+            _entries = merged
+            _loaded_signature = _FileSignature(CacheFile)
+            _touched = {}
+            _dirty = False
+        except (IOError, OSError):
+            sys.stderr.write('Unable to update ' + CacheFile + ': ' + str(sys.exc_info()[1]) + '\n')
+            if os.path.exists(temp_path):
+                os.remove(temp_path)
+    finally:
+        if lock_file is not None:
+            lock_file.close()
@@ -89,15 +89,110 @@ def verbose_trace(text):
         trace(text)
 
 
+# Every message travels as one frame: a native unsigned int holding the
+# payload length, followed by the payload.  The payload encoding (type tags,
+# strings, values) is unchanged; only the transport is batched.
+FRAME_HEADER_FORMAT = '@I'
+FRAME_HEADER_SIZE = struct.calcsize(FRAME_HEADER_FORMAT)
+
+_structs = dict()
+
+
+def get_struct(fmt):
+    s = _structs.get(fmt)
+    if s is None:
+        s = struct.Struct(fmt)
+        _structs[fmt] = s
+    return s
+
+
+def recv_exactly(fd, size):
+    chunks = []
+    remaining = size
+    while 0 < remaining:
+        buf = fd.recv(remaining)
+        if not buf:
+            return None
+        chunks.append(buf)
+        remaining -= len(buf)
+    return b''.join(chunks)
+
+
+def read_frame(fd):
+    """ Reads the next frame from fd.  Returns None when the peer closed
+        the socket."""
+    verbose_trace('<read_frame>')
+    buf = recv_exactly(fd, FRAME_HEADER_SIZE)
+    if buf is None:
+        return None
+    size = struct.unpack(FRAME_HEADER_FORMAT, buf)[0]
+    verbose_trace('  size: ' + str(size))
+    buf = recv_exactly(fd, size)
+    if buf is None:
+        return None
+    verbose_trace('</read_frame>')
+    return Frame(buf)
+
+
+class Frame:
+    """ A received frame.  The read functions decode from it in memory with
+        struct.unpack_from instead of issuing one recv per field."""
+    def __init__(self, data):
+        self.data = data
+        try:
+            self.view = memoryview(data)
+        except NameError:
+            # python 2.6 has no memoryview, unpack_from takes the str as is
+            self.view = data
+        self.offset = 0
+
+    def unpack(self, fmt):
+        s = get_struct(fmt)
+        vals = s.unpack_from(self.view, self.offset)
+        self.offset += s.size
+        return vals
+
+    def read_bytes(self, size):
+        end = self.offset + size
+        if len(self.data) < end:
+            raise struct.error('frame truncated reading ' + str(size) + ' bytes')
+        buf = self.data[self.offset:end]
+        self.offset = end
+        return buf
+
+
+class FrameWriter:
+    """ Collects everything written by write_* and MI_*.write so that it
+        goes out as a single frame in flush."""
+    def __init__(self):
+        self.chunks = []
+
+    def send(self, buf):
+        self.chunks.append(buf)
+        return len(buf)
+
+    def sendall(self, buf):
+        self.chunks.append(buf)
+
+    def flush(self, fd):
+        verbose_trace('<FrameWriter.flush>')
+        payload = b''.join(self.chunks)
+        if not isinstance(payload, bytes):
+            # python 2 promotes the payload to unicode when a key was unicode
+            payload = payload.encode('ascii')
+        self.chunks = []
+        verbose_trace('  size: ' + str(len(payload)))
+        fd.sendall(struct.pack(FRAME_HEADER_FORMAT, len(payload)) + payload)
+        verbose_trace('</FrameWriter.flush>')
+
+
 def read_string(fd):
     verbose_trace('<read_string>')
-    buf = fd.recv(4)
-    strl = struct.unpack('@i', buf)[0]
+    strl = fd.unpack('@i')[0]
     verbose_trace('  len: ' + str(strl))
     text = ''
     if 0 < strl:
-        buf = fd.recv(strl)
-        text = buf.decode('utf8')
+        text = fd.read_bytes(strl).decode('utf8')
     verbose_trace('  str: "' + text + '"')
     verbose_trace('</read_string>')
     return text
@@ -118,8 +213,7 @@ def read_arg_name(fd):
 def read_values(fd):
     verbose_trace('<read_values>')
     arg_dict = dict()
-    buf = fd.recv(4)
-    argc = struct.unpack('@i', buf)[0]
+    argc = fd.unpack('@i')[0]
     verbose_trace('  argc: ' + str(argc))
     for _ in range(argc):
         arg_name = read_arg_name(fd)
@@ -218,8 +312,7 @@ class MI_Value:
     @staticmethod
     def read(fd):
         verbose_trace('<MI_Value::read>')
-        buf = fd.recv(1)
-        type = struct.unpack('@B', buf)[0]
+        type = fd.unpack('@B')[0]
         switch = type & ~(MI_NULL_FLAG)
         verbose_trace('  type: ' + str(switch))
         val = None
@@ -317,8 +410,7 @@ class MI_Boolean(MI_Value):
         verbose_trace('<MI_Boolean.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(1)
-            val = struct.unpack('@B', buf)[0]
+            val = fd.unpack('@B')[0]
             verbose_trace('val is ' + str(int(val)) + '\n')
             if val:
                 tmp = 'True'
@@ -350,8 +442,7 @@ class MI_Uint8(MI_Value):
         verbose_trace('<MI_Uint8.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(1)
-            val = struct.unpack('@B', buf)[0]
+            val = fd.unpack('@B')[0]
         rval = MI_Uint8(val)
         verbose_trace('</MI_Uint8.read>')
         return rval
@@ -377,8 +468,7 @@ class MI_Sint8(MI_Value):
         verbose_trace('<MI_Sint8.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(1)
-            val = struct.unpack('@b', buf)[0]
+            val = fd.unpack('@b')[0]
         rval = MI_Sint8(val)
         verbose_trace('</MI_Sint8.read>')
         return rval
@@ -404,8 +494,7 @@ class MI_Uint16(MI_Value):
         verbose_trace('<MI_Uint16.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(2)
-            val = struct.unpack('@H', buf)[0]
+            val = fd.unpack('@H')[0]
         rval = MI_Uint16(val)
         verbose_trace('</MI_Uint16.read>')
         return rval
@@ -431,8 +520,7 @@ class MI_Sint16(MI_Value):
         verbose_trace('<MI_Sint16.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(2)
-            val = struct.unpack('@h', buf)[0]
+            val = fd.unpack('@h')[0]
         rval = MI_Sint16(val)
         verbose_trace('</MI_Sint16.read>')
         return rval
@@ -458,8 +546,7 @@ class MI_Uint32(MI_Value):
         verbose_trace('<MI_Uint32.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(4)
-            val = struct.unpack('@I', buf)[0]
+            val = fd.unpack('@I')[0]
         rval = MI_Uint32(val)
         verbose_trace('</MI_Uint32.read>')
         return rval
@@ -485,8 +572,7 @@ class MI_Sint32(MI_Value):
         verbose_trace('<MI_Sint32.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(4)
-            val = struct.unpack('@i', buf)[0]
+            val = fd.unpack('@i')[0]
         rval = MI_Sint32(val)
         verbose_trace('</MI_Sint32.read>')
         return rval
@@ -512,8 +598,7 @@ class MI_Uint64(MI_Value):
         verbose_trace('<MI_Uint64.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(8)
-            val = struct.unpack('@Q', buf)[0]
+            val = fd.unpack('@Q')[0]
         rval = MI_Uint64(val)
         verbose_trace('</MI_Uint64.read>')
         return rval
@@ -539,8 +624,7 @@ class MI_Sint64(MI_Value):
         verbose_trace('<MI_Sint64.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(8)
-            val = struct.unpack('@q', buf)[0]
+            val = fd.unpack('@q')[0]
         rval = MI_Sint64(val)
         verbose_trace('</MI_Sint64.read>')
         return rval
@@ -566,8 +650,7 @@ class MI_Real32(MI_Value):
         verbose_trace('<MI_Real32.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(8)
-            val = struct.unpack('@f', buf)[0]
+            val = fd.unpack('@f')[0]
         rval = MI_Real32(val)
         verbose_trace('</MI_Real32.read>')
         return rval
@@ -593,8 +676,7 @@ class MI_Real64(MI_Value):
         verbose_trace('<MI_Real64.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(8)
-            val = struct.unpack('@d', buf)[0]
+            val = fd.unpack('@d')[0]
         rval = MI_Real64(val)
         verbose_trace('</MI_Real64.read>')
         return rval
@@ -620,8 +702,7 @@ class MI_Char16(MI_Value):
         verbose_trace('<MI_Char16.read>')
         val = None
         if 0 == (MI_NULL_FLAG & flags):
-            buf = fd.recv(2)
-            val = struct.unpack('@H', buf)[0]
+            val = fd.unpack('@H')[0]
         rval = MI_Char16(val)
         verbose_trace('</MI_Char16.read>')
         return rval
@@ -653,12 +734,12 @@ class MI_Datetime(MI_Value):
     def read_data(fd):
         verbose_trace('  <MI_Datetime.read_data>')
         rval = None
-        buf = fd.recv(1)
+        flag = fd.unpack('@B')[0]
         isTimestamp = None
         try:
-            isTimestamp = ctypes.c_bool(struct.unpack('@B', buf)[0])
+            isTimestamp = ctypes.c_bool(flag)
         except:
-            isTimestamp = ctypes.c_int(struct.unpack('@B', buf)[0])
+            isTimestamp = ctypes.c_int(flag)
         if isTimestamp:
             rval = MI_Timestamp.read_data(fd)
         else:
@@ -762,23 +843,14 @@ class MI_Timestamp(MI_Datetime):
     @staticmethod
     def read_data(fd):
         verbose_trace('    <MI_Timestamp.read_data>')
-        buf = fd.recv(4)
-        year = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        month = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        day = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        hour = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        minute = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        second = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        microseconds = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        utc = struct.unpack('@i', buf)[0]
-        buf = fd.recv(4)
+        year = fd.unpack('@I')[0]
+        month = fd.unpack('@I')[0]
+        day = fd.unpack('@I')[0]
+        hour = fd.unpack('@I')[0]
+        minute = fd.unpack('@I')[0]
+        second = fd.unpack('@I')[0]
+        microseconds = fd.unpack('@I')[0]
+        utc = fd.unpack('@i')[0]
         rval = MI_Timestamp(year, month, day, hour, minute, second,
                             microseconds, utc)
         verbose_trace('      isTimestamp: True')
@@ -871,17 +943,11 @@ class MI_Interval(MI_Datetime):
     @staticmethod
     def read_data(fd):
         verbose_trace('    <MI_Interval.read_data>')
-        buf = fd.recv(4)
-        days = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        hours = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        minutes = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        seconds = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
-        microseconds = struct.unpack('@I', buf)[0]
-        buf = fd.recv(4)
+        days = fd.unpack('@I')[0]
+        hours = fd.unpack('@I')[0]
+        minutes = fd.unpack('@I')[0]
+        seconds = fd.unpack('@I')[0]
+        microseconds = fd.unpack('@I')[0]
         rval = MI_Timestamp(days, hours, minutes, seconds, microseconds)
         verbose_trace('      isTimestamp: False')
         verbose_trace('      days:' + str(days))
@@ -1000,12 +1066,10 @@ class MI_BooleanA(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(1)
-                val = struct.unpack('@B', buf)[0]
+                val = fd.unpack('@B')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_BooleanA(vals)
@@ -1045,12 +1109,10 @@ class MI_Uint8A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(1)
-                val = struct.unpack('@B', buf)[0]
+                val = fd.unpack('@B')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Uint8A(vals)
@@ -1090,12 +1152,10 @@ class MI_Sint8A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(1)
-                val = struct.unpack('@b', buf)[0]
+                val = fd.unpack('@b')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Sint8A(vals)
@@ -1140,12 +1200,10 @@ class MI_Uint16A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(2)
-                val = struct.unpack('@H', buf)[0]
+                val = fd.unpack('@H')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Uint16A(vals)
@@ -1185,12 +1243,10 @@ class MI_Sint16A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            len = struct.unpack('@i', buf)[0]
+            len = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(len))
             for _ in range(len):
-                buf = fd.recv(2)
-                val = struct.unpack('@h', buf)[0]
+                val = fd.unpack('@h')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Sint16A(vals)
@@ -1230,12 +1286,10 @@ class MI_Uint32A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(4)
-                val = struct.unpack('@I', buf)[0]
+                val = fd.unpack('@I')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Uint32A(vals)
@@ -1275,12 +1329,10 @@ class MI_Sint32A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(4)
-                val = struct.unpack('@i', buf)[0]
+                val = fd.unpack('@i')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Sint32A(vals)
@@ -1320,12 +1372,10 @@ class MI_Uint64A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(8)
-                val = struct.unpack('@Q', buf)[0]
+                val = fd.unpack('@Q')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Uint64A(vals)
@@ -1365,12 +1415,10 @@ class MI_Sint64A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            len = struct.unpack('@i', buf)[0]
+            len = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(len))
             for _ in range(len):
-                buf = fd.recv(8)
-                val = struct.unpack('@q', buf)[0]
+                val = fd.unpack('@q')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Sint64A(vals)
@@ -1410,12 +1458,10 @@ class MI_Real32A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(4)
-                val = struct.unpack('@f', buf)[0]
+                val = fd.unpack('@f')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Real32A(vals)
@@ -1455,12 +1501,10 @@ class MI_Real64A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
-                buf = fd.recv(8)
-                val = struct.unpack('@d', buf)[0]
+                val = fd.unpack('@d')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Real64A(vals)
@@ -1500,12 +1544,10 @@ class MI_Char16A(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for i in range(length):
-                buf = fd.recv(2)
-                val = struct.unpack('@H', buf)[0]
+                val = fd.unpack('@H')[0]
                 verbose_trace('  value: ' + str(val))
                 vals.append(val)
         rval = MI_Char16A(vals)
@@ -1536,8 +1578,7 @@ class MI_DatetimeA(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
                 val = MI_Datetime.read_data(fd)
@@ -1577,8 +1618,7 @@ class MI_StringA(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for i in range(length):
                 strg = read_string(fd)
@@ -1620,8 +1660,7 @@ class MI_InstanceA(MI_Value):
         vals = None
         if 0 == (MI_NULL_FLAG & flags):
             vals = []
-            buf = fd.recv(4)
-            length = struct.unpack('@i', buf)[0]
+            length = fd.unpack('@i')[0]
             verbose_trace('  len:' + str(length))
             for _ in range(length):
                 val = read_values(fd)
@@ -1630,3 +1669,25 @@ class MI_InstanceA(MI_Value):
         rval = MI_InstanceA(vals)
         verbose_trace('</MI_InstanceA.read>')
         return rval
+
+
+class InstanceGenerator:
+    """ Iterable that calls produce() afresh for every pass over it."""
+    def __init__(self, produce):
+        self.produce = produce
+
+    def __iter__(self):
+        return iter(self.produce())
+
+
+class MI_InstanceStream(MI_InstanceA):
+    """ An MI_InstanceA whose instances are generated on demand by produce.
+        client.py sends an Inventory result of this type a slice at a time,
+        so the provider never holds the whole list.  Anywhere else it is
+        written like an MI_InstanceA holding everything produce yields."""
+    def __init__(self, produce):
+        MI_Value.__init__(self, MI_INSTANCEA)
+        self.value = InstanceGenerator(produce)
+
+    def write(self, fd):
+        MI_InstanceA(list(self.value)).write(fd)
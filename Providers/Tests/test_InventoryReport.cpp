@@ -0,0 +1,245 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+// Checks that a report written by InventoryReport one chunk at a time is
+// byte-identical to a single serialization of the whole inventory result.
+#include "InventoryReport.hpp"
+
+#include <xmlserializer/xmlserializer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+
+namespace
+{
+
+
+// the slice size client.py uses for INVENTORY_CHUNK frames
+size_t const CHUNK_SIZE = 256;
+
+char const CLASS_NAME[] = "MSFT_nxTestResource";
+char const ITEM_CLASS_NAME[] = "MSFT_nxTestInventoryItem";
+
+
+// Builds the instance PythonProvider::inventory decodes from a frame: its
+// __Inventory holds items [begin, end).
+MI_Instance*
+newResult (
+    MI_Application* const pApplication,
+    std::vector<MI_Instance*> const& items,
+    size_t const begin,
+    size_t const end)
+{
+    MI_Instance* pResult = NULL;
+    if (MI_RESULT_OK != MI_Application_NewInstance (
+            pApplication, CLASS_NAME, NULL, &pResult))
+    {
+        return NULL;
+    }
+    MI_Value value;
+    value.instancea.data = begin < end
+        ? const_cast<MI_Instance**> (&items[begin]) : NULL;
+    value.instancea.size = static_cast<MI_Uint32> (end - begin);
+    if (MI_RESULT_OK != MI_Instance_AddElement (
+            pResult, "__Inventory", &value, MI_INSTANCEA, 0))
+    {
+        MI_Instance_Delete (pResult);
+        return NULL;
+    }
+    return pResult;
+}
+
+
+int
+serialize (
+    MI_Application* const pApplication,
+    MI_Instance const* const pInstance,
+    std::string* const pTextOut)
+{
+    MI_Serializer serializer;
+    if (MI_RESULT_OK != XmlSerializer_Create (
+            pApplication, 0, "MI_XML", &serializer))
+    {
+        return EXIT_FAILURE;
+    }
+    MI_Uint32 needed = 0;
+    std::vector<MI_Uint8> buffer (1);
+    MI_Result result = XmlSerializer_SerializeInstance (
+        &serializer, 0, pInstance, &buffer[0],
+        static_cast<MI_Uint32> (buffer.size ()), &needed);
+    if (MI_RESULT_OK != result && buffer.size () < needed)
+    {
+        buffer.resize (needed);
+        result = XmlSerializer_SerializeInstance (
+            &serializer, 0, pInstance, &buffer[0],
+            static_cast<MI_Uint32> (buffer.size ()), &needed);
+    }
+    XmlSerializer_Close (&serializer);
+    if (MI_RESULT_OK != result)
+    {
+        return EXIT_FAILURE;
+    }
+    pTextOut->assign (reinterpret_cast<char const*> (&buffer[0]), needed);
+    return EXIT_SUCCESS;
+}
+
+
+int
+checkReport (
+    MI_Application* const pApplication,
+    char const* const directory,
+    size_t const count)
+{
+    std::vector<MI_Instance*> items;
+    int rval = EXIT_SUCCESS;
+    for (size_t i = 0; EXIT_SUCCESS == rval && i < count; ++i)
+    {
+        MI_Instance* pItem = NULL;
+        std::ostringstream name;
+        name << "item" << i;
+        std::string const nameText (name.str ());
+        MI_Value value;
+        value.string = const_cast<MI_Char*> (nameText.c_str ());
+        if (MI_RESULT_OK == MI_Application_NewInstance (
+                pApplication, ITEM_CLASS_NAME, NULL, &pItem))
+        {
+            items.push_back (pItem);
+            if (MI_RESULT_OK != MI_Instance_AddElement (
+                    pItem, "Name", &value, MI_STRING, 0))
+            {
+                rval = EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            rval = EXIT_FAILURE;
+        }
+    }
+
+    // the whole result in one serialization
+    std::string expected;
+    if (EXIT_SUCCESS == rval)
+    {
+        MI_Instance* const pWhole = newResult (pApplication, items, 0, count);
+        rval = NULL != pWhole
+            ? serialize (pApplication, pWhole, &expected) : EXIT_FAILURE;
+        if (NULL != pWhole)
+        {
+            MI_Instance_Delete (pWhole);
+        }
+    }
+
+    // the same result one chunk at a time, the way client.py frames it: full
+    // slices first, then a final frame with the rest (possibly empty only when
+    // the whole result is)
+    std::string actual;
+    if (EXIT_SUCCESS == rval)
+    {
+        scx::InventoryReport report ("nxTest", directory);
+        size_t begin = 0;
+        do
+        {
+            size_t const end =
+                count - begin > CHUNK_SIZE ? begin + CHUNK_SIZE : count;
+            MI_Instance* const pChunk =
+                newResult (pApplication, items, begin, end);
+            rval = NULL != pChunk ? report.write (*pChunk) : EXIT_FAILURE;
+            if (NULL != pChunk)
+            {
+                MI_Instance_Delete (pChunk);
+            }
+            begin = end;
+        } while (EXIT_SUCCESS == rval && begin < count);
+        if (EXIT_SUCCESS == rval)
+        {
+            rval = report.commit ();
+        }
+        if (EXIT_SUCCESS == rval)
+        {
+            std::ifstream file (report.path ().c_str (), std::ios::binary);
+            actual.assign (std::istreambuf_iterator<char> (file),
+                           std::istreambuf_iterator<char> ());
+            unlink (report.path ().c_str ());
+        }
+    }
+
+    for (size_t i = 0; i < items.size (); ++i)
+    {
+        MI_Instance_Delete (items[i]);
+    }
+
+    if (EXIT_SUCCESS != rval)
+    {
+        std::cerr << "FAILED: " << count << " instances: could not write the "
+                  << "report" << std::endl;
+    }
+    else if (expected != actual)
+    {
+        std::cerr << "FAILED: " << count << " instances: the chunked report "
+                  << "differs from a single serialization" << std::endl;
+        rval = EXIT_FAILURE;
+    }
+    else
+    {
+        std::cout << "passed: " << count << " instances" << std::endl;
+    }
+    return rval;
+}
+
+
+} // namespace (unnamed)
+
+
+int
+main ()
+{
+    size_t const counts[] = { 0, 1, 256, 257, 513 };
+    char directory[] = "/tmp/InventoryReportXXXXXX";
+    if (NULL == mkdtemp (directory))
+    {
+        std::cerr << "FAILED: mkdtemp" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const prefix = std::string (directory) + '/';
+
+    MI_Application application;
+    if (MI_RESULT_OK != MI_Application_Initialize (0, NULL, NULL, &application))
+    {
+        std::cerr << "FAILED: MI_Application_Initialize" << std::endl;
+        rmdir (directory);
+        return EXIT_FAILURE;
+    }
+    int rval = EXIT_SUCCESS;
+    for (size_t i = 0; i < sizeof (counts) / sizeof (counts[0]); ++i)
+    {
+        if (EXIT_SUCCESS != checkReport (
+                &application, prefix.c_str (), counts[i]))
+        {
+            rval = EXIT_FAILURE;
+        }
+    }
+    MI_Application_Close (&application);
+    rmdir (directory);
+    return rval;
+}
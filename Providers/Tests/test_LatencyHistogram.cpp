@@ -0,0 +1,133 @@
+/*
+   PowerShell Desired State Configuration for Linux
+
+   Copyright (c) Microsoft Corporation
+
+   All rights reserved. 
+
+   MIT License
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the ""Software""), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED *AS IS*, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+// Checks that LatencyHistogram buckets calls by duration and that the
+// histogram line reaches the verbose channel of the MI_Context, which the
+// LCM copies into dsc.log.
+#include "LatencyHistogram.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+
+// stands in for the LCM's NativeResourceHostMiContext, only WriteMessage is
+// reachable from MI_Context_WriteVerbose
+struct FakeContext
+{
+    MI_Context context;
+    MI_ContextFT ft;
+    std::vector<MI_Uint32> channels;
+    std::vector<std::string> messages;
+};
+
+
+MI_Result MI_CALL
+fakeWriteMessage (
+    MI_Context* pContext,
+    MI_Uint32 channel,
+    MI_Char const* message)
+{
+    FakeContext* const pFake = reinterpret_cast<FakeContext*> (pContext);
+    pFake->channels.push_back (channel);
+    pFake->messages.push_back (message);
+    return MI_RESULT_OK;
+}
+
+
+int
+testBuckets ()
+{
+    scx::LatencyHistogram histogram;
+    histogram.record (0);
+    histogram.record (10);
+    histogram.record (11);
+    histogram.record (900000);
+    histogram.record (900001);
+    histogram.record (3600000);
+    unsigned long const expected[scx::LatencyHistogram::BUCKET_COUNT + 1] =
+        { 2, 1, 0, 0, 0, 0, 0, 1, 2 };
+    for (size_t n = 0; scx::LatencyHistogram::BUCKET_COUNT >= n; ++n)
+    {
+        if (expected[n] != histogram.count (n))
+        {
+            std::cerr << "FAILED: bucket " << n << " holds "
+                      << histogram.count (n) << " calls, expected "
+                      << expected[n] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+
+int
+testWrite ()
+{
+    FakeContext fake;
+    memset (&fake.context, 0, sizeof (fake.context));
+    memset (&fake.ft, 0, sizeof (fake.ft));
+    fake.ft.WriteMessage = fakeWriteMessage;
+    fake.context.ft = &fake.ft;
+
+    scx::LatencyHistogram histogram;
+    histogram.record (5);
+    histogram.record (2000);
+    histogram.record (1000000);
+    if (MI_RESULT_OK != histogram.write (&fake.context, "nxFile Test"))
+    {
+        std::cerr << "FAILED: write" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string const expected =
+        "nxFile Test latency histogram: <=10ms:1 <=100ms:0 <=1000ms:0 "
+        "<=5000ms:1 <=30000ms:0 <=60000ms:0 <=300000ms:0 <=900000ms:0 "
+        ">900000ms:1";
+    if (1 != fake.messages.size () ||
+        MI_WRITEMESSAGE_CHANNEL_VERBOSE != fake.channels[0] ||
+        expected != fake.messages[0])
+    {
+        std::cerr << "FAILED: the histogram was not written to the verbose "
+                  << "channel as \"" << expected << '\"' << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (MI_RESULT_OK == histogram.write (0, "nxFile Test"))
+    {
+        std::cerr << "FAILED: write without a context" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+} // namespace (unnamed)
+
+
+int
+main ()
+{
+    int rval = testBuckets ();
+    if (EXIT_SUCCESS == rval)
+    {
+        rval = testWrite ();
+    }
+    return rval;
+}
@@ -199,7 +199,8 @@ void MI_CALL MSFT_nxArchiveResource_Invoke_TestTargetResource(
     if (self)
     {
         MI_Boolean testResult = MI_FALSE;
-        result = self->test (in->InputResource.value->__instance, &testResult);
+        result = self->test (in->InputResource.value->__instance, context,
+                             &testResult);
         if (MI_RESULT_OK == result)
         {
             MSFT_nxArchiveResource_TestTargetResource out;
@@ -227,7 +228,8 @@ void MI_CALL MSFT_nxArchiveResource_Invoke_SetTargetResource(
     if (self)
     {
         MI_Result setResult = MI_RESULT_FAILED;
-        result = self->set (in->InputResource.value->__instance, &setResult);
+        result = self->set (in->InputResource.value->__instance, context,
+                            &setResult);
         if (MI_RESULT_OK == result)
         {
             result = setResult;
@@ -198,7 +198,7 @@ void MI_CALL MSFT_nxLogResource_Invoke_TestTargetResource(
     if (self)
     {
         MI_Boolean testResult = MI_FALSE;
-        result = self->test (in->InputResource.value, &testResult);
+        result = self->test (in->InputResource.value, context, &testResult);
         if (MI_RESULT_OK == result)
         {
             MSFT_nxLogResource_TestTargetResource out;
@@ -226,7 +226,7 @@ void MI_CALL MSFT_nxLogResource_Invoke_SetTargetResource(
     if (self)
     {
         MI_Result setResult = MI_RESULT_FAILED;
-        result = self->set (in->InputResource.value, &setResult);
+        result = self->set (in->InputResource.value, context, &setResult);
         if (MI_RESULT_OK == result)
         {
             result = setResult;
@@ -5,8 +5,8 @@
 #include "debug_tags.hpp"
 #include "MI.h"
 #include <common/common.h>
-#include <xmlserializer/xmlserializer.h>
 #include "PythonProvider.hpp"
+#include "InventoryReport.hpp"
 #include <dsc_config.h>
 
 #include <cstdlib>
@@ -205,102 +205,19 @@ void MI_CALL MSFT_nxServiceResource_Invoke_InventoryTargetResource(
 	MI_NewDynamicInstance (
                 context, className,
                 0, &retInstance);
+        scx::InventoryReport report ("nxService");
         result = self->inventory (in->InputResource.value->__instance, context,
-                            retInstance);
+                            retInstance, report);
         if (MI_RESULT_OK == result)
         {
             SCX_BOOKEND_PRINT ("packing succeeded!");
             MSFT_nxServiceResource_InventoryTargetResource out;
             MSFT_nxServiceResource_InventoryTargetResource_Construct (&out, context);
             MSFT_nxServiceResource_InventoryTargetResource_Set_MIReturn (&out, 0);
-
-	    {
-		const MI_Uint32 c_initBufferLength = 1000000;
-		MI_Application application;
-		MI_Serializer serializer;
-		MI_Uint8 *clientBuffer;
-		MI_Uint32 clientBufferLength = c_initBufferLength;
-		MI_Uint32 clientBufferNeeded = 0;
-		FILE *fp = NULL;
-		const char * reportTemplateBase = DSC_ETC_PATH "/InventoryReports/nxService_XXXXXX";
-		
-		clientBuffer = (MI_Uint8*)malloc(clientBufferLength + 1);
-        if(clientBuffer == NULL) {
-            return;
-        }
-        if(MI_Application_Initialize(0,NULL,NULL, &application) != MI_RESULT_OK) {
-            memset(&application, 0, sizeof(MI_Application));
-            free(clientBuffer);
-            MI_Application_Close(&application);
-            return;
-        }
-		result = XmlSerializer_Create(&application, 0, "MI_XML", &serializer);
-		if (result != MI_RESULT_OK)
-		{
-            free(clientBuffer);
-		    MI_Application_Close(&application);
-		    MI_Context_PostResult (context, result);
-		    return;
-		}
-		
-		result = XmlSerializer_SerializeInstance( &serializer, 0, retInstance, clientBuffer, clientBufferLength, &clientBufferNeeded);
-		if (result != MI_RESULT_OK)
-		{
-		    free(clientBuffer);
-		    if (clientBufferNeeded > 0)
-		    {
-			// Try again with a buffer given to us by the clientBufferNeeded field
-			clientBufferLength = clientBufferNeeded;
-			clientBuffer = (MI_Uint8*)malloc(clientBufferLength + 1);
-            if(clientBuffer == NULL) {
-                return;
-            }
-			result = XmlSerializer_SerializeInstance( &serializer, 0, retInstance, clientBuffer, clientBufferLength, &clientBufferNeeded);
-		    }
-		    else
-		    {
-			XmlSerializer_Close(&serializer);
-			MI_Application_Close(&application);
-			MI_Context_PostResult (context, result);
-			return;
-		    }
-		}
-		
-		XmlSerializer_Close(&serializer);
-		MI_Application_Close(&application);
-		if (result == MI_RESULT_OK)
-		{
-		    clientBuffer[clientBufferNeeded] = '\0';
-		    printf("%s", (char*)clientBuffer);
-		}
-		
-		{
-		    char * reportTemplate = (char*)malloc(strlen(reportTemplateBase) + 1);
-            if(reportTemplate == NULL) {
-                return;
+            if (EXIT_SUCCESS != report.commit ())
+            {
+                SCX_BOOKEND_PRINT ("failed to write the inventory report");
             }
-		    strcpy(reportTemplate, reportTemplateBase);
-		    int fd = mkstemp(reportTemplate);
-		    if (fd == -1)
-		    {
-			std::cerr << std::endl << "Error running mkstemp, errno = " << errno << std::endl;
-		    }
-		    fp = fdopen(fd, "w");
-		    if( fp != NULL )
-		    {
-			fwrite(clientBuffer, 1, clientBufferNeeded, fp);
-			fclose(fp);
-		    }
-		    else
-		    {
-			std::cerr << std::endl << "Error opening file descriptor for reportTemplate, errno = " << errno << std::endl;
-		    }
-		    free(reportTemplate);
-		}
-		
-		free(clientBuffer);
-	    }
-
             result = MSFT_nxServiceResource_InventoryTargetResource_Post (&out, context);
             if (MI_RESULT_OK != result)
             {
@@ -330,7 +247,8 @@ void MI_CALL MSFT_nxServiceResource_Invoke_TestTargetResource(
     if (self)
     {
         MI_Boolean testResult = MI_FALSE;
-        result = self->test (in->InputResource.value->__instance, &testResult);
+        result = self->test (in->InputResource.value->__instance, context,
+                             &testResult);
         if (MI_RESULT_OK == result)
         {
             MSFT_nxServiceResource_TestTargetResource out;
@@ -358,7 +276,8 @@ void MI_CALL MSFT_nxServiceResource_Invoke_SetTargetResource(
     if (self)
     {
         MI_Result setResult = MI_RESULT_FAILED;
-        result = self->set (in->InputResource.value->__instance, &setResult);
+        result = self->set (in->InputResource.value->__instance, context,
+                            &setResult);
         if (MI_RESULT_OK == result)
         {
             result = setResult;